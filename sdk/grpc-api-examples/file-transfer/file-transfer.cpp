@@ -0,0 +1,436 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+// Render file transfer: runs on the Octane host and gives remote clients the files of
+// saveRenderPassesDeepExr, saveDeepImage and saveRenderState, and accepts render state files for
+// loadRenderState. Octane only reads and writes those on its own file system, so the service calls
+// it with a temporary file, streams the file contents in chunks (render_file_transfer.proto) and
+// deletes the file again. Clients use RenderFileTransferSdk (shared/render_file_transfer_sdk.h).
+//
+//   octane_filetransfer [--address host:port] [--upstream host:port] [--temp-dir path] [--chunk-size N]
+
+// system headers
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+// protoc generated headers
+#include "apirender.grpc.pb.h"
+#include "render_file_transfer.grpc.pb.h"
+
+using octanefiletransfer::FileChunk;
+
+
+//--------------------------------------------------------------------------------------------------
+/// Settings of the service.
+struct TransferSettings
+{
+    /// Clients are on other machines, listen on all interfaces.
+    std::string mAddress       = "0.0.0.0:50053";
+    std::string mUpstream      = "127.0.0.1:50051";
+    std::string mTempDir       = (std::filesystem::temp_directory_path() / "octane_filetransfer").string();
+    /// Bytes per chunk unless the client asks for another size. Chunks stay below the 4 MB
+    /// default message limit of gRPC.
+    uint32_t    mChunkSize     = 1024 * 1024;
+    uint32_t    mMaxChunkSize  = 2 * 1024 * 1024;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/// Temporary files of the service. Only files created here can be released by clients.
+
+class TempFiles
+{
+public:
+    explicit TempFiles(
+        const std::string & directory)
+    :
+        mDirectory(directory)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(mDirectory, error);
+    }
+
+    ~TempFiles()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const std::string & path : mFiles)
+        {
+            std::error_code error;
+            std::filesystem::remove(path, error);
+        }
+    }
+
+    /// New unique path with the extension of the given name.
+    std::string create(
+        const std::string & nameHint)
+    {
+        const std::string extension = std::filesystem::path(nameHint).extension().string();
+        const std::string name = "transfer_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) +
+                                 "_" + std::to_string(mNext++) + extension;
+        const std::string path = (std::filesystem::path(mDirectory) / name).string();
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFiles.insert(path);
+        return path;
+    }
+
+    bool release(
+        const std::string & path)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mFiles.erase(path) == 0)
+            {
+                return false;
+            }
+        }
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return true;
+    }
+
+private:
+    const std::string     mDirectory;
+    std::atomic<uint64_t> mNext{ 0 };
+    std::mutex            mMutex;
+    std::set<std::string> mFiles;
+};
+
+
+/// Deletes a temporary file when a download is done, however it ended.
+class ScopedTempFile
+{
+public:
+    ScopedTempFile(
+        TempFiles &         files,
+        const std::string & nameHint)
+    :
+        mFiles(files),
+        mPath(files.create(nameHint))
+    {}
+
+    ~ScopedTempFile() { mFiles.release(mPath); }
+
+    const std::string & path() const { return mPath; }
+
+private:
+    TempFiles &       mFiles;
+    const std::string mPath;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+// Service
+
+class RenderFileTransferService final : public octanefiletransfer::RenderFileTransfer::Service
+{
+public:
+    explicit RenderFileTransferService(
+        const TransferSettings & settings)
+    :
+        mSettings(settings),
+        mTempFiles(settings.mTempDir),
+        mChannel(grpc::CreateChannel(settings.mUpstream, grpc::InsecureChannelCredentials())),
+        mRenderStub(octaneapi::ApiRenderEngineService::NewStub(mChannel))
+    {}
+
+    grpc::Status saveRenderPassesDeepExr(
+        grpc::ServerContext *                                           context,
+        const octanefiletransfer::SaveRenderPassesDeepExrRequest *      request,
+        grpc::ServerWriter<FileChunk> *                                 writer) override
+    {
+        // the Octane request holds a single pass, the same as ApiRenderEngineProxy sends, so
+        // more would be dropped without notice
+        if (request->passestoexport_size() > 1)
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                std::to_string(request->passestoexport_size()) +
+                                " passes to export, Octane takes at most one per deep EXR");
+        }
+        ScopedTempFile file(mTempFiles, "deep.exr");
+        octaneapi::ApiRenderEngine::saveRenderPassesDeepExrRequest upstreamRequest;
+        upstreamRequest.set_fullpath(file.path());
+        if (request->passestoexport_size() == 1)
+        {
+            octaneapi::RenderPassExport * pass = upstreamRequest.mutable_passestoexport();
+            pass->set_renderpassid(static_cast<octaneapi::RenderPassId>(request->passestoexport(0).renderpassid()));
+            pass->set_exportname(request->passestoexport(0).exportname());
+            upstreamRequest.set_passestoexportlength(1);
+        }
+        upstreamRequest.set_colorspace(static_cast<octaneapi::NamedColorSpace>(request->colorspace()));
+        upstreamRequest.set_compressiontype(static_cast<octaneapi::ExrCompressionType>(request->compressiontype()));
+        for (const std::string & value : request->metadata())
+        {
+            upstreamRequest.mutable_metadata()->add_data(value);
+        }
+        upstreamRequest.set_metadatalength((uint32_t)request->metadata_size());
+        // the file has to be complete before it is streamed
+        upstreamRequest.set_asynchronous(false);
+
+        octaneapi::ApiRenderEngine::saveRenderPassesDeepExrResponse upstreamResponse;
+        grpc::ClientContext upstreamContext;
+        const grpc::Status status = mRenderStub->saveRenderPassesDeepExr(&upstreamContext, upstreamRequest, &upstreamResponse);
+        if (!status.ok())
+        {
+            return status;
+        }
+        if (!upstreamResponse.result())
+        {
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Octane didn't save the deep passes, see its log");
+        }
+        return streamFile(context, file.path(), request->chunksize(), *writer);
+    }
+
+    grpc::Status saveDeepImage(
+        grpc::ServerContext *                                           context,
+        const octanefiletransfer::SaveDeepImageRequest *                request,
+        grpc::ServerWriter<FileChunk> *                                 writer) override
+    {
+        ScopedTempFile file(mTempFiles, "deep.exr");
+        octaneapi::ApiRenderEngine::saveDeepImageRequest upstreamRequest;
+        upstreamRequest.set_fullpath(file.path());
+        upstreamRequest.set_colorspace(static_cast<octaneapi::NamedColorSpace>(request->colorspace()));
+        upstreamRequest.set_saveasync(false);
+
+        octaneapi::ApiRenderEngine::saveDeepImageResponse upstreamResponse;
+        grpc::ClientContext upstreamContext;
+        const grpc::Status status = mRenderStub->saveDeepImage(&upstreamContext, upstreamRequest, &upstreamResponse);
+        if (!status.ok())
+        {
+            return status;
+        }
+        if (!upstreamResponse.result())
+        {
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Octane didn't save the deep image, see its log");
+        }
+        return streamFile(context, file.path(), request->chunksize(), *writer);
+    }
+
+    grpc::Status saveRenderState(
+        grpc::ServerContext *                                           context,
+        const octanefiletransfer::SaveRenderStateRequest *              request,
+        grpc::ServerWriter<FileChunk> *                                 writer) override
+    {
+        ScopedTempFile file(mTempFiles, "render_state");
+        octaneapi::ApiRenderEngine::saveRenderStateRequest upstreamRequest;
+        upstreamRequest.set_renderstatefilename(file.path());
+        upstreamRequest.set_customprojectfilename(request->customprojectfilename());
+        upstreamRequest.set_customprojecttime(request->customprojecttime());
+        upstreamRequest.set_customversion(request->customversion());
+        upstreamRequest.set_customdata(0);
+        upstreamRequest.set_customdatasize(0);
+
+        octaneapi::ApiRenderEngine::saveRenderStateResponse upstreamResponse;
+        grpc::ClientContext upstreamContext;
+        const grpc::Status status = mRenderStub->saveRenderState(&upstreamContext, upstreamRequest, &upstreamResponse);
+        if (!status.ok())
+        {
+            return status;
+        }
+        if (!upstreamResponse.result())
+        {
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Octane didn't save the render state, see its log");
+        }
+        return streamFile(context, file.path(), request->chunksize(), *writer);
+    }
+
+    /// The file stays until the client released it, or the service exits.
+    grpc::Status loadRenderState(
+        grpc::ServerContext *                                           context,
+        grpc::ServerReader<FileChunk> *                                 reader,
+        octanefiletransfer::UploadedFile *                              response) override
+    {
+        FileChunk chunk;
+        if (!reader->Read(&chunk))
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "no data");
+        }
+        const uint64_t totalSize = chunk.totalsize();
+        const std::string path = mTempFiles.create(chunk.filename());
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        uint64_t received = 0;
+        do
+        {
+            received += chunk.data().size();
+            if (received > totalSize)
+            {
+                mTempFiles.release(path);
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "more data than announced");
+            }
+            file.write(chunk.data().data(), (std::streamsize)chunk.data().size());
+        }
+        while (file && reader->Read(&chunk));
+
+        file.close();
+        if (!file || received != totalSize)
+        {
+            mTempFiles.release(path);
+            return !file ? grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "can't write " + path)
+                         : grpc::Status(grpc::StatusCode::CANCELLED, "upload ended early");
+        }
+        response->set_path(path);
+        response->set_size(received);
+        mUploads += 1;
+        mUploadedBytes += received;
+        return grpc::Status::OK;
+    }
+
+    grpc::Status releaseUpload(
+        grpc::ServerContext *                                           context,
+        const octanefiletransfer::UploadedFile *                        request,
+        google::protobuf::Empty *                                       response) override
+    {
+        if (!mTempFiles.release(request->path()))
+        {
+            return grpc::Status(grpc::StatusCode::NOT_FOUND, "not an upload of this service");
+        }
+        return grpc::Status::OK;
+    }
+
+    void printReport(
+        std::ostream & out) const
+    {
+        out << "[Transfer] " << mDownloads << " downloads (" << mDownloadedBytes / (1024 * 1024) << " MB), "
+            << mUploads << " uploads (" << mUploadedBytes / (1024 * 1024) << " MB)\n";
+    }
+
+private:
+    grpc::Status streamFile(
+        grpc::ServerContext *           context,
+        const std::string &             path,
+        uint32_t                        requestedChunkSize,
+        grpc::ServerWriter<FileChunk> & writer)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::error_code error;
+        const uint64_t totalSize = file ? std::filesystem::file_size(path, error) : 0;
+        if (!file || error)
+        {
+            return grpc::Status(grpc::StatusCode::INTERNAL, "Octane reported success but there is no file");
+        }
+        const size_t chunkSize = std::min(requestedChunkSize > 0 ? requestedChunkSize : mSettings.mChunkSize,
+                                          mSettings.mMaxChunkSize);
+
+        FileChunk chunk;
+        chunk.set_totalsize(totalSize);
+        uint64_t sent = 0;
+        do
+        {
+            std::string * data = chunk.mutable_data();
+            data->resize(std::min<uint64_t>(chunkSize, totalSize - sent));
+            if (!data->empty() && !file.read(&(*data)[0], (std::streamsize)data->size()))
+            {
+                return grpc::Status(grpc::StatusCode::INTERNAL, "can't read " + path);
+            }
+            if (context->IsCancelled() || !writer.Write(chunk))
+            {
+                return grpc::Status(grpc::StatusCode::CANCELLED, "client went away");
+            }
+            sent += data->size();
+            chunk.clear_totalsize();
+        }
+        while (sent < totalSize);
+
+        mDownloads += 1;
+        mDownloadedBytes += sent;
+        return grpc::Status::OK;
+    }
+
+    const TransferSettings                                      mSettings;
+    TempFiles                                                   mTempFiles;
+    std::shared_ptr<grpc::Channel>                              mChannel;
+    std::unique_ptr<octaneapi::ApiRenderEngineService::Stub>    mRenderStub;
+    std::atomic<uint64_t>                                       mDownloads{ 0 };
+    std::atomic<uint64_t>                                       mDownloadedBytes{ 0 };
+    std::atomic<uint64_t>                                       mUploads{ 0 };
+    std::atomic<uint64_t>                                       mUploadedBytes{ 0 };
+};
+
+
+//--------------------------------------------------------------------------------------------------
+
+static std::atomic<bool> gStopRequested{ false };
+
+static void onSignal(
+    int)
+{
+    gStopRequested = true;
+}
+
+
+int main(
+    int    argc,
+    char * argv[])
+{
+    TransferSettings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        const char * value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            std::cout << "Usage: octane_filetransfer [--address host:port] [--upstream host:port] "
+                         "[--temp-dir path] [--chunk-size N]\n";
+            return 1;
+        }
+        if (option == "--address")
+        {
+            settings.mAddress = value;
+        }
+        else if (option == "--upstream")
+        {
+            settings.mUpstream = value;
+        }
+        else if (option == "--temp-dir")
+        {
+            settings.mTempDir = value;
+        }
+        else if (option == "--chunk-size")
+        {
+            settings.mChunkSize = std::min((uint32_t)std::max(4096, std::atoi(value)), settings.mMaxChunkSize);
+        }
+        else
+        {
+            std::cout << "Unknown option " << option << "\n";
+            return 1;
+        }
+        ++i;
+    }
+
+    std::unique_ptr<RenderFileTransferService> service = std::make_unique<RenderFileTransferService>(settings);
+
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(settings.mAddress, grpc::InsecureServerCredentials());
+    builder.RegisterService(service.get());
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    if (!server)
+    {
+        std::cerr << "[Transfer] can't listen on " << settings.mAddress << "\n";
+        return 1;
+    }
+
+    std::cout << "[Transfer] files of " << settings.mUpstream << " on " << settings.mAddress
+              << ", temporary files in " << settings.mTempDir << "\n";
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    while (!gStopRequested)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+    service->printReport(std::cout);
+    // removes uploads that were never released
+    service.reset();
+    return 0;
+}
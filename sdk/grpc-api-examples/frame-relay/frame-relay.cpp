@@ -0,0 +1,803 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+// Local frame relay: subscribes once to the callback stream of Octane, fetches every new frame
+// once and re-publishes it to any number of local viewers. Viewers use the relay address for the
+// frame calls (callbackChannel, setOnNewImageCallback, grabRenderResult, releaseRenderResult,
+// setAsyncTonemapParams1, asyncTonemapBufferType) and keep talking to Octane for everything
+// else, so the frame traffic of Octane stays the same however many viewers are watching.
+//
+// Every viewer (identified by its connection) has
+// - a credit window: the number of new image notifications it may leave unanswered. Frames
+//   published while it is out of credit are coalesced, the next grab returns the newest frame
+//   and refills the window. A stalled viewer therefore costs nothing and slows nobody down.
+// - an encoding: the buffer type it asked for with setAsyncTonemapParams1. The relay converts
+//   the upstream frame (run it with --hdr to have Octane send float frames) once per frame and
+//   encoding, and serializes each encoded frame once for all viewers that share it.
+
+// system headers
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// protoc generated headers
+#include "apirender.grpc.pb.h"
+#include "callbackstream.grpc.pb.h"
+// shared helpers
+#include "../../../shared/pixel_convert.h"
+#include "../../../shared/display_lut.h"
+
+typedef octaneapi::ApiRenderEngine::grabRenderResultResponse GrabResponse;
+
+
+//--------------------------------------------------------------------------------------------------
+/// Settings of the relay.
+struct RelaySettings
+{
+    std::string mAddress         = "127.0.0.1:50052";
+    std::string mUpstream        = "127.0.0.1:50051";
+    /// New image notifications a viewer may leave unanswered.
+    uint32_t    mCredits         = 2;
+    /// Ask Octane for float frames, so viewers can choose between LDR and HDR.
+    bool        mRequestHdr      = false;
+    /// Seconds between two statistics reports, 0 reports only on exit.
+    double      mReportInterval  = 10.0;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/// Encoding of frames
+
+static bool isRgba(
+    octaneapi::ImageType type)
+{
+    return type == octaneapi::IMAGE_TYPE_LDR_RGBA ||
+           type == octaneapi::IMAGE_TYPE_HDR_RGBA ||
+           type == octaneapi::IMAGE_TYPE_HALF_RGBA;
+}
+
+
+static octaneapi::ImageType rgbaType(
+    octaneapi::TonemapBufferType bufferType)
+{
+    switch (bufferType)
+    {
+        case octaneapi::TONEMAP_BUFFER_TYPE_HDR_FLOAT: return octaneapi::IMAGE_TYPE_HDR_RGBA;
+        case octaneapi::TONEMAP_BUFFER_TYPE_HDR_HALF:  return octaneapi::IMAGE_TYPE_HALF_RGBA;
+        default:                                       return octaneapi::IMAGE_TYPE_LDR_RGBA;
+    }
+}
+
+
+/// Converts one RGBA image to the wanted type, false if it is passed on as it is. LDR images
+/// can't be turned into HDR ones and mono images are never converted.
+static bool encodeImage(
+    const octaneapi::ApiRenderImage & source,
+    octaneapi::ImageType              type,
+    octaneapi::ApiRenderImage &       out)
+{
+    using SharedUtils::PixelConvert::PixelFormat;
+
+    const octaneapi::ImageType sourceType = source.type();
+    if (sourceType == type || !isRgba(sourceType) || sourceType == octaneapi::IMAGE_TYPE_LDR_RGBA)
+    {
+        return false;
+    }
+
+    const uint32_t width  = source.size().x();
+    const uint32_t height = source.size().y();
+    const size_t   srcBpp = SharedUtils::PixelConvert::bytesPerPixel(static_cast<PixelFormat>(sourceType));
+    const size_t   srcPitch = (size_t)source.pitch() * srcBpp;
+    const std::string & src = source.buffer().data();
+    if (width == 0 || height == 0 || src.size() < srcPitch * (height - 1) + width * srcBpp)
+    {
+        return false;
+    }
+
+    // half frames are expanded to float first
+    std::vector<float> expanded;
+    const float * floats = reinterpret_cast<const float*>(src.data());
+    size_t floatPitch = srcPitch;
+    if (sourceType == octaneapi::IMAGE_TYPE_HALF_RGBA)
+    {
+        expanded.resize((size_t)width * height * 4);
+        SharedUtils::PixelConvert::forEachRowRange(width, height, [&](uint32_t first, uint32_t end)
+        {
+            for (uint32_t y = first; y < end; ++y)
+            {
+                SharedUtils::PixelConvert::halfToFloat(
+                    reinterpret_cast<const uint16_t*>(src.data() + (size_t)y * srcPitch),
+                    expanded.data() + (size_t)y * width * 4,
+                    (size_t)width * 4);
+            }
+        });
+        floats = expanded.data();
+        floatPitch = (size_t)width * 4 * sizeof(float);
+    }
+
+    out.CopyFrom(source);
+    const size_t dstBpp = SharedUtils::PixelConvert::bytesPerPixel(static_cast<PixelFormat>(type));
+    std::string * dst = out.mutable_buffer()->mutable_data();
+    dst->resize((size_t)width * height * dstBpp);
+    out.mutable_buffer()->set_size((uint32_t)dst->size());
+    out.set_type(type);
+    out.set_pitch(width);
+
+    if (type == octaneapi::IMAGE_TYPE_LDR_RGBA)
+    {
+        // linear float to sRGB, like Octane's own LDR output without a camera response curve
+        SharedUtils::applyDisplayTransform(floats, floatPitch, width, height,
+                                           reinterpret_cast<uint8_t*>(&(*dst)[0]), (size_t)width * 4,
+                                           SharedUtils::DisplaySettings(), nullptr);
+        out.set_colorspace(octaneapi::NAMED_COLOR_SPACE_SRGB);
+        out.set_islinear(false);
+    }
+    else if (type == octaneapi::IMAGE_TYPE_HALF_RGBA)
+    {
+        SharedUtils::PixelConvert::forEachRowRange(width, height, [&](uint32_t first, uint32_t end)
+        {
+            for (uint32_t y = first; y < end; ++y)
+            {
+                SharedUtils::PixelConvert::floatToHalf(
+                    reinterpret_cast<const float*>(reinterpret_cast<const char*>(floats) + (size_t)y * floatPitch),
+                    reinterpret_cast<uint16_t*>(&(*dst)[0]) + (size_t)y * width * 4,
+                    (size_t)width * 4);
+            }
+        });
+    }
+    else
+    {
+        std::memcpy(&(*dst)[0], floats, dst->size());
+    }
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/// A viewer connected to the relay.
+struct Subscriber
+{
+    std::string                  mPeer;
+    bool                         mHasEncoding = false;
+    octaneapi::TonemapBufferType mEncoding    = octaneapi::TONEMAP_BUFFER_TYPE_LDR;
+    /// Notifications sent since the last grab.
+    uint32_t                     mOutstanding = 0;
+    /// Sequence number of the last frame announced.
+    uint64_t                     mAnnounced   = 0;
+    uint32_t                     mStreams     = 0;
+    uint64_t                     mNotified    = 0;
+    uint64_t                     mCoalesced   = 0;
+    uint64_t                     mGrabs       = 0;
+    uint64_t                     mBytes       = 0;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/// The newest frame, its encodings and the viewers.
+class FrameRelay
+{
+public:
+    explicit FrameRelay(
+        uint32_t credits)
+    :
+        mCredits(std::max(1u, credits))
+    {}
+
+    /// Called by the upstream reader for each frame fetched from Octane.
+    void publish(
+        std::shared_ptr<const GrabResponse> frame)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mFrame = std::move(frame);
+            ++mSequence;
+            mEncoded.clear();
+        }
+        mChanged.notify_all();
+    }
+
+    /// True while at least one viewer has a callback stream open, frames are only fetched then.
+    bool hasSubscribers() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStreamCount > 0;
+    }
+
+    std::shared_ptr<Subscriber> openStream(
+        const std::string & peer)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::shared_ptr<Subscriber> subscriber = findOrAdd(peer);
+        ++subscriber->mStreams;
+        ++mStreamCount;
+        // a new stream starts with full credit and is told about the current frame right away
+        subscriber->mOutstanding = 0;
+        subscriber->mAnnounced = 0;
+        return subscriber;
+    }
+
+    void closeStream(
+        const std::shared_ptr<Subscriber> & subscriber)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            --subscriber->mStreams;
+            --mStreamCount;
+        }
+        mChanged.notify_all();
+    }
+
+    /// Blocks until there is a frame to announce and the viewer has credit for it. Returns false
+    /// on timeout or shutdown.
+    bool waitForAnnouncement(
+        Subscriber &              subscriber,
+        std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        const bool ready = mChanged.wait_for(lock, timeout, [&]
+        {
+            return mStopping ||
+                   (mSequence != subscriber.mAnnounced && mFrame && subscriber.mOutstanding < mCredits);
+        });
+        if (!ready || mStopping)
+        {
+            return false;
+        }
+        if (subscriber.mAnnounced != 0)
+        {
+            subscriber.mCoalesced += mSequence - subscriber.mAnnounced - 1;
+        }
+        subscriber.mAnnounced = mSequence;
+        ++subscriber.mOutstanding;
+        ++subscriber.mNotified;
+        return true;
+    }
+
+    /// The newest frame in the encoding of the viewer, serialized. False if there is no frame.
+    bool grab(
+        const std::string & peer,
+        grpc::ByteBuffer &  out)
+    {
+        std::shared_ptr<const GrabResponse> frame;
+        uint64_t sequence;
+        int encoding;
+        std::shared_ptr<Subscriber> subscriber;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mFrame)
+            {
+                return false;
+            }
+            subscriber = findOrAdd(peer);
+            // the newest frame answers all notifications sent so far
+            subscriber->mOutstanding = 0;
+            ++subscriber->mGrabs;
+            encoding = subscriber->mHasEncoding ? (int)subscriber->mEncoding : -1;
+            frame = mFrame;
+            sequence = mSequence;
+            auto it = mEncoded.find(encoding);
+            if (it != mEncoded.end())
+            {
+                out = it->second;
+                subscriber->mBytes += out.Length();
+                mChanged.notify_all();
+                return true;
+            }
+        }
+        mChanged.notify_all();
+
+        // encoded outside the lock, two viewers asking at once may both do it, the first one is kept
+        grpc::ByteBuffer buffer = encode(*frame, encoding);
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (sequence == mSequence)
+        {
+            buffer = mEncoded.emplace(encoding, buffer).first->second;
+        }
+        out = buffer;
+        subscriber->mBytes += out.Length();
+        ++mEncodings;
+        return true;
+    }
+
+    void setEncoding(
+        const std::string &          peer,
+        octaneapi::TonemapBufferType bufferType)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::shared_ptr<Subscriber> subscriber = findOrAdd(peer);
+        subscriber->mHasEncoding = true;
+        subscriber->mEncoding = bufferType;
+    }
+
+    /// The encoding of the viewer, the one of the upstream frames if it never set one.
+    octaneapi::TonemapBufferType encoding(
+        const std::string & peer) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mSubscribers.find(peer);
+        if (it != mSubscribers.end() && it->second->mHasEncoding)
+        {
+            return it->second->mEncoding;
+        }
+        if (mFrame && mFrame->renderimages().data_size() > 0)
+        {
+            switch (mFrame->renderimages().data(0).type())
+            {
+                case octaneapi::IMAGE_TYPE_HDR_RGBA:  return octaneapi::TONEMAP_BUFFER_TYPE_HDR_FLOAT;
+                case octaneapi::IMAGE_TYPE_HALF_RGBA: return octaneapi::TONEMAP_BUFFER_TYPE_HDR_HALF;
+                default: break;
+            }
+        }
+        return octaneapi::TONEMAP_BUFFER_TYPE_LDR;
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mChanged.notify_all();
+    }
+
+    void printReport(
+        std::ostream & out) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        out << "[Relay] " << mSequence << " frames, " << mEncodings << " encodings, " << mStreamCount
+            << " open streams\n";
+        for (const auto & entry : mSubscribers)
+        {
+            const Subscriber & subscriber = *entry.second;
+            out << "[Relay]   " << subscriber.mPeer << (subscriber.mStreams ? "" : " (gone)")
+                << ": " << subscriber.mNotified << " notified, " << subscriber.mCoalesced << " coalesced, "
+                << subscriber.mGrabs << " grabs, " << (subscriber.mBytes >> 20) << " MB, encoding "
+                << (subscriber.mHasEncoding ? std::to_string((int)subscriber.mEncoding) : std::string("upstream"))
+                << "\n";
+        }
+    }
+
+private:
+    std::shared_ptr<Subscriber> findOrAdd(
+        const std::string & peer)
+    {
+        std::shared_ptr<Subscriber> & subscriber = mSubscribers[peer];
+        if (!subscriber)
+        {
+            subscriber = std::make_shared<Subscriber>();
+            subscriber->mPeer = peer;
+        }
+        return subscriber;
+    }
+
+    static grpc::ByteBuffer encode(
+        const GrabResponse & frame,
+        int                  encoding)
+    {
+        GrabResponse encoded;
+        const GrabResponse * response = &frame;
+        if (encoding >= 0)
+        {
+            const octaneapi::ImageType type = rgbaType(static_cast<octaneapi::TonemapBufferType>(encoding));
+            encoded.set_result(frame.result());
+            for (const octaneapi::ApiRenderImage & image : frame.renderimages().data())
+            {
+                octaneapi::ApiRenderImage * out = encoded.mutable_renderimages()->add_data();
+                if (!encodeImage(image, type, *out))
+                {
+                    out->CopyFrom(image);
+                }
+            }
+            response = &encoded;
+        }
+
+        grpc::ByteBuffer buffer;
+        bool ownBuffer = false;
+        grpc::SerializationTraits<GrabResponse>::Serialize(*response, &buffer, &ownBuffer);
+        return buffer;
+    }
+
+    const uint32_t                                      mCredits;
+    mutable std::mutex                                  mMutex;
+    std::condition_variable                             mChanged;
+    std::shared_ptr<const GrabResponse>                 mFrame;
+    uint64_t                                            mSequence    = 0;
+    /// Serialized frame per encoding, -1 is the upstream one. Cleared by every new frame.
+    std::map<int, grpc::ByteBuffer>                     mEncoded;
+    uint64_t                                            mEncodings   = 0;
+    std::map<std::string, std::shared_ptr<Subscriber>>  mSubscribers;
+    uint32_t                                            mStreamCount = 0;
+    bool                                                mStopping    = false;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/// The single connection to Octane. Reads the callback stream and fetches each new frame once.
+class UpstreamReader
+{
+public:
+    UpstreamReader(
+        const RelaySettings & settings,
+        FrameRelay &          relay)
+    :
+        mSettings(settings),
+        mRelay(relay),
+        mChannel(createChannel(settings.mUpstream)),
+        mRenderStub(octaneapi::ApiRenderEngineService::NewStub(mChannel)),
+        mStreamStub(octaneapi::StreamCallbackService::NewStub(mChannel))
+    {
+        mThread = std::thread([this] { run(); });
+    }
+
+    ~UpstreamReader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+            if (mContext)
+            {
+                mContext->TryCancel();
+            }
+        }
+        mThread.join();
+    }
+
+    uint64_t notifications() const { return mNotifications; }
+    uint64_t fetches() const { return mFetches; }
+    uint64_t skipped() const { return mSkipped; }
+
+    /// Fetches the current frame if frames were skipped while nobody was watching, so a viewer
+    /// joining a finished render still gets its image.
+    void catchUp()
+    {
+        if (mStale.exchange(false))
+        {
+            fetchFrame();
+        }
+    }
+
+private:
+    void run()
+    {
+        while (!mStopping)
+        {
+            configure();
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mStopping)
+                {
+                    break;
+                }
+                mContext = std::make_unique<grpc::ClientContext>();
+            }
+            google::protobuf::Empty request;
+            std::unique_ptr<grpc::ClientReader<octaneapi::StreamCallbackRequest>> stream =
+                mStreamStub->callbackChannel(mContext.get(), request);
+            std::cout << "[Relay] subscribed to " << mSettings.mUpstream << "\n";
+
+            octaneapi::StreamCallbackRequest message;
+            while (!mStopping && stream->Read(&message))
+            {
+                if (message.payload_case() == octaneapi::StreamCallbackRequest::kNewImage)
+                {
+                    ++mNotifications;
+                    fetchFrame();
+                }
+            }
+            const grpc::Status status = stream->Finish();
+            if (mStopping)
+            {
+                break;
+            }
+            std::cout << "[Relay] upstream stream ended (" << status.error_message() << "), reconnecting\n";
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+
+    /// Registers the callback like the SDK clients do and asks for float frames with --hdr. Octane
+    /// builds without these calls still stream, so failures are only reported.
+    void configure()
+    {
+        {
+            octaneapi::ApiRenderEngine::setOnNewImageCallbackRequest request;
+            request.mutable_callback()->set_callbacksource("grpc_relay");
+            request.mutable_callback()->set_callbackid(1);
+            request.set_userdata(0);
+            octaneapi::ApiRenderEngine::setOnNewImageCallbackResponse response;
+            grpc::ClientContext context;
+            const grpc::Status status = mRenderStub->setOnNewImageCallback(&context, request, &response);
+            if (!status.ok())
+            {
+                std::cout << "[Relay] setOnNewImageCallback failed: " << status.error_message() << "\n";
+            }
+        }
+        if (mSettings.mRequestHdr)
+        {
+            octaneapi::ApiRenderEngine::setAsyncTonemapParams1Request request;
+            request.set_buffertype(octaneapi::TONEMAP_BUFFER_TYPE_HDR_FLOAT);
+            request.set_cryptomattefalsecolor(true);
+            request.set_colorspace(octaneapi::NAMED_COLOR_SPACE_LINEAR_SRGB);
+            request.set_premultipliedalphatype(octaneapi::PREMULTIPLIED_ALPHA_TYPE_NONE);
+            google::protobuf::Empty response;
+            grpc::ClientContext context;
+            const grpc::Status status = mRenderStub->setAsyncTonemapParams1(&context, request, &response);
+            if (!status.ok())
+            {
+                std::cout << "[Relay] setAsyncTonemapParams1 failed: " << status.error_message() << "\n";
+            }
+        }
+    }
+
+    static std::shared_ptr<grpc::Channel> createChannel(
+        const std::string & address)
+    {
+        // grabbed results are whole images, well above the default 4 MB receive limit
+        grpc::ChannelArguments arguments;
+        arguments.SetMaxReceiveMessageSize(-1);
+        return grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), arguments);
+    }
+
+    void fetchFrame()
+    {
+        // nobody is watching, Octane keeps the result until somebody asks
+        if (!mRelay.hasSubscribers())
+        {
+            ++mSkipped;
+            mStale = true;
+            return;
+        }
+
+        auto frame = std::make_shared<GrabResponse>();
+        octaneapi::ApiRenderEngine::grabRenderResultRequest request;
+        grpc::ClientContext context;
+        const grpc::Status status = mRenderStub->grabRenderResult(&context, request, frame.get());
+        ++mFetches;
+        if (!status.ok())
+        {
+            std::cout << "[Relay] grabRenderResult failed: " << status.error_message() << "\n";
+            return;
+        }
+        if (frame->result())
+        {
+            mRelay.publish(std::move(frame));
+        }
+    }
+
+    const RelaySettings &                                       mSettings;
+    FrameRelay &                                                mRelay;
+    std::shared_ptr<grpc::Channel>                              mChannel;
+    std::unique_ptr<octaneapi::ApiRenderEngineService::Stub>    mRenderStub;
+    std::unique_ptr<octaneapi::StreamCallbackService::Stub>     mStreamStub;
+    std::mutex                                                  mMutex;
+    std::unique_ptr<grpc::ClientContext>                        mContext;
+    std::thread                                                 mThread;
+    std::atomic<bool>                                           mStopping{ false };
+    std::atomic<bool>                                           mStale{ false };
+    std::atomic<uint64_t>                                       mNotifications{ 0 };
+    std::atomic<uint64_t>                                       mFetches{ 0 };
+    std::atomic<uint64_t>                                       mSkipped{ 0 };
+};
+
+
+//--------------------------------------------------------------------------------------------------
+// Services, only the frame calls are implemented
+
+class RelayRenderEngineService final :
+    public octaneapi::ApiRenderEngineService::WithRawCallbackMethod_grabRenderResult<
+        octaneapi::ApiRenderEngineService::Service>
+{
+public:
+    explicit RelayRenderEngineService(FrameRelay & relay) : mRelay(relay) {}
+
+    grpc::Status setOnNewImageCallback(
+        grpc::ServerContext *                                           context,
+        const octaneapi::ApiRenderEngine::setOnNewImageCallbackRequest * request,
+        octaneapi::ApiRenderEngine::setOnNewImageCallbackResponse *     response) override
+    {
+        // the relay holds the only registration with Octane
+        response->set_callbackid(1);
+        return grpc::Status::OK;
+    }
+
+    /// Served from the serialized frame, so viewers sharing an encoding cost no copies.
+    grpc::ServerUnaryReactor * grabRenderResult(
+        grpc::CallbackServerContext *   context,
+        const grpc::ByteBuffer *        request,
+        grpc::ByteBuffer *              response) override
+    {
+        if (!mRelay.grab(context->peer(), *response))
+        {
+            GrabResponse empty;
+            empty.set_result(false);
+            bool ownBuffer = false;
+            grpc::SerializationTraits<GrabResponse>::Serialize(empty, response, &ownBuffer);
+        }
+        grpc::ServerUnaryReactor * reactor = context->DefaultReactor();
+        reactor->Finish(grpc::Status::OK);
+        return reactor;
+    }
+
+    grpc::Status releaseRenderResult(
+        grpc::ServerContext *                                           context,
+        const octaneapi::ApiRenderEngine::releaseRenderResultRequest *  request,
+        google::protobuf::Empty *                                       response) override
+    {
+        return grpc::Status::OK;
+    }
+
+    /// Only the buffer type is used, it becomes the encoding of this viewer.
+    grpc::Status setAsyncTonemapParams1(
+        grpc::ServerContext *                                               context,
+        const octaneapi::ApiRenderEngine::setAsyncTonemapParams1Request *   request,
+        google::protobuf::Empty *                                           response) override
+    {
+        if (request->buffertype() >= octaneapi::TONEMAP_BUFFER_TYPE_COUNT)
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "unknown buffer type");
+        }
+        mRelay.setEncoding(context->peer(), request->buffertype());
+        return grpc::Status::OK;
+    }
+
+    grpc::Status asyncTonemapBufferType(
+        grpc::ServerContext *                                               context,
+        const octaneapi::ApiRenderEngine::asyncTonemapBufferTypeRequest *   request,
+        octaneapi::ApiRenderEngine::asyncTonemapBufferTypeResponse *        response) override
+    {
+        response->set_result(mRelay.encoding(context->peer()));
+        return grpc::Status::OK;
+    }
+
+private:
+    FrameRelay & mRelay;
+};
+
+
+class RelayCallbackStreamService final : public octaneapi::StreamCallbackService::Service
+{
+public:
+    RelayCallbackStreamService(FrameRelay & relay, UpstreamReader & upstream) : mRelay(relay), mUpstream(upstream) {}
+
+    grpc::Status callbackChannel(
+        grpc::ServerContext *                                   context,
+        const google::protobuf::Empty *                         request,
+        grpc::ServerWriter<octaneapi::StreamCallbackRequest> *  writer) override
+    {
+        const std::string peer = context->peer();
+        std::shared_ptr<Subscriber> subscriber = mRelay.openStream(peer);
+        mUpstream.catchUp();
+        std::cout << "[Relay] " << peer << " subscribed\n";
+        while (!context->IsCancelled())
+        {
+            if (!mRelay.waitForAnnouncement(*subscriber, std::chrono::milliseconds(100)))
+            {
+                continue;
+            }
+            octaneapi::StreamCallbackRequest message;
+            message.mutable_newimage()->set_user_data(0);
+            if (!writer->Write(message))
+            {
+                break;
+            }
+        }
+        mRelay.closeStream(subscriber);
+        std::cout << "[Relay] " << peer << " unsubscribed\n";
+        return grpc::Status::OK;
+    }
+
+private:
+    FrameRelay &     mRelay;
+    UpstreamReader & mUpstream;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+
+static std::atomic<bool> gStopRequested{ false };
+
+static void onSignal(
+    int)
+{
+    gStopRequested = true;
+}
+
+
+int main(
+    int    argc,
+    char * argv[])
+{
+    RelaySettings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        if (option == "--hdr")
+        {
+            settings.mRequestHdr = true;
+            continue;
+        }
+        const char * value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            std::cout << "Usage: octane_framerelay [--address host:port] [--upstream host:port] [--credits N] "
+                         "[--hdr] [--report-seconds N]\n";
+            return 1;
+        }
+        if (option == "--address")
+        {
+            settings.mAddress = value;
+        }
+        else if (option == "--upstream")
+        {
+            settings.mUpstream = value;
+        }
+        else if (option == "--credits")
+        {
+            settings.mCredits = (uint32_t)std::max(1, std::atoi(value));
+        }
+        else if (option == "--report-seconds")
+        {
+            settings.mReportInterval = std::max(0.0, std::atof(value));
+        }
+        else
+        {
+            std::cout << "Unknown option " << option << "\n";
+            return 1;
+        }
+        ++i;
+    }
+
+    FrameRelay                      relay(settings.mCredits);
+    std::unique_ptr<UpstreamReader> upstream = std::make_unique<UpstreamReader>(settings, relay);
+    RelayRenderEngineService        renderEngine(relay);
+    RelayCallbackStreamService      callbacks(relay, *upstream);
+
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(settings.mAddress, grpc::InsecureServerCredentials());
+    builder.SetMaxSendMessageSize(-1);
+    builder.RegisterService(&renderEngine);
+    builder.RegisterService(&callbacks);
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    if (!server)
+    {
+        std::cerr << "[Relay] can't listen on " << settings.mAddress << "\n";
+        return 1;
+    }
+
+    std::cout << "[Relay] relaying frames of " << settings.mUpstream << " on " << settings.mAddress << ", "
+              << settings.mCredits << " credits per viewer" << (settings.mRequestHdr ? ", HDR upstream" : "") << "\n";
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    auto lastReport = std::chrono::steady_clock::now();
+    while (!gStopRequested)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        const auto now = std::chrono::steady_clock::now();
+        if (settings.mReportInterval > 0.0 &&
+            std::chrono::duration<double>(now - lastReport).count() >= settings.mReportInterval)
+        {
+            lastReport = now;
+            relay.printReport(std::cout);
+        }
+    }
+
+    relay.stop();
+    server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+    std::cout << "[Relay] upstream: " << upstream->notifications() << " notifications, " << upstream->fetches()
+              << " fetches, " << upstream->skipped() << " skipped without viewers\n";
+    upstream.reset();
+    relay.printReport(std::cout);
+    return 0;
+}
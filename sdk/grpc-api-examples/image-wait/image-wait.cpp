@@ -0,0 +1,399 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+// Render image long poll: runs on the Octane host and answers waitForImage (render_image_wait.proto)
+// as soon as Octane has a newer render result. Clients that don't register the new image callback
+// otherwise poll isImageReady, hasPendingRenderData or getRenderImageChangeLevel over the network
+// and see a new image up to a poll interval late. Here one watcher polls over the local connection,
+// grabs the result once and hands it to every waiting client. Clients use ImageWaiterSdk
+// (shared/image_waiter_sdk.h).
+//
+//   octane_imagewait [--address host:port] [--upstream host:port] [--poll-ms N] [--timeout-ms N]
+
+// system headers
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+// protoc generated headers
+#include "apirender.grpc.pb.h"
+#include "render_image_wait.grpc.pb.h"
+
+using octaneimagewait::WaitForImageResponse;
+
+
+//--------------------------------------------------------------------------------------------------
+/// Settings of the service.
+struct WaitSettings
+{
+    /// Clients are on other machines, listen on all interfaces.
+    std::string mAddress       = "0.0.0.0:50054";
+    std::string mUpstream      = "127.0.0.1:50051";
+    /// Poll interval of the watcher while clients wait, and while nobody asked for a while.
+    uint32_t    mPollMs        = 2;
+    uint32_t    mIdlePollMs    = 100;
+    uint32_t    mIdleAfterMs   = 2000;
+    /// Wait of a request that has no timeout, and the longest wait of any request.
+    uint32_t    mTimeoutMs     = 1000;
+    uint32_t    mMaxTimeoutMs  = 30000;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/// Watches the render result of Octane. The newest result is kept as an immutable response, which
+/// waiting requests copy from.
+
+class ImageWatcher
+{
+public:
+    explicit ImageWatcher(
+        const WaitSettings & settings)
+    :
+        mSettings(settings)
+    {
+        // grabbed results are whole images, well above the default 4 MB receive limit
+        grpc::ChannelArguments arguments;
+        arguments.SetMaxReceiveMessageSize(-1);
+        mChannel = grpc::CreateCustomChannel(settings.mUpstream, grpc::InsecureChannelCredentials(), arguments);
+        mRenderStub = octaneapi::ApiRenderEngineService::NewStub(mChannel);
+        mThread = std::thread(&ImageWatcher::run, this);
+    }
+
+    ~ImageWatcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mWakeWatcher.notify_all();
+        mNewImage.notify_all();
+        mThread.join();
+    }
+
+    /// Wait for a result newer than afterSequence with at least minChangeLevel. Returns the
+    /// newest result, or null on timeout, cancellation or shutdown.
+    std::shared_ptr<const WaitForImageResponse> wait(
+        grpc::ServerContext *   context,
+        uint64_t                afterSequence,
+        uint64_t                minChangeLevel,
+        uint32_t                timeoutMs)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        std::unique_lock<std::mutex> lock(mMutex);
+        mLastRequest = std::chrono::steady_clock::now();
+        ++mWaiting;
+        // an idle watcher polls right away instead of after its idle interval
+        mWakeWatcher.notify_all();
+
+        std::shared_ptr<const WaitForImageResponse> result;
+        while (!mStop && !context->IsCancelled())
+        {
+            if (mLatest && mLatest->sequence() > afterSequence && mLatest->changelevel() >= minChangeLevel)
+            {
+                result = mLatest;
+                break;
+            }
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+            {
+                break;
+            }
+            // wake up now and then to notice a client that went away
+            mNewImage.wait_until(lock, std::min(deadline, now + std::chrono::milliseconds(100)));
+        }
+        --mWaiting;
+        return result;
+    }
+
+    void printReport(
+        std::ostream & out) const
+    {
+        out << "[ImageWait] " << mPolls << " polls of Octane, " << mResults << " render results grabbed, "
+            << mGrabbedBytes / (1024 * 1024) << " MB\n";
+    }
+
+private:
+    void run()
+    {
+        uint64_t lastChangeLevel = 0;
+        float lastSamples = -1.0f;
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mStop)
+        {
+            const bool idle = mWaiting == 0 &&
+                              std::chrono::steady_clock::now() - mLastRequest > std::chrono::milliseconds(mSettings.mIdleAfterMs);
+            mWakeWatcher.wait_for(lock, std::chrono::milliseconds(idle ? mSettings.mIdlePollMs : mSettings.mPollMs));
+            if (mStop)
+            {
+                break;
+            }
+            lock.unlock();
+            std::shared_ptr<WaitForImageResponse> result = poll(lastChangeLevel, lastSamples);
+            lock.lock();
+            if (result)
+            {
+                result->set_sequence(++mSequence);
+                mLatest = std::move(result);
+                mNewImage.notify_all();
+            }
+        }
+    }
+
+    /// The new render result, null if there is none.
+    std::shared_ptr<WaitForImageResponse> poll(
+        uint64_t & lastChangeLevel,
+        float &    lastSamples)
+    {
+        ++mPolls;
+        octaneapi::ApiRenderEngine::isImageReadyResponse readyResponse;
+        {
+            grpc::ClientContext context;
+            if (!mRenderStub->isImageReady(&context, octaneapi::ApiRenderEngine::isImageReadyRequest(), &readyResponse).ok())
+            {
+                return nullptr;
+            }
+        }
+        if (!readyResponse.result())
+        {
+            // isImageReady is deprecated, a restarted render still shows in the change level
+            octaneapi::ApiRenderEngine::getRenderImageChangeLevelResponse levelResponse;
+            grpc::ClientContext context;
+            if (!mRenderStub->getRenderImageChangeLevel(&context, octaneapi::ApiRenderEngine::getRenderImageChangeLevelRequest(), &levelResponse).ok() ||
+                levelResponse.result().value() == mPolledChangeLevel)
+            {
+                return nullptr;
+            }
+            mPolledChangeLevel = levelResponse.result().value();
+        }
+
+        octaneapi::ApiRenderEngine::grabRenderResultResponse grabResponse;
+        {
+            grpc::ClientContext context;
+            if (!mRenderStub->grabRenderResult(&context, octaneapi::ApiRenderEngine::grabRenderResultRequest(), &grabResponse).ok() ||
+                !grabResponse.result())
+            {
+                return nullptr;
+            }
+        }
+        {
+            grpc::ClientContext context;
+            google::protobuf::Empty empty;
+            mRenderStub->releaseRenderResult(&context, octaneapi::ApiRenderEngine::releaseRenderResultRequest(), &empty);
+        }
+        const octaneapi::ApiArrayApiRenderImage & images = grabResponse.renderimages();
+        if (images.data_size() == 0)
+        {
+            return nullptr;
+        }
+
+        // the same result again, nothing new to wake the clients for
+        const uint64_t changeLevel = images.data(0).changelevel().value();
+        const float samples = images.data(0).tonemappedsamplesperpixel();
+        if (changeLevel == lastChangeLevel && samples == lastSamples)
+        {
+            return nullptr;
+        }
+        lastChangeLevel = changeLevel;
+        lastSamples = samples;
+
+        std::shared_ptr<WaitForImageResponse> result = std::make_shared<WaitForImageResponse>();
+        result->set_ready(true);
+        result->set_changelevel(changeLevel);
+        result->set_tonemappedsamplesperpixel(samples);
+        for (const octaneapi::ApiRenderImage & in : images.data())
+        {
+            octaneimagewait::RenderImage * out = result->add_images();
+            out->set_type(static_cast<int32_t>(in.type()));
+            out->set_colorspace(static_cast<int32_t>(in.colorspace()));
+            out->set_islinear(in.islinear());
+            out->set_width(in.size().x());
+            out->set_height(in.size().y());
+            out->set_pitch(in.pitch());
+            out->set_buffer(in.buffer().data());
+            out->set_renderpassid(static_cast<int32_t>(in.renderpassid()));
+            out->set_tonemappedsamplesperpixel(in.tonemappedsamplesperpixel());
+            out->set_calculatedsamplesperpixel(in.calculatedsamplesperpixel());
+            out->set_regionsamplesperpixel(in.regionsamplesperpixel());
+            out->set_maxsamplesperpixel(in.maxsamplesperpixel());
+            out->set_samplespersecond(in.samplespersecond());
+            out->set_rendertime(in.rendertime());
+            out->set_changelevel(in.changelevel().value());
+            out->set_haspendingupdates(in.haspendingupdates());
+            out->set_subsampling(static_cast<int32_t>(in.subsampling()));
+            out->set_hasalpha(in.hasalpha());
+            out->set_premultipliedalphatype(static_cast<int32_t>(in.premultipliedalphatype()));
+            out->set_keepenvironment(in.keepenvironment());
+            mGrabbedBytes += in.buffer().data().size();
+        }
+        ++mResults;
+        return result;
+    }
+
+    const WaitSettings                                          mSettings;
+    std::shared_ptr<grpc::Channel>                              mChannel;
+    std::unique_ptr<octaneapi::ApiRenderEngineService::Stub>    mRenderStub;
+    /// Last getRenderImageChangeLevel() result, only used by the watcher thread.
+    uint64_t                                                    mPolledChangeLevel = 0;
+
+    std::mutex                                                  mMutex;
+    std::condition_variable                                     mNewImage;
+    std::condition_variable                                     mWakeWatcher;
+    std::shared_ptr<const WaitForImageResponse>                 mLatest;
+    uint64_t                                                    mSequence = 0;
+    uint32_t                                                    mWaiting = 0;
+    std::chrono::steady_clock::time_point                       mLastRequest;
+    bool                                                        mStop = false;
+
+    std::atomic<uint64_t>                                       mPolls{ 0 };
+    std::atomic<uint64_t>                                       mResults{ 0 };
+    std::atomic<uint64_t>                                       mGrabbedBytes{ 0 };
+    std::thread                                                 mThread;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+// Service
+
+class RenderImageWaitService final : public octaneimagewait::RenderImageWait::Service
+{
+public:
+    explicit RenderImageWaitService(
+        const WaitSettings & settings)
+    :
+        mSettings(settings),
+        mWatcher(settings)
+    {}
+
+    grpc::Status waitForImage(
+        grpc::ServerContext *                                           context,
+        const octaneimagewait::WaitForImageRequest *                    request,
+        WaitForImageResponse *                                          response) override
+    {
+        const uint32_t timeoutMs = std::min(request->timeoutms() > 0 ? request->timeoutms() : mSettings.mTimeoutMs,
+                                            mSettings.mMaxTimeoutMs);
+        std::shared_ptr<const WaitForImageResponse> latest =
+            mWatcher.wait(context, request->aftersequence(), request->minchangelevel(), timeoutMs);
+        if (context->IsCancelled())
+        {
+            return grpc::Status(grpc::StatusCode::CANCELLED, "client went away");
+        }
+        if (!latest)
+        {
+            // timed out, ready stays false
+            mTimeouts += 1;
+            return grpc::Status::OK;
+        }
+        if (request->includeimage())
+        {
+            *response = *latest;
+        }
+        else
+        {
+            response->set_ready(true);
+            response->set_sequence(latest->sequence());
+            response->set_changelevel(latest->changelevel());
+            response->set_tonemappedsamplesperpixel(latest->tonemappedsamplesperpixel());
+        }
+        mAnswered += 1;
+        return grpc::Status::OK;
+    }
+
+    void printReport(
+        std::ostream & out) const
+    {
+        out << "[ImageWait] " << mAnswered << " waits answered, " << mTimeouts << " timed out\n";
+        mWatcher.printReport(out);
+    }
+
+private:
+    const WaitSettings                                          mSettings;
+    ImageWatcher                                                mWatcher;
+    std::atomic<uint64_t>                                       mAnswered{ 0 };
+    std::atomic<uint64_t>                                       mTimeouts{ 0 };
+};
+
+
+//--------------------------------------------------------------------------------------------------
+
+static std::atomic<bool> gStopRequested{ false };
+
+static void onSignal(
+    int)
+{
+    gStopRequested = true;
+}
+
+
+int main(
+    int    argc,
+    char * argv[])
+{
+    WaitSettings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        const char * value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            std::cout << "Usage: octane_imagewait [--address host:port] [--upstream host:port] "
+                         "[--poll-ms N] [--timeout-ms N]\n";
+            return 1;
+        }
+        if (option == "--address")
+        {
+            settings.mAddress = value;
+        }
+        else if (option == "--upstream")
+        {
+            settings.mUpstream = value;
+        }
+        else if (option == "--poll-ms")
+        {
+            settings.mPollMs = (uint32_t)std::max(1, std::atoi(value));
+        }
+        else if (option == "--timeout-ms")
+        {
+            settings.mTimeoutMs = std::min((uint32_t)std::max(1, std::atoi(value)), settings.mMaxTimeoutMs);
+        }
+        else
+        {
+            std::cout << "Unknown option " << option << "\n";
+            return 1;
+        }
+        ++i;
+    }
+
+    std::unique_ptr<RenderImageWaitService> service = std::make_unique<RenderImageWaitService>(settings);
+
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(settings.mAddress, grpc::InsecureServerCredentials());
+    builder.RegisterService(service.get());
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    if (!server)
+    {
+        std::cerr << "[ImageWait] can't listen on " << settings.mAddress << "\n";
+        return 1;
+    }
+
+    std::cout << "[ImageWait] render images of " << settings.mUpstream << " on " << settings.mAddress
+              << ", polled every " << settings.mPollMs << " ms\n";
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    while (!gStopRequested)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+    service->printReport(std::cout);
+    service.reset();
+    return 0;
+}
@@ -0,0 +1,854 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+// Mesh upload benchmark: encodes the vertices, normals and indices of a generated mesh as
+// setArrayByAttrID (one sub message per element) and as setPackedArray (one memcpy into a bytes
+// field), and compares encode and decode time and the size on the wire. With --octane and --arrays
+// it also times the uploads and the reads back, directly to Octane and through octane_arrays, and
+// the chunked setArrayStream upload. A scene rebuild through the blob cache, which sends only the
+// arrays the service doesn't hold yet, is compared with one that sends them all again.
+// The animation part uploads --frames samples of the vertices of a deforming mesh as one
+// setAnimByAttr message and one sample at a time through setAnimStream, with every sample
+// encoding, and reports time, bytes on the wire and what the client holds at its peak.
+// octane_mockserver (render-example) can stand in for Octane, any --item handle is fine then.
+//
+//   octane_arraybench [--vertices N] [--runs N] [--octane host:port] [--arrays host:port]
+//                     [--item handle] [--chunk KB] [--frames N] [--anim-vertices N]
+
+// system headers
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iterator>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+// protoc generated headers
+// apiItem
+#include "apinodesystem_3.grpc.pb.h"
+#include "item_array_transfer.grpc.pb.h"
+// shared helpers
+#include "../../../shared/anim_sample_codec.h"
+#include "../../../shared/content_hash.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/// Settings of the benchmark.
+struct BenchSettings
+{
+    uint32_t    mVertices      = 5000000;
+    int         mRuns          = 5;
+    /// Octane or octane_mockserver, and octane_arrays in front of it. Empty skips the uploads.
+    std::string mOctane;
+    std::string mArrays;
+    /// Mesh node whose arrays are overwritten.
+    uint64_t    mItem          = 1;
+    /// Data per setArrayStream chunk.
+    size_t      mChunkKb       = 1024;
+    /// Time samples of the deforming mesh, 0 skips the animation part.
+    uint32_t    mFrames        = 500;
+    uint32_t    mAnimVertices  = 20000;
+};
+
+
+/// Arrays of a mesh like a scene exporter sends them.
+struct Mesh
+{
+    std::vector<float>   mVertices;     // float_3
+    std::vector<float>   mNormals;      // float_3
+    std::vector<int32_t> mIndices;      // 3 per triangle
+};
+
+
+struct MeshArray
+{
+    const char *                mName;
+    octaneapi::AttributeId      mAttribute;
+    octanearrays::PackedType    mType;
+    const void *                mData;
+    size_t                      mCount;
+    size_t                      mElementSize;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+
+/// A wavy grid of about vertices vertices, two triangles per quad.
+static Mesh makeMesh(
+    const uint32_t vertices)
+{
+    const uint32_t side = std::max(2u, (uint32_t)std::sqrt((double)vertices));
+    Mesh mesh;
+    mesh.mVertices.reserve((size_t)side * side * 3);
+    mesh.mNormals.reserve((size_t)side * side * 3);
+    for (uint32_t y = 0; y < side; ++y)
+    {
+        for (uint32_t x = 0; x < side; ++x)
+        {
+            const float u = (float)x / (side - 1);
+            const float v = (float)y / (side - 1);
+            const float h = 0.05f * std::sin(u * 40.0f) * std::cos(v * 40.0f);
+            mesh.mVertices.insert(mesh.mVertices.end(), { u - 0.5f, h, v - 0.5f });
+            mesh.mNormals.insert(mesh.mNormals.end(), { -2.0f * std::cos(u * 40.0f) * h, 1.0f, 2.0f * std::sin(v * 40.0f) * h });
+        }
+    }
+    mesh.mIndices.reserve((size_t)(side - 1) * (side - 1) * 6);
+    for (uint32_t y = 0; y + 1 < side; ++y)
+    {
+        for (uint32_t x = 0; x + 1 < side; ++x)
+        {
+            const int32_t i = (int32_t)(y * side + x);
+            const int32_t s = (int32_t)side;
+            mesh.mIndices.insert(mesh.mIndices.end(), { i, i + s, i + 1, i + 1, i + s, i + s + 1 });
+        }
+    }
+    return mesh;
+}
+
+
+template <class F>
+static double medianMs(
+    int     runs,
+    F       func)
+{
+    std::vector<double> times;
+    times.reserve(runs);
+    for (int i = 0; i < runs; ++i)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        func();
+        auto end = std::chrono::high_resolution_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+
+/// Uploads array through setArrayStream in chunks of chunkBytes, the client holds one chunk.
+static grpc::Status streamArray(
+    octanearrays::ItemArrayTransfer::Stub & stub,
+    const MeshArray &                       array,
+    const uint64_t                          item,
+    const size_t                            chunkBytes,
+    uint64_t &                              chunks)
+{
+    grpc::ClientContext context;
+    octanearrays::SetPackedArrayResponse response;
+    auto writer = stub.setArrayStream(&context, &response);
+    octanearrays::SetArrayChunk chunk;
+    chunk.set_itemhandle(item);
+    chunk.set_attributeid((uint32_t)array.mAttribute);
+    chunk.set_evaluate(false);
+    chunk.set_type(array.mType);
+    chunk.set_count(array.mCount);
+    const char * data = (const char *)array.mData;
+    const size_t total = array.mCount * array.mElementSize;
+    size_t sent = 0;
+    do
+    {
+        const size_t size = std::min(chunkBytes, total - sent);
+        chunk.set_data(data + sent, size);
+        if (!writer->Write(chunk))
+        {
+            break;
+        }
+        chunk.clear_itemhandle();
+        chunk.clear_attributeid();
+        chunk.clear_type();
+        chunk.clear_count();
+        sent += size;
+        chunks += 1;
+    }
+    while (sent < total);
+    writer->WritesDone();
+    return writer->Finish();
+}
+
+
+/// Sets the arrays of the mesh from blobs in one setArrays transaction: hashes them, looks the keys
+/// up and uploads the missing ones first. bytesSent receives the payload bytes uploaded.
+static grpc::Status rebuildFromBlobs(
+    octanearrays::BlobCache::Stub &         blobStub,
+    octanearrays::ItemArrayTransfer::Stub & arraysStub,
+    const std::vector<MeshArray> &          arrays,
+    const uint64_t                          item,
+    uint64_t &                              bytesSent)
+{
+    octanearrays::FindBlobsRequest find;
+    octanearrays::SetArraysRequest set;
+    set.set_itemhandle(item);
+    for (const MeshArray & array : arrays)
+    {
+        const SharedUtils::ContentKey key = SharedUtils::contentKey(array.mData, array.mCount * array.mElementSize);
+        octanearrays::BlobKey * findKey = find.add_keys();
+        findKey->set_hash(key.hash);
+        findKey->set_size(key.size);
+        octanearrays::AttributeArray * attribute = set.add_arrays();
+        attribute->set_attributeid((uint32_t)array.mAttribute);
+        attribute->mutable_blob()->set_type(array.mType);
+        *attribute->mutable_blob()->mutable_key() = *findKey;
+    }
+
+    octanearrays::FindBlobsResponse found;
+    grpc::ClientContext findContext;
+    grpc::Status status = blobStub.findBlobs(&findContext, find, &found);
+    for (size_t i = 0; status.ok() && i < arrays.size(); ++i)
+    {
+        if (found.present((int)i))
+        {
+            continue;
+        }
+        octanearrays::PutBlobRequest put;
+        *put.mutable_key() = find.keys((int)i);
+        put.set_data(arrays[i].mData, arrays[i].mCount * arrays[i].mElementSize);
+        octanearrays::PutBlobResponse stored;
+        grpc::ClientContext putContext;
+        status = blobStub.putBlob(&putContext, put, &stored);
+        bytesSent += put.data().size();
+    }
+    if (!status.ok())
+    {
+        return status;
+    }
+
+    octanearrays::SetPackedArrayResponse response;
+    grpc::ClientContext setContext;
+    return arraysStub.setArrays(&setContext, set, &response);
+}
+
+
+static void printRow(
+    const std::string & name,
+    const double        ms,
+    const double        baselineMs,
+    const size_t        bytes)
+{
+    std::cout << "  " << std::left << std::setw(26) << name << std::right << std::fixed
+              << std::setprecision(2) << std::setw(10) << ms << " ms" << std::setw(10)
+              << (ms > 0.0 ? bytes / (ms * 1000.0) : 0.0) << " MB/s" << std::setw(8)
+              << std::setprecision(1) << (ms > 0.0 ? baselineMs / ms : 0.0) << "x\n";
+}
+
+
+static bool checkStatus(
+    const grpc::Status &    status,
+    const char *            call)
+{
+    if (!status.ok())
+    {
+        std::cerr << call << " failed: " << status.error_message() << "\n";
+    }
+    return status.ok();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// The two encodings
+
+/// What ApiItemProxy::set() does for the array, element by element.
+static void encodeElements(
+    const MeshArray &                           array,
+    const uint64_t                              item,
+    octaneapi::ApiItem::setArrayByIDRequest &   request)
+{
+    request.Clear();
+    auto * ref = request.mutable_item_ref();
+    ref->set_type(octaneapi::ObjectRef_ObjectType::ObjectRef_ObjectType_ApiItem);
+    ref->set_handle(item);
+    request.set_attribute_id(array.mAttribute);
+    request.set_evaluate(false);
+    if (array.mType == octanearrays::PACKED_FLOAT3)
+    {
+        const float * v = (const float *)array.mData;
+        auto * arrMsg = request.mutable_float3_array();
+        for (size_t i = 0; i < array.mCount; ++i, v += 3)
+        {
+            auto * e = arrMsg->add_data();
+            e->set_x(v[0]);
+            e->set_y(v[1]);
+            e->set_z(v[2]);
+        }
+    }
+    else
+    {
+        const int32_t * v = (const int32_t *)array.mData;
+        auto * arrMsg = request.mutable_int_array();
+        for (size_t i = 0; i < array.mCount; ++i)
+        {
+            arrMsg->add_data(v[i]);
+        }
+    }
+}
+
+
+/// What ItemArraySdk::set() does, one memcpy.
+static void encodePacked(
+    const MeshArray &                       array,
+    const uint64_t                          item,
+    octanearrays::SetPackedArrayRequest &   request)
+{
+    request.Clear();
+    request.set_itemhandle(item);
+    request.set_attributeid((uint32_t)array.mAttribute);
+    request.set_evaluate(false);
+    octanearrays::PackedArray * packed = request.mutable_array();
+    packed->set_type(array.mType);
+    packed->set_count(array.mCount);
+    packed->set_data(array.mData, array.mCount * array.mElementSize);
+}
+
+
+/// Reads the elements back into a flat buffer, like the receiving side has to.
+static void decodeElements(
+    const octaneapi::ApiItem::setArrayByIDRequest & request,
+    std::vector<char> &                             out)
+{
+    if (request.has_float3_array())
+    {
+        out.resize((size_t)request.float3_array().data_size() * 12);
+        float * v = (float *)out.data();
+        for (const auto & e : request.float3_array().data())
+        {
+            *v++ = e.x();
+            *v++ = e.y();
+            *v++ = e.z();
+        }
+    }
+    else
+    {
+        out.resize((size_t)request.int_array().data_size() * 4);
+        std::memcpy(out.data(), request.int_array().data().data(), out.size());
+    }
+}
+
+
+static void decodePacked(
+    const octanearrays::SetPackedArrayRequest & request,
+    std::vector<char> &                         out)
+{
+    const std::string & data = request.array().data();
+    out.assign(data.begin(), data.end());
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Animation
+
+/// Vertices of frame of a deforming mesh, a ripple running over base, as a vertex cache reader
+/// would decode them one frame at a time.
+static void deformFrame(
+    const Mesh &    base,
+    const uint32_t  frame,
+    float *         out)
+{
+    const float phase = frame * 0.04f;
+    for (size_t i = 0; i < base.mVertices.size(); i += 3)
+    {
+        const float x = base.mVertices[i];
+        const float z = base.mVertices[i + 2];
+        out[i]     = x;
+        out[i + 1] = base.mVertices[i + 1] + 0.1f * std::sin(std::sqrt(x * x + z * z) * 20.0f - phase);
+        out[i + 2] = z;
+    }
+}
+
+
+struct AnimRow
+{
+    std::string                 mName;
+    SharedUtils::SampleEncoding mEncoding;
+    bool                        mDelta;
+};
+
+
+/// Uploads frames samples through setAnimStream, one message each, and returns the encoded bytes.
+static grpc::Status streamAnimation(
+    octanearrays::ItemArrayTransfer::Stub & stub,
+    const Mesh &                            base,
+    const SharedUtils::SampleFormat &       format,
+    const uint32_t                          frames,
+    const uint64_t                          item,
+    uint64_t &                              bytes)
+{
+    grpc::ClientContext context;
+    octanearrays::SetPackedArrayResponse response;
+    auto writer = stub.setAnimStream(&context, &response);
+    octanearrays::AnimSample sample;
+    sample.set_itemhandle(item);
+    sample.set_attributeid((uint32_t)octaneapi::A_VERTICES);
+    sample.set_type(octanearrays::PACKED_FLOAT3);
+    sample.set_count(base.mVertices.size() / 3);
+    sample.set_samples(frames);
+    sample.mutable_timing()->set_period(1.0f / 24.0f);
+    sample.mutable_timing()->set_endtime(frames / 24.0f);
+    sample.set_encoding((octanearrays::SampleEncoding)format.encoding);
+    sample.set_delta(format.delta);
+    sample.set_rangemin(format.rangeMin);
+    sample.set_rangemax(format.rangeMax);
+
+    SharedUtils::SampleEncoder encoder(format);
+    std::vector<float> frame(base.mVertices.size());
+    bytes = 0;
+    for (uint32_t f = 0; f < frames; ++f)
+    {
+        deformFrame(base, f, frame.data());
+        encoder.encode(frame.data(), *sample.mutable_data());
+        bytes += sample.data().size();
+        if (!writer->Write(sample))
+        {
+            break;
+        }
+        if (f == 0)
+        {
+            sample.Clear();
+        }
+    }
+    writer->WritesDone();
+    return writer->Finish();
+}
+
+
+/// Deforming mesh of settings.mFrames samples: one setAnimByAttr message of all samples against
+/// setAnimStream with each sample encoding. Returns false if an upload failed.
+static bool benchAnimation(
+    const BenchSettings & settings)
+{
+    const Mesh base = makeMesh(settings.mAnimVertices);
+    const size_t vertices = base.mVertices.size() / 3;
+    const uint32_t frames = settings.mFrames;
+    const size_t rawSample = base.mVertices.size() * sizeof(float);
+    const size_t raw = rawSample * frames;
+    std::cout << "\nDeforming mesh, " << vertices << " vertices, " << frames << " samples, "
+              << raw / (1024 * 1024) << " MB of vertices\n";
+
+    // ApiItemProxy::setAnim(): the client holds all samples and one message of every element
+    const auto wholeStart = std::chrono::high_resolution_clock::now();
+    std::vector<float> cache(base.mVertices.size() * frames);
+    for (uint32_t f = 0; f < frames; ++f)
+    {
+        deformFrame(base, f, cache.data() + f * base.mVertices.size());
+    }
+    octaneapi::ApiItem::setAnimByIDRequest wholeRequest;
+    auto * ref = wholeRequest.mutable_item_ref();
+    ref->set_type(octaneapi::ObjectRef_ObjectType::ObjectRef_ObjectType_ApiItem);
+    ref->set_handle(settings.mItem);
+    wholeRequest.set_attribute_id(octaneapi::A_VERTICES);
+    wholeRequest.mutable_times()->mutable_period()->set_value(1.0f / 24.0f);
+    wholeRequest.mutable_times()->mutable_endtime()->set_value(frames / 24.0f);
+    wholeRequest.set_num_time_samples(frames);
+    wholeRequest.set_evaluate(false);
+    auto * elements = wholeRequest.mutable_float3_array()->mutable_data();
+    elements->Reserve((int)(vertices * frames));
+    for (size_t i = 0; i < cache.size(); i += 3)
+    {
+        auto * e = elements->Add();
+        e->set_x(cache[i]);
+        e->set_y(cache[i + 1]);
+        e->set_z(cache[i + 2]);
+    }
+    std::string wire;
+    wholeRequest.SerializeToString(&wire);
+    const double wholeEncodeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - wholeStart).count();
+    const size_t wholeHeld = cache.size() * sizeof(float) + wholeRequest.SpaceUsedLong() + wire.size();
+
+    // quantized steps cover the rest shape and the ripple
+    float low = base.mVertices[0];
+    float high = low;
+    for (const float v : base.mVertices)
+    {
+        low = std::min(low, v);
+        high = std::max(high, v);
+    }
+    const AnimRow rows[] =
+    {
+        { "exact",             SharedUtils::SampleEncoding::Exact,     false },
+        { "exact, delta",      SharedUtils::SampleEncoding::Exact,     true  },
+        { "half",              SharedUtils::SampleEncoding::Half,      false },
+        { "half, delta",       SharedUtils::SampleEncoding::Half,      true  },
+        { "quantized",         SharedUtils::SampleEncoding::Quantized, false },
+        { "quantized, delta",  SharedUtils::SampleEncoding::Quantized, true  },
+    };
+
+    std::cout << "\nanimation, encode (bytes on the wire, held by the client at its peak, max error)\n";
+    printRow("setAnimByAttr message", wholeEncodeMs, wholeEncodeMs, raw);
+    std::cout << "  " << std::setw(28) << "" << wire.size() / (1024 * 1024) << " MB, holds "
+              << wholeHeld / (1024 * 1024) << " MB\n";
+    cache = std::vector<float>();
+    wire = std::string();
+
+    std::vector<SharedUtils::SampleFormat> formats;
+    std::vector<float> frame(base.mVertices.size());
+    std::vector<float> decoded(base.mVertices.size());
+    for (const AnimRow & row : rows)
+    {
+        SharedUtils::SampleFormat format;
+        format.encoding    = row.mEncoding;
+        format.delta       = row.mDelta;
+        format.rangeMin    = low - 0.1f;
+        format.rangeMax    = high + 0.1f;
+        format.sampleBytes = rawSample;
+        format.floats      = true;
+        formats.push_back(format);
+
+        // what the client does per sample is timed, the decoding of the service is not
+        SharedUtils::SampleEncoder encoder(format);
+        SharedUtils::SampleDecoder decoder(format);
+        std::string sample;
+        size_t bytes = 0;
+        size_t largest = 0;
+        double encodeMs = 0.0;
+        float maxError = 0.0f;
+        for (uint32_t f = 0; f < frames; ++f)
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+            deformFrame(base, f, frame.data());
+            encoder.encode(frame.data(), sample);
+            encodeMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            bytes += sample.size();
+            largest = std::max(largest, sample.size());
+            decoder.decode(sample.data(), sample.size(), decoded.data());
+            for (size_t i = 0; i < frame.size(); ++i)
+            {
+                maxError = std::max(maxError, std::fabs(decoded[i] - frame[i]));
+            }
+        }
+        // one raw sample, the previous one of the encoder and the encoded message
+        const size_t held = rawSample * (row.mDelta ? 2 : 1) + largest;
+        printRow("stream " + row.mName, encodeMs, wholeEncodeMs, raw);
+        std::cout << "  " << std::setw(28) << "" << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MB, holds "
+                  << held / (1024.0 * 1024.0) << " MB, max error " << std::scientific << maxError << std::fixed << "\n";
+    }
+
+    if (settings.mOctane.empty() || settings.mArrays.empty())
+    {
+        return true;
+    }
+
+    // uploads, a single run each: a second whole message would only measure the same again
+    grpc::ChannelArguments arguments;
+    arguments.SetMaxSendMessageSize(-1);
+    auto octaneStub = octaneapi::ApiItemService::NewStub(
+        grpc::CreateCustomChannel(settings.mOctane, grpc::InsecureChannelCredentials(), arguments));
+    auto arraysStub = octanearrays::ItemArrayTransfer::NewStub(
+        grpc::CreateChannel(settings.mArrays, grpc::InsecureChannelCredentials()));
+    bool uploadsOk = true;
+
+    std::cout << "\nanimation, upload\n";
+    const auto directStart = std::chrono::high_resolution_clock::now();
+    {
+        grpc::ClientContext context;
+        octaneapi::ApiItem::setAnimArrayResponse response;
+        uploadsOk = checkStatus(octaneStub->setAnimByAttr(&context, wholeRequest, &response), "setAnimByAttr") && uploadsOk;
+    }
+    const double directMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - directStart).count();
+    printRow("setAnimByAttr", directMs, directMs, raw);
+    wholeRequest.Clear();
+
+    for (size_t i = 0; i < formats.size(); ++i)
+    {
+        uint64_t bytes = 0;
+        const auto start = std::chrono::high_resolution_clock::now();
+        uploadsOk = checkStatus(streamAnimation(*arraysStub, base, formats[i], frames, settings.mItem, bytes), "setAnimStream") && uploadsOk;
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        printRow("setAnimStream " + rows[i].mName, ms, directMs, raw);
+    }
+    if (!uploadsOk)
+    {
+        std::cout << "  some calls FAILED\n";
+    }
+    return uploadsOk;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+
+int main(
+    int    argc,
+    char * argv[])
+{
+    BenchSettings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        const char * value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            std::cout << "Usage: octane_arraybench [--vertices N] [--runs N] [--octane host:port] "
+                         "[--arrays host:port] [--item handle] [--chunk KB] [--frames N] [--anim-vertices N]\n";
+            return 1;
+        }
+        if (option == "--vertices")
+        {
+            settings.mVertices = (uint32_t)std::max(4, std::atoi(value));
+        }
+        else if (option == "--runs")
+        {
+            settings.mRuns = std::max(1, std::atoi(value));
+        }
+        else if (option == "--octane")
+        {
+            settings.mOctane = value;
+        }
+        else if (option == "--arrays")
+        {
+            settings.mArrays = value;
+        }
+        else if (option == "--item")
+        {
+            settings.mItem = std::strtoull(value, nullptr, 10);
+        }
+        else if (option == "--chunk")
+        {
+            settings.mChunkKb = (size_t)std::max(1, std::atoi(value));
+        }
+        else if (option == "--frames")
+        {
+            settings.mFrames = (uint32_t)std::max(0, std::atoi(value));
+        }
+        else if (option == "--anim-vertices")
+        {
+            settings.mAnimVertices = (uint32_t)std::max(4, std::atoi(value));
+        }
+        else
+        {
+            std::cout << "Unknown option " << option << "\n";
+            return 1;
+        }
+        ++i;
+    }
+
+    const Mesh mesh = makeMesh(settings.mVertices);
+    const size_t vertices = mesh.mVertices.size() / 3;
+    const MeshArray arrays[] =
+    {
+        { "vertices", octaneapi::A_VERTICES,            octanearrays::PACKED_FLOAT3, mesh.mVertices.data(), vertices,               12 },
+        { "normals",  octaneapi::A_NORMALS,             octanearrays::PACKED_FLOAT3, mesh.mNormals.data(),  vertices,               12 },
+        { "indices",  octaneapi::A_POLY_VERTEX_INDICES, octanearrays::PACKED_INT,    mesh.mIndices.data(),  mesh.mIndices.size(),   4  },
+    };
+    std::cout << "Mesh upload benchmark, " << vertices << " vertices, " << mesh.mIndices.size() / 3
+              << " triangles, median of " << settings.mRuns << " runs\n";
+
+    octaneapi::ApiItem::setArrayByIDRequest elementRequest;
+    octanearrays::SetPackedArrayRequest packedRequest;
+    std::string wire;
+    std::vector<char> decoded;
+    size_t totalRaw = 0;
+    size_t totalElementWire = 0;
+    size_t totalPackedWire = 0;
+    double totalElementMs = 0.0;
+    double totalPackedMs = 0.0;
+    bool allMatch = true;
+    for (const MeshArray & array : arrays)
+    {
+        const size_t raw = array.mCount * array.mElementSize;
+        std::cout << "\n" << array.mName << ", " << array.mCount << " elements, "
+                  << raw / (1024 * 1024) << " MB\n";
+
+        // encode and serialize, what the client pays per array
+        const double elementEncodeMs = medianMs(settings.mRuns, [&]() {
+            encodeElements(array, settings.mItem, elementRequest);
+            elementRequest.SerializeToString(&wire);
+        });
+        const size_t elementWire = wire.size();
+        const double elementDecodeMs = medianMs(settings.mRuns, [&]() {
+            elementRequest.ParseFromString(wire);
+            decodeElements(elementRequest, decoded);
+        });
+        allMatch = allMatch && decoded.size() == raw && std::memcmp(decoded.data(), array.mData, raw) == 0;
+
+        const double packedEncodeMs = medianMs(settings.mRuns, [&]() {
+            encodePacked(array, settings.mItem, packedRequest);
+            packedRequest.SerializeToString(&wire);
+        });
+        const size_t packedWire = wire.size();
+        const double packedDecodeMs = medianMs(settings.mRuns, [&]() {
+            packedRequest.ParseFromString(wire);
+            decodePacked(packedRequest, decoded);
+        });
+        allMatch = allMatch && decoded.size() == raw && std::memcmp(decoded.data(), array.mData, raw) == 0;
+
+        printRow("per element encode", elementEncodeMs, elementEncodeMs, raw);
+        printRow("packed encode", packedEncodeMs, elementEncodeMs, raw);
+        printRow("per element decode", elementDecodeMs, elementDecodeMs, raw);
+        printRow("packed decode", packedDecodeMs, elementDecodeMs, raw);
+        std::cout << "  on the wire: " << elementWire << " bytes per element, " << packedWire
+                  << " bytes packed (" << std::setprecision(0) << 100.0 * elementWire / packedWire - 100.0
+                  << "% more per element)\n";
+
+        totalRaw += raw;
+        totalElementWire += elementWire;
+        totalPackedWire += packedWire;
+        totalElementMs += elementEncodeMs + elementDecodeMs;
+        totalPackedMs += packedEncodeMs + packedDecodeMs;
+    }
+
+    std::cout << "\nwhole mesh, encode and decode\n";
+    printRow("per element", totalElementMs, totalElementMs, totalRaw);
+    printRow("packed", totalPackedMs, totalElementMs, totalRaw);
+    std::cout << "  on the wire: " << totalElementWire / (1024 * 1024) << " MB per element, "
+              << totalPackedWire / (1024 * 1024) << " MB packed\n";
+
+    // uploads, with the conversion of octane_arrays and the work of Octane included
+    if (!settings.mOctane.empty() && !settings.mArrays.empty())
+    {
+        auto octaneStub = octaneapi::ApiItemService::NewStub(
+            grpc::CreateChannel(settings.mOctane, grpc::InsecureChannelCredentials()));
+        auto arraysStub = octanearrays::ItemArrayTransfer::NewStub(
+            grpc::CreateChannel(settings.mArrays, grpc::InsecureChannelCredentials()));
+        bool uploadsOk = true;
+
+        const double directMs = medianMs(settings.mRuns, [&]() {
+            for (const MeshArray & array : arrays)
+            {
+                encodeElements(array, settings.mItem, elementRequest);
+                grpc::ClientContext context;
+                octaneapi::ApiItem::setArrayResponse response;
+                uploadsOk = checkStatus(octaneStub->setArrayByAttrID(&context, elementRequest, &response), "setArrayByAttrID") && uploadsOk;
+            }
+        });
+        const double packedMs = medianMs(settings.mRuns, [&]() {
+            for (const MeshArray & array : arrays)
+            {
+                encodePacked(array, settings.mItem, packedRequest);
+                grpc::ClientContext context;
+                octanearrays::SetPackedArrayResponse response;
+                uploadsOk = checkStatus(arraysStub->setPackedArray(&context, packedRequest, &response), "setPackedArray") && uploadsOk;
+            }
+        });
+
+        // whole elements per chunk, like ItemArraySdk::setStream()
+        const size_t chunkBytes = settings.mChunkKb * 1024 / 12 * 12;
+        uint64_t chunks = 0;
+        const double streamMs = medianMs(settings.mRuns, [&]() {
+            chunks = 0;
+            for (const MeshArray & array : arrays)
+            {
+                uploadsOk = checkStatus(streamArray(*arraysStub, array, settings.mItem, chunkBytes, chunks), "setArrayStream") && uploadsOk;
+            }
+        });
+
+        std::cout << "\nwhole mesh, upload\n";
+        printRow("setArrayByAttrID", directMs, directMs, totalRaw);
+        printRow("setPackedArray", packedMs, directMs, totalRaw);
+        printRow("setArrayStream", streamMs, directMs, totalRaw);
+        std::cout << "  stream: " << chunks << " chunks of " << chunkBytes / 1024 << " KB held by the client, "
+                  << "setPackedArray holds a request of up to " << mesh.mVertices.size() * 4 / (1024 * 1024) << " MB\n";
+        std::cout << "  " << std::setprecision(2) << vertices / (directMs * 1000.0) << " vs "
+                  << vertices / (packedMs * 1000.0) << " M vertices/s\n";
+
+        // scene rebuild: all arrays again in one transaction, or through the blob cache where an
+        // unchanged array costs its hash and key
+        auto blobStub = octanearrays::BlobCache::NewStub(
+            grpc::CreateChannel(settings.mArrays, grpc::InsecureChannelCredentials()));
+        const double resendMs = medianMs(settings.mRuns, [&]() {
+            octanearrays::SetArraysRequest request;
+            request.set_itemhandle(settings.mItem);
+            for (const MeshArray & array : arrays)
+            {
+                octanearrays::AttributeArray * attribute = request.add_arrays();
+                attribute->set_attributeid((uint32_t)array.mAttribute);
+                attribute->mutable_array()->set_type(array.mType);
+                attribute->mutable_array()->set_count(array.mCount);
+                attribute->mutable_array()->set_data(array.mData, array.mCount * array.mElementSize);
+            }
+            grpc::ClientContext context;
+            octanearrays::SetPackedArrayResponse response;
+            uploadsOk = checkStatus(arraysStub->setArrays(&context, request, &response), "setArrays") && uploadsOk;
+        });
+        const std::vector<MeshArray> meshArrays(std::begin(arrays), std::end(arrays));
+        std::vector<float> editedVertices = mesh.mVertices;
+        std::vector<MeshArray> editedArrays = meshArrays;
+        editedArrays[0].mData = editedVertices.data();
+        uint64_t coldBytes = 0;
+        uint64_t unchangedBytes = 0;
+        uint64_t changedBytes = 0;
+        const auto coldStart = std::chrono::high_resolution_clock::now();
+        uploadsOk = checkStatus(rebuildFromBlobs(*blobStub, *arraysStub, meshArrays, settings.mItem, coldBytes), "blob rebuild") && uploadsOk;
+        const double coldMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - coldStart).count();
+        const double unchangedMs = medianMs(settings.mRuns, [&]() {
+            unchangedBytes = 0;
+            uploadsOk = checkStatus(rebuildFromBlobs(*blobStub, *arraysStub, meshArrays, settings.mItem, unchangedBytes), "blob rebuild") && uploadsOk;
+        });
+        // an edit that moves one vertex, the normals and indices stay as they are
+        const double changedMs = medianMs(settings.mRuns, [&]() {
+            editedVertices[0] += 0.001f;
+            changedBytes = 0;
+            uploadsOk = checkStatus(rebuildFromBlobs(*blobStub, *arraysStub, editedArrays, settings.mItem, changedBytes), "blob rebuild") && uploadsOk;
+        });
+
+        std::cout << "\nscene rebuild, whole mesh in one transaction\n";
+        printRow("setArrays, all arrays", resendMs, resendMs, totalRaw);
+        printRow("blobs, first upload", coldMs, resendMs, totalRaw);
+        printRow("blobs, unchanged", unchangedMs, resendMs, totalRaw);
+        printRow("blobs, vertices changed", changedMs, resendMs, totalRaw);
+        std::cout << "  sent " << coldBytes / (1024 * 1024) << " / " << unchangedBytes / (1024 * 1024) << " / "
+                  << changedBytes / (1024 * 1024) << " MB of " << totalRaw / (1024 * 1024) << " MB\n";
+
+        // read back what was uploaded, into a buffer that is reused across runs like
+        // ItemArraySdk::read() does
+        std::vector<char> readBuffer(std::max(mesh.mVertices.size(), mesh.mIndices.size()) * 4);
+        const double directReadMs = medianMs(settings.mRuns, [&]() {
+            for (const MeshArray & array : arrays)
+            {
+                octaneapi::ApiItem::getArrayByIDRequest request;
+                auto * ref = request.mutable_item_ref();
+                ref->set_type(octaneapi::ObjectRef_ObjectType::ObjectRef_ObjectType_ApiItem);
+                ref->set_handle(settings.mItem);
+                request.set_attribute_id(array.mAttribute);
+                request.set_expected_type(array.mType == octanearrays::PACKED_FLOAT3 ? octaneapi::ATTR_ID_FLOAT3
+                                                                                     : octaneapi::ATTR_ID_INT);
+                grpc::ClientContext context;
+                octaneapi::ApiItem::getArrayResponse response;
+                uploadsOk = checkStatus(octaneStub->getArrayByAttrID(&context, request, &response), "getArrayByAttrID") && uploadsOk;
+                if (response.has_float3_array())
+                {
+                    float * v = (float *)readBuffer.data();
+                    for (const auto & e : response.float3_array().data())
+                    {
+                        *v++ = e.x();
+                        *v++ = e.y();
+                        *v++ = e.z();
+                    }
+                }
+                else
+                {
+                    std::memcpy(readBuffer.data(), response.int_array().data().data(), response.int_array().data_size() * 4);
+                }
+            }
+        });
+        const double packedReadMs = medianMs(settings.mRuns, [&]() {
+            for (const MeshArray & array : arrays)
+            {
+                octanearrays::GetPackedArrayRequest request;
+                request.set_itemhandle(settings.mItem);
+                request.set_attributeid((uint32_t)array.mAttribute);
+                request.set_type(array.mType);
+                grpc::ClientContext context;
+                octanearrays::GetPackedArrayResponse response;
+                uploadsOk = checkStatus(arraysStub->getPackedArray(&context, request, &response), "getPackedArray") && uploadsOk;
+                const std::string & data = response.array().data();
+                std::memcpy(readBuffer.data(), data.data(), std::min(data.size(), readBuffer.size()));
+            }
+        });
+
+        std::cout << "\nwhole mesh, read back\n";
+        printRow("getArrayByAttrID", directReadMs, directReadMs, totalRaw);
+        printRow("getPackedArray", packedReadMs, directReadMs, totalRaw);
+        if (!uploadsOk)
+        {
+            std::cout << "  some calls FAILED\n";
+            return 1;
+        }
+    }
+
+    const bool animationOk = settings.mFrames == 0 || benchAnimation(settings);
+
+    std::cout << "\nDecoded arrays " << (allMatch ? "match" : "DO NOT match") << " the mesh\n";
+    return allMatch && animationOk ? 0 : 1;
+}
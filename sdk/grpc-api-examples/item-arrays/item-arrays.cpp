@@ -0,0 +1,1633 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+// Packed item arrays: runs on the Octane host and serves setPackedArray and getPackedArray
+// (item_array_transfer.proto). ApiItemService encodes every element of a vertex, normal or index
+// array as a protobuf sub message, here a whole array is one little endian bytes field the client
+// filled with a memcpy. The service reads the elements straight out of the bytes and passes them
+// to Octane over the local connection, so only the packed array crosses the network. Clients use
+// ItemArraySdk (shared/item_array_sdk.h). Arrays too big for one message come through
+// setArrayStream in chunks, which are converted as they arrive. setArrays sets all arrays of a
+// mesh in one call and evaluates once; it reads the previous value of every attribute before
+// overwriting it, so a refused array puts the ones already set back.
+//
+// setAnimStream takes an animated array one time sample per message, optionally as differences to
+// the previous sample and as half floats or 16 bit steps, and hands Octane all of them at the end.
+//
+// The BlobCache service of the same process keeps uploaded payloads by their XXH64, so a client
+// rebuilding a mostly unchanged scene sends a key instead of the mesh arrays, images and texture
+// files it sent before. Texture files go to --blob-dir, where they outlive the service.
+//
+//   octane_arrays [--address host:port] [--upstream host:port] [--blob-memory MB] [--blob-dir path]
+
+// system headers
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+// protoc generated headers
+// apiItem
+#include "apinodesystem_3.grpc.pb.h"
+#include "item_array_transfer.grpc.pb.h"
+// apiImage
+#include "apiimage.grpc.pb.h"
+// shared helpers
+#include "../../../shared/anim_sample_codec.h"
+#include "../../../shared/content_hash.h"
+
+using octanearrays::PackedArray;
+using octanearrays::PackedType;
+
+
+//--------------------------------------------------------------------------------------------------
+/// Settings of the service.
+struct ArraySettings
+{
+    /// Clients are on other machines, listen on all interfaces.
+    std::string mAddress       = "0.0.0.0:50055";
+    std::string mUpstream      = "127.0.0.1:50051";
+    /// Arrays read for a size query wait this long for the get that follows, at most this many.
+    uint32_t    mSizedKeepMs   = 2000;
+    size_t      mSizedMax      = 16;
+    /// Blobs kept in memory, the least recently used go first.
+    size_t      mBlobMemoryMb  = 1024;
+    /// Texture files written for blobFile, empty for octane_blobs in the temp directory.
+    std::string mBlobDir;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+// Packed encoding
+
+/// Bytes of one element of a packed array, 0 for an unknown type.
+static size_t elementSize(
+    const PackedType type)
+{
+    switch (type)
+    {
+    case octanearrays::PACKED_BOOL:   return 1;
+    case octanearrays::PACKED_INT:    return 4;
+    case octanearrays::PACKED_INT2:   return 8;
+    case octanearrays::PACKED_INT3:   return 12;
+    case octanearrays::PACKED_INT4:   return 16;
+    case octanearrays::PACKED_LONG:   return 8;
+    case octanearrays::PACKED_LONG2:  return 16;
+    case octanearrays::PACKED_FLOAT:  return 4;
+    case octanearrays::PACKED_FLOAT2: return 8;
+    case octanearrays::PACKED_FLOAT3: return 12;
+    case octanearrays::PACKED_FLOAT4: return 16;
+    case octanearrays::PACKED_MATRIX: return 48;
+    case octanearrays::PACKED_BYTE:   return 1;
+    default:                          return 0;
+    }
+}
+
+
+/// True for the types whose components are 32 bit floats, the ones lossy samples apply to.
+static bool hasFloats(
+    const PackedType type)
+{
+    return type >= octanearrays::PACKED_FLOAT && type <= octanearrays::PACKED_MATRIX;
+}
+
+
+/// The attribute type getArrayByAttrID checks the array against.
+static octaneapi::AttributeTypeId attributeType(
+    const PackedType type)
+{
+    switch (type)
+    {
+    case octanearrays::PACKED_BOOL:   return octaneapi::ATTR_ID_BOOL;
+    case octanearrays::PACKED_INT:    return octaneapi::ATTR_ID_INT;
+    case octanearrays::PACKED_INT2:   return octaneapi::ATTR_ID_INT2;
+    case octanearrays::PACKED_INT3:   return octaneapi::ATTR_ID_INT3;
+    case octanearrays::PACKED_INT4:   return octaneapi::ATTR_ID_INT4;
+    case octanearrays::PACKED_LONG:   return octaneapi::ATTR_ID_LONG;
+    case octanearrays::PACKED_LONG2:  return octaneapi::ATTR_ID_LONG2;
+    case octanearrays::PACKED_FLOAT:  return octaneapi::ATTR_ID_FLOAT;
+    case octanearrays::PACKED_FLOAT2: return octaneapi::ATTR_ID_FLOAT2;
+    case octanearrays::PACKED_FLOAT3: return octaneapi::ATTR_ID_FLOAT3;
+    case octanearrays::PACKED_FLOAT4: return octaneapi::ATTR_ID_FLOAT4;
+    case octanearrays::PACKED_MATRIX: return octaneapi::ATTR_ID_MATRIX;
+    case octanearrays::PACKED_BYTE:   return octaneapi::ATTR_ID_BYTE;
+    default:                          return octaneapi::ATTR_ID_UNDEFINED;
+    }
+}
+
+
+/// Elements to reserve in a repeated field of size elements that count are appended to and that
+/// will hold total in the end. Repeated fields index with int, larger arrays are refused before
+/// they get here.
+static int reserveCount(
+    const int    size,
+    const size_t count,
+    const size_t total)
+{
+    return (int)std::min(std::max(total, (size_t)size + count), (size_t)INT_MAX);
+}
+
+
+/// The part of a total announced by a stream that is reserved once received elements arrived.
+/// Twice what came so far, so a count the stream doesn't live up to can't make the service
+/// allocate far more than it was sent, and the array still grows by doubling at most.
+static size_t reserveAhead(
+    const size_t received,
+    const size_t declared)
+{
+    return std::min(declared, std::max(received, (size_t)1) * 2);
+}
+
+
+/// Appends a packed scalar array to a repeated field with one memcpy, protobuf keeps scalars
+/// in a flat array of the same layout.
+template <typename T>
+static void unpackScalars(
+    const char *                            data,
+    const size_t                            count,
+    const size_t                            total,
+    google::protobuf::RepeatedField<T> *    out)
+{
+    const int size = out->size();
+    out->Reserve(reserveCount(size, count, total));
+    out->Resize(size + (int)count, T());
+    if (count > 0)
+    {
+        std::memcpy(out->mutable_data() + size, data, count * sizeof(T));
+    }
+}
+
+
+/// Reads N components of type T of every element and hands them to add(), which appends the
+/// element to the request.
+template <typename T, size_t N, typename Add>
+static void unpackVectors(
+    const char * data,
+    const size_t count,
+    Add          add)
+{
+    T v[N];
+    for (size_t i = 0; i < count; ++i, data += sizeof(v))
+    {
+        std::memcpy(v, data, sizeof(v));
+        add(v);
+    }
+}
+
+
+/// Appends count elements of a packed array to the array of a setArrayByAttrID or setAnimByAttr
+/// request, both name their arrays alike. total is the number of elements the array will have in
+/// the end if known, so it's allocated once.
+template <typename Request>
+static void unpack(
+    const PackedType                            type,
+    const char *                                data,
+    const size_t                                count,
+    const size_t                                total,
+    Request &                                   request)
+{
+    switch (type)
+    {
+    case octanearrays::PACKED_BOOL:
+    {
+        auto * out = request.mutable_bool_array()->mutable_data();
+        out->Reserve(reserveCount(out->size(), count, total));
+        for (size_t i = 0; i < count; ++i)
+        {
+            out->Add(data[i] != 0);
+        }
+        break;
+    }
+    case octanearrays::PACKED_INT:
+        unpackScalars(data, count, total, request.mutable_int_array()->mutable_data());
+        break;
+    case octanearrays::PACKED_INT2:
+    {
+        auto * out = request.mutable_int2_array()->mutable_data();
+        out->Reserve(reserveCount(out->size(), count, total));
+        unpackVectors<int32_t, 2>(data, count, [out](const int32_t * v)
+        {
+            auto * e = out->Add();
+            e->set_x(v[0]);
+            e->set_y(v[1]);
+        });
+        break;
+    }
+    case octanearrays::PACKED_INT3:
+    {
+        auto * out = request.mutable_int3_array()->mutable_data();
+        out->Reserve(reserveCount(out->size(), count, total));
+        unpackVectors<int32_t, 3>(data, count, [out](const int32_t * v)
+        {
+            auto * e = out->Add();
+            e->set_x(v[0]);
+            e->set_y(v[1]);
+            e->set_z(v[2]);
+        });
+        break;
+    }
+    case octanearrays::PACKED_INT4:
+    {
+        auto * out = request.mutable_int4_array()->mutable_data();
+        out->Reserve(reserveCount(out->size(), count, total));
+        unpackVectors<int32_t, 4>(data, count, [out](const int32_t * v)
+        {
+            auto * e = out->Add();
+            e->set_x(v[0]);
+            e->set_y(v[1]);
+            e->set_z(v[2]);
+            e->set_w(v[3]);
+        });
+        break;
+    }
+    case octanearrays::PACKED_LONG:
+        unpackScalars(data, count, total, request.mutable_long_array()->mutable_data());
+        break;
+    case octanearrays::PACKED_LONG2:
+    {
+        auto * out = request.mutable_long2_array()->mutable_data();
+        out->Reserve(reserveCount(out->size(), count, total));
+        unpackVectors<int64_t, 2>(data, count, [out](const int64_t * v)
+        {
+            auto * e = out->Add();
+            e->set_x(v[0]);
+            e->set_y(v[1]);
+        });
+        break;
+    }
+    case octanearrays::PACKED_FLOAT:
+        unpackScalars(data, count, total, request.mutable_float_array()->mutable_data());
+        break;
+    case octanearrays::PACKED_FLOAT2:
+    {
+        auto * out = request.mutable_float2_array()->mutable_data();
+        out->Reserve(reserveCount(out->size(), count, total));
+        unpackVectors<float, 2>(data, count, [out](const float * v)
+        {
+            auto * e = out->Add();
+            e->set_x(v[0]);
+            e->set_y(v[1]);
+        });
+        break;
+    }
+    case octanearrays::PACKED_FLOAT3:
+    {
+        auto * out = request.mutable_float3_array()->mutable_data();
+        out->Reserve(reserveCount(out->size(), count, total));
+        unpackVectors<float, 3>(data, count, [out](const float * v)
+        {
+            auto * e = out->Add();
+            e->set_x(v[0]);
+            e->set_y(v[1]);
+            e->set_z(v[2]);
+        });
+        break;
+    }
+    case octanearrays::PACKED_FLOAT4:
+    {
+        auto * out = request.mutable_float4_array()->mutable_data();
+        out->Reserve(reserveCount(out->size(), count, total));
+        unpackVectors<float, 4>(data, count, [out](const float * v)
+        {
+            auto * e = out->Add();
+            e->set_x(v[0]);
+            e->set_y(v[1]);
+            e->set_z(v[2]);
+            e->set_w(v[3]);
+        });
+        break;
+    }
+    case octanearrays::PACKED_MATRIX:
+    {
+        auto * out = request.mutable_matrix_array()->mutable_data();
+        out->Reserve(reserveCount(out->size(), count, total));
+        unpackVectors<float, 12>(data, count, [out](const float * v)
+        {
+            auto * matrix = out->Add();
+            for (int row = 0; row < 3; ++row)
+            {
+                auto * r = matrix->add_m();
+                r->set_x(v[row * 4 + 0]);
+                r->set_y(v[row * 4 + 1]);
+                r->set_z(v[row * 4 + 2]);
+                r->set_w(v[row * 4 + 3]);
+            }
+        });
+        break;
+    }
+    case octanearrays::PACKED_BYTE:
+    {
+        std::string * out = request.mutable_byte_array()->mutable_data();
+        out->reserve(std::max(total, out->size() + count));
+        out->append(data, count);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+
+/// Appends N components of type T per element to the packed bytes.
+template <typename T, size_t N, typename Elements, typename Get>
+static void packVectors(
+    const Elements & elements,
+    std::string &    out,
+    Get              get)
+{
+    out.resize((size_t)elements.size() * N * sizeof(T));
+    char * p = &out[0];
+    T v[N];
+    for (const auto & e : elements)
+    {
+        get(e, v);
+        std::memcpy(p, v, sizeof(v));
+        p += sizeof(v);
+    }
+}
+
+
+template <typename T>
+static void packScalars(
+    const google::protobuf::RepeatedField<T> &  in,
+    std::string &                               out)
+{
+    out.resize((size_t)in.size() * sizeof(T));
+    if (in.size() > 0)
+    {
+        std::memcpy(&out[0], in.data(), out.size());
+    }
+}
+
+
+/// Packs the array of a getArrayByAttrID response. Returns false if it doesn't hold an array of
+/// type.
+static bool pack(
+    const octaneapi::ApiItem::getArrayResponse &    response,
+    const PackedType                                type,
+    PackedArray &                                   array)
+{
+    std::string & out = *array.mutable_data();
+    uint64_t count = 0;
+    switch (type)
+    {
+    case octanearrays::PACKED_BOOL:
+    {
+        if (!response.has_bool_array())
+        {
+            return false;
+        }
+        const auto & in = response.bool_array().data();
+        out.resize((size_t)in.size());
+        for (int i = 0; i < in.size(); ++i)
+        {
+            out[i] = in.Get(i) ? 1 : 0;
+        }
+        count = in.size();
+        break;
+    }
+    case octanearrays::PACKED_INT:
+        if (!response.has_int_array())
+        {
+            return false;
+        }
+        packScalars(response.int_array().data(), out);
+        count = response.int_array().data_size();
+        break;
+    case octanearrays::PACKED_INT2:
+        if (!response.has_int2_array())
+        {
+            return false;
+        }
+        packVectors<int32_t, 2>(response.int2_array().data(), out, [](const octaneapi::int32_2 & e, int32_t * v)
+        {
+            v[0] = e.x(); v[1] = e.y();
+        });
+        count = response.int2_array().data_size();
+        break;
+    case octanearrays::PACKED_INT3:
+        if (!response.has_int3_array())
+        {
+            return false;
+        }
+        packVectors<int32_t, 3>(response.int3_array().data(), out, [](const octaneapi::int32_3 & e, int32_t * v)
+        {
+            v[0] = e.x(); v[1] = e.y(); v[2] = e.z();
+        });
+        count = response.int3_array().data_size();
+        break;
+    case octanearrays::PACKED_INT4:
+        if (!response.has_int4_array())
+        {
+            return false;
+        }
+        packVectors<int32_t, 4>(response.int4_array().data(), out, [](const octaneapi::int32_4 & e, int32_t * v)
+        {
+            v[0] = e.x(); v[1] = e.y(); v[2] = e.z(); v[3] = e.w();
+        });
+        count = response.int4_array().data_size();
+        break;
+    case octanearrays::PACKED_LONG:
+        if (!response.has_long_array())
+        {
+            return false;
+        }
+        packScalars(response.long_array().data(), out);
+        count = response.long_array().data_size();
+        break;
+    case octanearrays::PACKED_LONG2:
+        if (!response.has_long2_array())
+        {
+            return false;
+        }
+        packVectors<int64_t, 2>(response.long2_array().data(), out, [](const octaneapi::int64_2 & e, int64_t * v)
+        {
+            v[0] = e.x(); v[1] = e.y();
+        });
+        count = response.long2_array().data_size();
+        break;
+    case octanearrays::PACKED_FLOAT:
+        if (!response.has_float_array())
+        {
+            return false;
+        }
+        packScalars(response.float_array().data(), out);
+        count = response.float_array().data_size();
+        break;
+    case octanearrays::PACKED_FLOAT2:
+        if (!response.has_float2_array())
+        {
+            return false;
+        }
+        packVectors<float, 2>(response.float2_array().data(), out, [](const octaneapi::float_2 & e, float * v)
+        {
+            v[0] = e.x(); v[1] = e.y();
+        });
+        count = response.float2_array().data_size();
+        break;
+    case octanearrays::PACKED_FLOAT3:
+        if (!response.has_float3_array())
+        {
+            return false;
+        }
+        packVectors<float, 3>(response.float3_array().data(), out, [](const octaneapi::float_3 & e, float * v)
+        {
+            v[0] = e.x(); v[1] = e.y(); v[2] = e.z();
+        });
+        count = response.float3_array().data_size();
+        break;
+    case octanearrays::PACKED_FLOAT4:
+        if (!response.has_float4_array())
+        {
+            return false;
+        }
+        packVectors<float, 4>(response.float4_array().data(), out, [](const octaneapi::float_4 & e, float * v)
+        {
+            v[0] = e.x(); v[1] = e.y(); v[2] = e.z(); v[3] = e.w();
+        });
+        count = response.float4_array().data_size();
+        break;
+    case octanearrays::PACKED_MATRIX:
+        if (!response.has_matrix_array())
+        {
+            return false;
+        }
+        packVectors<float, 12>(response.matrix_array().data(), out, [](const octaneapi::MatrixF & e, float * v)
+        {
+            for (int row = 0; row < 3; ++row)
+            {
+                const octaneapi::float_4 & r = row < e.m_size() ? e.m(row) : octaneapi::float_4::default_instance();
+                v[row * 4 + 0] = r.x();
+                v[row * 4 + 1] = r.y();
+                v[row * 4 + 2] = r.z();
+                v[row * 4 + 3] = r.w();
+            }
+        });
+        count = response.matrix_array().data_size();
+        break;
+    case octanearrays::PACKED_BYTE:
+        if (!response.has_byte_array())
+        {
+            return false;
+        }
+        out = response.byte_array().data();
+        count = out.size();
+        break;
+    default:
+        return false;
+    }
+    array.set_type(type);
+    array.set_count(count);
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Blob store
+
+/// Uploaded payloads by their content key. Blobs are kept in memory up to a limit; the ones
+/// written out as files for blobFile are found again in the blob directory after a restart.
+class BlobStore
+{
+public:
+    typedef std::shared_ptr<const std::string> Blob;
+
+    explicit BlobStore(
+        const ArraySettings & settings)
+    :
+        mMemoryLimit(settings.mBlobMemoryMb * 1024 * 1024),
+        mDirectory(settings.mBlobDir)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(mDirectory, error);
+        // files of earlier runs, named <key><extension>
+        for (const auto & entry : std::filesystem::directory_iterator(mDirectory, error))
+        {
+            SharedUtils::ContentKey key;
+            if (parseFileName(entry.path().filename().string(), key))
+            {
+                mFiles[key] = entry.path().string();
+            }
+        }
+    }
+
+    static SharedUtils::ContentKey toKey(
+        const octanearrays::BlobKey & key)
+    {
+        SharedUtils::ContentKey result;
+        result.hash = key.hash();
+        result.size = key.size();
+        return result;
+    }
+
+    /// The blob of key from memory or from its file, null if the store doesn't have it.
+    Blob find(
+        const octanearrays::BlobKey & key)
+    {
+        const SharedUtils::ContentKey contentKey = toKey(key);
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mBlobs.find(contentKey);
+            if (it != mBlobs.end())
+            {
+                mLru.splice(mLru.end(), mLru, it->second.mLru);
+                mHits += 1;
+                return it->second.mData;
+            }
+            auto file = mFiles.find(contentKey);
+            if (file == mFiles.end())
+            {
+                mMisses += 1;
+                return nullptr;
+            }
+            path = file->second;
+        }
+
+        std::ifstream in(path, std::ios::binary);
+        auto data = std::make_shared<std::string>(contentKey.size, '\0');
+        if (!in.read(&(*data)[0], (std::streamsize)data->size()) ||
+            SharedUtils::contentKey(data->data(), data->size()) != contentKey)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mFiles.erase(contentKey);
+            mMisses += 1;
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mHits += 1;
+        return insert(contentKey, data);
+    }
+
+    bool contains(
+        const octanearrays::BlobKey & key)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const SharedUtils::ContentKey contentKey = toKey(key);
+        return mBlobs.count(contentKey) != 0 || mFiles.count(contentKey) != 0;
+    }
+
+    grpc::Status put(
+        const octanearrays::BlobKey &   key,
+        std::string &&                  data)
+    {
+        const SharedUtils::ContentKey contentKey = toKey(key);
+        if (SharedUtils::contentKey(data.data(), data.size()) != contentKey)
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "data doesn't match blob " + contentKey.toString());
+        }
+        auto blob = std::make_shared<const std::string>(std::move(data));
+        std::lock_guard<std::mutex> lock(mMutex);
+        insert(contentKey, blob);
+        mStored += 1;
+        mBytesStored += contentKey.size;
+        return grpc::Status::OK;
+    }
+
+    /// Path of the file holding the blob of key, written if it doesn't exist yet.
+    grpc::Status file(
+        const octanearrays::BlobKey &   key,
+        const std::string &             extension,
+        std::string &                   path)
+    {
+        for (const char c : extension)
+        {
+            if (!std::isalnum((unsigned char)c) && c != '.')
+            {
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "invalid extension " + extension);
+            }
+        }
+        const SharedUtils::ContentKey contentKey = toKey(key);
+        const std::filesystem::path target = std::filesystem::path(mDirectory) / (contentKey.toString() + extension);
+        path = target.string();
+        std::error_code error;
+        if (std::filesystem::file_size(target, error) == contentKey.size && !error)
+        {
+            return grpc::Status::OK;
+        }
+
+        const Blob blob = find(key);
+        if (!blob)
+        {
+            return grpc::Status(grpc::StatusCode::NOT_FOUND, "blob " + contentKey.toString() + " is not stored");
+        }
+        // written under another name first, a reader never sees half a file
+        const std::filesystem::path partial = target.string() + ".part";
+        {
+            std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+            if (!out.write(blob->data(), (std::streamsize)blob->size()))
+            {
+                return grpc::Status(grpc::StatusCode::INTERNAL, "can't write " + partial.string());
+            }
+        }
+        std::filesystem::rename(partial, target, error);
+        if (error)
+        {
+            return grpc::Status(grpc::StatusCode::INTERNAL, "can't write " + path + ": " + error.message());
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFiles[contentKey] = path;
+        mFilesWritten += 1;
+        return grpc::Status::OK;
+    }
+
+    void printReport(
+        std::ostream & out) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        out << "[Blobs] " << mHits << " found, " << mMisses << " missing, " << mStored << " stored ("
+            << mBytesStored / (1024 * 1024) << " MB), " << mEvicted << " evicted, " << mFilesWritten
+            << " files written, " << mBlobs.size() << " in memory (" << mMemory / (1024 * 1024) << " MB)\n";
+    }
+
+private:
+    struct Entry
+    {
+        Blob                                                mData;
+        std::list<SharedUtils::ContentKey>::iterator        mLru;
+    };
+
+    static bool parseFileName(
+        const std::string &         name,
+        SharedUtils::ContentKey &   key)
+    {
+        const size_t dash = name.find('-');
+        if (dash != 16 || name.size() < 18 || name.compare(name.size() - 5, 5, ".part") == 0)
+        {
+            return false;
+        }
+        char * end = nullptr;
+        key.hash = std::strtoull(name.substr(0, 16).c_str(), &end, 16);
+        if (*end != '\0' || !std::isdigit((unsigned char)name[17]))
+        {
+            return false;
+        }
+        key.size = std::strtoull(name.c_str() + 17, nullptr, 10);
+        return true;
+    }
+
+    /// Adds a blob and evicts the least recently used beyond the limit, called with mMutex held.
+    Blob insert(
+        const SharedUtils::ContentKey &     key,
+        const Blob &                        blob)
+    {
+        auto it = mBlobs.find(key);
+        if (it != mBlobs.end())
+        {
+            mLru.splice(mLru.end(), mLru, it->second.mLru);
+            return it->second.mData;
+        }
+        mLru.push_back(key);
+        mBlobs[key] = { blob, std::prev(mLru.end()) };
+        mMemory += blob->size();
+        while (mMemory > mMemoryLimit && mLru.size() > 1)
+        {
+            auto oldest = mBlobs.find(mLru.front());
+            mMemory -= oldest->second.mData->size();
+            mBlobs.erase(oldest);
+            mLru.pop_front();
+            mEvicted += 1;
+        }
+        return blob;
+    }
+
+    const size_t                                                mMemoryLimit;
+    const std::string                                           mDirectory;
+    mutable std::mutex                                          mMutex;
+    std::map<SharedUtils::ContentKey, Entry>                    mBlobs;
+    std::list<SharedUtils::ContentKey>                          mLru;
+    std::map<SharedUtils::ContentKey, std::string>              mFiles;
+    size_t                                                      mMemory         = 0;
+    uint64_t                                                    mHits           = 0;
+    uint64_t                                                    mMisses         = 0;
+    uint64_t                                                    mStored         = 0;
+    uint64_t                                                    mBytesStored    = 0;
+    uint64_t                                                    mEvicted        = 0;
+    uint64_t                                                    mFilesWritten   = 0;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+// Service
+
+class ItemArrayService final : public octanearrays::ItemArrayTransfer::Service
+{
+public:
+    ItemArrayService(
+        const ArraySettings &   settings,
+        BlobStore &             blobs)
+    :
+        mSettings(settings),
+        mBlobs(blobs)
+    {
+        // arrays of a big mesh are well above the default 4 MB receive limit
+        grpc::ChannelArguments arguments;
+        arguments.SetMaxReceiveMessageSize(-1);
+        mChannel = grpc::CreateCustomChannel(settings.mUpstream, grpc::InsecureChannelCredentials(), arguments);
+        mItemStub = octaneapi::ApiItemService::NewStub(mChannel);
+    }
+
+    grpc::Status setPackedArray(
+        grpc::ServerContext *                                   context,
+        const octanearrays::SetPackedArrayRequest *             request,
+        octanearrays::SetPackedArrayResponse *                  response) override
+    {
+        const PackedArray & array = request->array();
+        const size_t size = elementSize(array.type());
+        if (size == 0)
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "unknown array type");
+        }
+        if (array.data().size() % size != 0 || array.count() != array.data().size() / size)
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                "array of " + std::to_string(array.count()) + " elements has " +
+                                std::to_string(array.data().size()) + " bytes");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mSizedMutex);
+            dropSized(request->itemhandle(), request->attributeid());
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        octaneapi::ApiItem::setArrayByIDRequest upstream;
+        startUpstream(request->itemhandle(), request->attributeid(), request->evaluate(), upstream);
+        unpack(array.type(), array.data().data(), (size_t)array.count(), (size_t)array.count(), upstream);
+        const auto converted = std::chrono::steady_clock::now();
+
+        const grpc::Status status = forward(upstream, start, converted, response);
+        if (status.ok())
+        {
+            mSets += 1;
+            mBytes += array.data().size();
+        }
+        return status;
+    }
+
+    grpc::Status setArrayStream(
+        grpc::ServerContext *                                   context,
+        grpc::ServerReader<octanearrays::SetArrayChunk> *       reader,
+        octanearrays::SetPackedArrayResponse *                  response) override
+    {
+        octanearrays::SetArrayChunk chunk;
+        if (!reader->Read(&chunk))
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "stream without chunks");
+        }
+        const PackedType type = chunk.type();
+        const size_t size = elementSize(type);
+        if (size == 0)
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "unknown array type");
+        }
+        if (chunk.count() > (uint64_t)INT_MAX)
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                std::to_string(chunk.count()) + " elements don't fit in an Octane array");
+        }
+        const size_t declared = (size_t)chunk.count();
+
+        {
+            std::lock_guard<std::mutex> lock(mSizedMutex);
+            dropSized(chunk.itemhandle(), chunk.attributeid());
+        }
+
+        // the elements go straight into the upstream request as the chunks arrive, only an
+        // element split between two chunks is copied aside
+        const auto start = std::chrono::steady_clock::now();
+        octaneapi::ApiItem::setArrayByIDRequest upstream;
+        startUpstream(chunk.itemhandle(), chunk.attributeid(), chunk.evaluate(), upstream);
+        std::string carry;
+        size_t      elements = 0;
+        uint64_t    bytes    = 0;
+        uint64_t    chunks   = 0;
+        do
+        {
+            const std::string & data   = chunk.data();
+            size_t              offset = 0;
+            chunks += 1;
+            bytes  += data.size();
+            if (!carry.empty())
+            {
+                offset = std::min(size - carry.size(), data.size());
+                carry.append(data, 0, offset);
+                if (carry.size() == size)
+                {
+                    unpack(type, carry.data(), 1, reserveAhead(elements + 1, declared), upstream);
+                    elements += 1;
+                    carry.clear();
+                }
+            }
+            const size_t whole = (data.size() - offset) / size;
+            if (elements + whole > (declared != 0 ? declared : (size_t)INT_MAX))
+            {
+                mErrors += 1;
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                    declared != 0 ? "more than the " + std::to_string(declared) + " elements announced"
+                                                  : std::string("more elements than fit in an Octane array"));
+            }
+            unpack(type, data.data() + offset, whole, reserveAhead(elements + whole, declared), upstream);
+            elements += whole;
+            offset += whole * size;
+            carry.append(data, offset, std::string::npos);
+        }
+        while (reader->Read(&chunk));
+
+        if (!carry.empty() || (declared != 0 && elements != declared))
+        {
+            mErrors += 1;
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                "stream of " + std::to_string(bytes) + " bytes doesn't hold the " +
+                                std::to_string(declared) + " elements announced");
+        }
+        const auto converted = std::chrono::steady_clock::now();
+
+        const grpc::Status status = forward(upstream, start, converted, response);
+        if (status.ok())
+        {
+            mStreams += 1;
+            mChunks += chunks;
+            mBytes += bytes;
+        }
+        return status;
+    }
+
+    grpc::Status setAnimStream(
+        grpc::ServerContext *                                   context,
+        grpc::ServerReader<octanearrays::AnimSample> *          reader,
+        octanearrays::SetPackedArrayResponse *                  response) override
+    {
+        octanearrays::AnimSample sample;
+        if (!reader->Read(&sample))
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "stream without samples");
+        }
+        const PackedType type     = sample.type();
+        const size_t     count    = (size_t)sample.count();
+        const size_t     declared = sample.samples();
+        // Octane gets all samples in one array, and the first sample isn't delta coded, so it
+        // takes at least 2 bytes per 4 byte component however it's encoded
+        if (sample.count() > (uint64_t)INT_MAX || (declared != 0 && count * declared > (size_t)INT_MAX) ||
+            (size_t)sample.data().size() * 2 < count * elementSize(type))
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                std::to_string(sample.count()) + " elements in " + std::to_string(declared) +
+                                " samples don't fit the first sample or an Octane array");
+        }
+        SharedUtils::SampleFormat format;
+        format.encoding    = (SharedUtils::SampleEncoding)sample.encoding();
+        format.delta       = sample.delta();
+        format.rangeMin    = sample.rangemin();
+        format.rangeMax    = sample.rangemax();
+        format.sampleBytes = count * elementSize(type);
+        format.floats      = hasFloats(type);
+        const std::string problem = elementSize(type) == 0 ? "unknown array type" : format.check();
+        if (!problem.empty())
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, problem);
+        }
+
+        // Octane takes all samples in one setAnimByAttr, they are decoded into it as they arrive
+        // and only the sample at hand is held besides
+        const auto start = std::chrono::steady_clock::now();
+        octaneapi::ApiItem::setAnimByIDRequest upstream;
+        auto * ref = upstream.mutable_item_ref();
+        ref->set_type(octaneapi::ObjectRef_ObjectType::ObjectRef_ObjectType_ApiItem);
+        ref->set_handle(sample.itemhandle());
+        upstream.set_attribute_id(static_cast<octaneapi::AttributeId>(sample.attributeid()));
+        upstream.set_evaluate(sample.evaluate());
+        toTimeSampling(sample.timing(), *upstream.mutable_times());
+
+        SharedUtils::SampleDecoder decoder(format);
+        std::vector<char> values(format.sampleBytes);
+        size_t   samples = 0;
+        uint64_t bytes   = 0;
+        do
+        {
+            if (!decoder.decode(sample.data().data(), sample.data().size(), values.data()))
+            {
+                mErrors += 1;
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                    "sample " + std::to_string(samples) + " doesn't hold " + std::to_string(count) + " elements");
+            }
+            if (count * (samples + 1) > (size_t)INT_MAX)
+            {
+                mErrors += 1;
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                    "more samples than fit in an Octane array");
+            }
+            unpack(type, values.data(), count, count * reserveAhead(samples + 1, declared), upstream);
+            samples += 1;
+            bytes += sample.data().size();
+            if (declared != 0 && samples > declared)
+            {
+                mErrors += 1;
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                    "more than the " + std::to_string(declared) + " samples announced");
+            }
+        }
+        while (reader->Read(&sample));
+
+        if (declared != 0 && samples != declared)
+        {
+            mErrors += 1;
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                std::to_string(samples) + " of the " + std::to_string(declared) + " samples announced");
+        }
+        upstream.set_num_time_samples((uint32_t)samples);
+        const auto converted = std::chrono::steady_clock::now();
+
+        grpc::ClientContext upstreamContext;
+        octaneapi::ApiItem::setAnimArrayResponse upstreamResponse;
+        const grpc::Status status = mItemStub->setAnimByAttr(&upstreamContext, upstream, &upstreamResponse);
+        addTiming(start, converted);
+        if (!status.ok())
+        {
+            mErrors += 1;
+            return status;
+        }
+        if (!upstreamResponse.success())
+        {
+            mErrors += 1;
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "setAnimByAttr refused: " + upstreamResponse.error_message());
+        }
+        mAnimStreams += 1;
+        mAnimSamples += samples;
+        mBytes += bytes;
+        response->set_success(true);
+        return grpc::Status::OK;
+    }
+
+    grpc::Status getPackedArray(
+        grpc::ServerContext *                                   context,
+        const octanearrays::GetPackedArrayRequest *             request,
+        octanearrays::GetPackedArrayResponse *                  response) override
+    {
+        if (elementSize(request->type()) == 0)
+        {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "unknown array type");
+        }
+
+        // the array of a size query that came just before
+        PackedArray & array = *response->mutable_array();
+        if (!request->sizeonly() && takeSized(*request, array))
+        {
+            mSizedHits += 1;
+        }
+        else
+        {
+            const grpc::Status status = fetch(*request, array);
+            if (!status.ok())
+            {
+                mErrors += 1;
+                return status;
+            }
+        }
+
+        if (request->sizeonly())
+        {
+            keepSized(*request, array);
+            mSizeQueries += 1;
+            return grpc::Status::OK;
+        }
+        mGets += 1;
+        mBytes += array.data().size();
+        return grpc::Status::OK;
+    }
+
+    grpc::Status setArrays(
+        grpc::ServerContext *                                   context,
+        const octanearrays::SetArraysRequest *                  request,
+        octanearrays::SetPackedArrayResponse *                  response) override
+    {
+        // a malformed transaction is refused before Octane sees its first array, and so is one
+        // that refers to a blob the store doesn't have
+        std::set<uint32_t> attributes;
+        std::vector<BlobStore::Blob> blobs(request->arrays_size());
+        uint64_t bytes = 0;
+        for (int i = 0; i < request->arrays_size(); ++i)
+        {
+            const octanearrays::AttributeArray & attribute = request->arrays(i);
+            const std::string name = "attribute " + std::to_string(attribute.attributeid());
+            if (!attributes.insert(attribute.attributeid()).second)
+            {
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, name + " is set twice");
+            }
+            if (attribute.has_array())
+            {
+                const PackedArray & array = attribute.array();
+                const size_t size = elementSize(array.type());
+                if (size == 0 || array.data().size() % size != 0 || array.count() != array.data().size() / size)
+                {
+                    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, name + " has an invalid array");
+                }
+                bytes += array.data().size();
+            }
+            else if (attribute.has_blob())
+            {
+                const size_t size = elementSize(attribute.blob().type());
+                blobs[i] = mBlobs.find(attribute.blob().key());
+                if (!blobs[i])
+                {
+                    return grpc::Status(grpc::StatusCode::NOT_FOUND, name + " refers to a blob that is not stored");
+                }
+                if (size == 0 || blobs[i]->size() % size != 0 || blobs[i]->size() / size > (size_t)INT_MAX)
+                {
+                    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, name + " has an invalid blob array");
+                }
+            }
+            else if (!attribute.has_strings())
+            {
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, name + " has no value");
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mSizedMutex);
+            for (const uint32_t attribute : attributes)
+            {
+                dropSized(request->itemhandle(), attribute);
+            }
+        }
+
+        std::vector<Previous> applied;
+        applied.reserve(request->arrays_size());
+        octaneapi::ApiItem::setArrayByIDRequest upstream;
+        grpc::Status status;
+        for (int i = 0; i < request->arrays_size(); ++i)
+        {
+            const octanearrays::AttributeArray & attribute = request->arrays(i);
+            Previous previous;
+            status = readPrevious(request->itemhandle(), attribute, previous);
+            if (!status.ok())
+            {
+                break;
+            }
+
+            // evaluated once below, not with every array
+            const auto start = std::chrono::steady_clock::now();
+            upstream.Clear();
+            startUpstream(request->itemhandle(), attribute.attributeid(), false, upstream);
+            if (attribute.has_array())
+            {
+                const PackedArray & array = attribute.array();
+                unpack(array.type(), array.data().data(), (size_t)array.count(), (size_t)array.count(), upstream);
+            }
+            else if (attribute.has_blob())
+            {
+                const size_t count = blobs[i]->size() / elementSize(attribute.blob().type());
+                unpack(attribute.blob().type(), blobs[i]->data(), count, count, upstream);
+            }
+            else
+            {
+                upstream.mutable_string_array()->mutable_data()->CopyFrom(attribute.strings().data());
+            }
+            addTiming(start, std::chrono::steady_clock::now());
+
+            grpc::ClientContext upstreamContext;
+            octaneapi::ApiItem::setArrayResponse upstreamResponse;
+            status = mItemStub->setArrayByAttrID(&upstreamContext, upstream, &upstreamResponse);
+            if (status.ok() && !upstreamResponse.success())
+            {
+                // Octane refused the array, the ones set before are rolled back all the same
+                status = grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                                      "setArrayByAttrID refused: " + upstreamResponse.error_message());
+            }
+            if (!status.ok())
+            {
+                break;
+            }
+            applied.push_back(std::move(previous));
+        }
+
+        if (!status.ok())
+        {
+            mErrors += 1;
+            if (!applied.empty())
+            {
+                restorePrevious(request->itemhandle(), applied);
+                mRollbacks += 1;
+            }
+            return grpc::Status(status.error_code(),
+                                "attribute " + std::to_string(request->arrays((int)applied.size()).attributeid()) +
+                                ": " + status.error_message() + ", " + std::to_string(applied.size()) +
+                                " arrays set before were restored");
+        }
+
+        if (request->evaluate())
+        {
+            octaneapi::ApiItem::evaluateRequest evaluateRequest;
+            auto * ref = evaluateRequest.mutable_objectptr();
+            ref->set_type(octaneapi::ObjectRef_ObjectType::ObjectRef_ObjectType_ApiItem);
+            ref->set_handle(request->itemhandle());
+            grpc::ClientContext upstreamContext;
+            google::protobuf::Empty empty;
+            status = mItemStub->evaluate(&upstreamContext, evaluateRequest, &empty);
+            if (!status.ok())
+            {
+                // the arrays are in, only the evaluation failed
+                mErrors += 1;
+                return status;
+            }
+        }
+        response->set_success(true);
+        mTransactions += 1;
+        mSets += request->arrays_size();
+        mBytes += bytes;
+        return grpc::Status::OK;
+    }
+
+    void printReport(
+        std::ostream & out) const
+    {
+        out << "[Arrays] " << mSets << " arrays set, " << mStreams << " streamed in " << mChunks << " chunks, "
+            << mTransactions << " transactions (" << mRollbacks << " rolled back), " << mAnimStreams << " animations ("
+            << mAnimSamples << " samples), " << mGets << " read (" << mSizeQueries << " size queries, "
+            << mSizedHits << " answered from them), " << mErrors << " failed, " << mBytes / (1024 * 1024)
+            << " MB packed, " << mConvertUs / 1000 << " ms converting\n";
+    }
+
+private:
+    /// An array read for a size query, kept for the get that follows.
+    struct SizedArray
+    {
+        uint64_t                                mItem;
+        uint32_t                                mAttribute;
+        std::chrono::steady_clock::time_point   mTime;
+        PackedArray                             mArray;
+    };
+
+    /// Value of an attribute before a setArrays transaction overwrote it.
+    struct Previous
+    {
+        const octanearrays::AttributeArray *    mAttribute = nullptr;
+        /// false if the attribute had no array yet
+        bool                                    mFound     = false;
+        octaneapi::ApiItem::getArrayResponse    mValue;
+    };
+
+    grpc::Status readPrevious(
+        const uint64_t                          item,
+        const octanearrays::AttributeArray &    attribute,
+        Previous &                              previous)
+    {
+        octaneapi::ApiItem::getArrayByIDRequest upstream;
+        auto * ref = upstream.mutable_item_ref();
+        ref->set_type(octaneapi::ObjectRef_ObjectType::ObjectRef_ObjectType_ApiItem);
+        ref->set_handle(item);
+        upstream.set_attribute_id(static_cast<octaneapi::AttributeId>(attribute.attributeid()));
+        upstream.set_expected_type(attribute.has_strings() ? octaneapi::ATTR_ID_STRING
+                                                           : attributeType(packedType(attribute)));
+
+        grpc::ClientContext upstreamContext;
+        previous.mAttribute = &attribute;
+        const grpc::Status status = mItemStub->getArrayByAttrID(&upstreamContext, upstream, &previous.mValue);
+        previous.mFound = status.ok();
+        return status.ok() || status.error_code() == grpc::StatusCode::NOT_FOUND ? grpc::Status::OK : status;
+    }
+
+    /// Puts the previous values back, last set first. An attribute that had no array gets an
+    /// empty one of its type.
+    void restorePrevious(
+        const uint64_t                  item,
+        const std::vector<Previous> &   applied)
+    {
+        for (auto it = applied.rbegin(); it != applied.rend(); ++it)
+        {
+            octaneapi::ApiItem::setArrayByIDRequest upstream;
+            if (it->mFound)
+            {
+                // the field numbers of the arrays are the same in both messages
+                upstream.ParseFromString(it->mValue.SerializeAsString());
+            }
+            else if (!it->mAttribute->has_strings())
+            {
+                unpack(packedType(*it->mAttribute), "", 0, 0, upstream);
+            }
+            else
+            {
+                upstream.mutable_string_array();
+            }
+            startUpstream(item, it->mAttribute->attributeid(), false, upstream);
+
+            grpc::ClientContext upstreamContext;
+            octaneapi::ApiItem::setArrayResponse upstreamResponse;
+            if (!mItemStub->setArrayByAttrID(&upstreamContext, upstream, &upstreamResponse).ok())
+            {
+                std::cout << "[Arrays] could not restore attribute " << it->mAttribute->attributeid()
+                          << " of item " << item << "\n";
+            }
+        }
+    }
+
+    /// Element type of an attribute given as packed array or blob.
+    static PackedType packedType(
+        const octanearrays::AttributeArray & attribute)
+    {
+        return attribute.has_blob() ? attribute.blob().type() : attribute.array().type();
+    }
+
+    /// The time sampling of an animation as setAnimByAttr takes it.
+    static void toTimeSampling(
+        const octanearrays::AnimTiming &    timing,
+        octaneapi::ApiTimeSampling &        times)
+    {
+        for (const float time : timing.pattern())
+        {
+            times.mutable_pattern()->add_data()->set_value(time);
+        }
+        times.set_patternsize((uint32_t)timing.pattern_size());
+        times.mutable_period()->set_value(timing.period());
+        times.mutable_endtime()->set_value(timing.endtime());
+        times.set_animationtype(static_cast<octaneapi::AnimationType>(timing.animationtype()));
+    }
+
+    /// Fills the item reference of an upstream set.
+    static void startUpstream(
+        const uint64_t                              item,
+        const uint32_t                              attribute,
+        const bool                                  evaluate,
+        octaneapi::ApiItem::setArrayByIDRequest &   upstream)
+    {
+        auto * ref = upstream.mutable_item_ref();
+        ref->set_type(octaneapi::ObjectRef_ObjectType::ObjectRef_ObjectType_ApiItem);
+        ref->set_handle(item);
+        upstream.set_attribute_id(static_cast<octaneapi::AttributeId>(attribute));
+        upstream.set_evaluate(evaluate);
+    }
+
+    /// Sets the converted array in Octane.
+    grpc::Status forward(
+        const octaneapi::ApiItem::setArrayByIDRequest & upstream,
+        const std::chrono::steady_clock::time_point     start,
+        const std::chrono::steady_clock::time_point     converted,
+        octanearrays::SetPackedArrayResponse *          response)
+    {
+        grpc::ClientContext upstreamContext;
+        octaneapi::ApiItem::setArrayResponse upstreamResponse;
+        const grpc::Status status = mItemStub->setArrayByAttrID(&upstreamContext, upstream, &upstreamResponse);
+        addTiming(start, converted);
+        if (!status.ok())
+        {
+            mErrors += 1;
+            return status;
+        }
+        response->set_success(upstreamResponse.success());
+        return grpc::Status::OK;
+    }
+
+    /// Reads the array from Octane and packs it.
+    grpc::Status fetch(
+        const octanearrays::GetPackedArrayRequest & request,
+        PackedArray &                               array)
+    {
+        octaneapi::ApiItem::getArrayByIDRequest upstream;
+        auto * ref = upstream.mutable_item_ref();
+        ref->set_type(octaneapi::ObjectRef_ObjectType::ObjectRef_ObjectType_ApiItem);
+        ref->set_handle(request.itemhandle());
+        upstream.set_attribute_id(static_cast<octaneapi::AttributeId>(request.attributeid()));
+        upstream.set_expected_type(attributeType(request.type()));
+
+        grpc::ClientContext upstreamContext;
+        octaneapi::ApiItem::getArrayResponse upstreamResponse;
+        const grpc::Status status = mItemStub->getArrayByAttrID(&upstreamContext, upstream, &upstreamResponse);
+        if (!status.ok())
+        {
+            return status;
+        }
+        const auto received = std::chrono::steady_clock::now();
+        if (!pack(upstreamResponse, request.type(), array))
+        {
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "attribute holds another array type");
+        }
+        addTiming(received, std::chrono::steady_clock::now());
+        return grpc::Status::OK;
+    }
+
+    /// Takes the data of array, which keeps its type and count for the answer.
+    void keepSized(
+        const octanearrays::GetPackedArrayRequest & request,
+        PackedArray &                               array)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mSizedMutex);
+        dropSized(request.itemhandle(), request.attributeid());
+        // nobody came for the oldest ones
+        while (!mSized.empty() && (mSized.size() >= mSettings.mSizedMax ||
+                                   now - mSized.front().mTime > std::chrono::milliseconds(mSettings.mSizedKeepMs)))
+        {
+            mSized.pop_front();
+        }
+        mSized.push_back({ request.itemhandle(), request.attributeid(), now, PackedArray() });
+        mSized.back().mArray.set_type(array.type());
+        mSized.back().mArray.set_count(array.count());
+        mSized.back().mArray.mutable_data()->swap(*array.mutable_data());
+    }
+
+    bool takeSized(
+        const octanearrays::GetPackedArrayRequest & request,
+        PackedArray &                               array)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mSizedMutex);
+        for (auto it = mSized.begin(); it != mSized.end(); ++it)
+        {
+            if (it->mItem == request.itemhandle() && it->mAttribute == request.attributeid())
+            {
+                const bool usable = it->mArray.type() == request.type() &&
+                                    now - it->mTime <= std::chrono::milliseconds(mSettings.mSizedKeepMs);
+                if (usable)
+                {
+                    array.Swap(&it->mArray);
+                }
+                mSized.erase(it);
+                return usable;
+            }
+        }
+        return false;
+    }
+
+    /// Forgets the kept array of an attribute, called with mSizedMutex held.
+    void dropSized(
+        const uint64_t item,
+        const uint32_t attribute)
+    {
+        for (auto it = mSized.begin(); it != mSized.end(); ++it)
+        {
+            if (it->mItem == item && it->mAttribute == attribute)
+            {
+                mSized.erase(it);
+                return;
+            }
+        }
+    }
+
+    void addTiming(
+        const std::chrono::steady_clock::time_point from,
+        const std::chrono::steady_clock::time_point to)
+    {
+        mConvertUs += (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+    }
+
+    const ArraySettings                                         mSettings;
+    BlobStore &                                                 mBlobs;
+    std::shared_ptr<grpc::Channel>                              mChannel;
+    std::unique_ptr<octaneapi::ApiItemService::Stub>            mItemStub;
+    std::mutex                                                  mSizedMutex;
+    std::deque<SizedArray>                                      mSized;
+    std::atomic<uint64_t>                                       mSets{ 0 };
+    std::atomic<uint64_t>                                       mStreams{ 0 };
+    std::atomic<uint64_t>                                       mChunks{ 0 };
+    std::atomic<uint64_t>                                       mTransactions{ 0 };
+    std::atomic<uint64_t>                                       mRollbacks{ 0 };
+    std::atomic<uint64_t>                                       mAnimStreams{ 0 };
+    std::atomic<uint64_t>                                       mAnimSamples{ 0 };
+    std::atomic<uint64_t>                                       mGets{ 0 };
+    std::atomic<uint64_t>                                       mSizeQueries{ 0 };
+    std::atomic<uint64_t>                                       mSizedHits{ 0 };
+    std::atomic<uint64_t>                                       mErrors{ 0 };
+    std::atomic<uint64_t>                                       mBytes{ 0 };
+    std::atomic<uint64_t>                                       mConvertUs{ 0 };
+};
+
+
+/// Answers the BlobCache rpcs from the store the ItemArrayTransfer service reads blob arrays from.
+class BlobCacheService final : public octanearrays::BlobCache::Service
+{
+public:
+    BlobCacheService(
+        const ArraySettings &   settings,
+        BlobStore &             blobs)
+    :
+        mBlobs(blobs)
+    {
+        grpc::ChannelArguments arguments;
+        arguments.SetMaxReceiveMessageSize(-1);
+        mChannel = grpc::CreateCustomChannel(settings.mUpstream, grpc::InsecureChannelCredentials(), arguments);
+        mImageStub = octaneapi::ApiImageService::NewStub(mChannel);
+    }
+
+    grpc::Status findBlobs(
+        grpc::ServerContext *                                   context,
+        const octanearrays::FindBlobsRequest *                  request,
+        octanearrays::FindBlobsResponse *                       response) override
+    {
+        for (const octanearrays::BlobKey & key : request->keys())
+        {
+            response->add_present(mBlobs.contains(key));
+        }
+        return grpc::Status::OK;
+    }
+
+    grpc::Status putBlob(
+        grpc::ServerContext *                                   context,
+        const octanearrays::PutBlobRequest *                    request,
+        octanearrays::PutBlobResponse *                         response) override
+    {
+        // the request is not read again, its data moves into the store without a copy
+        std::string data = std::move(*const_cast<octanearrays::PutBlobRequest *>(request)->mutable_data());
+        const grpc::Status status = mBlobs.put(request->key(), std::move(data));
+        response->set_stored(status.ok());
+        return status;
+    }
+
+    grpc::Status loadImageFromBlob(
+        grpc::ServerContext *                                   context,
+        const octanearrays::LoadImageFromBlobRequest *          request,
+        octanearrays::LoadImageFromBlobResponse *               response) override
+    {
+        const BlobStore::Blob blob = mBlobs.find(request->key());
+        if (!blob)
+        {
+            return grpc::Status(grpc::StatusCode::NOT_FOUND, "blob " + BlobStore::toKey(request->key()).toString() + " is not stored");
+        }
+
+        octaneapi::ApiImage::loadFromMemoryRequest upstream;
+        upstream.mutable_imagedata()->set_data(*blob);
+        upstream.mutable_imagedata()->set_size((uint32_t)blob->size());
+        upstream.set_sizeinbytes((uint32_t)blob->size());
+        octaneapi::ApiImage::loadFromMemoryResponse result;
+        grpc::ClientContext upstreamContext;
+        const grpc::Status status = mImageStub->loadFromMemory(&upstreamContext, upstream, &result);
+        if (!status.ok())
+        {
+            return status;
+        }
+        response->set_imagehandle(result.result().handle());
+        mImages += 1;
+        return grpc::Status::OK;
+    }
+
+    grpc::Status blobFile(
+        grpc::ServerContext *                                   context,
+        const octanearrays::BlobFileRequest *                   request,
+        octanearrays::BlobFileResponse *                        response) override
+    {
+        std::string path;
+        const grpc::Status status = mBlobs.file(request->key(), request->extension(), path);
+        if (status.ok())
+        {
+            response->set_path(path);
+        }
+        return status;
+    }
+
+    void printReport(
+        std::ostream & out) const
+    {
+        mBlobs.printReport(out);
+        out << "[Blobs] " << mImages << " images loaded from blobs\n";
+    }
+
+private:
+    BlobStore &                                                 mBlobs;
+    std::shared_ptr<grpc::Channel>                              mChannel;
+    std::unique_ptr<octaneapi::ApiImageService::Stub>           mImageStub;
+    std::atomic<uint64_t>                                       mImages{ 0 };
+};
+
+
+//--------------------------------------------------------------------------------------------------
+
+static std::atomic<bool> gStopRequested{ false };
+
+static void onSignal(
+    int)
+{
+    gStopRequested = true;
+}
+
+
+int main(
+    int    argc,
+    char * argv[])
+{
+    ArraySettings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        const char * value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            std::cout << "Usage: octane_arrays [--address host:port] [--upstream host:port] [--blob-memory MB]"
+                         " [--blob-dir path]\n";
+            return 1;
+        }
+        if (option == "--address")
+        {
+            settings.mAddress = value;
+        }
+        else if (option == "--upstream")
+        {
+            settings.mUpstream = value;
+        }
+        else if (option == "--blob-memory")
+        {
+            settings.mBlobMemoryMb = (size_t)std::max(1, std::atoi(value));
+        }
+        else if (option == "--blob-dir")
+        {
+            settings.mBlobDir = value;
+        }
+        else
+        {
+            std::cout << "Unknown option " << option << "\n";
+            return 1;
+        }
+        ++i;
+    }
+
+    if (settings.mBlobDir.empty())
+    {
+        settings.mBlobDir = (std::filesystem::temp_directory_path() / "octane_blobs").string();
+    }
+
+    BlobStore blobs(settings);
+    std::unique_ptr<ItemArrayService> service = std::make_unique<ItemArrayService>(settings, blobs);
+    std::unique_ptr<BlobCacheService> blobService = std::make_unique<BlobCacheService>(settings, blobs);
+
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(settings.mAddress, grpc::InsecureServerCredentials());
+    builder.SetMaxReceiveMessageSize(-1);
+    builder.SetMaxSendMessageSize(-1);
+    builder.RegisterService(service.get());
+    builder.RegisterService(blobService.get());
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    if (!server)
+    {
+        std::cerr << "[Arrays] can't listen on " << settings.mAddress << "\n";
+        return 1;
+    }
+
+    std::cout << "[Arrays] packed item arrays for " << settings.mUpstream << " on " << settings.mAddress
+              << ", blob files in " << settings.mBlobDir << "\n";
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    while (!gStopRequested)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+    service->printReport(std::cout);
+    blobService->printReport(std::cout);
+    blobService.reset();
+    service.reset();
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+// Benchmarks picking a grid of positions with one ApiRenderEngineProxy::pick() call per
+// position against PickBatchSdk, which keeps the calls in flight on one channel. Run it
+// against octane.exe with a scene loaded, or against octane_mockserver (render-example),
+// which picks a sphere in the middle of its image:
+//
+//   octane_mockserver --call-cost-us 200
+//   pickbatch_bench 127.0.0.1:50051
+//
+// usage: pickbatch_bench <server> [--rect x y w h] [--stride N] [--in-flight N] [--runs N]
+
+// system headers
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+// application headers
+#include "grpcsettings.h"
+#include "apirenderengineclient.h"
+// shared batch picker
+#include "../../../shared/pick_batch_sdk.h"
+
+using namespace OctaneGRPC;
+
+
+//--------------------------------------------------------------------------------------------------
+/// One pick() per position, the way tools picked a grid so far. Returns the number of
+/// positions with an intersection, depths of misses are negative.
+static size_t pickOneByOne(
+    const std::vector<PickBatchSdk::Position> & positions,
+    std::vector<float> &                        depths,
+    double &                                    ms)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+    depths.assign(positions.size(), -1.0f);
+    size_t hits = 0;
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        GRPCPickIntersection intersection;
+        if (ApiRenderEngineProxy::pick(positions[i].x, positions[i].y, false, intersection, 1) > 0)
+        {
+            depths[i] = intersection.mDepth;
+            ++hits;
+        }
+    }
+    ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return hits;
+}
+
+
+int main(
+    int    argc,
+    char * argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage: pickbatch_bench <server> [--rect x y w h] [--stride N] [--in-flight N] [--runs N]\n";
+        return 1;
+    }
+    const std::string serverURL = argv[1];
+    // 64x64 around the middle of a 1280x720 render
+    uint32_t rect[4] = { 608, 328, 64, 64 };
+    uint32_t stride = 1;
+    unsigned inFlight = PickBatchSdk::Settings().maxInFlight;
+    int runs = 5;
+    for (int i = 2; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        if (option == "--rect" && i + 4 < argc)
+        {
+            for (int k = 0; k < 4; ++k)
+            {
+                rect[k] = (uint32_t)std::max(0, std::atoi(argv[++i]));
+            }
+        }
+        else if (option == "--stride" && i + 1 < argc)
+        {
+            stride = (uint32_t)std::max(1, std::atoi(argv[++i]));
+        }
+        else if (option == "--in-flight" && i + 1 < argc)
+        {
+            inFlight = (unsigned)std::max(1, std::atoi(argv[++i]));
+        }
+        else if (option == "--runs" && i + 1 < argc)
+        {
+            runs = std::max(1, std::atoi(argv[++i]));
+        }
+        else
+        {
+            std::cout << "Unknown option " << option << "\n";
+            return 1;
+        }
+    }
+
+    auto channel = grpc::CreateChannel(serverURL, grpc::InsecureChannelCredentials());
+    if (!channel->WaitForConnected(std::chrono::system_clock::now() + std::chrono::seconds(1)))
+    {
+        std::cout << "Failed to connect to gRPC server at " << serverURL << ". Exiting.\n";
+        return 1;
+    }
+    GRPCSettings::getInstance().setServerAddress(serverURL);
+
+    std::vector<PickBatchSdk::Position> positions;
+    for (uint32_t y = 0; y < rect[3]; y += stride)
+    {
+        for (uint32_t x = 0; x < rect[2]; x += stride)
+        {
+            positions.push_back(PickBatchSdk::Position{ rect[0] + x, rect[1] + y });
+        }
+    }
+    std::cout << "Pick benchmark on " << serverURL << ", " << positions.size() << " positions in " << rect[2]
+              << "x" << rect[3] << " at (" << rect[0] << ", " << rect[1] << "), stride " << stride << "\n";
+
+    std::vector<float> depths;
+    double oneByOneMs = 0.0;
+    size_t oneByOneHits = 0;
+    try
+    {
+        oneByOneHits = pickOneByOne(positions, depths, oneByOneMs);
+    }
+    catch (const std::exception & e)
+    {
+        std::cout << "pick() failed: " << e.what() << "\n";
+        return 1;
+    }
+
+    PickBatchSdk::Settings settings;
+    settings.maxInFlight = inFlight;
+    PickBatchSdk batch(settings);
+    PickBatchSdk::Result result;
+    std::vector<double> batchMs;
+    size_t batchHits = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        batchHits = batch.pick(positions, false, 1, result);
+        batchMs.push_back(result.ms);
+    }
+    std::sort(batchMs.begin(), batchMs.end());
+    const double medianMs = batchMs[batchMs.size() / 2];
+
+    // same answers as the calls one by one
+    size_t mismatches = 0;
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        const bool hit = result.count(i) > 0;
+        if (hit != (depths[i] >= 0.0f) ||
+            (hit && std::fabs(result.intersections[result.begin(i)].mDepth - depths[i]) > 1e-5f))
+        {
+            ++mismatches;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  one by one:     " << std::setw(10) << oneByOneMs << " ms  "
+              << std::setw(8) << oneByOneMs * 1000.0 / positions.size() << " us/position, "
+              << oneByOneHits << " hits\n";
+    std::cout << "  batched (" << std::setw(4) << inFlight << "): " << std::setw(10) << medianMs << " ms  "
+              << std::setw(8) << medianMs * 1000.0 / positions.size() << " us/position, "
+              << batchHits << " hits, median of " << runs << "\n";
+    std::cout << "  speedup " << std::setprecision(1) << oneByOneMs / std::max(medianMs, 1e-3) << "x, "
+              << result.failedCalls << " failed calls, " << mismatches << " mismatches\n";
+    batch.printSummary(std::cout);
+    return mismatches == 0 && result.failedCalls == 0 ? 0 : 1;
+}
@@ -0,0 +1,650 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+// Minimal stand-in for octane.exe that serves the calls of render-example, so the benchmark
+// (renderexample_app <server> --bench) can run without Octane or a GPU. Scene calls only hand out
+// handles; every scene change restarts a simulated render that produces frames at a fixed rate
+// and announces them on the callback stream like Octane does.
+
+// system headers
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// protoc generated headers
+#include "apiprojectmanager.grpc.pb.h"
+// apiItem
+#include "apinodesystem_3.grpc.pb.h"
+// apiNode
+#include "apinodesystem_7.grpc.pb.h"
+#include "apirender.grpc.pb.h"
+#include "apichangemanager.grpc.pb.h"
+#include "callbackstream.grpc.pb.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/// Settings of the simulated render.
+struct MockSettings
+{
+    std::string mAddress       = "127.0.0.1:50051";
+    uint32_t    mWidth         = 1280;
+    uint32_t    mHeight        = 720;
+    /// Frames announced per second while rendering.
+    double      mFrameRate     = 30.0;
+    /// Samples per pixel added per frame.
+    uint32_t    mSppPerFrame   = 8;
+    /// Simulated server side cost of a scene call in microseconds.
+    uint32_t    mCallCostUs    = 0;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/// Scene handles and the state of the simulated render, shared by all services.
+class MockOctane
+{
+public:
+    explicit MockOctane(
+        const MockSettings & settings)
+    :
+        mSettings(settings),
+        mPixels((size_t)settings.mWidth * settings.mHeight * 4)
+    {
+        // a gradient, so the frames look like an image when dumped
+        for (uint32_t y = 0; y < settings.mHeight; ++y)
+        {
+            for (uint32_t x = 0; x < settings.mWidth; ++x)
+            {
+                char * pixel = &mPixels[((size_t)y * settings.mWidth + x) * 4];
+                pixel[0] = (char)(x * 255 / std::max(1u, settings.mWidth - 1));
+                pixel[1] = (char)(y * 255 / std::max(1u, settings.mHeight - 1));
+                pixel[2] = (char)128;
+                pixel[3] = (char)255;
+            }
+        }
+        mRenderThread = std::thread([this] { renderLoop(); });
+    }
+
+    ~MockOctane()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mChanged.notify_all();
+        mRenderThread.join();
+    }
+
+    octaneapi::ObjectRef newNode()
+    {
+        simulateCallCost();
+        octaneapi::ObjectRef ref;
+        ref.set_type(octaneapi::ObjectRef_ObjectType_ApiNode);
+        ref.set_handle(mNextHandle.fetch_add(1));
+        mNodeCount.fetch_add(1);
+        return ref;
+    }
+
+    octaneapi::ObjectRef rootGraph() const
+    {
+        octaneapi::ObjectRef ref;
+        ref.set_type(octaneapi::ObjectRef_ObjectType_ApiRootNodeGraph);
+        ref.set_handle(1);
+        return ref;
+    }
+
+    /// Any scene change restarts the render, like in Octane.
+    void sceneChanged()
+    {
+        simulateCallCost();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mSamplesPerPixel = 0;
+            mRendering = true;
+        }
+        mChanged.notify_all();
+    }
+
+    void reset()
+    {
+        mNodeCount = 0;
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSamplesPerPixel = 0;
+        mRendering = false;
+    }
+
+    void setMaxSamples(
+        uint32_t maxSamples)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mMaxSamples = std::max(1u, maxSamples);
+    }
+
+    /// Fills the current frame, false if nothing was rendered since the last restart.
+    bool grabFrame(
+        octaneapi::ApiArrayApiRenderImage & images)
+    {
+        float spp, maxSpp;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mSamplesPerPixel == 0)
+            {
+                return false;
+            }
+            spp = (float)mSamplesPerPixel;
+            maxSpp = (float)mMaxSamples;
+        }
+
+        octaneapi::ApiRenderImage * image = images.add_data();
+        image->set_type(octaneapi::IMAGE_TYPE_LDR_RGBA);
+        image->set_colorspace(octaneapi::NAMED_COLOR_SPACE_SRGB);
+        image->set_islinear(false);
+        image->mutable_size()->set_x(mSettings.mWidth);
+        image->mutable_size()->set_y(mSettings.mHeight);
+        image->set_pitch(mSettings.mWidth);
+        image->mutable_buffer()->set_data(mPixels.data(), mPixels.size());
+        image->mutable_buffer()->set_size((uint32_t)mPixels.size());
+        image->set_tonemappedsamplesperpixel(spp);
+        image->set_calculatedsamplesperpixel(spp);
+        image->set_maxsamplesperpixel(maxSpp);
+        image->set_samplespersecond(spp * mSettings.mWidth * mSettings.mHeight);
+        image->set_hasalpha(true);
+        return true;
+    }
+
+    /// Blocks until a frame newer than lastFrame was rendered or the timeout expired.
+    uint64_t waitForFrame(
+        uint64_t                  lastFrame,
+        std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mFrameRendered.wait_for(lock, timeout, [&] { return mFrame != lastFrame || mStopping; });
+        return mFrame;
+    }
+
+    /// Picks a sphere filling the middle of the image, so about half of a probe grid hits.
+    uint32_t pick(
+        uint32_t                                                x,
+        uint32_t                                                y,
+        octaneapi::ApiRenderEngine_ApiRenderEngine_PickIntersection & intersection)
+    {
+        simulateCallCost();
+        const float radius = 0.4f * (float)std::min(mSettings.mWidth, mSettings.mHeight);
+        const float dx = ((float)x + 0.5f - 0.5f * (float)mSettings.mWidth) / radius;
+        const float dy = (0.5f * (float)mSettings.mHeight - (float)y - 0.5f) / radius;
+        const float r2 = dx * dx + dy * dy;
+        if (r2 >= 1.0f)
+        {
+            return 0;
+        }
+        const float dz = std::sqrt(1.0f - r2);
+        intersection.mutable_node()->set_type(octaneapi::ObjectRef_ObjectType_ApiNode);
+        intersection.mutable_node()->set_handle(1);
+        intersection.set_depth(10.0f - dz);
+        for (octaneapi::float_3 * v : { intersection.mutable_position(),
+                                        intersection.mutable_geometricnormal(),
+                                        intersection.mutable_smoothednormal() })
+        {
+            v->set_x(dx);
+            v->set_y(dy);
+            v->set_z(dz);
+        }
+        intersection.set_primitivetype(octaneapi::PRIMITIVE_TRIANGLE);
+        for (int k = 0; k < 3; ++k)
+        {
+            octaneapi::float_3 * vertex = intersection.mutable_primitivevertices()->add_data();
+            vertex->set_x(dx);
+            vertex->set_y(dy);
+            vertex->set_z(dz);
+        }
+        intersection.mutable_positiononprimitive()->set_x(1.0f / 3.0f);
+        intersection.mutable_positiononprimitive()->set_y(1.0f / 3.0f);
+        intersection.mutable_positiononprimitive()->set_z(1.0f / 3.0f);
+        return 1;
+    }
+
+    uint64_t nodeCount() const { return mNodeCount; }
+
+private:
+    void simulateCallCost()
+    {
+        if (mSettings.mCallCostUs)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(mSettings.mCallCostUs));
+        }
+    }
+
+    void renderLoop()
+    {
+        const auto frameTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / std::max(0.1, mSettings.mFrameRate)));
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mStopping)
+        {
+            if (!mRendering)
+            {
+                mChanged.wait(lock, [this] { return mRendering || mStopping; });
+                continue;
+            }
+            // restarts don't shorten the frame time
+            mChanged.wait_until(lock, std::chrono::steady_clock::now() + frameTime, [this] { return mStopping; });
+            if (mStopping || !mRendering)
+            {
+                continue;
+            }
+            mSamplesPerPixel = std::min(mMaxSamples, mSamplesPerPixel + mSettings.mSppPerFrame);
+            // Octane stops sending frames once the render is complete
+            mRendering = mSamplesPerPixel < mMaxSamples;
+            ++mFrame;
+            mFrameRendered.notify_all();
+        }
+        mFrameRendered.notify_all();
+    }
+
+    const MockSettings      mSettings;
+    std::vector<char>       mPixels;
+    std::atomic<uint64_t>   mNextHandle{ 1000 };
+    std::atomic<uint64_t>   mNodeCount{ 0 };
+
+    std::mutex              mMutex;
+    std::condition_variable mChanged;
+    std::condition_variable mFrameRendered;
+    std::thread             mRenderThread;
+    bool                    mStopping        = false;
+    bool                    mRendering       = false;
+    uint32_t                mSamplesPerPixel = 0;
+    uint32_t                mMaxSamples      = 1000;
+    uint64_t                mFrame           = 0;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+// Services, only the calls render-example makes are implemented
+
+class MockProjectManagerService final : public octaneapi::ApiProjectManagerService::Service
+{
+public:
+    explicit MockProjectManagerService(MockOctane & octane) : mOctane(octane) {}
+
+    grpc::Status rootNodeGraph(
+        grpc::ServerContext *                                       context,
+        const octaneapi::ApiProjectManager::rootNodeGraphRequest *  request,
+        octaneapi::ApiProjectManager::rootNodeGraphResponse *       response) override
+    {
+        *response->mutable_result() = mOctane.rootGraph();
+        return grpc::Status::OK;
+    }
+
+    grpc::Status resetProject(
+        grpc::ServerContext *                                       context,
+        const octaneapi::ApiProjectManager::resetProjectRequest *   request,
+        octaneapi::ApiProjectManager::resetProjectResponse *        response) override
+    {
+        mOctane.reset();
+        response->set_result(true);
+        return grpc::Status::OK;
+    }
+
+private:
+    MockOctane & mOctane;
+};
+
+
+class MockNodeService final : public octaneapi::ApiNodeService::Service
+{
+public:
+    explicit MockNodeService(MockOctane & octane) : mOctane(octane) {}
+
+    grpc::Status create(
+        grpc::ServerContext *                       context,
+        const octaneapi::ApiNode::createRequest *   request,
+        octaneapi::ApiNode::createResponse *        response) override
+    {
+        *response->mutable_result() = mOctane.newNode();
+        return grpc::Status::OK;
+    }
+
+    grpc::Status createInternal(
+        grpc::ServerContext *                               context,
+        const octaneapi::ApiNode::createInternalRequest *   request,
+        octaneapi::ApiNode::createInternalResponse *        response) override
+    {
+        *response->mutable_result() = mOctane.newNode();
+        return grpc::Status::OK;
+    }
+
+    grpc::Status staticPinCount(
+        grpc::ServerContext *                               context,
+        const octaneapi::ApiNode::staticPinCountRequest *   request,
+        octaneapi::ApiNode::staticPinCountResponse *        response) override
+    {
+        // material maps have one geometry pin before their material pins
+        response->set_result(1);
+        return grpc::Status::OK;
+    }
+
+    grpc::Status connectedNode(
+        grpc::ServerContext *                               context,
+        const octaneapi::ApiNode::connectedNodeRequest *    request,
+        octaneapi::ApiNode::connectedNodeResponse *         response) override
+    {
+        *response->mutable_result() = mOctane.newNode();
+        return grpc::Status::OK;
+    }
+
+    grpc::Status connectTo(
+        grpc::ServerContext *                       context,
+        const octaneapi::ApiNode::connectToRequest * request,
+        google::protobuf::Empty *                   response) override
+    {
+        mOctane.sceneChanged();
+        return grpc::Status::OK;
+    }
+
+    grpc::Status connectToIx(
+        grpc::ServerContext *                           context,
+        const octaneapi::ApiNode::connectToIxRequest *  request,
+        google::protobuf::Empty *                       response) override
+    {
+        mOctane.sceneChanged();
+        return grpc::Status::OK;
+    }
+
+    grpc::Status setPinValueByPinID(
+        grpc::ServerContext *                               context,
+        const octaneapi::ApiNode::setPinValueByIDRequest *  request,
+        octaneapi::ApiNode::setPinValueResponse *           response) override
+    {
+        if (request->pin_id() == octaneapi::P_MAX_SAMPLES && request->value_case() ==
+            octaneapi::ApiNode::setPinValueByIDRequest::kIntValue)
+        {
+            mOctane.setMaxSamples((uint32_t)std::max(1, request->int_value()));
+        }
+        mOctane.sceneChanged();
+        response->set_success(true);
+        return grpc::Status::OK;
+    }
+
+private:
+    MockOctane & mOctane;
+};
+
+
+class MockItemService final : public octaneapi::ApiItemService::Service
+{
+public:
+    explicit MockItemService(MockOctane & octane) : mOctane(octane) {}
+
+    grpc::Status setValueByAttrID(
+        grpc::ServerContext *                           context,
+        const octaneapi::ApiItem::setValueByIDRequest * request,
+        octaneapi::ApiItem::setValueResponse *          response) override
+    {
+        mOctane.sceneChanged();
+        response->set_success(true);
+        return grpc::Status::OK;
+    }
+
+    grpc::Status setArrayByAttrID(
+        grpc::ServerContext *                           context,
+        const octaneapi::ApiItem::setArrayByIDRequest * request,
+        octaneapi::ApiItem::setArrayResponse *          response) override
+    {
+        // kept for getArrayByAttrID, the field numbers of the arrays are the same in both messages
+        octaneapi::ApiItem::getArrayResponse array;
+        array.ParseFromString(request->SerializeAsString());
+        // item_ref, attribute_id and evaluate
+        array.mutable_unknown_fields()->Clear();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mArrays[std::make_pair(request->item_ref().handle(), (int)request->attribute_id())] = std::move(array);
+        }
+        mOctane.sceneChanged();
+        response->set_success(true);
+        return grpc::Status::OK;
+    }
+
+    grpc::Status setAnimByAttr(
+        grpc::ServerContext *                           context,
+        const octaneapi::ApiItem::setAnimByIDRequest *  request,
+        octaneapi::ApiItem::setAnimArrayResponse *      response) override
+    {
+        mOctane.sceneChanged();
+        response->set_success(true);
+        return grpc::Status::OK;
+    }
+
+    grpc::Status getArrayByAttrID(
+        grpc::ServerContext *                           context,
+        const octaneapi::ApiItem::getArrayByIDRequest * request,
+        octaneapi::ApiItem::getArrayResponse *          response) override
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mArrays.find(std::make_pair(request->item_ref().handle(), (int)request->attribute_id()));
+        if (it == mArrays.end())
+        {
+            return grpc::Status(grpc::StatusCode::NOT_FOUND, "array was never set");
+        }
+        *response = it->second;
+        return grpc::Status::OK;
+    }
+
+    grpc::Status evaluate(
+        grpc::ServerContext *                       context,
+        const octaneapi::ApiItem::evaluateRequest * request,
+        google::protobuf::Empty *                   response) override
+    {
+        mOctane.sceneChanged();
+        return grpc::Status::OK;
+    }
+
+private:
+    MockOctane &                                                        mOctane;
+    std::mutex                                                          mMutex;
+    std::map<std::pair<uint64_t, int>, octaneapi::ApiItem::getArrayResponse> mArrays;
+};
+
+
+class MockRenderEngineService final : public octaneapi::ApiRenderEngineService::Service
+{
+public:
+    explicit MockRenderEngineService(MockOctane & octane) : mOctane(octane) {}
+
+    grpc::Status setRenderTargetNode(
+        grpc::ServerContext *                                       context,
+        const octaneapi::ApiRenderEngine::setRenderTargetNodeRequest * request,
+        octaneapi::ApiRenderEngine::setRenderTargetNodeResponse *   response) override
+    {
+        mOctane.sceneChanged();
+        response->set_result(true);
+        return grpc::Status::OK;
+    }
+
+    grpc::Status grabRenderResult(
+        grpc::ServerContext *                                       context,
+        const octaneapi::ApiRenderEngine::grabRenderResultRequest * request,
+        octaneapi::ApiRenderEngine::grabRenderResultResponse *      response) override
+    {
+        response->set_result(mOctane.grabFrame(*response->mutable_renderimages()));
+        return grpc::Status::OK;
+    }
+
+    grpc::Status pick(
+        grpc::ServerContext *                                       context,
+        const octaneapi::ApiRenderEngine::pickRequest *             request,
+        octaneapi::ApiRenderEngine::pickResponse *                  response) override
+    {
+        if (request->intersectionssize() > 0)
+        {
+            response->set_result(mOctane.pick(request->x(), request->y(), *response->mutable_intersections()));
+        }
+        return grpc::Status::OK;
+    }
+
+private:
+    MockOctane & mOctane;
+};
+
+
+class MockChangeManagerService final : public octaneapi::ApiChangeManagerService::Service
+{
+public:
+    explicit MockChangeManagerService(MockOctane & octane) : mOctane(octane) {}
+
+    grpc::Status update(
+        grpc::ServerContext *                               context,
+        const octaneapi::ApiChangeManager::updateRequest *  request,
+        google::protobuf::Empty *                           response) override
+    {
+        mOctane.sceneChanged();
+        return grpc::Status::OK;
+    }
+
+private:
+    MockOctane & mOctane;
+};
+
+
+class MockCallbackStreamService final : public octaneapi::StreamCallbackService::Service
+{
+public:
+    explicit MockCallbackStreamService(MockOctane & octane) : mOctane(octane) {}
+
+    grpc::Status callbackChannel(
+        grpc::ServerContext *                                   context,
+        const google::protobuf::Empty *                         request,
+        grpc::ServerWriter<octaneapi::StreamCallbackRequest> *  writer) override
+    {
+        std::cout << "[Mock] callback stream opened\n";
+        uint64_t lastFrame = 0;
+        while (!context->IsCancelled())
+        {
+            const uint64_t frame = mOctane.waitForFrame(lastFrame, std::chrono::milliseconds(100));
+            if (frame == lastFrame)
+            {
+                continue;
+            }
+            lastFrame = frame;
+
+            octaneapi::StreamCallbackRequest message;
+            message.mutable_newimage()->set_user_data(0);
+            if (!writer->Write(message))
+            {
+                break;
+            }
+        }
+        std::cout << "[Mock] callback stream closed\n";
+        return grpc::Status::OK;
+    }
+
+private:
+    MockOctane & mOctane;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+
+static std::atomic<bool> gStopRequested{ false };
+
+static void onSignal(
+    int)
+{
+    gStopRequested = true;
+}
+
+
+int main(
+    int    argc,
+    char * argv[])
+{
+    MockSettings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        const char * value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            std::cout << "Usage: octane_mockserver [--address host:port] [--size W H] [--fps N] "
+                         "[--spp-per-frame N] [--call-cost-us N]\n";
+            return 1;
+        }
+        if (option == "--address")
+        {
+            settings.mAddress = value;
+        }
+        else if (option == "--size" && i + 2 < argc)
+        {
+            settings.mWidth  = (uint32_t)std::max(1, std::atoi(argv[i + 1]));
+            settings.mHeight = (uint32_t)std::max(1, std::atoi(argv[i + 2]));
+            ++i;
+        }
+        else if (option == "--fps")
+        {
+            settings.mFrameRate = std::max(0.1, std::atof(value));
+        }
+        else if (option == "--spp-per-frame")
+        {
+            settings.mSppPerFrame = (uint32_t)std::max(1, std::atoi(value));
+        }
+        else if (option == "--call-cost-us")
+        {
+            settings.mCallCostUs = (uint32_t)std::max(0, std::atoi(value));
+        }
+        else
+        {
+            std::cout << "Unknown option " << option << "\n";
+            return 1;
+        }
+        ++i;
+    }
+
+    MockOctane octane(settings);
+    MockProjectManagerService projectManager(octane);
+    MockNodeService           nodes(octane);
+    MockItemService           items(octane);
+    MockRenderEngineService   renderEngine(octane);
+    MockChangeManagerService  changeManager(octane);
+    MockCallbackStreamService callbacks(octane);
+
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(settings.mAddress, grpc::InsecureServerCredentials());
+    builder.SetMaxSendMessageSize(-1);
+    // mesh arrays of the array benchmark (item-arrays)
+    builder.SetMaxReceiveMessageSize(-1);
+    builder.RegisterService(&projectManager);
+    builder.RegisterService(&nodes);
+    builder.RegisterService(&items);
+    builder.RegisterService(&renderEngine);
+    builder.RegisterService(&changeManager);
+    builder.RegisterService(&callbacks);
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    if (!server)
+    {
+        std::cerr << "[Mock] can't listen on " << settings.mAddress << "\n";
+        return 1;
+    }
+
+    std::cout << "[Mock] Octane stand-in listening on " << settings.mAddress << ", " << settings.mWidth << "x"
+              << settings.mHeight << " at " << settings.mFrameRate << " fps, " << settings.mSppPerFrame
+              << " spp per frame\n";
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    while (!gStopRequested)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    // the callback streams notice the cancellation within their wait timeout
+    server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+    std::cout << "[Mock] stopped, " << octane.nodeCount() << " nodes were created\n";
+    return 0;
+}
@@ -0,0 +1,298 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+// Benchmarks the shared pixel conversion kernels against the per-pixel loops that
+// GRPCAPIEvents::HandleCallback used to convert render results to 8-bit RGBA.
+//
+// usage: pixelconvert_bench [width height [iterations]]
+
+// system headers
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+// shared kernels
+#include "../../../shared/pixel_convert.h"
+
+using namespace SharedUtils::PixelConvert;
+
+
+//--------------------------------------------------------------------------------------------------
+/// The conversion loops as they were in render-example.cpp. Pitches are in pixels, like
+/// ApiRenderImage::mPitch.
+static void legacyConvert(
+    PixelFormat     type,
+    const void      *buffer,
+    uint32_t        pitch,
+    uint32_t        sizeX,
+    uint32_t        sizeY,
+    uint8_t         *pixelData)
+{
+    const size_t dstPitch = sizeX * 4;
+    uint8_t * dst = pixelData;
+    switch (type)
+    {
+        case PIXEL_FORMAT_LDR_RGBA:
+        {
+            const unsigned char *src = (const unsigned char*)buffer;
+            const size_t        srcPitch = pitch * 4;
+            for (unsigned int y=0; y<sizeY; ++y, src+=srcPitch, dst+=dstPitch)
+            {
+                const unsigned char *srcPixel = src;
+                unsigned char       *dstPixel = dst;
+                for (unsigned int x = 0; x < sizeX; ++x, srcPixel += 4, dstPixel += 4)
+                {
+                    dstPixel[0] = srcPixel[0];
+                    dstPixel[1] = srcPixel[1];
+                    dstPixel[2] = srcPixel[2];
+                    dstPixel[3] = 0xff;
+                }
+            }
+            break;
+        }
+        case PIXEL_FORMAT_LDR_MONO_ALPHA:
+        {
+            const unsigned char *src = (const unsigned char*)buffer;
+            const size_t        srcPitch = pitch * 2;
+            for (unsigned int y=0; y<sizeY; ++y, src+=srcPitch, dst+=dstPitch)
+            {
+                const unsigned char *srcPixel = src;
+                unsigned char       *dstPixel = dst;
+                for (unsigned int x=0; x<sizeX; ++x, srcPixel+=2, dstPixel+=4)
+                {
+                    dstPixel[0] = srcPixel[0];
+                    dstPixel[1] = srcPixel[0];
+                    dstPixel[2] = srcPixel[0];
+                    dstPixel[3] = 0xff;
+                }
+            }
+            break;
+        }
+        case PIXEL_FORMAT_HDR_RGBA:
+        {
+            const float  *src = (const float*)buffer;
+            const size_t srcPitch = pitch * 4;
+            for (unsigned int y = 0; y < sizeY; ++y, src+=srcPitch, dst+=dstPitch)
+            {
+                const float   *srcPixel = src;
+                unsigned char *dstPixel = dst;
+                for (unsigned int x=0; x<sizeX; ++x, srcPixel+=4, dstPixel+=4)
+                {
+                    dstPixel[0] = (unsigned char)std::clamp(srcPixel[0] * 255.f, 0.f, 255.f);
+                    dstPixel[1] = (unsigned char)std::clamp(srcPixel[1] * 255.f, 0.f, 255.f);
+                    dstPixel[2] = (unsigned char)std::clamp(srcPixel[2] * 255.f, 0.f, 255.f);
+                    dstPixel[3] = 0xff;
+                }
+            }
+            break;
+        }
+        case PIXEL_FORMAT_HDR_MONO_ALPHA:
+        {
+            const float  *src = (const float*)buffer;
+            const size_t srcPitch = pitch * 2;
+            for (unsigned int y=0; y<sizeY; ++y, src+=srcPitch, dst+=dstPitch)
+            {
+                const float   *srcPixel = src;
+                unsigned char *dstPixel = dst;
+                for (unsigned int x = 0; x < sizeX; ++x, srcPixel += 2, dstPixel += 4)
+                {
+                    dstPixel[0] = (unsigned char)std::clamp(srcPixel[0] * 255.f, 0.f, 255.f);
+                    dstPixel[1] = (unsigned char)std::clamp(srcPixel[0] * 255.f, 0.f, 255.f);
+                    dstPixel[2] = (unsigned char)std::clamp(srcPixel[0] * 255.f, 0.f, 255.f);
+                    dstPixel[3] = 0xff;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/// Runs func iterations times and returns the median time in milliseconds.
+template <class F>
+static double medianMs(
+    int     iterations,
+    F       func)
+{
+    std::vector<double> times;
+    times.reserve(iterations);
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        func();
+        auto end = std::chrono::high_resolution_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+
+static void printRow(
+    const std::string   &name,
+    double              ms,
+    double              baselineMs,
+    size_t              bytes)
+{
+    std::cout << "  " << std::left << std::setw(28) << name << std::right
+              << std::fixed << std::setprecision(3) << std::setw(10) << ms << " ms"
+              << std::setprecision(1) << std::setw(10) << (bytes / (ms * 1.0e6)) << " GB/s"
+              << std::setprecision(2) << std::setw(8) << (baselineMs / ms) << "x\n";
+}
+
+
+static std::vector<SimdLevel> availableLevels()
+{
+    std::vector<SimdLevel> levels;
+    const SimdLevel candidates[] = { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_NEON };
+    for (SimdLevel level : candidates)
+    {
+        if (setSimdLevel(level) == level)
+        {
+            levels.push_back(level);
+        }
+    }
+    return levels;
+}
+
+
+int main(
+    int     argc,
+    char    **argv)
+{
+    uint32_t width      = 3840;
+    uint32_t height     = 2160;
+    int      iterations = 15;
+    if (argc >= 3)
+    {
+        width  = (uint32_t)std::stoul(argv[1]);
+        height = (uint32_t)std::stoul(argv[2]);
+    }
+    if (argc >= 4)
+    {
+        iterations = std::max(1, std::stoi(argv[3]));
+    }
+    // Octane pads rows, use a pitch that is not the width to exercise that
+    const uint32_t pitch = (width + 31) & ~31u;
+
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> hdrValue(-0.25f, 1.5f);
+    std::vector<float> hdr((size_t)pitch * height * 4);
+    for (float &v : hdr)
+    {
+        v = hdrValue(rng);
+    }
+    std::vector<uint8_t> ldr((size_t)pitch * height * 4);
+    for (uint8_t &v : ldr)
+    {
+        v = (uint8_t)rng();
+    }
+    std::vector<uint8_t> expected((size_t)width * height * 4);
+    std::vector<uint8_t> result(expected.size());
+
+    const std::vector<SimdLevel> levels = availableLevels();
+    std::cout << "Pixel conversion benchmark " << width << "x" << height << " (pitch " << pitch
+              << "), median of " << iterations << " runs\n";
+
+    struct Case
+    {
+        const char  *name;
+        PixelFormat format;
+        const void  *buffer;
+    };
+    const Case cases[] =
+    {
+        { "LDR_RGBA",       PIXEL_FORMAT_LDR_RGBA,       ldr.data() },
+        { "LDR_MONO_ALPHA", PIXEL_FORMAT_LDR_MONO_ALPHA, ldr.data() },
+        { "HDR_RGBA",       PIXEL_FORMAT_HDR_RGBA,       hdr.data() },
+        { "HDR_MONO_ALPHA", PIXEL_FORMAT_HDR_MONO_ALPHA, hdr.data() },
+    };
+
+    bool allMatch = true;
+    for (const Case &c : cases)
+    {
+        const size_t srcPitch = pitch * bytesPerPixel(c.format);
+        const size_t bytes = srcPitch * height + expected.size();
+        std::cout << "\n" << c.name << "\n";
+
+        const double legacyMs = medianMs(iterations, [&]() {
+            legacyConvert(c.format, c.buffer, pitch, width, height, expected.data());
+        });
+        printRow("legacy loop", legacyMs, legacyMs, bytes);
+
+        for (SimdLevel level : levels)
+        {
+            setSimdLevel(level);
+            for (int threaded = 0; threaded < 2; ++threaded)
+            {
+                setParallelThreshold(threaded ? 1024 * 1024 : 0);
+                std::fill(result.begin(), result.end(), 0);
+                const double ms = medianMs(iterations, [&]() {
+                    convertToRgba8(c.format, c.buffer, srcPitch, width, height, result.data(), width * 4);
+                });
+                std::string name = std::string(simdLevelName(level)) + (threaded ? " threaded" : "");
+                if (result != expected)
+                {
+                    name += " MISMATCH";
+                    allMatch = false;
+                }
+                printRow(name, ms, legacyMs, bytes);
+            }
+        }
+    }
+
+    // kernels that had no previous implementation, compared against the scalar path
+    const size_t values = (size_t)width * height * 4;
+    std::vector<uint16_t> halfs(values);
+    std::vector<float> floats(values);
+    std::vector<uint8_t> rgba(ldr.begin(), ldr.begin() + values);
+    const uint8_t bgra[4] = { 2, 1, 0, 3 };
+    std::vector<float> premultiplied(hdr.begin(), hdr.begin() + values);
+    for (size_t i = 3; i < values; i += 4)
+    {
+        premultiplied[i] = 0.25f + std::abs(premultiplied[i]);
+    }
+    setParallelThreshold(0);
+
+    struct Kernel
+    {
+        const char *name;
+        size_t     bytes;
+        std::function<void()> run;
+    };
+    const Kernel kernels[] =
+    {
+        { "floatToHalf",   values * 6, [&]() { floatToHalf(hdr.data(), halfs.data(), values); } },
+        { "halfToFloat",   values * 6, [&]() { halfToFloat(halfs.data(), floats.data(), values); } },
+        { "premultiply8",  values * 2, [&]() { premultiply8(rgba.data(), values / 4); } },
+        { "swizzle8 BGRA", values * 2, [&]() { swizzle8(rgba.data(), rgba.data(), values / 4, bgra); } },
+        // the pair keeps the values stable across iterations
+        { "(un)premultiplyF", values * 16, [&]() {
+            premultiplyFloat(premultiplied.data(), values / 4);
+            unpremultiplyFloat(premultiplied.data(), values / 4);
+        } },
+    };
+    for (const Kernel &k : kernels)
+    {
+        std::cout << "\n" << k.name << "\n";
+        setSimdLevel(SIMD_SCALAR);
+        const double scalarMs = medianMs(iterations, k.run);
+        for (SimdLevel level : levels)
+        {
+            setSimdLevel(level);
+            printRow(simdLevelName(level), medianMs(iterations, k.run), scalarMs, k.bytes);
+        }
+    }
+
+    std::cout << "\nOutput " << (allMatch ? "matches" : "DOES NOT match") << " the legacy loops\n";
+    return allMatch ? 0 : 1;
+}
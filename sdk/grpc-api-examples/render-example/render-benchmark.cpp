@@ -0,0 +1,631 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+#include "render-benchmark.h"
+
+// system headers
+#include <grpcpp/support/client_interceptor.h>
+#include <google/protobuf/message_lite.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+namespace
+{
+
+//--------------------------------------------------------------------------------------------------
+/// Interceptor of a single call, reports the call to the counter once its status arrived.
+class RpcCountingInterceptor : public grpc::experimental::Interceptor
+{
+public:
+    RpcCountingInterceptor(
+        grpc::experimental::ClientRpcInfo * info,
+        RpcCounter &                        counter)
+    :
+        mCounter(counter),
+        mMethod(info->method() ? info->method() : "")
+    {}
+
+    void Intercept(
+        grpc::experimental::InterceptorBatchMethods * methods) override
+    {
+        using grpc::experimental::InterceptionHookPoints;
+
+        if (methods->QueryInterceptionHookPoint(InterceptionHookPoints::PRE_SEND_MESSAGE))
+        {
+            const grpc::ByteBuffer * buffer = methods->GetSerializedSendMessage();
+            if (buffer)
+            {
+                mBytesSent += buffer->Length();
+            }
+        }
+        if (methods->QueryInterceptionHookPoint(InterceptionHookPoints::POST_RECV_MESSAGE))
+        {
+            // all messages of the API are protobuf messages
+            const void * message = methods->GetRecvMessage();
+            if (message)
+            {
+                mBytesReceived += static_cast<const google::protobuf::MessageLite*>(message)->ByteSizeLong();
+            }
+        }
+        if (methods->QueryInterceptionHookPoint(InterceptionHookPoints::POST_RECV_STATUS))
+        {
+            const grpc::Status * status = methods->GetRecvStatus();
+            mCounter.record(mMethod, mBytesSent, mBytesReceived, status && !status->ok());
+        }
+        methods->Proceed();
+    }
+
+private:
+    RpcCounter & mCounter;
+    std::string  mMethod;
+    uint64_t     mBytesSent     = 0;
+    uint64_t     mBytesReceived = 0;
+};
+
+
+class RpcCountingInterceptorFactory : public grpc::experimental::ClientInterceptorFactoryInterface
+{
+public:
+    explicit RpcCountingInterceptorFactory(
+        RpcCounter & counter)
+    :
+        mCounter(counter)
+    {}
+
+    grpc::experimental::Interceptor * CreateClientInterceptor(
+        grpc::experimental::ClientRpcInfo * info) override
+    {
+        return new RpcCountingInterceptor(info, mCounter);
+    }
+
+private:
+    RpcCounter & mCounter;
+};
+
+
+double percentile(
+    std::vector<double> values,
+    double              fraction)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * (values.size() - 1) + 0.5));
+    return values[index];
+}
+
+
+double mean(
+    const std::vector<double> & values)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (double v : values)
+    {
+        sum += v;
+    }
+    return sum / values.size();
+}
+
+
+void writeDistribution(
+    std::ostream &              out,
+    const char *                name,
+    const std::vector<double> & values)
+{
+    out << "    \"" << name << "\": { \"count\": " << values.size()
+        << ", \"mean\": " << mean(values)
+        << ", \"p50\": " << percentile(values, 0.5)
+        << ", \"p95\": " << percentile(values, 0.95)
+        << ", \"max\": " << (values.empty() ? 0.0 : *std::max_element(values.begin(), values.end())) << " }";
+}
+
+
+std::string jsonEscape(
+    const std::string & text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+        }
+        if (static_cast<unsigned char>(c) >= 0x20)
+        {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+
+bool parseInt(
+    const char * text,
+    int          minValue,
+    int &        value)
+{
+    char * end = nullptr;
+    const long parsed = std::strtol(text, &end, 10);
+    if (!end || *end != '\0' || parsed < minValue)
+    {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+} // namespace
+
+
+//--------------------------------------------------------------------------------------------------
+// RenderBenchmarkConfig
+
+bool RenderBenchmarkConfig::parse(
+    int    argc,
+    char * argv[],
+    int    first)
+{
+    for (int i = first; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        const char * value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (option == "--objects")
+        {
+            ok = ok && parseInt(value, 0, mObjects);
+        }
+        else if (option == "--diffuse-materials")
+        {
+            ok = ok && parseInt(value, 1, mDiffuseMaterials);
+        }
+        else if (option == "--glossy-materials")
+        {
+            ok = ok && parseInt(value, 1, mGlossyMaterials);
+        }
+        else if (option == "--rgb-textures")
+        {
+            ok = ok && parseInt(value, 1, mRgbTextures);
+        }
+        else if (option == "--image-textures")
+        {
+            ok = ok && parseInt(value, 0, mImageTextures);
+        }
+        else if (option == "--spp")
+        {
+            int spp = 0;
+            ok = ok && parseInt(value, 1, spp);
+            mTargetSpp = static_cast<uint32_t>(spp);
+        }
+        else if (option == "--timeout")
+        {
+            int seconds = 0;
+            ok = ok && parseInt(value, 1, seconds);
+            mTimeoutSeconds = seconds;
+        }
+        else if (option == "--label")
+        {
+            if (ok) mLabel = value;
+        }
+        else if (option == "--out")
+        {
+            if (ok) mResultsPath = value;
+        }
+        else if (option == "--arrays")
+        {
+            if (ok) mArrays = value;
+        }
+        else if (option == "--texture-dir")
+        {
+            if (ok) mTextureDir = value;
+        }
+        else if (option == "--texture-mode")
+        {
+            ok = ok && TexturePipeline::parseMode(value, mTextures.mMode);
+        }
+        else if (option == "--texture-threads")
+        {
+            int threads = 0;
+            ok = ok && parseInt(value, 0, threads);
+            mTextures.mDecodeThreads = static_cast<unsigned>(threads);
+        }
+        else if (option == "--upload-threads")
+        {
+            int threads = 0;
+            ok = ok && parseInt(value, 1, threads);
+            mTextures.mUploadThreads = static_cast<unsigned>(threads);
+        }
+        else if (option == "--texture-memory")
+        {
+            int mb = 0;
+            ok = ok && parseInt(value, 1, mb);
+            mTextures.mMaxInFlightMb = static_cast<size_t>(mb);
+        }
+        else if (option == "--texture-max-size")
+        {
+            int size = 0;
+            ok = ok && parseInt(value, 0, size);
+            mTextures.mMaxSize = static_cast<uint32_t>(size);
+        }
+        else
+        {
+            std::cout << "Unknown benchmark option " << option << "\n";
+            printUsage(std::cout);
+            return false;
+        }
+
+        if (!ok)
+        {
+            std::cout << "Missing or invalid value for " << option << "\n";
+            printUsage(std::cout);
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+
+void RenderBenchmarkConfig::printUsage(
+    std::ostream & out)
+{
+    out << "Benchmark: renderexample_app <server> --bench [options]\n"
+        << "  --objects N            sphere instances (100)\n"
+        << "  --diffuse-materials N  diffuse materials (30)\n"
+        << "  --glossy-materials N   glossy materials (30)\n"
+        << "  --rgb-textures N       RGB textures (50)\n"
+        << "  --image-textures N     image textures (5)\n"
+        << "  --spp N                samples per pixel the run waits for (256)\n"
+        << "  --timeout S            give up after S seconds (120)\n"
+        << "  --label TEXT           stored with the results\n"
+        << "  --out FILE             JSON results (render-benchmark.json)\n"
+        << "  --arrays HOST:PORT     set the mesh arrays in one call through octane_arrays\n"
+        << "  --texture-dir DIR      image textures cycle through the image files below DIR\n"
+        << "  --texture-mode MODE    file (Octane reads the path), upload (to octane_arrays, needs\n"
+        << "                         --arrays) or pixels (PNG/PPM decoded here) (file)\n"
+        << "  --texture-threads N    threads reading and decoding texture files, 0 for all cores (0)\n"
+        << "  --upload-threads N     image texture nodes created and loaded at the same time (4)\n"
+        << "  --texture-memory MB    decoded textures waiting for their upload (256)\n"
+        << "  --texture-max-size N   halve decoded textures until no side is above N, 0 keeps them (0)\n";
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// RpcCounter
+
+std::shared_ptr<grpc::Channel> RpcCounter::createChannel(
+    const std::string & serverURL)
+{
+    grpc::ChannelArguments args;
+    // frames of large resolutions exceed the default 4 MB limit
+    args.SetMaxReceiveMessageSize(-1);
+
+    std::vector<std::unique_ptr<grpc::experimental::ClientInterceptorFactoryInterface>> interceptors;
+    interceptors.push_back(std::make_unique<RpcCountingInterceptorFactory>(*this));
+    return grpc::experimental::CreateCustomChannelWithInterceptors(
+        serverURL, grpc::InsecureChannelCredentials(), args, std::move(interceptors));
+}
+
+
+RpcCounter::MethodStats RpcCounter::total() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    MethodStats sum;
+    for (const auto & method : mMethods)
+    {
+        sum.mCalls         += method.second.mCalls;
+        sum.mFailed        += method.second.mFailed;
+        sum.mBytesSent     += method.second.mBytesSent;
+        sum.mBytesReceived += method.second.mBytesReceived;
+    }
+    return sum;
+}
+
+
+std::map<std::string, RpcCounter::MethodStats> RpcCounter::methods() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMethods;
+}
+
+
+void RpcCounter::record(
+    const std::string & method,
+    uint64_t            bytesSent,
+    uint64_t            bytesReceived,
+    bool                failed)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    MethodStats & stats = mMethods[method];
+    ++stats.mCalls;
+    stats.mFailed        += failed ? 1 : 0;
+    stats.mBytesSent     += bytesSent;
+    stats.mBytesReceived += bytesReceived;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// RenderBenchmark
+
+RenderBenchmark::RenderBenchmark(
+    const RenderBenchmarkConfig & config)
+:
+    mConfig(config),
+    mStartTime(Clock::now()),
+    mCpuStart(processCpuSeconds())
+{}
+
+
+double RenderBenchmark::msBetween(
+    Clock::time_point from,
+    Clock::time_point to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+
+double RenderBenchmark::processCpuSeconds()
+{
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+        return 0.0;
+    }
+    auto toSeconds = [](const FILETIME & time)
+    {
+        ULARGE_INTEGER value;
+        value.LowPart  = time.dwLowDateTime;
+        value.HighPart = time.dwHighDateTime;
+        return value.QuadPart * 1e-7;
+    };
+    return toSeconds(userTime) + toSeconds(kernelTime);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0.0;
+    }
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+
+void RenderBenchmark::sceneBuildStarted()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSceneStart    = Clock::now();
+    mCpuSceneStart = processCpuSeconds();
+    mSceneRpcs     = mRpcCounter.total();
+}
+
+
+void RenderBenchmark::sceneBuildFinished()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSceneEnd      = Clock::now();
+    mCpuSceneEnd   = processCpuSeconds();
+
+    // only the calls made during the build count towards it
+    const RpcCounter::MethodStats total = mRpcCounter.total();
+    mSceneRpcs.mCalls         = total.mCalls - mSceneRpcs.mCalls;
+    mSceneRpcs.mFailed        = total.mFailed - mSceneRpcs.mFailed;
+    mSceneRpcs.mBytesSent     = total.mBytesSent - mSceneRpcs.mBytesSent;
+    mSceneRpcs.mBytesReceived = total.mBytesReceived - mSceneRpcs.mBytesReceived;
+    mSceneBuilt    = true;
+    mLastFrameTime = mSceneEnd;
+}
+
+
+void RenderBenchmark::meshArraysSet(
+    double   ms,
+    uint32_t calls)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mMeshes;
+    mMeshCalls += calls;
+    mMeshMs    += ms;
+}
+
+
+void RenderBenchmark::texturesLoaded(
+    const TexturePipelineResult & result)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTextureResult = result;
+}
+
+
+void RenderBenchmark::frameDelivered(
+    Clock::time_point notified,
+    float             samplesPerPixel,
+    uint64_t          bytes)
+{
+    const Clock::time_point now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mSceneBuilt || mFinished)
+        {
+            return;
+        }
+
+        if (mFrames == 0)
+        {
+            mFirstFrameMs = msBetween(mSceneEnd, now);
+        }
+        else
+        {
+            mFrameIntervalMs.push_back(msBetween(mLastFrameTime, now));
+        }
+        mDeliveryMs.push_back(msBetween(notified, now));
+        mLastFrameTime = now;
+        mLastSpp       = samplesPerPixel;
+        mFrameBytes   += bytes;
+        ++mFrames;
+
+        if (mTargetSppMs < 0.0 && samplesPerPixel >= mConfig.mTargetSpp)
+        {
+            mTargetSppMs = msBetween(mSceneEnd, now);
+        }
+    }
+    mFrameArrived.notify_all();
+}
+
+
+bool RenderBenchmark::waitForTarget()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    const auto timeout = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(mConfig.mTimeoutSeconds));
+    return mFrameArrived.wait_for(lock, timeout, [this] { return mTargetSppMs >= 0.0; });
+}
+
+
+void RenderBenchmark::finish()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFinished)
+    {
+        return;
+    }
+    mFinished = true;
+    mEndTime  = Clock::now();
+    mCpuEnd   = processCpuSeconds();
+}
+
+
+bool RenderBenchmark::writeResults(
+    const std::string & path) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "Can't write benchmark results to " << path << "\n";
+        return false;
+    }
+    writeResults(file);
+    return static_cast<bool>(file);
+}
+
+
+void RenderBenchmark::writeResults(
+    std::ostream & out) const
+{
+    const RpcCounter::MethodStats total = mRpcCounter.total();
+    const std::map<std::string, RpcCounter::MethodStats> methods = mRpcCounter.methods();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    const std::time_t now = std::time(nullptr);
+    char timestamp[32] = {};
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\n"
+        << "  \"label\": \"" << jsonEscape(mConfig.mLabel) << "\",\n"
+        << "  \"timestamp\": \"" << timestamp << "\",\n"
+        << "  \"config\": { \"objects\": " << mConfig.mObjects
+        << ", \"diffuseMaterials\": " << mConfig.mDiffuseMaterials
+        << ", \"glossyMaterials\": " << mConfig.mGlossyMaterials
+        << ", \"rgbTextures\": " << mConfig.mRgbTextures
+        << ", \"imageTextures\": " << mConfig.mImageTextures
+        << ", \"targetSpp\": " << mConfig.mTargetSpp
+        << ", \"timeoutSeconds\": " << mConfig.mTimeoutSeconds << " },\n"
+        << "  \"sceneBuild\": { \"wallMs\": " << (mSceneBuilt ? msBetween(mSceneStart, mSceneEnd) : 0.0)
+        << ", \"cpuMs\": " << (mCpuSceneEnd - mCpuSceneStart) * 1000.0
+        << ", \"rpcs\": " << mSceneRpcs.mCalls
+        << ", \"failedRpcs\": " << mSceneRpcs.mFailed
+        << ", \"bytesSent\": " << mSceneRpcs.mBytesSent
+        << ", \"bytesReceived\": " << mSceneRpcs.mBytesReceived << " },\n"
+        << "  \"meshArrays\": { \"batched\": " << (mConfig.mArrays.empty() ? "false" : "true")
+        << ", \"meshes\": " << mMeshes << ", \"calls\": " << mMeshCalls << ", \"wallMs\": " << mMeshMs << " },\n"
+        << "  \"imageTextures\": { \"mode\": \"" << TexturePipeline::modeName(mTextureResult.mMode)
+        << "\", \"textures\": " << mTextureResult.mTextures << ", \"files\": " << mTextureResult.mFiles
+        << ", \"decoded\": " << mTextureResult.mDecoded << ", \"byPath\": " << mTextureResult.mFallbacks
+        << ", \"failed\": " << mTextureResult.mFailed << ", \"bytesRead\": " << mTextureResult.mBytesRead
+        << ", \"bytesSent\": " << mTextureResult.mBytesSent << ", \"wallMs\": " << mTextureResult.mWallMs
+        << ", \"texturesPerSecond\": " << mTextureResult.texturesPerSecond()
+        << ", \"mbPerSecond\": " << mTextureResult.mbPerSecond() << " },\n"
+        << "  \"render\": {\n"
+        << "    \"timeToFirstPixelMs\": " << mFirstFrameMs << ",\n"
+        << "    \"timeToTargetSppMs\": " << mTargetSppMs << ",\n"
+        << "    \"targetReached\": " << (mTargetSppMs >= 0.0 ? "true" : "false") << ",\n"
+        << "    \"frames\": " << mFrames << ",\n"
+        << "    \"lastSpp\": " << mLastSpp << ",\n"
+        << "    \"frameBytes\": " << mFrameBytes << ",\n";
+    writeDistribution(out, "deliveryLatencyMs", mDeliveryMs);
+    out << ",\n";
+    writeDistribution(out, "frameIntervalMs", mFrameIntervalMs);
+    out << "\n  },\n"
+        << "  \"client\": { \"wallMs\": " << msBetween(mStartTime, mFinished ? mEndTime : Clock::now())
+        << ", \"cpuMs\": " << ((mFinished ? mCpuEnd : processCpuSeconds()) - mCpuStart) * 1000.0 << " },\n"
+        << "  \"rpcTotal\": { \"calls\": " << total.mCalls << ", \"failed\": " << total.mFailed
+        << ", \"bytesSent\": " << total.mBytesSent << ", \"bytesReceived\": " << total.mBytesReceived << " },\n"
+        << "  \"rpcMethods\": [";
+    bool first = true;
+    for (const auto & method : methods)
+    {
+        out << (first ? "\n" : ",\n")
+            << "    { \"method\": \"" << jsonEscape(method.first) << "\", \"calls\": " << method.second.mCalls
+            << ", \"failed\": " << method.second.mFailed << ", \"bytesSent\": " << method.second.mBytesSent
+            << ", \"bytesReceived\": " << method.second.mBytesReceived << " }";
+        first = false;
+    }
+    out << "\n  ]\n}\n";
+    out << std::defaultfloat;
+}
+
+
+void RenderBenchmark::printSummary(
+    std::ostream & out) const
+{
+    const RpcCounter::MethodStats total = mRpcCounter.total();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    out << std::fixed << std::setprecision(1);
+    out << "[Bench] scene: " << mConfig.mObjects << " objects, " << mConfig.mRgbTextures << " RGB and "
+        << mConfig.mImageTextures << " image textures, " << mConfig.mDiffuseMaterials + mConfig.mGlossyMaterials
+        << " materials\n";
+    out << "[Bench] scene build: " << (mSceneBuilt ? msBetween(mSceneStart, mSceneEnd) : 0.0) << " ms, "
+        << mSceneRpcs.mCalls << " RPCs, " << mSceneRpcs.mBytesSent / 1024.0 << " KB sent, "
+        << mSceneRpcs.mBytesReceived / 1024.0 << " KB received, "
+        << (mCpuSceneEnd - mCpuSceneStart) * 1000.0 << " ms CPU\n";
+    out << "[Bench] mesh arrays: " << mMeshes << " meshes in " << mMeshMs << " ms, " << mMeshCalls << " calls "
+        << (mConfig.mArrays.empty() ? "(per attribute)" : "(setArrays)") << "\n";
+    out << "[Bench] image textures: " << mTextureResult.mTextures << " in " << mTextureResult.mWallMs << " ms ("
+        << TexturePipeline::modeName(mTextureResult.mMode) << "), " << mTextureResult.texturesPerSecond()
+        << " textures/s, " << mTextureResult.mbPerSecond() << " MB/s\n";
+    out << "[Bench] first pixel after " << mFirstFrameMs << " ms, " << mConfig.mTargetSpp << " spp ";
+    if (mTargetSppMs >= 0.0)
+    {
+        out << "after " << mTargetSppMs << " ms\n";
+    }
+    else
+    {
+        out << "not reached (last frame " << mLastSpp << " spp)\n";
+    }
+    out << "[Bench] " << mFrames << " frames, " << mFrameBytes / 1048576.0 << " MB, delivery latency mean "
+        << mean(mDeliveryMs) << " ms, p95 " << percentile(mDeliveryMs, 0.95) << " ms, frame interval mean "
+        << mean(mFrameIntervalMs) << " ms\n";
+    out << "[Bench] all RPCs: " << total.mCalls << " calls (" << total.mFailed << " failed), "
+        << total.mBytesSent / 1048576.0 << " MB sent, " << total.mBytesReceived / 1048576.0 << " MB received\n";
+    out << "[Bench] client CPU: " << ((mFinished ? mCpuEnd : processCpuSeconds()) - mCpuStart) * 1000.0 << " ms over "
+        << msBetween(mStartTime, mFinished ? mEndTime : Clock::now()) << " ms\n";
+    out << std::defaultfloat;
+}
@@ -0,0 +1,194 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+#pragma once
+
+// system headers
+#include <grpcpp/grpcpp.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// application headers
+#include "texture-pipeline.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/// Parameters of a benchmark run. The scene counts replace the fixed amounts of the example
+/// scene, so the same scene can be built at different sizes.
+struct RenderBenchmarkConfig
+{
+    /// Number of sphere instances.
+    int         mObjects          = 100;
+    int         mDiffuseMaterials = 30;
+    int         mGlossyMaterials  = 30;
+    int         mRgbTextures      = 50;
+    /// Image textures cycle through the texture files of the example.
+    int         mImageTextures    = 5;
+    /// The run ends when a frame with this many samples per pixel arrived, or on the timeout.
+    uint32_t    mTargetSpp        = 256;
+    double      mTimeoutSeconds   = 120.0;
+    /// Name stored with the results, e.g. the server or build that was measured.
+    std::string mLabel;
+    /// Results file, JSON.
+    std::string mResultsPath      = "render-benchmark.json";
+    /// octane_arrays (item-arrays) next to the server. If set the meshes are built with one
+    /// setArrays call each instead of a call per attribute.
+    std::string mArrays;
+    /// Image textures cycle through the image files below this directory instead of the texture
+    /// files of the example.
+    std::string mTextureDir;
+    /// How the image texture files are loaded, see TexturePipeline.
+    TexturePipelineSettings mTextures;
+
+    /// Parses the options following --bench. Returns false and prints the usage on an error.
+    bool parse(
+        int          argc,
+        char *       argv[],
+        int          first);
+
+    static void printUsage(
+        std::ostream & out);
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/// Counts the RPCs made on a channel and the size of their messages.
+///
+/// Installed as a client interceptor, so every call of the example is counted without touching
+/// the call sites. Request sizes are the serialized size, response sizes the protobuf size of
+/// the received message.
+class RpcCounter
+{
+public:
+    struct MethodStats
+    {
+        uint64_t mCalls         = 0;
+        uint64_t mFailed        = 0;
+        uint64_t mBytesSent     = 0;
+        uint64_t mBytesReceived = 0;
+    };
+
+    /// Creates a channel whose calls are counted by this counter. The counter must outlive the
+    /// channel.
+    std::shared_ptr<grpc::Channel> createChannel(
+        const std::string & serverURL);
+
+    /// Totals over all methods.
+    MethodStats total() const;
+
+    /// Stats per full method name, e.g. "/octaneapi.ApiNodeService/create".
+    std::map<std::string, MethodStats> methods() const;
+
+    void record(
+        const std::string & method,
+        uint64_t            bytesSent,
+        uint64_t            bytesReceived,
+        bool                failed);
+
+private:
+    mutable std::mutex                  mMutex;
+    std::map<std::string, MethodStats>  mMethods;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/// Collects the timings of one benchmark run and writes them out.
+///
+/// All times are measured on the client. The scene build is timed around the calls that create
+/// the scene; the render measurements only count frames that arrive after the build finished, so
+/// restarts caused by the build don't shorten the time to the target samples.
+class RenderBenchmark
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit RenderBenchmark(
+        const RenderBenchmarkConfig & config);
+
+    const RenderBenchmarkConfig & config() const { return mConfig; }
+
+    RpcCounter & rpcCounter() { return mRpcCounter; }
+
+    void sceneBuildStarted();
+
+    void sceneBuildFinished();
+
+    /// Called after the arrays of a mesh were set and the mesh evaluated, with the calls it took.
+    void meshArraysSet(
+        double   ms,
+        uint32_t calls);
+
+    /// Called once the image textures are loaded.
+    void texturesLoaded(
+        const TexturePipelineResult & result);
+
+    /// Called when the server notified a new frame and the client fetched it. notified is the
+    /// time the notification arrived, bytes is the pixel data of all passes.
+    void frameDelivered(
+        Clock::time_point notified,
+        float             samplesPerPixel,
+        uint64_t          bytes);
+
+    /// Blocks until a frame with the target samples per pixel arrived or the timeout expired.
+    /// Returns true if the target was reached.
+    bool waitForTarget();
+
+    /// Stops the measurement. Later frames are ignored.
+    void finish();
+
+    /// Writes the results as JSON.
+    bool writeResults(
+        const std::string & path) const;
+
+    void writeResults(
+        std::ostream & out) const;
+
+    void printSummary(
+        std::ostream & out) const;
+
+    /// User plus system CPU time of this process in seconds.
+    static double processCpuSeconds();
+
+private:
+    static double msBetween(
+        Clock::time_point from,
+        Clock::time_point to);
+
+    RenderBenchmarkConfig      mConfig;
+    RpcCounter                 mRpcCounter;
+
+    mutable std::mutex         mMutex;
+    std::condition_variable    mFrameArrived;
+
+    Clock::time_point          mStartTime;
+    Clock::time_point          mSceneStart;
+    Clock::time_point          mSceneEnd;
+    Clock::time_point          mEndTime;
+    bool                       mSceneBuilt      = false;
+    bool                       mFinished        = false;
+    double                     mCpuStart        = 0.0;
+    double                     mCpuSceneStart   = 0.0;
+    double                     mCpuSceneEnd     = 0.0;
+    double                     mCpuEnd          = 0.0;
+    RpcCounter::MethodStats    mSceneRpcs;
+    uint32_t                   mMeshes          = 0;
+    uint32_t                   mMeshCalls       = 0;
+    double                     mMeshMs          = 0.0;
+    TexturePipelineResult      mTextureResult;
+
+    // frames after the scene build
+    uint64_t                   mFrames          = 0;
+    uint64_t                   mFrameBytes      = 0;
+    double                     mFirstFrameMs    = -1.0;
+    double                     mTargetSppMs     = -1.0;
+    float                      mLastSpp         = 0.0f;
+    Clock::time_point          mLastFrameTime;
+    std::vector<double>        mDeliveryMs;
+    std::vector<double>        mFrameIntervalMs;
+};
@@ -2,6 +2,8 @@
 
 // system headers
 #include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <cstdio>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
@@ -22,7 +24,13 @@
 #include "apirender.grpc.pb.h"
 #include "apichangemanager.grpc.pb.h"
 #include "callbackstream.grpc.pb.h"
+#include "item_array_transfer.grpc.pb.h"
 #include "apirender.h"
+// shared helpers
+#include "../../../shared/pixel_convert.h"
+#include "../../../shared/image_writer.h"
+#include "render-benchmark.h"
+#include "texture-pipeline.h"
 
 using grpc::Channel;
 using grpc::ClientContext;
@@ -36,6 +44,13 @@ using namespace octaneapi;
 
 std::string gServerURL = "127.0.0.1:50051";
 std::string gImageDumpPath;
+SharedUtils::ImageFileFormat gImageDumpFormat = SharedUtils::IMAGE_FILE_BMP;
+/// Amounts of the scene objects; the defaults build the usual example scene, --bench can scale them.
+RenderBenchmarkConfig gBenchConfig;
+/// Set when running with --bench.
+std::unique_ptr<RenderBenchmark> gBenchmark;
+/// octane_arrays, set with --bench --arrays. The meshes are then built with one setArrays call.
+std::shared_ptr<grpc::Channel> gArraysChannel;
 
 
 #ifdef _WIN32
@@ -189,19 +204,16 @@ static int32_t CUBE_FACES[] =
 };
 
 
-#define OBJECTAMOUNT        100
 #define CUBEAMOUNT          1
-#define DIFFUSEMATAMOUNT    30
-#define GLOSSYMATAMOUNT     30
-#define RGBTEXAMOUNT        50
-#define IMGTEXAMOUNT        5
+#define IMGTEXFILEAMOUNT    5
 
 
-static octaneapi::ObjectRef        gImageTextures[IMGTEXAMOUNT];
-static octaneapi::ObjectRef        gRgbTextures[RGBTEXAMOUNT];
-static octaneapi::ObjectRef        gDiffuseMaterials[DIFFUSEMATAMOUNT];
-static octaneapi::ObjectRef        gGlossyMaterials[GLOSSYMATAMOUNT];
-static octaneapi::ObjectRef        gMaterialMaps[OBJECTAMOUNT + CUBEAMOUNT];
+// sized by initMaterials() from gBenchConfig
+static std::vector<octaneapi::ObjectRef> gImageTextures;
+static std::vector<octaneapi::ObjectRef> gRgbTextures;
+static std::vector<octaneapi::ObjectRef> gDiffuseMaterials;
+static std::vector<octaneapi::ObjectRef> gGlossyMaterials;
+static std::vector<octaneapi::ObjectRef> gMaterialMaps;
 static octaneapi::ObjectRef        gSphereMesh;
 static octaneapi::ObjectRef        gSpinCube;
 static octaneapi::ObjectRef        gRenderTarget;
@@ -223,7 +235,14 @@ public:
     GRPCAPIEvents(std::shared_ptr<grpc::Channel> channel)
 :
     mStub(StreamCallbackService::NewStub(channel)),
-    mChannel(channel)  {}
+    mChannel(channel)
+    {
+        if (gImageDumpPath != "")
+        {
+            // frames are encoded and written on worker threads, the reader thread only queues them
+            mImageWriter = std::make_unique<SharedUtils::ImageWriter>();
+        }
+    }
 
     void initConnection();
 
@@ -238,6 +257,8 @@ private:
     std::unique_ptr<grpc::ClientReader<StreamCallbackRequest>> mStream;
     std::thread mReaderThread;
     std::atomic<bool> mShutdownRequested = false;
+    std::unique_ptr<SharedUtils::ImageWriter> mImageWriter;
+    uint64_t mDumpedFrames = 0;
 
     void HandleCallback(
         const StreamCallbackRequest & request);
@@ -344,19 +365,19 @@ inline T* vectorBuffer(
 
 static octaneapi::ObjectRef & getRandomRgbTexture()
 {
-    return gRgbTextures[lcgRandomRange(RGBTEXAMOUNT)];
+    return gRgbTextures[lcgRandomRange((int)gRgbTextures.size())];
 }
 
 
 static octaneapi::ObjectRef & getRandomImgTexture()
 {
-    return gImageTextures[lcgRandomRange(IMGTEXAMOUNT)];
+    return gImageTextures[lcgRandomRange((int)gImageTextures.size())];
 }
 
 
 static octaneapi::ObjectRef & getRandomTexture()
 {
-    if (lcgRandomBool())
+    if (lcgRandomBool() || gImageTextures.empty())
     {
         return getRandomRgbTexture();
     }
@@ -369,13 +390,13 @@ static octaneapi::ObjectRef & getRandomTexture()
 
 static octaneapi::ObjectRef & getRandomDiffuseMat()
 {
-    return gDiffuseMaterials[lcgRandomRange(DIFFUSEMATAMOUNT)];
+    return gDiffuseMaterials[lcgRandomRange((int)gDiffuseMaterials.size())];
 }
 
 
 static octaneapi::ObjectRef & getRandomGlossyMat()
 {
-    return gGlossyMaterials[lcgRandomRange(GLOSSYMATAMOUNT)];
+    return gGlossyMaterials[lcgRandomRange((int)gGlossyMaterials.size())];
 }
 
 
@@ -1056,6 +1077,113 @@ void setArray(
 };
 
 
+/// The arrays of a mesh node, in the order they are set.
+struct MeshArrays
+{
+    std::vector<int32_t>        mVertsPerPoly;
+    const Float3 *              mVertices;
+    size_t                      mVertexCount;
+    /// vertex, UVW and normal indices all use these
+    const int32_t *             mFaces;
+    size_t                      mFaceIndexCount;
+    std::vector<const char *>   mMaterialNames;
+    std::vector<int32_t>        mPolyMaterialIndices;
+};
+
+
+static_assert(sizeof(Float3) == 12, "Float3 is not the packed float_3 layout");
+
+
+/// Adds a packed array to a setArrays transaction.
+static void addArray(
+    octanearrays::SetArraysRequest &    request,
+    const octaneapi::AttributeId        id,
+    const octanearrays::PackedType      type,
+    const void *                        data,
+    const size_t                        count,
+    const size_t                        elementSize)
+{
+    auto * attribute = request.add_arrays();
+    attribute->set_attributeid((uint32_t)id);
+    auto * array = attribute->mutable_array();
+    array->set_type(type);
+    array->set_count(count);
+    array->set_data(data, count * elementSize);
+}
+
+
+/// Sets all arrays of mesh and evaluates it once. With octane_arrays that is one call, otherwise
+/// one call per attribute and one for the evaluation.
+bool setMeshArrays(
+    std::shared_ptr<grpc::Channel> &  channel,
+    octaneapi::ObjectRef &            meshNode,
+    const MeshArrays &                mesh)
+{
+    const auto start = std::chrono::steady_clock::now();
+    uint32_t calls = 0;
+    bool ok = true;
+    if (gArraysChannel)
+    {
+        octanearrays::SetArraysRequest request;
+        request.set_itemhandle(meshNode.handle());
+        request.set_evaluate(true);
+        addArray(request, octaneapi::A_VERTICES_PER_POLY,   octanearrays::PACKED_INT,    vectorBuffer(mesh.mVertsPerPoly), mesh.mVertsPerPoly.size(), 4);
+        addArray(request, octaneapi::A_VERTICES,            octanearrays::PACKED_FLOAT3, mesh.mVertices,                   mesh.mVertexCount,         12);
+        addArray(request, octaneapi::A_UVWS,                octanearrays::PACKED_FLOAT3, mesh.mVertices,                   mesh.mVertexCount,         12);
+        addArray(request, octaneapi::A_NORMALS,             octanearrays::PACKED_FLOAT3, mesh.mVertices,                   mesh.mVertexCount,         12);
+        addArray(request, octaneapi::A_POLY_VERTEX_INDICES, octanearrays::PACKED_INT,    mesh.mFaces,                      mesh.mFaceIndexCount,      4);
+        addArray(request, octaneapi::A_POLY_UVW_INDICES,    octanearrays::PACKED_INT,    mesh.mFaces,                      mesh.mFaceIndexCount,      4);
+        addArray(request, octaneapi::A_POLY_NORMAL_INDICES, octanearrays::PACKED_INT,    mesh.mFaces,                      mesh.mFaceIndexCount,      4);
+        auto * names = request.add_arrays();
+        names->set_attributeid((uint32_t)octaneapi::A_MATERIAL_NAMES);
+        for (const char * name : mesh.mMaterialNames)
+        {
+            names->mutable_strings()->add_data(name);
+        }
+        addArray(request, octaneapi::A_POLY_MATERIAL_INDICES, octanearrays::PACKED_INT, vectorBuffer(mesh.mPolyMaterialIndices),
+                 mesh.mPolyMaterialIndices.size(), 4);
+
+        auto stub = octanearrays::ItemArrayTransfer::NewStub(gArraysChannel);
+        grpc::ClientContext context;
+        octanearrays::SetPackedArrayResponse response;
+        const grpc::Status status = stub->setArrays(&context, request, &response);
+        if (!status.ok())
+        {
+            std::cout << "[Mesh] setArrays failed: " << status.error_message() << "\n";
+        }
+        ok = status.ok();
+        calls = 1;
+    }
+    else
+    {
+        const std::vector<int32_t> & vertsPerPoly = mesh.mVertsPerPoly;
+        setArray(channel, meshNode, octaneapi::A_VERTICES_PER_POLY,   vectorBuffer(vertsPerPoly), vertsPerPoly.size(),   false);
+        setArray(channel, meshNode, octaneapi::A_VERTICES,            mesh.mVertices,             mesh.mVertexCount,     false);
+        setArray(channel, meshNode, octaneapi::A_UVWS,                mesh.mVertices,             mesh.mVertexCount,     false);
+        setArray(channel, meshNode, octaneapi::A_NORMALS,             mesh.mVertices,             mesh.mVertexCount,     false);
+        setArray(channel, meshNode, octaneapi::A_POLY_VERTEX_INDICES, mesh.mFaces,                mesh.mFaceIndexCount,  false);
+        setArray(channel, meshNode, octaneapi::A_POLY_UVW_INDICES,    mesh.mFaces,                mesh.mFaceIndexCount,  false);
+        setArray(channel, meshNode, octaneapi::A_POLY_NORMAL_INDICES, mesh.mFaces,                mesh.mFaceIndexCount,  false);
+        setArray(channel, meshNode, octaneapi::A_MATERIAL_NAMES, vectorBuffer(mesh.mMaterialNames), mesh.mMaterialNames.size(), false);
+        setArray(channel, meshNode, octaneapi::A_POLY_MATERIAL_INDICES, vectorBuffer(mesh.mPolyMaterialIndices),
+                 mesh.mPolyMaterialIndices.size(), false);
+
+        // evaluate the mesh
+        ok = evaluate(channel, meshNode);
+        calls = 10;
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[Mesh] " << mesh.mVertexCount << " vertices, " << mesh.mVertsPerPoly.size() << " polygons: "
+              << calls << (calls == 1 ? " setArrays call, " : " calls, ") << ms << " ms\n";
+    if (gBenchmark)
+    {
+        gBenchmark->meshArraysSet(ms, calls);
+    }
+    return ok;
+}
+
+
 octaneapi::ObjectRef createCube(
     std::shared_ptr<grpc::Channel> &  channel)
 {
@@ -1064,31 +1192,22 @@ octaneapi::ObjectRef createCube(
 
     octaneapi::ObjectRef meshNode = createNode(channel,projectRoot,  octaneapi::NT_GEO_MESH, true);
 
-    // set cube geometry
-    const std::vector<int32_t> vertsPerPoly(ARRAY_WIDTH(CUBE_FACES) / 3, 3);
-    setArray(channel, meshNode, octaneapi::A_VERTICES_PER_POLY,   vectorBuffer(vertsPerPoly), vertsPerPoly.size(),        false);
-    setArray(channel, meshNode, octaneapi::A_VERTICES,            CUBE_VERTICES,              ARRAY_WIDTH(CUBE_VERTICES), false);
-    setArray(channel, meshNode, octaneapi::A_UVWS,                CUBE_VERTICES,              ARRAY_WIDTH(CUBE_VERTICES), false);
-    setArray(channel, meshNode, octaneapi::A_NORMALS,             CUBE_VERTICES,              ARRAY_WIDTH(CUBE_VERTICES), false);
-    setArray(channel, meshNode, octaneapi::A_POLY_VERTEX_INDICES, CUBE_FACES,                 ARRAY_WIDTH(CUBE_FACES),    false);
-    setArray(channel, meshNode, octaneapi::A_POLY_UVW_INDICES,    CUBE_FACES,                 ARRAY_WIDTH(CUBE_FACES),    false);
-    setArray(channel, meshNode, octaneapi::A_POLY_NORMAL_INDICES, CUBE_FACES,                 ARRAY_WIDTH(CUBE_FACES),    false);
-
-    // set material names
-    std::vector<const char*> matNames;
-    matNames.push_back("Material 1");
-    setArray(channel, meshNode, octaneapi::A_MATERIAL_NAMES, vectorBuffer(matNames), 1, false);
+    // cube geometry
+    MeshArrays mesh;
+    mesh.mVertsPerPoly.assign(ARRAY_WIDTH(CUBE_FACES) / 3, 3);
+    mesh.mVertices       = CUBE_VERTICES;
+    mesh.mVertexCount    = ARRAY_WIDTH(CUBE_VERTICES);
+    mesh.mFaces          = CUBE_FACES;
+    mesh.mFaceIndexCount = ARRAY_WIDTH(CUBE_FACES);
+
+    // material names
+    mesh.mMaterialNames.push_back("Material 1");
 
     // assign materials to faces
-    std::vector<int32_t> polyMatIndices(vertsPerPoly.size());
-    for (int32_t i = 0; i < polyMatIndices.size(); ++i)
-    {
-        polyMatIndices[i] = 0;
-    }
-    setArray(channel, meshNode, octaneapi::A_POLY_MATERIAL_INDICES, vectorBuffer(polyMatIndices), polyMatIndices.size(), false);
+    mesh.mPolyMaterialIndices.assign(mesh.mVertsPerPoly.size(), 0);
 
-    // evaluate the mesh
-    evaluate(channel, meshNode);
+    // set the arrays and evaluate the mesh
+    setMeshArrays(channel, meshNode, mesh);
 
     return meshNode;
 }
@@ -1104,40 +1223,31 @@ octaneapi::ObjectRef createSphere(
     // create sphere
     octaneapi::ObjectRef meshNode = createNode(channel, projectRoot, octaneapi::NT_GEO_MESH, true);
 
-    // set sphere geometry
-    const std::vector<int32_t> vertsPerPoly(ARRAY_WIDTH(SPHERE_FACES) / 3, 3);
-    setArray(channel, meshNode, octaneapi::A_VERTICES_PER_POLY, vectorBuffer(vertsPerPoly), vertsPerPoly.size(), false);
-    setArray(channel, meshNode, octaneapi::A_VERTICES, SPHERE_VERTICES, ARRAY_WIDTH(SPHERE_VERTICES), false);
-    setArray(channel, meshNode, octaneapi::A_UVWS, SPHERE_VERTICES, ARRAY_WIDTH(SPHERE_VERTICES), false);
-    setArray(channel, meshNode, octaneapi::A_NORMALS, SPHERE_VERTICES, ARRAY_WIDTH(SPHERE_VERTICES), false);
-    setArray(channel, meshNode, octaneapi::A_POLY_VERTEX_INDICES, SPHERE_FACES, ARRAY_WIDTH(SPHERE_FACES), false);
-    setArray(channel, meshNode, octaneapi::A_POLY_UVW_INDICES, SPHERE_FACES, ARRAY_WIDTH(SPHERE_FACES), false);
-    setArray(channel, meshNode, octaneapi::A_POLY_NORMAL_INDICES, SPHERE_FACES, ARRAY_WIDTH(SPHERE_FACES), false);
-
-    // set material names
-    std::vector<const char*> matNames;
-    matNames.push_back("Material 1");
-    matNames.push_back("Material 2");
-    matNames.push_back("Material 3");
-    matNames.push_back("Material 4");
-    matNames.push_back("Material 5");
-    matNames.push_back("Material 6");
-    matNames.push_back("Material 7");
-    matNames.push_back("Material 8");
-    matNames.push_back("Material 9");
-    matNames.push_back("Material 10");
-    setArray(channel, meshNode, octaneapi::A_MATERIAL_NAMES, vectorBuffer(matNames), matCount, false);
+    // sphere geometry
+    MeshArrays mesh;
+    mesh.mVertsPerPoly.assign(ARRAY_WIDTH(SPHERE_FACES) / 3, 3);
+    mesh.mVertices       = SPHERE_VERTICES;
+    mesh.mVertexCount    = ARRAY_WIDTH(SPHERE_VERTICES);
+    mesh.mFaces          = SPHERE_FACES;
+    mesh.mFaceIndexCount = ARRAY_WIDTH(SPHERE_FACES);
+
+    // material names
+    static const char * MATERIAL_NAMES[] =
+    {
+        "Material 1", "Material 2", "Material 3", "Material 4", "Material 5",
+        "Material 6", "Material 7", "Material 8", "Material 9", "Material 10"
+    };
+    mesh.mMaterialNames.assign(MATERIAL_NAMES, MATERIAL_NAMES + std::min<size_t>(matCount, ARRAY_WIDTH(MATERIAL_NAMES)));
 
     // assign materials to faces
-    std::vector<int32_t> polyMatIndices(vertsPerPoly.size());
-    for (int32_t i=0; i<polyMatIndices.size(); ++i)
+    mesh.mPolyMaterialIndices.resize(mesh.mVertsPerPoly.size());
+    for (int32_t i=0; i<(int32_t)mesh.mPolyMaterialIndices.size(); ++i)
     {
-        polyMatIndices[i] = i % matCount;
+        mesh.mPolyMaterialIndices[i] = i % matCount;
     }
-    setArray(channel, meshNode, octaneapi::A_POLY_MATERIAL_INDICES, vectorBuffer(polyMatIndices), polyMatIndices.size(), false);
 
-    // evaluate the mesh
-    evaluate(channel, meshNode);
+    // set the arrays and evaluate the mesh
+    setMeshArrays(channel, meshNode, mesh);
 
     return meshNode;
 }
@@ -1146,7 +1256,7 @@ octaneapi::ObjectRef createSphere(
 void initMaterials(
     std::shared_ptr<grpc::Channel >& channel)
 {
-    std::string texFiles[IMGTEXAMOUNT] =
+    std::string texFiles[IMGTEXFILEAMOUNT] =
     {
         "textures/Bokeh2.jpg",
         "textures/Mineral.jpg",
@@ -1155,22 +1265,52 @@ void initMaterials(
         "textures/OctaneLogo.png"
     };
 
+    const int objectAmount = gBenchConfig.mObjects;
+    gImageTextures.resize(gBenchConfig.mImageTextures);
+    gRgbTextures.resize(gBenchConfig.mRgbTextures);
+    gDiffuseMaterials.resize(gBenchConfig.mDiffuseMaterials);
+    gGlossyMaterials.resize(gBenchConfig.mGlossyMaterials);
+    gMaterialMaps.resize(objectAmount + CUBEAMOUNT);
+
     octaneapi::ObjectRef projectRoot;
     rootNodeGraph(channel, projectRoot);
 
-    std::filesystem::path exePath = getExecutablePath();
-    std::filesystem::path parentDir = exePath.parent_path().parent_path().parent_path();
-    for (int i = 0; i < IMGTEXAMOUNT; ++i)
+    std::vector<std::string> textureFiles;
+    if (!gBenchConfig.mTextureDir.empty())
+    {
+        textureFiles = TexturePipeline::listImageFiles(gBenchConfig.mTextureDir);
+        if (textureFiles.empty())
+        {
+            std::cout << "[Textures] no image files in " << gBenchConfig.mTextureDir
+                      << ", using the example textures\n";
+        }
+    }
+    if (textureFiles.empty())
+    {
+        std::filesystem::path exePath = getExecutablePath();
+        std::filesystem::path parentDir = exePath.parent_path().parent_path().parent_path();
+        for (int i = 0; i < IMGTEXFILEAMOUNT; ++i)
+        {
+            textureFiles.push_back((parentDir / texFiles[i]).string());
+        }
+    }
+
+    // the image textures are created and loaded in parallel, reading and decoding the files
+    // overlaps with the calls
+    std::vector<std::string> texturePaths(gImageTextures.size());
+    for (size_t i = 0; i < texturePaths.size(); ++i)
+    {
+        texturePaths[i] = textureFiles[i % textureFiles.size()];
+    }
+    TexturePipeline texturePipeline(channel, gArraysChannel, gBenchConfig.mTextures);
+    const TexturePipelineResult textureResult = texturePipeline.run(projectRoot, texturePaths, gImageTextures);
+    texturePipeline.printResult(textureResult, std::cout);
+    if (gBenchmark)
     {
-        gImageTextures[i] = createNode(channel, projectRoot, octaneapi::NT_TEX_IMAGE, true);
-        std::filesystem::path texFilePath = parentDir / texFiles[i];
-        std::string fullPath = texFilePath.string();
-        octaneapi::ApiItem::setValueByIDRequest request; 
-        request.set_string_value(fullPath);
-        set(channel, gImageTextures[i], octaneapi::A_FILENAME, request, true);
+        gBenchmark->texturesLoaded(textureResult);
     }
 
-    for (int i = 0; i < RGBTEXAMOUNT; ++i)
+    for (int i = 0; i < (int)gRgbTextures.size(); ++i)
     {
         gRgbTextures[i] = createNode(channel, projectRoot, octaneapi::NT_TEX_RGB, true);
         octaneapi::ApiItem::setValueByIDRequest request;
@@ -1184,13 +1324,13 @@ void initMaterials(
         set(channel, gRgbTextures[i], octaneapi::A_VALUE, request, true);
     }
 
-    for (int i = 0; i < DIFFUSEMATAMOUNT; ++i)
+    for (int i = 0; i < (int)gDiffuseMaterials.size(); ++i)
     {
         gDiffuseMaterials[i] = createNode(channel, projectRoot, octaneapi::NT_MAT_DIFFUSE, true);
         connectTo(channel, gDiffuseMaterials[i], octaneapi::P_DIFFUSE, getRandomTexture(), true, false);
     }
 
-    for (int i = 0; i < GLOSSYMATAMOUNT; ++i)
+    for (int i = 0; i < (int)gGlossyMaterials.size(); ++i)
     {
         gGlossyMaterials[i] = createNode(channel, projectRoot, octaneapi::NT_MAT_DIFFUSE, true);
         connectTo(channel, gGlossyMaterials[i], octaneapi::P_DIFFUSE, getRandomTexture(), true, false);
@@ -1199,7 +1339,7 @@ void initMaterials(
     if (!gSphereMesh.handle())
     {
         gSphereMesh = createSphere(channel, 2);
-        for (int i = 0; i < OBJECTAMOUNT; ++i)
+        for (int i = 0; i < objectAmount; ++i)
         {
             gMaterialMaps[i] = createNode(channel, projectRoot, octaneapi::NT_MAT_MAP, true);
             connectTo(channel, gMaterialMaps[i], octaneapi::P_GEOMETRY, gSphereMesh, true, false);
@@ -1211,8 +1351,8 @@ void initMaterials(
         gSpinCube = createCube(channel);
         for (int c = 0; c < CUBEAMOUNT; ++c)
         {
-            gMaterialMaps[OBJECTAMOUNT+c] = createNode(channel, projectRoot, octaneapi::NT_MAT_MAP, true);
-            connectTo(channel, gMaterialMaps[OBJECTAMOUNT+c], octaneapi::P_GEOMETRY, gSpinCube, true, false);
+            gMaterialMaps[objectAmount+c] = createNode(channel, projectRoot, octaneapi::NT_MAT_MAP, true);
+            connectTo(channel, gMaterialMaps[objectAmount+c], octaneapi::P_GEOMETRY, gSpinCube, true, false);
         }
 
         gCubePlacementNode = createNode(channel, projectRoot, octaneapi::NT_GEO_PLACEMENT, true);
@@ -1228,7 +1368,7 @@ void initMaterials(
         connectTo(channel, gCubeMat, octaneapi::P_DIFFUSE, cubeTexture, true, false);
     }
 
-    for (int i = 0; i < OBJECTAMOUNT; ++i)
+    for (int i = 0; i < objectAmount; ++i)
     {
         octaneapi::ObjectRef matMap = gMaterialMaps[i];
         int base = staticPinCount(channel, matMap);
@@ -1238,7 +1378,7 @@ void initMaterials(
 
     for (int c = 0; c < CUBEAMOUNT; ++c)
     {
-        octaneapi::ObjectRef matMap = gMaterialMaps[OBJECTAMOUNT+c];
+        octaneapi::ObjectRef matMap = gMaterialMaps[objectAmount+c];
         connectToIx(channel, matMap, staticPinCount(channel, matMap) + 0, gCubeMat, true, false);
     }
 }
@@ -1248,20 +1388,21 @@ void makeSimpleScene(
     std::shared_ptr<grpc::Channel> & channel,
     octaneapi::ObjectRef &           renderTargetNode)
 {
+    const int objectAmount = gBenchConfig.mObjects;
     octaneapi::ObjectRef projectRoot;
     rootNodeGraph(channel, projectRoot);
     octaneapi::ObjectRef geoGroup;
     if (connectedNode(channel, renderTargetNode, octaneapi::P_MESH, false, geoGroup))
     {
         octaneapi::ApiItem::setValueByIDRequest request;
-        request.set_int_value(OBJECTAMOUNT + CUBEAMOUNT);
+        request.set_int_value(objectAmount + CUBEAMOUNT);
         set(channel, geoGroup, octaneapi::A_PIN_COUNT, request, true);
     }
 
     initMaterials(channel);
 
     // creates instances of the meshes and connects them with the geometry group
-    for (int i = 0; i < OBJECTAMOUNT; ++i)
+    for (int i = 0; i < objectAmount; ++i)
     {
         const float t = sqrtf(i * 0.001f);
         auto scatter = createNode(channel, projectRoot, octaneapi::NT_GEO_SCATTER, true);
@@ -1280,8 +1421,8 @@ void makeSimpleScene(
         auto * v = request.mutable_matrix_value();
         *v = mat;
         setPinValue(channel, gCubePlacementNode, octaneapi::P_TRANSFORM, request, true);
-        connectTo(channel, gCubePlacementNode, octaneapi::P_GEOMETRY, gMaterialMaps[OBJECTAMOUNT], true, false);
-        connectToIx(channel, geoGroup, OBJECTAMOUNT, gCubePlacementNode, true, false);
+        connectTo(channel, gCubePlacementNode, octaneapi::P_GEOMETRY, gMaterialMaps[objectAmount], true, false);
+        connectToIx(channel, geoGroup, objectAmount, gCubePlacementNode, true, false);
     }
 
     // set up camera
@@ -1332,85 +1473,24 @@ void makeSimpleScene(
 
     {
         octaneapi::ApiNode::setPinValueByIDRequest request;
-        request.set_int_value(1000);
+        // the benchmark may wait for more samples than the example renders
+        request.set_int_value(std::max<uint32_t>(1000, gBenchConfig.mTargetSpp));
         setPinValue(channel, kernel, octaneapi::P_MAX_SAMPLES, request, true);
     }
     connectTo(channel, renderTargetNode, octaneapi::P_KERNEL, kernel, true, false);
 }
 
 
-void saveAsBMP(
-    const std::string & filename,
-    const uint8_t *     pixelData,
-    int                 width,
-    int                 height)
-{
-    const uint32_t rowSize = width * 4; // 4 bytes per pixel (BGRA)
-    const uint32_t imageSize = rowSize * height;
-    const uint32_t fileSize = 14 + 40 + imageSize;
-
-    std::ofstream out(filename, std::ios::binary);
-    if (!out)
-    {
-        throw std::runtime_error("Unable to open file for writing");
-    }
-
-    // BITMAPFILEHEADER
-    out.put('B');
-    out.put('M');
-    out.write(reinterpret_cast<const char*>(&fileSize), 4);
-    uint32_t reserved = 0;
-    out.write(reinterpret_cast<const char*>(&reserved), 4);
-    uint32_t pixelDataOffset = 14 + 40;
-    out.write(reinterpret_cast<const char*>(&pixelDataOffset), 4);
-
-    // BITMAPINFOHEADER
-    uint32_t infoHeaderSize = 40;
-    out.write(reinterpret_cast<const char*>(&infoHeaderSize), 4);
-    out.write(reinterpret_cast<const char*>(&width), 4);
-    out.write(reinterpret_cast<const char*>(&height), 4);
-    uint16_t planes = 1;
-    out.write(reinterpret_cast<const char*>(&planes), 2);
-    uint16_t bitsPerPixel = 32;
-    out.write(reinterpret_cast<const char*>(&bitsPerPixel), 2);
-    uint32_t compression = 0;
-    out.write(reinterpret_cast<const char*>(&compression), 4);
-    out.write(reinterpret_cast<const char*>(&imageSize), 4);
-    uint32_t ppm = 2835; // 72 DPI
-    out.write(reinterpret_cast<const char*>(&ppm), 4); // x pixels per meter
-    out.write(reinterpret_cast<const char*>(&ppm), 4); // y pixels per meter
-    uint32_t colorsUsed = 0;
-    out.write(reinterpret_cast<const char*>(&colorsUsed), 4);
-    uint32_t importantColors = 0;
-    out.write(reinterpret_cast<const char*>(&importantColors), 4);
-
-    // Write pixel data — BMP expects BGRA
-    for (int y = height - 1; y >= 0; --y) // BMP stores pixels bottom to top
-    {
-        const uint8_t * rowPtr = pixelData + (y * width * 4);
-        for (int x = 0; x < width; ++x)
-        {
-            uint8_t r = rowPtr[x * 4 + 0];
-            uint8_t g = rowPtr[x * 4 + 1];
-            uint8_t b = rowPtr[x * 4 + 2];
-            uint8_t a = rowPtr[x * 4 + 3];
-
-            out.put(b);
-            out.put(g);
-            out.put(r);
-            out.put(a); // Alpha channel (BGRA format)
-        }
-    }
-
-    out.close();
-}
-
-
 void renderScene(
     std::shared_ptr<grpc::Channel> & channel)
 {
     grpc::Status status = grpc::Status::OK;
 
+    if (gBenchmark)
+    {
+        gBenchmark->sceneBuildStarted();
+    }
+
     resetProject(channel);
 
     octaneapi::ObjectRef projectRoot;
@@ -1426,6 +1506,11 @@ void renderScene(
     octaneapi::ObjectRef renderPasses = createNode(channel, projectRoot, octaneapi::NT_RENDER_PASSES, true); 
     connectTo(channel, renderTarget, octaneapi::P_RENDER_PASSES, renderPasses, true, false);
     changeManagerUpdate(channel);
+
+    if (gBenchmark)
+    {
+        gBenchmark->sceneBuildFinished();
+    }
 }
 
 
@@ -1490,9 +1575,30 @@ int main(int    argc,
     }
  
     gServerURL = std::string(argv[1]);
-    if (argc >= 2 && argv[2])
+    if (argc >= 3 && std::string(argv[2]) == "--bench")
     {
-        gImageDumpPath = std::string(argv[2]);
+        // headless benchmark, works against octane.exe or octane_mockserver
+        if (!gBenchConfig.parse(argc, argv, 3))
+        {
+            return 1;
+        }
+        gBenchmark = std::make_unique<RenderBenchmark>(gBenchConfig);
+        if (!gBenchConfig.mArrays.empty())
+        {
+            gArraysChannel = gBenchmark->rpcCounter().createChannel(gBenchConfig.mArrays);
+        }
+    }
+    else
+    {
+        if (argc >= 2 && argv[2])
+        {
+            gImageDumpPath = std::string(argv[2]);
+        }
+        if (argc >= 4 && !SharedUtils::ImageWriter::formatFromName(argv[3], gImageDumpFormat))
+        {
+            std::cout << "Unknown image format " << argv[3] << ", use bmp, ppm, png or exr\n";
+            return 1;
+        }
     }
 
     {
@@ -1505,7 +1611,9 @@ int main(int    argc,
 
         std::cout << "Connecting to octane.exe on " << gServerURL << "\n";
 
-        auto channel = grpc::CreateChannel(gServerURL, grpc::InsecureChannelCredentials());
+        // the benchmark counts the calls and bytes of every RPC
+        auto channel = gBenchmark ? gBenchmark->rpcCounter().createChannel(gServerURL)
+                                  : grpc::CreateChannel(gServerURL, grpc::InsecureChannelCredentials());
 
         {
             GRPCAPIEvents serverEvents(channel);
@@ -1518,12 +1626,32 @@ int main(int    argc,
             // render a scene in octane.exe
             renderScene(channel);
 
-            // pause before shutting down events so we can get the last newImage event
-            // optionally wait until the render is complete
-            std::this_thread::sleep_for(std::chrono::seconds(5));
+            if (gBenchmark)
+            {
+                if (!gBenchmark->waitForTarget())
+                {
+                    std::cout << "[Bench] timed out waiting for " << gBenchConfig.mTargetSpp << " spp\n";
+                }
+                gBenchmark->finish();
+            }
+            else
+            {
+                // pause before shutting down events so we can get the last newImage event
+                // optionally wait until the render is complete
+                std::this_thread::sleep_for(std::chrono::seconds(5));
+            }
 
             serverEvents.shutdown();
         }
+
+        if (gBenchmark)
+        {
+            gBenchmark->printSummary(std::cout);
+            if (gBenchmark->writeResults(gBenchConfig.mResultsPath))
+            {
+                std::cout << "[Bench] results written to " << gBenchConfig.mResultsPath << "\n";
+            }
+        }
         std::cout << "Server stopped. Exiting.\n";
     }
     return 0;
@@ -1582,6 +1710,16 @@ void GRPCAPIEvents::shutdown()
             mReaderThread.join();// Wait for reading to stop
         }
     }
+
+    if (mImageWriter)
+    {
+        // write the frames that are still queued
+        mImageWriter->flush();
+        const SharedUtils::ImageWriter::Stats stats = mImageWriter->stats();
+        std::cout << "[Client] Image dump: " << stats.written << " written, " << stats.dropped << " dropped, "
+                  << stats.failed << " failed, " << (stats.bytesWritten >> 20) << " MB, last frame encoded in "
+                  << stats.lastEncodeMs << " ms and written in " << stats.lastWriteMs << " ms\n";
+    }
 }
 
 
@@ -1619,114 +1757,60 @@ void GRPCAPIEvents::HandleCallback(
         }
         case octaneapi::StreamCallbackRequest::kNewImage:
         {
-            std::cout << "[Client] Received callback of type: kNewImage \n";
+            const RenderBenchmark::Clock::time_point notified = RenderBenchmark::Clock::now();
+            if (!gBenchmark)
+            {
+                std::cout << "[Client] Received callback of type: kNewImage \n";
+            }
             std::vector<RenderedImage> renderImages;
             if (!grabRenderResult(mChannel, renderImages))
             {
                 // call releaseRenderResult on the server inside grabRenderResult and try to change to vector instead of ApiArray
                 return;
             }
+            if (gBenchmark)
+            {
+                // frame delivery is the notification plus fetching and converting the pixels
+                float samplesPerPixel = 0.0f;
+                uint64_t bytes = 0;
+                for (const RenderedImage & renderImage : renderImages)
+                {
+                    samplesPerPixel = std::max(samplesPerPixel, renderImage.mTonemappedSamplesPerPixel);
+                    bytes += (uint64_t)renderImage.mPitch * renderImage.mSizeY *
+                        SharedUtils::PixelConvert::bytesPerPixel(
+                            static_cast<SharedUtils::PixelConvert::PixelFormat>(renderImage.mType));
+                }
+                gBenchmark->frameDelivered(notified, samplesPerPixel, bytes);
+            }
             // process all the rendered images
             for (size_t i = 0; i < renderImages.size(); ++i)
             {
                 const RenderedImage & renderImage = renderImages[i]; 
 
-                // create new ARGB image
-                const size_t            dstPitch = renderImage.mSizeX * 4;// imgData.lineStride;
-                uint8_t * pixelData = new uint8_t[renderImage.mSizeX * renderImage.mSizeY * 4];
-                uint8_t * dst = pixelData;
-                switch (renderImage.mType)
+                if (!mImageWriter)
                 {
-                    case  Octane::IMAGE_TYPE_LDR_RGBA:
-                    {
-                        const unsigned char *src = (const unsigned char*)renderImage.mBuffer;
-                        const size_t        srcPitch = renderImage.mPitch * 4;
-                        for (unsigned int y=0; y<renderImage.mSizeY; ++y, src+=srcPitch, dst+=dstPitch)
-                        {
-                            const unsigned char *srcPixel = src;
-                            unsigned char       *dstPixel = dst;
-                            for (unsigned int x = 0; x < renderImage.mSizeX; ++x, srcPixel += 4, dstPixel += 4)
-                            {
-                                dstPixel[0] = srcPixel[0];
-                                dstPixel[1] = srcPixel[1];
-                                dstPixel[2] = srcPixel[2];
-                                dstPixel[3] = 0xff;
-                            }
-                        }
-                        break;
-                    }
-                    case  Octane::IMAGE_TYPE_LDR_MONO_ALPHA:
-                    {
-                        const unsigned char *src = (const unsigned char*)renderImage.mBuffer;
-                        const size_t        srcPitch = renderImage.mPitch * 2;
-                        for (unsigned int y=0; y<renderImage.mSizeY; ++y, src+=srcPitch, dst+=dstPitch)
-                        {
-                            const unsigned char *srcPixel = src;
-                            unsigned char       *dstPixel = dst;
-                            for (unsigned int x=0; x<renderImage.mSizeX; ++x, srcPixel+=2, dstPixel+=4)
-                            {
-                                dstPixel[0] = srcPixel[0];
-                                dstPixel[1] = srcPixel[0];
-                                dstPixel[2] = srcPixel[0];
-                                dstPixel[3] = 0xff;
-                            }
-                        }
-                        break;
-                    }
-                    case  Octane::IMAGE_TYPE_HDR_RGBA:
-                    {
-                        const float  *src = (const float*)renderImage.mBuffer;
-                        const size_t srcPitch = renderImage.mPitch * 4;
-                        for (unsigned int y = 0; y < renderImage.mSizeY; ++y, src+=srcPitch, dst+=dstPitch)
-                        {
-                            const float   *srcPixel = src;
-                            unsigned char *dstPixel = dst;
-                            for (unsigned int x=0; x<renderImage.mSizeX; ++x, srcPixel+=4, dstPixel+=4)
-                            {
-                                dstPixel[0] = (unsigned char)std::clamp(srcPixel[0] * 255.f, 0.f, 255.f);
-                                dstPixel[1] = (unsigned char)std::clamp(srcPixel[1] * 255.f, 0.f, 255.f);
-                                dstPixel[2] = (unsigned char)std::clamp(srcPixel[2] * 255.f, 0.f, 255.f);
-                                dstPixel[3] = 0xff;
-                            }
-                        }
-                        break;
-                    }
-                    case  Octane::IMAGE_TYPE_HDR_MONO_ALPHA:
-                    {
-                        const float  *src = (const float*)renderImage.mBuffer;
-                        const size_t srcPitch = renderImage.mPitch * 2;
-                        for (unsigned int y=0; y<renderImage.mSizeY; ++y, src+=srcPitch, dst+=dstPitch)
-                        {
-                            const float   *srcPixel = src;
-                            unsigned char *dstPixel = dst;
-                            for (unsigned int x = 0; x < renderImage.mSizeX; ++x, srcPixel += 2, dstPixel += 4)
-                            {
-                                dstPixel[0] = (unsigned char)std::clamp(srcPixel[0] * 255.f, 0.f, 255.f);
-                                dstPixel[1] = (unsigned char)std::clamp(srcPixel[0] * 255.f, 0.f, 255.f);
-                                dstPixel[2] = (unsigned char)std::clamp(srcPixel[0] * 255.f, 0.f, 255.f);
-                                dstPixel[3] = 0xff;
-                            }
-                        }
-                    }
+                    delete[] (const char*)renderImage.mBuffer;
+                    continue;
                 }
 
-                if (gImageDumpPath != "")
-                {
-                    std::string path = gImageDumpPath;
-                    path.append("/__test.bmp");
-                    saveAsBMP(path, pixelData, renderImage.mSizeX, renderImage.mSizeY);
-                }
-        
-                // delete the data
-                if (pixelData)
-                {
-                    delete[] pixelData;
-                }
-                if (renderImage.mBuffer)
+                // hand the buffer to the writer, it is released once the file is written
+                SharedUtils::ImageFrame frame;
+                frame.format = static_cast<SharedUtils::PixelConvert::PixelFormat>(renderImage.mType);
+                frame.width  = renderImage.mSizeX;
+                frame.height = renderImage.mSizeY;
+                frame.pitch  = renderImage.mPitch * SharedUtils::PixelConvert::bytesPerPixel(frame.format);
+                frame.pixels = std::shared_ptr<const void>(renderImage.mBuffer,
+                                                           [](const void *buffer) { delete[] (const char*)buffer; });
+
+                char name[64];
+                snprintf(name, sizeof(name), "/__test_%06llu_%zu.%s", (unsigned long long)mDumpedFrames, i,
+                         SharedUtils::ImageWriter::extension(gImageDumpFormat));
+                if (!mImageWriter->enqueue(gImageDumpPath + name, gImageDumpFormat, std::move(frame)))
                 {
-                    delete[] renderImage.mBuffer;
+                    std::cerr << "[Client] Image dump queue full, dropped frame " << mDumpedFrames << "\n";
                 }
             }
+            ++mDumpedFrames;
 
             break;
         }
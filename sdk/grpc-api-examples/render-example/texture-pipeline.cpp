@@ -0,0 +1,562 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+#include "texture-pipeline.h"
+
+// system headers
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// application headers
+#include "apinodesystem_3.grpc.pb.h"
+#include "apinodesystem_7.grpc.pb.h"
+#include "item_array_transfer.grpc.pb.h"
+#include "../../../shared/content_hash.h"
+#include "../../../shared/image_reader.h"
+#include "../../../shared/mapped_file.h"
+#include "../../../shared/thread_pool.h"
+
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+/// Extensions of the files listImageFiles() picks up, the formats Octane loads.
+const char * IMAGE_EXTENSIONS[] =
+{
+    ".png", ".jpg", ".jpeg", ".exr", ".hdr", ".tga", ".tif", ".tiff", ".bmp", ".ppm", ".pgm", ".gif"
+};
+
+
+double msSince(
+    Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+
+std::string lowerExtension(
+    const std::filesystem::path & path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return (char)std::tolower(c); });
+    return extension;
+}
+
+
+void toMessage(
+    const SharedUtils::ContentKey & key,
+    octanearrays::BlobKey *         message)
+{
+    message->set_hash(key.hash);
+    message->set_size(key.size);
+}
+
+
+octaneapi::ObjectRef createImageNode(
+    const std::shared_ptr<grpc::Channel> & channel,
+    const octaneapi::ObjectRef &           owner)
+{
+    octaneapi::ApiNode::createRequest request;
+    request.set_type(octaneapi::NT_TEX_IMAGE);
+    *request.mutable_ownergraph() = owner;
+    request.set_configurepins(true);
+
+    octaneapi::ApiNode::createResponse response;
+    grpc::ClientContext context;
+    auto stub = octaneapi::ApiNodeService::NewStub(channel);
+    if (!stub->create(&context, request, &response).ok())
+    {
+        return octaneapi::ObjectRef();
+    }
+    return response.result();
+}
+
+
+bool setValue(
+    const std::shared_ptr<grpc::Channel> &    channel,
+    const octaneapi::ObjectRef &              node,
+    const octaneapi::AttributeId              id,
+    octaneapi::ApiItem::setValueByIDRequest & request,
+    bool                                      evaluate)
+{
+    *request.mutable_item_ref() = node;
+    request.set_attribute_id(id);
+    request.set_evaluate(evaluate);
+
+    octaneapi::ApiItem::setValueResponse response;
+    grpc::ClientContext context;
+    auto stub = octaneapi::ApiItemService::NewStub(channel);
+    return stub->setValueByAttrID(&context, request, &response).ok();
+}
+
+
+/// A_BUFFER is a byte array, sent as one bytes field.
+bool setBuffer(
+    const std::shared_ptr<grpc::Channel> & channel,
+    const octaneapi::ObjectRef &           node,
+    const std::vector<uint8_t> &           pixels,
+    bool                                   evaluate)
+{
+    octaneapi::ApiItem::setArrayByIDRequest request;
+    *request.mutable_item_ref() = node;
+    request.set_attribute_id(octaneapi::A_BUFFER);
+    request.set_evaluate(evaluate);
+    request.mutable_byte_array()->set_data(pixels.data(), pixels.size());
+
+    octaneapi::ApiItem::setArrayResponse response;
+    grpc::ClientContext context;
+    auto stub = octaneapi::ApiItemService::NewStub(channel);
+    return stub->setArrayByAttrID(&context, request, &response).ok();
+}
+
+} // namespace
+
+
+//--------------------------------------------------------------------------------------------------
+// TexturePipelineResult
+
+double TexturePipelineResult::texturesPerSecond() const
+{
+    return mWallMs > 0.0 ? mTextures * 1000.0 / mWallMs : 0.0;
+}
+
+
+double TexturePipelineResult::mbPerSecond() const
+{
+    return mWallMs > 0.0 ? mBytesRead / 1048576.0 * 1000.0 / mWallMs : 0.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// TexturePipeline
+
+/// One distinct file and the nodes that show it.
+struct TexturePipeline::Source
+{
+    std::string                 mPath;
+    /// indices into the paths of the run
+    std::vector<size_t>         mNodes;
+    SharedUtils::MappedFile     mFile;
+    SharedUtils::ContentKey     mKey;
+    SharedUtils::DecodedImage   mImage;
+    bool                        mDecoded     = false;
+    uint64_t                    mFileBytes   = 0;
+    /// counted against mMaxInFlightMb until the last node is set
+    size_t                      mHeldBytes   = 0;
+    std::once_flag              mUploadOnce;
+    /// path on the Octane host, empty if the upload failed
+    std::string                 mRemotePath;
+    std::atomic<size_t>         mPending{ 0 };
+};
+
+
+/// State shared by the decode and upload threads of one run().
+struct TexturePipeline::Run
+{
+    typedef std::pair<std::shared_ptr<Source>, size_t> Task;
+
+    TextureLoadMode                     mMode;
+    const octaneapi::ObjectRef *        mOwner;
+    std::vector<octaneapi::ObjectRef> * mNodes;
+    size_t                              mMaxInFlight;
+    size_t                              mSources;
+
+    std::mutex                          mMutex;
+    std::condition_variable             mChanged;
+    std::deque<Task>                    mQueue;
+    size_t                              mInFlight    = 0;
+    size_t                              mPrepared    = 0;
+    TexturePipelineResult               mResult;
+};
+
+
+TexturePipeline::TexturePipeline(
+    std::shared_ptr<grpc::Channel>  channel,
+    std::shared_ptr<grpc::Channel>  arraysChannel,
+    const TexturePipelineSettings & settings)
+:
+    mChannel(std::move(channel)),
+    mArraysChannel(std::move(arraysChannel)),
+    mSettings(settings)
+{}
+
+
+TexturePipelineResult TexturePipeline::run(
+    const octaneapi::ObjectRef &        owner,
+    const std::vector<std::string> &    paths,
+    std::vector<octaneapi::ObjectRef> & nodes)
+{
+    const Clock::time_point start = Clock::now();
+    nodes.assign(paths.size(), octaneapi::ObjectRef());
+
+    // a file used by several nodes is read once
+    std::map<std::string, std::shared_ptr<Source>> byPath;
+    std::vector<std::shared_ptr<Source>> sources;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        std::shared_ptr<Source> & source = byPath[paths[i]];
+        if (!source)
+        {
+            source = std::make_shared<Source>();
+            source->mPath = paths[i];
+            sources.push_back(source);
+        }
+        source->mNodes.push_back(i);
+    }
+    for (const std::shared_ptr<Source> & source : sources)
+    {
+        source->mPending = source->mNodes.size();
+    }
+
+    Run run;
+    run.mMode        = mSettings.mMode;
+    run.mOwner       = &owner;
+    run.mNodes       = &nodes;
+    run.mMaxInFlight = mSettings.mMaxInFlightMb * 1024 * 1024;
+    run.mSources     = sources.size();
+    if (run.mMode == TEXTURE_LOAD_UPLOAD && !mArraysChannel)
+    {
+        std::cout << "[Textures] uploads need octane_arrays (--arrays), loading the files by path\n";
+        run.mMode = TEXTURE_LOAD_FILE;
+    }
+    run.mResult.mMode  = run.mMode;
+    run.mResult.mFiles = (uint32_t)sources.size();
+
+    std::vector<std::thread> uploaders;
+    for (unsigned i = 0; i < std::max(1u, mSettings.mUploadThreads); ++i)
+    {
+        uploaders.emplace_back([this, &run]() { uploadLoop(run); });
+    }
+    {
+        // the pool runs all submitted files before it is destroyed
+        SharedUtils::ThreadPool decoders(mSettings.mDecodeThreads);
+        for (const std::shared_ptr<Source> & source : sources)
+        {
+            decoders.submit([this, &run, source]() { prepare(run, source); });
+        }
+    }
+    for (std::thread & uploader : uploaders)
+    {
+        uploader.join();
+    }
+
+    run.mResult.mWallMs = msSince(start);
+    return run.mResult;
+}
+
+
+void TexturePipeline::prepare(
+    Run &                   run,
+    std::shared_ptr<Source> source)
+{
+    const Clock::time_point start = Clock::now();
+    size_t held = 0;
+    bool fallback = false;
+    std::string error;
+    if (run.mMode == TEXTURE_LOAD_FILE)
+    {
+        // Octane reads the file, its size is only needed for the throughput
+        std::error_code ignored;
+        const uintmax_t size = std::filesystem::file_size(source->mPath, ignored);
+        source->mFileBytes = size == (uintmax_t)-1 ? 0 : (uint64_t)size;
+    }
+    else if (!source->mFile.map(source->mPath))
+    {
+        error = "can't read the file";
+        fallback = true;
+    }
+    else if (run.mMode == TEXTURE_LOAD_UPLOAD)
+    {
+        // kept mapped for the upload, the pages read for the hash are sent from the page cache
+        source->mFileBytes = source->mFile.size();
+        source->mKey = SharedUtils::contentKey(source->mFile.data(), source->mFile.size());
+        held = source->mFile.size();
+    }
+    else
+    {
+        // files without a decoder here, e.g. JPEG, go by path without a message
+        source->mFileBytes = source->mFile.size();
+        if (SharedUtils::ImageReader::canDecode(source->mFile.data(), source->mFile.size()))
+        {
+            source->mDecoded = SharedUtils::ImageReader::decode(source->mFile.data(), source->mFile.size(),
+                                                                 source->mImage, &error);
+        }
+        fallback = !source->mDecoded;
+        source->mFile.unmap();
+        if (source->mDecoded)
+        {
+            SharedUtils::ImageReader::downsample(source->mImage, mSettings.mMaxSize);
+            held = source->mImage.rgba.size();
+        }
+    }
+    const double ms = msSince(start);
+
+    std::unique_lock<std::mutex> lock(run.mMutex);
+    if (fallback)
+    {
+        if (!error.empty())
+        {
+            std::cout << "[Textures] " << source->mPath << ": " << error << ", loading it by path\n";
+        }
+        ++run.mResult.mFallbacks;
+    }
+    // wait for uploads to free memory, a texture above the limit goes through on its own
+    run.mChanged.wait(lock, [&run, held]() { return run.mInFlight == 0 || run.mInFlight + held <= run.mMaxInFlight; });
+    run.mInFlight += held;
+    source->mHeldBytes = held;
+    run.mResult.mBytesRead += source->mFileBytes;
+    run.mResult.mDecodeMs  += ms;
+    run.mResult.mDecoded   += source->mDecoded ? 1 : 0;
+    for (size_t index : source->mNodes)
+    {
+        run.mQueue.emplace_back(source, index);
+    }
+    ++run.mPrepared;
+    run.mChanged.notify_all();
+}
+
+
+void TexturePipeline::uploadLoop(
+    Run & run)
+{
+    for (;;)
+    {
+        Run::Task task;
+        {
+            std::unique_lock<std::mutex> lock(run.mMutex);
+            run.mChanged.wait(lock, [&run]() { return !run.mQueue.empty() || run.mPrepared == run.mSources; });
+            if (run.mQueue.empty())
+            {
+                return;
+            }
+            task = std::move(run.mQueue.front());
+            run.mQueue.pop_front();
+        }
+
+        Source & source = *task.first;
+        const Clock::time_point start = Clock::now();
+        octaneapi::ObjectRef node;
+        const bool ok = load(run, source, node);
+        const double ms = msSince(start);
+
+        // the last node of a file releases its memory
+        size_t released = 0;
+        if (--source.mPending == 0)
+        {
+            released = source.mHeldBytes;
+            source.mFile.unmap();
+            source.mImage = SharedUtils::DecodedImage();
+        }
+
+        std::lock_guard<std::mutex> lock(run.mMutex);
+        run.mResult.mUploadMs += ms;
+        if (ok)
+        {
+            (*run.mNodes)[task.second] = node;
+            ++run.mResult.mTextures;
+        }
+        else
+        {
+            ++run.mResult.mFailed;
+        }
+        if (released != 0)
+        {
+            run.mInFlight -= released;
+            run.mChanged.notify_all();
+        }
+    }
+}
+
+
+bool TexturePipeline::load(
+    Run &                  run,
+    Source &               source,
+    octaneapi::ObjectRef & node)
+{
+    node = createImageNode(mChannel, *run.mOwner);
+    if (node.handle() == 0)
+    {
+        return false;
+    }
+
+    if (source.mDecoded)
+    {
+        octaneapi::ApiItem::setValueByIDRequest size;
+        size.mutable_int2_value()->set_x((int32_t)source.mImage.width);
+        size.mutable_int2_value()->set_y((int32_t)source.mImage.height);
+        octaneapi::ApiItem::setValueByIDRequest type;
+        type.set_int_value(octaneapi::IMAGE_TYPE_LDR_RGBA);
+        // the node is evaluated once, with the buffer
+        const bool ok = setValue(mChannel, node, octaneapi::A_SIZE, size, false) &&
+                        setValue(mChannel, node, octaneapi::A_TYPE, type, false) &&
+                        setBuffer(mChannel, node, source.mImage.rgba, true);
+        std::lock_guard<std::mutex> lock(run.mMutex);
+        run.mResult.mBytesSent += source.mImage.rgba.size();
+        return ok;
+    }
+
+    std::string path = source.mPath;
+    if (run.mMode == TEXTURE_LOAD_UPLOAD && source.mFile.data())
+    {
+        // the first node of a file uploads it, the others wait for its path
+        std::call_once(source.mUploadOnce, [this, &run, &source]() { uploadFile(run, source); });
+        if (!source.mRemotePath.empty())
+        {
+            path = source.mRemotePath;
+        }
+    }
+    octaneapi::ApiItem::setValueByIDRequest request;
+    request.set_string_value(path);
+    return setValue(mChannel, node, octaneapi::A_FILENAME, request, true);
+}
+
+
+bool TexturePipeline::uploadFile(
+    Run &    run,
+    Source & source)
+{
+    auto stub = octanearrays::BlobCache::NewStub(mArraysChannel);
+    grpc::Status status;
+    uint64_t sent = 0;
+    // a blob evicted between the put and blobFile is sent once more
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        octanearrays::FindBlobsRequest find;
+        toMessage(source.mKey, find.add_keys());
+        octanearrays::FindBlobsResponse found;
+        grpc::ClientContext findContext;
+        status = stub->findBlobs(&findContext, find, &found);
+        if (!status.ok())
+        {
+            break;
+        }
+        if (found.present_size() != 1 || !found.present(0))
+        {
+            octanearrays::PutBlobRequest put;
+            toMessage(source.mKey, put.mutable_key());
+            put.set_data(source.mFile.data(), source.mFile.size());
+            octanearrays::PutBlobResponse stored;
+            grpc::ClientContext putContext;
+            status = stub->putBlob(&putContext, put, &stored);
+            if (!status.ok())
+            {
+                break;
+            }
+            sent += source.mFile.size();
+        }
+
+        // image loaders on the Octane host go by the extension
+        octanearrays::BlobFileRequest request;
+        toMessage(source.mKey, request.mutable_key());
+        request.set_extension(lowerExtension(source.mPath));
+        octanearrays::BlobFileResponse response;
+        grpc::ClientContext context;
+        status = stub->blobFile(&context, request, &response);
+        if (status.ok())
+        {
+            source.mRemotePath = response.path();
+            break;
+        }
+        if (status.error_code() != grpc::StatusCode::NOT_FOUND)
+        {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(run.mMutex);
+    run.mResult.mBytesSent += sent;
+    if (source.mRemotePath.empty())
+    {
+        std::cout << "[Textures] upload of " << source.mPath << " failed: " << status.error_message()
+                  << ", loading it by path\n";
+        ++run.mResult.mFallbacks;
+        return false;
+    }
+    return true;
+}
+
+
+std::vector<std::string> TexturePipeline::listImageFiles(
+    const std::string & dir)
+{
+    std::vector<std::string> files;
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator it(
+        dir, std::filesystem::directory_options::skip_permission_denied, error);
+    for (; !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+    {
+        if (!it->is_regular_file(error))
+        {
+            continue;
+        }
+        const std::string extension = lowerExtension(it->path());
+        for (const char * imageExtension : IMAGE_EXTENSIONS)
+        {
+            if (extension == imageExtension)
+            {
+                files.push_back(it->path().string());
+                break;
+            }
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+
+bool TexturePipeline::parseMode(
+    const std::string & name,
+    TextureLoadMode &   mode)
+{
+    for (TextureLoadMode candidate : { TEXTURE_LOAD_FILE, TEXTURE_LOAD_UPLOAD, TEXTURE_LOAD_PIXELS })
+    {
+        if (name == modeName(candidate))
+        {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+const char * TexturePipeline::modeName(
+    TextureLoadMode mode)
+{
+    switch (mode)
+    {
+    case TEXTURE_LOAD_UPLOAD: return "upload";
+    case TEXTURE_LOAD_PIXELS: return "pixels";
+    default:                  return "file";
+    }
+}
+
+
+void TexturePipeline::printResult(
+    const TexturePipelineResult & result,
+    std::ostream &                out) const
+{
+    out << std::fixed << std::setprecision(1);
+    out << "[Textures] " << result.mTextures << " image textures from " << result.mFiles << " files ("
+        << modeName(result.mMode) << ", " << mSettings.mUploadThreads << " upload threads) in "
+        << result.mWallMs << " ms: " << result.texturesPerSecond() << " textures/s, " << result.mbPerSecond()
+        << " MB/s\n";
+    out << "[Textures] " << result.mBytesRead / 1048576.0 << " MB read, " << result.mBytesSent / 1048576.0
+        << " MB sent, " << result.mDecoded << " decoded, " << result.mFallbacks << " loaded by path instead, "
+        << result.mFailed << " failed; " << result.mDecodeMs << " ms reading and decoding, " << result.mUploadMs
+        << " ms in calls\n";
+    out << std::defaultfloat;
+}
@@ -0,0 +1,140 @@
+// Copyright (C) 2026 OTOY NZ Ltd.
+
+#pragma once
+
+// system headers
+#include <grpcpp/grpcpp.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// application headers
+#include "common.pb.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/// How the texture pipeline gets an image file into its image texture node.
+enum TextureLoadMode
+{
+    /// A_FILENAME with the local path, Octane reads the file itself. Needs the files on the host
+    /// running Octane.
+    TEXTURE_LOAD_FILE = 0,
+    /// The file is sent to the BlobCache of octane_arrays, once per content, and A_FILENAME names
+    /// the copy on the host running Octane.
+    TEXTURE_LOAD_UPLOAD,
+    /// PNG and PPM files are decoded on the client, downsampled to the maximum size and set as
+    /// A_BUFFER. Other files, e.g. JPEG, are loaded like TEXTURE_LOAD_FILE.
+    TEXTURE_LOAD_PIXELS,
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/// Parameters of the texture pipeline.
+struct TexturePipelineSettings
+{
+    TextureLoadMode mMode            = TEXTURE_LOAD_FILE;
+    /// Threads mapping, hashing and decoding the files, 0 for one per hardware thread.
+    unsigned        mDecodeThreads   = 0;
+    /// Threads creating the nodes and making the upload calls, each has one call in flight.
+    unsigned        mUploadThreads   = 4;
+    /// Mapped files and decoded pixels waiting for their upload. A decode thread that would go
+    /// above it waits, a single larger texture still goes through on its own.
+    size_t          mMaxInFlightMb   = 256;
+    /// Longest side of decoded textures, larger ones are halved until they fit. 0 keeps the size.
+    uint32_t        mMaxSize         = 0;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/// Outcome of one TexturePipeline::run().
+struct TexturePipelineResult
+{
+    /// The mode used, TEXTURE_LOAD_FILE if uploads were asked for without octane_arrays.
+    TextureLoadMode mMode   = TEXTURE_LOAD_FILE;
+    uint32_t mTextures      = 0;
+    /// Distinct files, each is read and decoded or uploaded once however many nodes use it.
+    uint32_t mFiles         = 0;
+    uint32_t mDecoded       = 0;
+    /// Files loaded by path instead, because they can't be decoded or the upload failed.
+    uint32_t mFallbacks     = 0;
+    uint32_t mFailed        = 0;
+    uint64_t mBytesRead     = 0;
+    uint64_t mBytesSent     = 0;
+    double   mWallMs        = 0.0;
+    /// Summed over the threads, so with several threads they add up to more than the wall time.
+    double   mDecodeMs      = 0.0;
+    double   mUploadMs      = 0.0;
+
+    double texturesPerSecond() const;
+
+    /// File bytes per second of wall time.
+    double mbPerSecond() const;
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/// Creates image texture nodes and loads their files with a bounded pipeline.
+///
+/// Decode threads map each distinct file and, depending on the mode, hash or decode it. Upload
+/// threads create the nodes and set their attributes, so the calls for one texture overlap with
+/// the decoding of the next ones and the round trips of several calls overlap with each other.
+/// All RPCs are independent per node, the order in which textures finish is not defined but
+/// nodes[i] is always the node of paths[i].
+class TexturePipeline
+{
+public:
+    /// arraysChannel is octane_arrays, needed for TEXTURE_LOAD_UPLOAD only.
+    TexturePipeline(
+        std::shared_ptr<grpc::Channel>  channel,
+        std::shared_ptr<grpc::Channel>  arraysChannel,
+        const TexturePipelineSettings & settings);
+
+    /// Creates an NT_TEX_IMAGE node in owner for each path and loads the file into it. Returns
+    /// once all nodes are set, failed nodes are left as an empty ObjectRef.
+    TexturePipelineResult run(
+        const octaneapi::ObjectRef &        owner,
+        const std::vector<std::string> &    paths,
+        std::vector<octaneapi::ObjectRef> & nodes);
+
+    /// Image files below dir, sorted by path.
+    static std::vector<std::string> listImageFiles(
+        const std::string & dir);
+
+    static bool parseMode(
+        const std::string & name,
+        TextureLoadMode &   mode);
+
+    static const char * modeName(
+        TextureLoadMode mode);
+
+    void printResult(
+        const TexturePipelineResult & result,
+        std::ostream &                out) const;
+
+private:
+    struct Source;
+    struct Run;
+
+    void prepare(
+        Run &                   run,
+        std::shared_ptr<Source> source);
+
+    void uploadLoop(
+        Run & run);
+
+    bool load(
+        Run &                  run,
+        Source &               source,
+        octaneapi::ObjectRef & node);
+
+    bool uploadFile(
+        Run &    run,
+        Source & source);
+
+    std::shared_ptr<grpc::Channel>  mChannel;
+    std::shared_ptr<grpc::Channel>  mArraysChannel;
+    TexturePipelineSettings         mSettings;
+};
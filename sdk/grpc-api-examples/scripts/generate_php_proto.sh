@@ -217,3 +217,9 @@ mkdir -p proto_php_out
 "$PROTOC" -I "$PROTODEFS" --generated_php=./proto_php_out  "$PROTODEFS"control.proto
 "$PROTOC" -I "$PROTODEFS" --grpc_out=./proto_php_out --plugin=protoc-gen-grpc="$GRPC_PLUGIN"  "$PROTODEFS"livelink.proto
 "$PROTOC" -I "$PROTODEFS" --generated_php=./proto_php_out  "$PROTODEFS"livelink.proto
+"$PROTOC" -I "$PROTODEFS" --grpc_out=./proto_php_out --plugin=protoc-gen-grpc="$GRPC_PLUGIN"  "$PROTODEFS"render_file_transfer.proto
+"$PROTOC" -I "$PROTODEFS" --generated_php=./proto_php_out  "$PROTODEFS"render_file_transfer.proto
+"$PROTOC" -I "$PROTODEFS" --grpc_out=./proto_php_out --plugin=protoc-gen-grpc="$GRPC_PLUGIN"  "$PROTODEFS"render_image_wait.proto
+"$PROTOC" -I "$PROTODEFS" --generated_php=./proto_php_out  "$PROTODEFS"render_image_wait.proto
+"$PROTOC" -I "$PROTODEFS" --grpc_out=./proto_php_out --plugin=protoc-gen-grpc="$GRPC_PLUGIN"  "$PROTODEFS"item_array_transfer.proto
+"$PROTOC" -I "$PROTODEFS" --generated_php=./proto_php_out  "$PROTODEFS"item_array_transfer.proto
@@ -45,6 +45,7 @@ void ApiArrayApiRenderImageConverter::convert(
         img.mSize.x = image.size().x();
         img.mSize.y = image.size().y();
         img.mPitch = image.pitch();
+        img.mRenderPassId = static_cast<Octane::RenderPassId>(image.renderpassid());
 
         //buffer
         img.mBuffer = nullptr;
@@ -94,6 +95,7 @@ void ApiArrayApiRenderImageConverter::convert(
         size->set_x(renderImage.mSize.x);
         size->set_y(renderImage.mSize.y); 
         newImage->set_pitch(renderImage.mPitch);
+        newImage->set_renderpassid(static_cast<octaneapi::RenderPassId>(renderImage.mRenderPassId));
     
         if (renderImage.mBuffer)
         {
@@ -0,0 +1,264 @@
+#include "anim_sample_codec.h"
+#include "pixel_convert.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace SharedUtils {
+
+namespace {
+
+    const uint32_t QUANTIZED_STEPS = 65535;
+
+    inline float asFloat(uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t asBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline uint16_t toHalf(float value)
+    {
+        uint16_t half;
+        PixelConvert::floatToHalf(&value, &half, 1);
+        return half;
+    }
+
+    inline float fromHalf(uint16_t half)
+    {
+        float value;
+        PixelConvert::halfToFloat(&half, &value, 1);
+        return value;
+    }
+
+    inline void put16(std::string& out, uint16_t value)
+    {
+        out.push_back(static_cast<char>(value & 0xff));
+        out.push_back(static_cast<char>(value >> 8));
+    }
+
+    inline void putVarint(std::string& out, uint32_t value)
+    {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    inline uint32_t zigzag(int32_t value)
+    {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    inline int32_t unzigzag(uint32_t value)
+    {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+
+    /// Reads the encoded values of a sample, every read fails once the data is used up
+    class Reader
+    {
+    public:
+        Reader(const void* data, size_t size)
+            : mNext(static_cast<const uint8_t*>(data)), mEnd(mNext + size)
+        {
+        }
+
+        bool read16(uint16_t& value)
+        {
+            if (mEnd - mNext < 2) {
+                return false;
+            }
+            value = static_cast<uint16_t>(mNext[0] | (mNext[1] << 8));
+            mNext += 2;
+            return true;
+        }
+
+        bool readVarint(uint32_t& value)
+        {
+            value = 0;
+            for (int shift = 0; shift < 35 && mNext < mEnd; shift += 7) {
+                const uint8_t byte = *mNext++;
+                value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool atEnd() const { return mNext == mEnd; }
+
+    private:
+        const uint8_t* mNext;
+        const uint8_t* mEnd;
+    };
+
+    uint32_t quantize(const SampleFormat& format, float value)
+    {
+        const float step = (value - format.rangeMin) / (format.rangeMax - format.rangeMin) * QUANTIZED_STEPS;
+        if (!(step > 0.0f)) {
+            return 0;
+        }
+        return step >= QUANTIZED_STEPS ? QUANTIZED_STEPS : static_cast<uint32_t>(std::lround(step));
+    }
+
+    float dequantize(const SampleFormat& format, uint32_t step)
+    {
+        return format.rangeMin + (format.rangeMax - format.rangeMin) * (static_cast<float>(step) / QUANTIZED_STEPS);
+    }
+
+} // namespace
+
+std::string SampleFormat::check() const
+{
+    if (encoding != SampleEncoding::Exact && !floats) {
+        return "half and quantized samples need float components";
+    }
+    if ((encoding != SampleEncoding::Exact || delta) && sampleBytes % 4 != 0) {
+        return "delta and lossy samples need 32 bit components";
+    }
+    if (encoding == SampleEncoding::Quantized && !(rangeMax > rangeMin)) {
+        return "quantized samples need rangeMax above rangeMin";
+    }
+    if (encoding > SampleEncoding::Quantized) {
+        return "unknown sample encoding";
+    }
+    return std::string();
+}
+
+SampleEncoder::SampleEncoder(const SampleFormat& format)
+    : mFormat(format)
+    , mPrevious(format.sampleBytes / 4, 0)
+{
+}
+
+void SampleEncoder::encode(const void* sample, std::string& out)
+{
+    out.clear();
+    const uint8_t* in = static_cast<const uint8_t*>(sample);
+    const bool delta = mFormat.delta && !mFirst;
+    mFirst = false;
+
+    if (mFormat.encoding == SampleEncoding::Exact && !delta) {
+        out.assign(reinterpret_cast<const char*>(in), mFormat.sampleBytes);
+        if (mFormat.delta) {
+            std::memcpy(mPrevious.data(), in, mPrevious.size() * 4);
+        }
+        return;
+    }
+
+    out.reserve(mPrevious.size() * 2);
+    for (size_t i = 0; i < mPrevious.size(); ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, in + i * 4, sizeof(bits));
+        switch (mFormat.encoding) {
+        case SampleEncoding::Exact:
+            // unchanged words take one byte, small changes of a float leave its high bits alone
+            putVarint(out, bits ^ mPrevious[i]);
+            mPrevious[i] = bits;
+            break;
+        case SampleEncoding::Half: {
+            const float previous = delta ? asFloat(mPrevious[i]) : 0.0f;
+            const uint16_t half = toHalf(asFloat(bits) - previous);
+            put16(out, half);
+            mPrevious[i] = asBits(previous + fromHalf(half));
+            break;
+        }
+        case SampleEncoding::Quantized: {
+            const uint32_t step = quantize(mFormat, asFloat(bits));
+            if (delta) {
+                putVarint(out, zigzag(static_cast<int32_t>(step) - static_cast<int32_t>(mPrevious[i])));
+            } else {
+                put16(out, static_cast<uint16_t>(step));
+            }
+            mPrevious[i] = step;
+            break;
+        }
+        }
+    }
+}
+
+SampleDecoder::SampleDecoder(const SampleFormat& format)
+    : mFormat(format)
+    , mPrevious(format.sampleBytes / 4, 0)
+{
+}
+
+bool SampleDecoder::decode(const void* data, size_t size, void* out)
+{
+    uint8_t* values = static_cast<uint8_t*>(out);
+    const bool delta = mFormat.delta && !mFirst;
+    mFirst = false;
+
+    if (mFormat.encoding == SampleEncoding::Exact && !delta) {
+        if (size != mFormat.sampleBytes) {
+            return false;
+        }
+        std::memcpy(values, data, size);
+        if (mFormat.delta) {
+            std::memcpy(mPrevious.data(), data, mPrevious.size() * 4);
+        }
+        return true;
+    }
+
+    Reader reader(data, size);
+    for (size_t i = 0; i < mPrevious.size(); ++i) {
+        uint32_t bits = 0;
+        switch (mFormat.encoding) {
+        case SampleEncoding::Exact: {
+            uint32_t difference;
+            if (!reader.readVarint(difference)) {
+                return false;
+            }
+            bits = mPrevious[i] ^ difference;
+            mPrevious[i] = bits;
+            break;
+        }
+        case SampleEncoding::Half: {
+            uint16_t half;
+            if (!reader.read16(half)) {
+                return false;
+            }
+            const float previous = delta ? asFloat(mPrevious[i]) : 0.0f;
+            bits = asBits(previous + fromHalf(half));
+            mPrevious[i] = bits;
+            break;
+        }
+        case SampleEncoding::Quantized: {
+            uint32_t step;
+            if (delta) {
+                uint32_t difference;
+                if (!reader.readVarint(difference)) {
+                    return false;
+                }
+                step = static_cast<uint32_t>(static_cast<int32_t>(mPrevious[i]) + unzigzag(difference));
+            } else {
+                uint16_t value;
+                if (!reader.read16(value)) {
+                    return false;
+                }
+                step = value;
+            }
+            if (step > QUANTIZED_STEPS) {
+                return false;
+            }
+            bits = asBits(dequantize(mFormat, step));
+            mPrevious[i] = step;
+            break;
+        }
+        }
+        std::memcpy(values + i * 4, &bits, sizeof(bits));
+    }
+    return reader.atEnd();
+}
+
+} // namespace SharedUtils
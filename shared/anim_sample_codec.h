@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SharedUtils {
+
+    /**
+     * How the values of one time sample of an animated array are written, the values of
+     * octanearrays::SampleEncoding. Half and Quantized apply to float components only.
+     */
+    enum class SampleEncoding : uint32_t
+    {
+        Exact = 0,        // the raw bytes
+        Half = 1,         // every float as IEEE half, 2 bytes
+        Quantized = 2,    // every float as a 16 bit step between rangeMin and rangeMax
+    };
+
+    /**
+     * Layout and encoding of the samples of one animated array. With delta every sample after
+     * the first holds the difference to the previous one as the decoder reconstructed it, so lossy
+     * encodings don't drift: the XOR of the 32 bit words as varints for Exact, the half of the
+     * difference for Half and the step difference as zigzag varint for Quantized.
+     */
+    struct SampleFormat
+    {
+        SampleEncoding encoding = SampleEncoding::Exact;
+        bool delta = false;
+        float rangeMin = 0.0f;
+        float rangeMax = 1.0f;
+        size_t sampleBytes = 0;     // raw bytes of one sample
+        bool floats = true;         // 32 bit float components, otherwise integers
+
+        /**
+         * Empty if samples can be encoded in this format, otherwise the reason why not
+         */
+        std::string check() const;
+    };
+
+    /**
+     * Encodes the samples of an animated array one after the other
+     */
+    class SampleEncoder
+    {
+    public:
+        explicit SampleEncoder(const SampleFormat& format);
+
+        /**
+         * Encodes the next sample, format.sampleBytes bytes at sample, into out
+         */
+        void encode(const void* sample, std::string& out);
+
+    private:
+        SampleFormat mFormat;
+        // previous sample as the decoder has it: the words for Exact and Half, the steps for
+        // Quantized
+        std::vector<uint32_t> mPrevious;
+        bool mFirst = true;
+    };
+
+    /**
+     * Decodes what a SampleEncoder of the same format wrote, in the same order
+     */
+    class SampleDecoder
+    {
+    public:
+        explicit SampleDecoder(const SampleFormat& format);
+
+        /**
+         * Decodes the next sample from size bytes at data into format.sampleBytes bytes at out.
+         * Returns false if the data is not a sample of the format.
+         */
+        bool decode(const void* data, size_t size, void* out);
+
+    private:
+        SampleFormat mFormat;
+        std::vector<uint32_t> mPrevious;
+        bool mFirst = true;
+    };
+
+} // namespace SharedUtils
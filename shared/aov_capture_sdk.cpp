@@ -0,0 +1,222 @@
+#include "aov_capture_sdk.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <set>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apiinfoclient.h"
+#include "apinodeclient.h"
+#include "apirender.h"
+#endif
+
+namespace {
+
+double msSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+}
+
+AovCaptureSdk::AovCaptureSdk(const std::string& outputDir, SharedUtils::ImageFileFormat fileFormat, unsigned encodeWorkers)
+    : m_outputDir(outputDir)
+    , m_fileFormat(fileFormat)
+    // room for two frames of 20 passes, capture() only waits when the encoders fall further behind
+    , m_writer(encodeWorkers, 40)
+    , m_nextFrame(0)
+{
+}
+
+AovCaptureSdk::~AovCaptureSdk() {
+    flush();
+}
+
+std::string AovCaptureSdk::passName(int passId) {
+    auto it = m_passNames.find(passId);
+    if (it != m_passNames.end()) {
+        return it->second;
+    }
+
+    std::string name;
+#ifdef DO_GRPC_SDK_ENABLED
+    try {
+        name = OctaneGRPC::ApiInfoProxy::renderPassShortName(static_cast<Octane::RenderPassId>(passId));
+    } catch (const std::exception& e) {
+        std::cout << "AovCaptureSdk: no name for pass " << passId << ": " << e.what() << std::endl;
+    }
+#endif
+    // usable as part of a file name
+    std::replace_if(name.begin(), name.end(), [](unsigned char c) { return !std::isalnum(c); }, '_');
+    if (name.empty()) {
+        name = "pass" + std::to_string(passId);
+    }
+    m_passNames[passId] = name;
+    return name;
+}
+
+bool AovCaptureSdk::capture() {
+#ifdef DO_GRPC_SDK_ENABLED
+    auto pending = std::make_shared<PendingFrame>();
+    pending->start = std::chrono::high_resolution_clock::now();
+    FrameTimings& timings = pending->timings;
+    timings.frame = m_nextFrame;
+
+    std::vector<Octane::ApiRenderImage> images;
+    try {
+        auto stageStart = std::chrono::high_resolution_clock::now();
+        OctaneGRPC::ApiNodeProxy renderTarget = OctaneGRPC::ApiRenderEngineProxy::getRenderTargetNode();
+        if (!renderTarget.isNull()) {
+            std::vector<Octane::RenderPassId> aovIds;
+            OctaneGRPC::ApiRenderEngineProxy::getEnabledAovs(&renderTarget, aovIds);
+            timings.enabledAovs = aovIds.size();
+        }
+        timings.aovQueryMs = msSince(stageStart);
+
+        // all passes in one round trip
+        stageStart = std::chrono::high_resolution_clock::now();
+        const bool hdr = m_fileFormat == SharedUtils::IMAGE_FILE_EXR;
+        const bool ok = OctaneGRPC::ApiRenderEngineProxy::synchronousTonemapAllRenderPasses(
+            hdr ? Octane::TONEMAP_BUFFER_TYPE_HDR_FLOAT : Octane::TONEMAP_BUFFER_TYPE_LDR,
+            !hdr,
+            hdr ? Octane::NAMED_COLOR_SPACE_LINEAR_SRGB : Octane::NAMED_COLOR_SPACE_SRGB,
+            Octane::PREMULTIPLIED_ALPHA_TYPE_NONE,
+            images);
+        timings.fetchMs = msSince(stageStart);
+        if (!ok || images.empty()) {
+            std::cout << "AovCaptureSdk: no render passes available" << std::endl;
+            for (const Octane::ApiRenderImage& image : images) {
+                delete[] static_cast<const char*>(image.mBuffer);
+            }
+            return false;
+        }
+    } catch (const std::exception& e) {
+        std::cout << "AovCaptureSdk: capture failed: " << e.what() << std::endl;
+        for (const Octane::ApiRenderImage& image : images) {
+            delete[] static_cast<const char*>(image.mBuffer);
+        }
+        return false;
+    }
+    ++m_nextFrame;
+
+    // names are looked up before queuing anything, the completions may run right away
+    std::vector<std::string> paths(images.size());
+    std::set<std::string> usedNames;
+    for (size_t i = 0; i < images.size(); ++i) {
+        char frameName[32];
+        snprintf(frameName, sizeof(frameName), "/aov_%06llu_", (unsigned long long)timings.frame);
+        // a server that doesn't report the pass ids leaves them all at the beauty pass, keep the
+        // files apart by their index then
+        std::string name = passName(images[i].mRenderPassId);
+        if (!usedNames.insert(name).second) {
+            name += "_" + std::to_string(i);
+        }
+        paths[i] = m_outputDir + frameName + name + "." +
+                   SharedUtils::ImageWriter::extension(m_fileFormat);
+        timings.transferBytes += static_cast<size_t>(images[i].mPitch) * images[i].mSize.y *
+            SharedUtils::PixelConvert::bytesPerPixel(static_cast<SharedUtils::PixelConvert::PixelFormat>(images[i].mType));
+    }
+    timings.passes = images.size();
+    // one extra reference until all passes are queued, so the frame can't complete before that
+    pending->remaining = images.size() + 1;
+
+    auto stageStart = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < images.size(); ++i) {
+        const Octane::ApiRenderImage& image = images[i];
+        SharedUtils::ImageFrame frame;
+        frame.format = static_cast<SharedUtils::PixelConvert::PixelFormat>(image.mType);
+        frame.width = image.mSize.x;
+        frame.height = image.mSize.y;
+        frame.pitch = image.mPitch * SharedUtils::PixelConvert::bytesPerPixel(frame.format);
+        // the converter allocated the buffer for us, the writer frees it after encoding
+        frame.pixels = std::shared_ptr<const void>(image.mBuffer, [](const void* buffer) {
+            delete[] static_cast<const char*>(buffer);
+        });
+        if (frame.pitch == 0 || !frame.pixels) {
+            passWritten(pending, SharedUtils::ImageWriter::JobResult());
+            continue;
+        }
+        m_writer.enqueue(paths[i], m_fileFormat, std::move(frame), true,
+            [this, pending](const SharedUtils::ImageWriter::JobResult& result) {
+                passWritten(pending, result);
+            });
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        timings.queueMs = msSince(stageStart);
+        releasePass(*pending);
+    }
+    return true;
+#else
+    std::cout << "AovCaptureSdk: SDK not available" << std::endl;
+    return false;
+#endif
+}
+
+void AovCaptureSdk::passWritten(const std::shared_ptr<PendingFrame>& pending, const SharedUtils::ImageWriter::JobResult& result) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FrameTimings& timings = pending->timings;
+    if (result.ok) {
+        timings.fileBytes += result.bytes;
+        timings.encodeMsTotal += result.encodeMs;
+        timings.encodeMsMax = std::max(timings.encodeMsMax, result.encodeMs);
+        timings.writeMsTotal += result.writeMs;
+    } else {
+        ++timings.failedPasses;
+    }
+    releasePass(*pending);
+}
+
+void AovCaptureSdk::releasePass(PendingFrame& pending) {
+    if (--pending.remaining == 0) {
+        pending.timings.totalMs = msSince(pending.start);
+        m_completed.push_back(pending.timings);
+    }
+}
+
+void AovCaptureSdk::flush() {
+    m_writer.flush();
+}
+
+std::vector<AovCaptureSdk::FrameTimings> AovCaptureSdk::completedFrames() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_completed;
+}
+
+void AovCaptureSdk::printReport(std::ostream& out) const {
+    const std::vector<FrameTimings> frames = completedFrames();
+    out << "AOV capture: " << frames.size() << " frames" << std::endl;
+    if (frames.empty()) {
+        return;
+    }
+
+    out << std::fixed << std::setprecision(2);
+    out << "  frame passes   MB in  MB out   query   fetch   queue  encode(sum/max)    write   total" << std::endl;
+    FrameTimings sum;
+    for (const FrameTimings& t : frames) {
+        out << std::setw(7) << t.frame << std::setw(7) << t.passes
+            << std::setw(8) << t.transferBytes / 1048576.0 << std::setw(8) << t.fileBytes / 1048576.0
+            << std::setw(8) << t.aovQueryMs << std::setw(8) << t.fetchMs << std::setw(8) << t.queueMs
+            << std::setw(9) << t.encodeMsTotal << "/" << std::left << std::setw(8) << t.encodeMsMax << std::right
+            << std::setw(8) << t.writeMsTotal << std::setw(8) << t.totalMs;
+        if (t.failedPasses) {
+            out << "  " << t.failedPasses << " failed";
+        }
+        out << std::endl;
+
+        sum.aovQueryMs += t.aovQueryMs;
+        sum.fetchMs += t.fetchMs;
+        sum.queueMs += t.queueMs;
+        sum.encodeMsTotal += t.encodeMsTotal;
+        sum.writeMsTotal += t.writeMsTotal;
+        sum.totalMs += t.totalMs;
+        sum.transferBytes += t.transferBytes;
+    }
+    const double n = static_cast<double>(frames.size());
+    out << "  average: query " << sum.aovQueryMs / n << " ms, fetch " << sum.fetchMs / n
+        << " ms (" << (sum.transferBytes / 1048576.0) / (sum.fetchMs / 1000.0) << " MB/s), queue "
+        << sum.queueMs / n << " ms, encode " << sum.encodeMsTotal / n << " ms, write " << sum.writeMsTotal / n
+        << " ms, total " << sum.totalMs / n << " ms" << std::endl;
+    out << std::defaultfloat;
+}
@@ -0,0 +1,101 @@
+#ifndef AOV_CAPTURE_SDK_H
+#define AOV_CAPTURE_SDK_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "image_writer.h"
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apirenderengineclient.h"
+#endif
+
+/**
+ * @brief Captures all enabled AOVs of the current render into local files
+ *
+ * All enabled render passes are fetched with a single synchronousTonemapAllRenderPasses()
+ * call and handed to the parallel encoders of an ImageWriter. capture() returns as soon
+ * as the images are queued, so encoding and writing frame N overlaps with rendering
+ * frame N+1. This replaces saveRenderPasses(), which blocks while Octane writes the
+ * files to its own disk.
+ */
+class AovCaptureSdk {
+public:
+    /**
+     * @brief Per stage timings of one captured frame, in milliseconds
+     */
+    struct FrameTimings {
+        uint64_t frame = 0;
+        size_t enabledAovs = 0;
+        size_t passes = 0;
+        size_t transferBytes = 0;       // pixel data received from Octane
+        size_t fileBytes = 0;
+        size_t failedPasses = 0;
+        double aovQueryMs = 0.0;        // getEnabledAovs()
+        double fetchMs = 0.0;           // tonemap of all passes plus the transfer
+        double queueMs = 0.0;           // handing the images to the writer
+        double encodeMsTotal = 0.0;     // summed over all passes
+        double encodeMsMax = 0.0;       // slowest pass
+        double writeMsTotal = 0.0;
+        double totalMs = 0.0;           // capture() start until the last file is written
+    };
+
+    /**
+     * @param outputDir     directory the files are written to, must exist
+     * @param fileFormat    EXR keeps the HDR passes, the other formats fetch 8-bit passes
+     * @param encodeWorkers number of passes encoded at the same time
+     */
+    AovCaptureSdk(const std::string& outputDir,
+                  SharedUtils::ImageFileFormat fileFormat = SharedUtils::IMAGE_FILE_EXR,
+                  unsigned encodeWorkers = 4);
+    ~AovCaptureSdk();
+
+    /**
+     * @brief Fetch all enabled passes of the current render and queue them for writing
+     * @return false if Octane returned no results
+     */
+    bool capture();
+
+    /**
+     * @brief Wait until all captured frames are written
+     */
+    void flush();
+
+    /**
+     * @brief Timings of the frames whose files are all written
+     */
+    std::vector<FrameTimings> completedFrames() const;
+
+    /**
+     * @brief Print the timings of the completed frames and their averages
+     */
+    void printReport(std::ostream& out) const;
+
+private:
+    struct PendingFrame {
+        FrameTimings timings;
+        size_t remaining = 0;
+        std::chrono::high_resolution_clock::time_point start;
+    };
+
+    void passWritten(const std::shared_ptr<PendingFrame>& pending, const SharedUtils::ImageWriter::JobResult& result);
+    // called with m_mutex held
+    void releasePass(PendingFrame& pending);
+    std::string passName(int passId);
+
+    std::string m_outputDir;
+    SharedUtils::ImageFileFormat m_fileFormat;
+    SharedUtils::ImageWriter m_writer;
+    uint64_t m_nextFrame;
+    std::map<int, std::string> m_passNames;
+
+    mutable std::mutex m_mutex;
+    std::vector<FrameTimings> m_completed;
+};
+
+#endif // AOV_CAPTURE_SDK_H
@@ -0,0 +1,201 @@
+#include "async_file_writer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace SharedUtils {
+
+    AsyncFileWriter::AsyncFileWriter(size_t maxQueuedBytes)
+        : mMaxQueuedBytes(maxQueuedBytes > 0 ? maxQueuedBytes : 1)
+    {
+    }
+
+    AsyncFileWriter::~AsyncFileWriter()
+    {
+        // a transfer that wasn't finished didn't complete
+        abort();
+    }
+
+    bool AsyncFileWriter::open(const std::string& path)
+    {
+        abort();
+
+        std::error_code error;
+        const std::filesystem::path filePath(path);
+        if (filePath.has_parent_path())
+        {
+            std::filesystem::create_directories(filePath.parent_path(), error);
+        }
+        mPath = path;
+        mPartPath = path + ".part";
+        mFile = std::fopen(mPartPath.c_str(), "wb");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.clear();
+        mQueuedBytes = 0;
+        mClosing = false;
+        mFailed = mFile == nullptr;
+        mError = mFailed ? "can't create " + mPartPath + ": " + std::strerror(errno) : std::string();
+        mBytesWritten = 0;
+        if (mFailed)
+        {
+            return false;
+        }
+        // chunks are large already, the thread writes them unbuffered
+        std::setvbuf(mFile, nullptr, _IONBF, 0);
+        mThread = std::thread(&AsyncFileWriter::writerLoop, this);
+        return true;
+    }
+
+    bool AsyncFileWriter::isOpen() const
+    {
+        return mThread.joinable();
+    }
+
+    bool AsyncFileWriter::write(const void* data, size_t size)
+    {
+        return write(std::string(static_cast<const char*>(data), size));
+    }
+
+    bool AsyncFileWriter::write(std::string&& data)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (!mThread.joinable() || mClosing || mFailed)
+        {
+            return false;
+        }
+        if (data.empty())
+        {
+            return true;
+        }
+        // a single chunk larger than the limit still goes through once the queue is empty
+        mSpaceFree.wait(lock, [this] { return mFailed || mQueuedBytes == 0 ||
+                                              mQueuedBytes < mMaxQueuedBytes; });
+        if (mFailed)
+        {
+            return false;
+        }
+        mQueuedBytes += data.size();
+        mQueue.push_back(std::move(data));
+        mDataReady.notify_one();
+        return true;
+    }
+
+    void AsyncFileWriter::writerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        for (;;)
+        {
+            mDataReady.wait(lock, [this] { return mClosing || !mQueue.empty(); });
+            if (mQueue.empty())
+            {
+                return;
+            }
+            std::string data = std::move(mQueue.front());
+            mQueue.pop_front();
+
+            lock.unlock();
+            const bool ok = std::fwrite(data.data(), 1, data.size(), mFile) == data.size();
+            const int writeError = errno;
+            lock.lock();
+
+            mQueuedBytes -= data.size();
+            if (ok)
+            {
+                mBytesWritten += data.size();
+            }
+            else if (!mFailed)
+            {
+                mFailed = true;
+                mError = "can't write " + mPartPath + ": " + std::strerror(writeError);
+                mQueue.clear();
+                mQueuedBytes = 0;
+            }
+            mSpaceFree.notify_all();
+        }
+    }
+
+    void AsyncFileWriter::closeFile(bool keep)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mClosing = true;
+        }
+        mDataReady.notify_one();
+        mSpaceFree.notify_all();
+        if (mThread.joinable())
+        {
+            mThread.join();
+        }
+        if (mFile)
+        {
+            if (std::fclose(mFile) != 0 && keep)
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mFailed = true;
+                mError = "can't close " + mPartPath + ": " + std::strerror(errno);
+            }
+            mFile = nullptr;
+        }
+
+        std::error_code error;
+        if (keep && !mFailed)
+        {
+            std::filesystem::rename(mPartPath, mPath, error);
+            if (error)
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mFailed = true;
+                mError = "can't rename " + mPartPath + ": " + error.message();
+            }
+        }
+        if (!keep || mFailed)
+        {
+            std::filesystem::remove(mPartPath, error);
+        }
+    }
+
+    bool AsyncFileWriter::finish()
+    {
+        if (!mThread.joinable())
+        {
+            return false;
+        }
+        closeFile(true);
+        return !mFailed;
+    }
+
+    void AsyncFileWriter::abort()
+    {
+        if (!mThread.joinable())
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQueue.clear();
+            mQueuedBytes = 0;
+            if (!mFailed)
+            {
+                mFailed = true;
+                mError = "aborted";
+            }
+        }
+        closeFile(false);
+    }
+
+    std::string AsyncFileWriter::error() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mError;
+    }
+
+    uint64_t AsyncFileWriter::bytesWritten() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mBytesWritten;
+    }
+
+} // namespace SharedUtils
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace SharedUtils {
+
+    /**
+     * Writes a file on a background thread, so a producer that receives the file in chunks,
+     * e.g. from a gRPC stream, keeps receiving while the disk catches up. write() only blocks
+     * when more than maxQueuedBytes are waiting.
+     *
+     * The data goes to "<path>.part" which finish() renames to the path once everything is
+     * on disk, a failed or aborted transfer never leaves a truncated file under the real name.
+     */
+    class AsyncFileWriter
+    {
+    public:
+        explicit AsyncFileWriter(size_t maxQueuedBytes = 16 * 1024 * 1024);
+        ~AsyncFileWriter();
+
+        AsyncFileWriter(const AsyncFileWriter&) = delete;
+        AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+        bool open(const std::string& path);
+        bool isOpen() const;
+
+        /**
+         * Queue data. Returns false once writing failed, the error is kept until finish().
+         */
+        bool write(const void* data, size_t size);
+        bool write(std::string&& data);
+
+        /**
+         * Wait for the queue to drain, close and rename the file. Returns false if anything
+         * failed, the partial file is removed then.
+         */
+        bool finish();
+
+        /**
+         * Drop queued data and remove the partial file
+         */
+        void abort();
+
+        const std::string& path() const { return mPath; }
+        std::string error() const;
+        uint64_t bytesWritten() const;
+
+    private:
+        void writerLoop();
+        void closeFile(bool keep);
+
+        const size_t mMaxQueuedBytes;
+        std::string mPath;
+        std::string mPartPath;
+        FILE* mFile = nullptr;
+        std::thread mThread;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mDataReady;
+        std::condition_variable mSpaceFree;
+        std::deque<std::string> mQueue;
+        size_t mQueuedBytes = 0;
+        bool mClosing = false;
+        bool mFailed = false;
+        std::string mError;
+        uint64_t mBytesWritten = 0;
+    };
+
+} // namespace SharedUtils
@@ -0,0 +1,326 @@
+#include "blob_cache_sdk.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <utility>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "protos/item_array_transfer.grpc.pb.h"
+#include "protos/item_array_transfer.pb.h"
+
+namespace {
+
+double msSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+std::shared_ptr<grpc::Channel> createChannel(const std::string& address) {
+    // a blob is a whole mesh array or texture, well above the default 4 MB receive limit
+    grpc::ChannelArguments arguments;
+    arguments.SetMaxReceiveMessageSize(-1);
+    return grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), arguments);
+}
+
+void toMessage(const SharedUtils::ContentKey& key, octanearrays::BlobKey* message) {
+    message->set_hash(key.hash);
+    message->set_size(key.size);
+}
+
+}
+
+BlobCacheSdk::BlobCacheSdk(const Settings& settings)
+    : BlobCacheSdk(settings, createChannel(settings.address))
+{
+}
+
+BlobCacheSdk::BlobCacheSdk(const Settings& settings, std::shared_ptr<grpc::Channel> channel)
+    : m_settings(settings)
+    , m_channel(std::move(channel))
+{
+}
+
+bool BlobCacheSdk::ensure(const void* data, size_t size, SharedUtils::ContentKey& key, std::string* error) {
+    std::vector<SharedUtils::ContentKey> keys;
+    if (!ensureAll({ Payload{ data, size } }, keys, error)) {
+        return false;
+    }
+    key = keys.front();
+    return true;
+}
+
+bool BlobCacheSdk::ensureAll(const std::vector<Payload>& payloads,
+                             std::vector<SharedUtils::ContentKey>& keys,
+                             std::string* error) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    keys.clear();
+    keys.reserve(payloads.size());
+    for (const Payload& payload : payloads) {
+        keys.push_back(SharedUtils::contentKey(payload.data, payload.size));
+    }
+    const double hashMs = msSince(start);
+
+    // only keys not confirmed this session are looked up
+    octanearrays::FindBlobsRequest find;
+    std::vector<size_t> unknown;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.lookups += payloads.size();
+        m_stats.hashMs += hashMs;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (m_stored.count(keys[i]) != 0) {
+                ++m_stats.sessionHits;
+                m_stats.bytesSkipped += keys[i].size;
+            } else {
+                unknown.push_back(i);
+                toMessage(keys[i], find.add_keys());
+            }
+        }
+    }
+    if (unknown.empty()) {
+        return true;
+    }
+
+    std::unique_ptr<octanearrays::BlobCache::Stub> stub = octanearrays::BlobCache::NewStub(m_channel);
+    octanearrays::FindBlobsResponse found;
+    grpc::ClientContext findContext;
+    grpc::Status status = stub->findBlobs(&findContext, find, &found);
+    if (status.ok() && found.present_size() != static_cast<int>(unknown.size())) {
+        status = grpc::Status(grpc::StatusCode::INTERNAL, "findBlobs answered " + std::to_string(found.present_size()) +
+                                                              " of " + std::to_string(unknown.size()) + " keys");
+    }
+    if (!status.ok()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.errors;
+        if (error) {
+            *error = "findBlobs: " + status.error_message();
+        }
+        return false;
+    }
+
+    for (size_t i = 0; i < unknown.size(); ++i) {
+        const size_t index = unknown[i];
+        const SharedUtils::ContentKey& key = keys[index];
+        if (found.present(static_cast<int>(i))) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stored.insert(key);
+            ++m_stats.serverHits;
+            m_stats.bytesSkipped += key.size;
+            continue;
+        }
+
+        octanearrays::PutBlobRequest put;
+        toMessage(key, put.mutable_key());
+        put.set_data(payloads[index].data, payloads[index].size);
+        octanearrays::PutBlobResponse stored;
+        grpc::ClientContext putContext;
+        status = stub->putBlob(&putContext, put, &stored);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!status.ok()) {
+            ++m_stats.errors;
+            if (error) {
+                *error = "putBlob: " + status.error_message();
+            }
+            return false;
+        }
+        m_stored.insert(key);
+        ++m_stats.uploads;
+        m_stats.bytesUploaded += key.size;
+    }
+    return true;
+}
+
+bool BlobCacheSdk::setBlobs(const OctaneGRPC::ApiItemProxy& item,
+                            const ItemArraySdk::ArrayBatch& batch,
+                            const std::vector<SharedUtils::ContentKey>& keys,
+                            bool evaluate,
+                            grpc::Status& status) {
+    octanearrays::SetArraysRequest request;
+    request.set_itemhandle(static_cast<uint64_t>(item.getObjectHandle()));
+    request.set_evaluate(evaluate);
+    size_t packed = 0;
+    for (const ItemArraySdk::ArrayBatch::Entry& entry : batch.m_entries) {
+        octanearrays::AttributeArray* attribute = request.add_arrays();
+        attribute->set_attributeid(static_cast<uint32_t>(entry.id));
+        if (entry.isStrings) {
+            for (const std::string& value : entry.strings) {
+                attribute->mutable_strings()->add_data(value);
+            }
+            continue;
+        }
+        octanearrays::BlobArray* blob = attribute->mutable_blob();
+        blob->set_type(static_cast<octanearrays::PackedType>(entry.type));
+        toMessage(keys[packed++], blob->mutable_key());
+    }
+
+    grpc::ClientContext context;
+    octanearrays::SetPackedArrayResponse response;
+    status = octanearrays::ItemArrayTransfer::NewStub(m_channel)->setArrays(&context, request, &response);
+    return status.ok();
+}
+
+bool BlobCacheSdk::setMany(const OctaneGRPC::ApiItemProxy& item,
+                           const ItemArraySdk::ArrayBatch& batch,
+                           bool evaluate,
+                           std::string* error) {
+    std::vector<Payload> payloads;
+    for (const ItemArraySdk::ArrayBatch::Entry& entry : batch.m_entries) {
+        if (!entry.isStrings) {
+            payloads.push_back(Payload{ entry.data, entry.count * ItemArraySdk::elementSize(entry.type) });
+        }
+    }
+
+    std::vector<SharedUtils::ContentKey> keys;
+    grpc::Status status;
+    if (!ensureAll(payloads, keys, error)) {
+        return false;
+    }
+    if (!setBlobs(item, batch, keys, evaluate, status) && status.error_code() == grpc::StatusCode::NOT_FOUND) {
+        // evicted since it was confirmed, upload again
+        forgetKeys(keys);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.retries;
+        }
+        if (!ensureAll(payloads, keys, error)) {
+            return false;
+        }
+        setBlobs(item, batch, keys, evaluate, status);
+    }
+
+    if (!status.ok()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.errors;
+        if (error) {
+            *error = "setArrays: " + status.error_message();
+        }
+        return false;
+    }
+    return true;
+}
+
+bool BlobCacheSdk::setArray(const OctaneGRPC::ApiItemProxy& item,
+                            Octane::AttributeId id,
+                            ItemArraySdk::ElementType type,
+                            const void* data,
+                            size_t count,
+                            bool evaluate,
+                            std::string* error) {
+    ItemArraySdk::ArrayBatch batch;
+    batch.m_entries.push_back({ id, type, data, count, false, {} });
+    return setMany(item, batch, evaluate, error);
+}
+
+OctaneGRPC::ApiImageProxy BlobCacheSdk::loadImage(const void* data, size_t size, std::string* error) {
+    OctaneGRPC::ApiImageProxy image;
+    std::unique_ptr<octanearrays::BlobCache::Stub> stub = octanearrays::BlobCache::NewStub(m_channel);
+    grpc::Status status;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        SharedUtils::ContentKey key;
+        if (!ensure(data, size, key, error)) {
+            return image;
+        }
+        octanearrays::LoadImageFromBlobRequest request;
+        toMessage(key, request.mutable_key());
+        octanearrays::LoadImageFromBlobResponse response;
+        grpc::ClientContext context;
+        status = stub->loadImageFromBlob(&context, request, &response);
+        if (status.ok()) {
+            image.attachObjectHandle(response.imagehandle());
+            return image;
+        }
+        if (status.error_code() != grpc::StatusCode::NOT_FOUND) {
+            break;
+        }
+        forgetKeys({ key });
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.retries;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.errors;
+    if (error) {
+        *error = "loadImageFromBlob: " + status.error_message();
+    }
+    return image;
+}
+
+bool BlobCacheSdk::textureFile(const std::string& localPath, std::string& remotePath, std::string* error) {
+    std::ifstream in(localPath, std::ios::binary);
+    if (!in) {
+        if (error) {
+            *error = "can't read " + localPath;
+        }
+        return false;
+    }
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // image loaders on the Octane host go by the extension
+    std::string extension;
+    const size_t dot = localPath.find_last_of('.');
+    const size_t slash = localPath.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        extension = localPath.substr(dot);
+    }
+
+    std::unique_ptr<octanearrays::BlobCache::Stub> stub = octanearrays::BlobCache::NewStub(m_channel);
+    grpc::Status status;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        SharedUtils::ContentKey key;
+        if (!ensure(data.data(), data.size(), key, error)) {
+            return false;
+        }
+        octanearrays::BlobFileRequest request;
+        toMessage(key, request.mutable_key());
+        request.set_extension(extension);
+        octanearrays::BlobFileResponse response;
+        grpc::ClientContext context;
+        status = stub->blobFile(&context, request, &response);
+        if (status.ok()) {
+            remotePath = response.path();
+            return true;
+        }
+        if (status.error_code() != grpc::StatusCode::NOT_FOUND) {
+            break;
+        }
+        forgetKeys({ key });
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.retries;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.errors;
+    if (error) {
+        *error = "blobFile: " + status.error_message();
+    }
+    return false;
+}
+
+void BlobCacheSdk::forgetKeys(const std::vector<SharedUtils::ContentKey>& keys) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const SharedUtils::ContentKey& key : keys) {
+        m_stored.erase(key);
+    }
+}
+
+void BlobCacheSdk::forget() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stored.clear();
+}
+
+BlobCacheSdk::Stats BlobCacheSdk::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void BlobCacheSdk::printSummary(std::ostream& out) const {
+    const Stats s = stats();
+    out << "BlobCacheSdk: " << s.lookups << " payloads (" << s.sessionHits << " known, " << s.serverHits
+        << " found on the service, " << s.uploads << " uploaded), " << std::fixed << std::setprecision(1)
+        << s.bytesUploaded / (1024.0 * 1024.0) << " MB sent, " << s.bytesSkipped / (1024.0 * 1024.0)
+        << " MB skipped, " << s.hashMs << " ms hashing, " << s.retries << " retried after eviction, "
+        << s.errors << " failed" << std::endl;
+}
+
+#endif
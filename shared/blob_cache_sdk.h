@@ -0,0 +1,125 @@
+#ifndef BLOB_CACHE_SDK_H
+#define BLOB_CACHE_SDK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "content_hash.h"
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include <grpcpp/grpcpp.h>
+#include "apiimageclient.h"
+#include "apiitemclient.h"
+#include "item_array_sdk.h"
+
+/**
+ * @brief Uploads big payloads once per content instead of once per scene rebuild
+ *
+ * A rebuild of a mostly unchanged scene sends the same mesh arrays, images and texture files
+ * again. BlobCacheSdk hashes a payload (XXH64, see content_hash.h), asks the BlobCache service of
+ * octane_arrays whether it holds it and uploads it only if not; the attribute, image or file is
+ * then set from the stored blob by its key. Keys known to be stored are remembered for the
+ * session, so a second rebuild costs one hash per payload and no lookup.
+ *
+ * The service evicts blobs beyond its memory limit. A set that refers to an evicted blob fails
+ * with NOT_FOUND; the payload is then uploaded again and the set retried once.
+ */
+class BlobCacheSdk {
+public:
+    struct Settings {
+        std::string address = "127.0.0.1:50055";    // octane_arrays next to Octane
+    };
+
+    struct Payload {
+        const void* data;
+        size_t size;
+    };
+
+    struct Stats {
+        uint64_t lookups = 0;                       // payloads hashed
+        uint64_t sessionHits = 0;                   // known stored, no call
+        uint64_t serverHits = 0;                    // found by findBlobs, not uploaded
+        uint64_t uploads = 0;
+        uint64_t bytesUploaded = 0;
+        uint64_t bytesSkipped = 0;                  // payload bytes not sent thanks to the cache
+        uint64_t retries = 0;                       // sets repeated after an eviction
+        uint64_t errors = 0;
+        double hashMs = 0.0;
+    };
+
+    BlobCacheSdk() : BlobCacheSdk(Settings()) {}
+    explicit BlobCacheSdk(const Settings& settings);
+
+    /**
+     * @brief Use a channel of its own instead of one to settings.address. It must accept
+     * messages of a whole payload.
+     */
+    BlobCacheSdk(const Settings& settings, std::shared_ptr<grpc::Channel> channel);
+
+    const Settings& settings() const { return m_settings; }
+
+    /**
+     * @brief Make sure the service holds size bytes at data, uploading them if it doesn't.
+     * key receives the key to refer to them.
+     */
+    bool ensure(const void* data, size_t size, SharedUtils::ContentKey& key, std::string* error = nullptr);
+
+    /**
+     * @brief ensure() for several payloads with a single lookup of those not known yet
+     */
+    bool ensureAll(const std::vector<Payload>& payloads, std::vector<SharedUtils::ContentKey>& keys, std::string* error = nullptr);
+
+    /**
+     * @brief ItemArraySdk::setMany() with the packed arrays of batch sent as blobs: an array the
+     * service already holds costs its key instead of its data. Strings are sent as they are.
+     */
+    bool setMany(const OctaneGRPC::ApiItemProxy& item, const ItemArraySdk::ArrayBatch& batch, bool evaluate, std::string* error = nullptr);
+
+    /**
+     * @brief Set one array attribute from a blob, see setMany()
+     */
+    bool setArray(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, ItemArraySdk::ElementType type,
+                  const void* data, size_t count, bool evaluate, std::string* error = nullptr);
+
+    /**
+     * @brief ApiImageProxy::loadFromMemory() with the encoded image sent as a blob. Returns a
+     * null proxy if Octane couldn't load it.
+     */
+    OctaneGRPC::ApiImageProxy loadImage(const void* data, size_t size, std::string* error = nullptr);
+
+    /**
+     * @brief Make the file at localPath available on the Octane host, e.g. for A_FILENAME of an
+     * image texture. remotePath receives its path there, named after its content.
+     */
+    bool textureFile(const std::string& localPath, std::string& remotePath, std::string* error = nullptr);
+
+    /**
+     * @brief Forget which blobs are stored, e.g. after the service restarted. The next
+     * ensure() asks the service again.
+     */
+    void forget();
+
+    Stats stats() const;
+    void printSummary(std::ostream& out) const;
+
+private:
+    bool setBlobs(const OctaneGRPC::ApiItemProxy& item, const ItemArraySdk::ArrayBatch& batch,
+                  const std::vector<SharedUtils::ContentKey>& keys, bool evaluate, grpc::Status& status);
+    void forgetKeys(const std::vector<SharedUtils::ContentKey>& keys);
+
+    const Settings m_settings;
+    std::shared_ptr<grpc::Channel> m_channel;
+
+    mutable std::mutex m_mutex;
+    std::set<SharedUtils::ContentKey> m_stored;
+    Stats m_stats;
+};
+#endif
+
+#endif // BLOB_CACHE_SDK_H
@@ -0,0 +1,254 @@
+#include "camera_latency_sdk.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    // nearest rank
+    const size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+void printPercentiles(std::ostream& out, const char* name, const CameraLatencySdk::Percentiles& p) {
+    out << "   " << name << ": p50 " << p.p50 << ", p90 " << p.p90 << ", p99 " << p.p99
+        << ", max " << p.max << " ms" << std::endl;
+}
+
+}
+
+CameraLatencySdk::CameraLatencySdk(const Settings& settings)
+    : m_settings(settings)
+    , m_nextSequence(1)
+    , m_updates(0)
+    , m_displayed(0)
+    , m_coalesced(0)
+    , m_hudEnabled(false)
+{
+}
+
+uint64_t CameraLatencySdk::onCameraUpdate(Clock::time_point issued) {
+    // the level after the update, frames at or above it show this camera
+    uint64_t changeLevel = 0;
+#ifdef DO_GRPC_SDK_ENABLED
+    if (m_settings.queryChangeLevel) {
+        try {
+            changeLevel = static_cast<uint64_t>(OctaneGRPC::ApiRenderEngineProxy::getCurrentChangeLevel());
+        } catch (const std::exception& e) {
+            std::cout << "CameraLatencySdk: getCurrentChangeLevel failed: " << e.what() << std::endl;
+        }
+    }
+#endif
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Update update;
+    update.sequence = m_nextSequence++;
+    update.changeLevel = changeLevel;
+    update.issued = issued;
+    update.hasFrame = false;
+    update.hasUpload = false;
+    m_pending.push_back(update);
+    ++m_updates;
+
+    // nothing is displayed (local cube, no connection), the oldest never will be
+    while (m_pending.size() > std::max<size_t>(m_settings.maxPending, 1)) {
+        m_pending.pop_front();
+        ++m_coalesced;
+    }
+    return update.sequence;
+}
+
+uint64_t CameraLatencySdk::onFrame(uint64_t changeLevel) {
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_pending.rbegin(); it != m_pending.rend(); ++it) {
+        if (it->hasFrame) {
+            // newer updates than an answered one were not answered before either
+            break;
+        }
+        if (it->changeLevel == 0 || changeLevel >= it->changeLevel) {
+            it->hasFrame = true;
+            it->arrived = now;
+            return it->sequence;
+        }
+    }
+    return 0;
+}
+
+#ifdef DO_GRPC_SDK_ENABLED
+uint64_t CameraLatencySdk::onFrame(const Octane::ApiRenderImage& image) {
+    return onFrame(static_cast<uint64_t>(image.mChangeLevel));
+}
+#endif
+
+CameraLatencySdk::Update* CameraLatencySdk::find(uint64_t sequence) {
+    for (Update& update : m_pending) {
+        if (update.sequence == sequence) {
+            return &update;
+        }
+    }
+    return nullptr;
+}
+
+void CameraLatencySdk::onUploaded(uint64_t sequence) {
+    if (sequence == 0) {
+        return;
+    }
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Update* update = find(sequence);
+    if (update && update->hasFrame && !update->hasUpload) {
+        update->uploaded = now;
+        update->hasUpload = true;
+    }
+}
+
+void CameraLatencySdk::onDisplayed(uint64_t sequence) {
+    if (sequence == 0) {
+        return;
+    }
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Update* update = find(sequence);
+    if (!update || !update->hasFrame) {
+        return;
+    }
+    const Clock::time_point uploaded = update->hasUpload ? update->uploaded : update->arrived;
+    Sample sample;
+    sample.toFrame = elapsedMs(update->issued, update->arrived);
+    sample.toUpload = elapsedMs(update->arrived, uploaded);
+    sample.toDisplay = elapsedMs(uploaded, now);
+    m_samples.push_back(sample);
+    while (m_samples.size() > std::max<size_t>(m_settings.window, 1)) {
+        m_samples.pop_front();
+    }
+    ++m_displayed;
+
+    // older updates are behind the camera on screen now and won't be shown anymore
+    while (!m_pending.empty() && m_pending.front().sequence <= sequence) {
+        if (m_pending.front().sequence != sequence) {
+            ++m_coalesced;
+        }
+        m_pending.pop_front();
+    }
+}
+
+void CameraLatencySdk::setHudEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hudEnabled = enabled;
+    m_hudText.clear();
+}
+
+bool CameraLatencySdk::hudEnabled() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hudEnabled;
+}
+
+std::string CameraLatencySdk::hudText() {
+    const Clock::time_point now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_hudEnabled) {
+            return std::string();
+        }
+        if (!m_hudText.empty() && elapsedMs(m_hudTime, now) < m_settings.hudIntervalMs) {
+            return m_hudText;
+        }
+    }
+
+    const Stats current = stats();
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(0) << "camera to screen ";
+    if (current.total.count == 0) {
+        text << "-";
+    } else {
+        text << "p50 " << current.total.p50 << " / p90 " << current.total.p90 << " / p99 "
+             << current.total.p99 << " ms (Octane " << current.toFrame.p50 << ", upload "
+             << current.toUpload.p50 << ", draw " << current.toDisplay.p50 << ")";
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hudTime = now;
+    m_hudText = text.str();
+    return m_hudText;
+}
+
+void CameraLatencySdk::reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+    m_samples.clear();
+    m_updates = 0;
+    m_displayed = 0;
+    m_coalesced = 0;
+    m_hudText.clear();
+}
+
+CameraLatencySdk::Percentiles CameraLatencySdk::percentiles(std::vector<double>& values) {
+    Percentiles result;
+    result.count = values.size();
+    if (values.empty()) {
+        return result;
+    }
+    std::sort(values.begin(), values.end());
+    result.p50 = percentile(values, 0.50);
+    result.p90 = percentile(values, 0.90);
+    result.p99 = percentile(values, 0.99);
+    result.max = values.back();
+    return result;
+}
+
+CameraLatencySdk::Stats CameraLatencySdk::stats() const {
+    std::vector<double> total;
+    std::vector<double> toFrame;
+    std::vector<double> toUpload;
+    std::vector<double> toDisplay;
+    Stats result;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        result.updates = m_updates;
+        result.displayed = m_displayed;
+        result.coalesced = m_coalesced;
+        total.reserve(m_samples.size());
+        toFrame.reserve(m_samples.size());
+        toUpload.reserve(m_samples.size());
+        toDisplay.reserve(m_samples.size());
+        for (const Sample& sample : m_samples) {
+            total.push_back(sample.toFrame + sample.toUpload + sample.toDisplay);
+            toFrame.push_back(sample.toFrame);
+            toUpload.push_back(sample.toUpload);
+            toDisplay.push_back(sample.toDisplay);
+        }
+    }
+    result.total = percentiles(total);
+    result.toFrame = percentiles(toFrame);
+    result.toUpload = percentiles(toUpload);
+    result.toDisplay = percentiles(toDisplay);
+    return result;
+}
+
+void CameraLatencySdk::printSummary(std::ostream& out) const {
+    const Stats current = stats();
+    out << "Camera latency: " << current.updates << " camera updates, " << current.displayed
+        << " displayed, " << current.coalesced << " coalesced";
+    if (current.total.count == 0) {
+        out << std::endl;
+        return;
+    }
+    out << ", last " << current.total.count << " samples:" << std::endl;
+    const std::streamsize precision = out.precision();
+    const std::ios_base::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(1);
+    printPercentiles(out, "camera to screen ", current.total);
+    printPercentiles(out, "camera to frame  ", current.toFrame);
+    printPercentiles(out, "frame to upload  ", current.toUpload);
+    printPercentiles(out, "upload to screen ", current.toDisplay);
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,144 @@
+#ifndef CAMERA_LATENCY_SDK_H
+#define CAMERA_LATENCY_SDK_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apirenderengineclient.h"
+#endif
+
+/**
+ * @brief Measures the time from a camera change to the frame showing it on screen
+ *
+ * Every camera update passed to onCameraUpdate() gets a sequence number and the change
+ * level Octane reports right after the update (ApiRenderEngineProxy::getCurrentChangeLevel()).
+ * A render image reflects all updates up to its mChangeLevel, so onFrame() finds the newest
+ * update the frame answers and returns its sequence number. That number travels with the
+ * frame to the render loop, which calls onUploaded() once the texture holds the frame and
+ * onDisplayed() after the swap.
+ *
+ * Each displayed update yields one sample split into three stages: camera to frame arrival
+ * (Octane and the network), arrival to upload (handoff and conversion) and upload to
+ * display (draw and swap). Percentiles are taken over the last `window` samples. Updates
+ * a newer frame answered first, or that never reached the screen, are counted as coalesced.
+ *
+ * Without a change level (the query failed or is disabled) the first frame arriving after
+ * the update answers it, as DynamicResolutionSdk does.
+ *
+ * onCameraUpdate(), onUploaded() and onDisplayed() are called by the render loop, onFrame()
+ * by the new image callback.
+ */
+class CameraLatencySdk {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Settings {
+        size_t window = 512;                // samples the percentiles are taken over
+        size_t maxPending = 256;            // camera updates waiting for their frame
+        bool queryChangeLevel = true;       // one getCurrentChangeLevel() per camera update
+        double hudIntervalMs = 250.0;       // hudText() changes at most this often
+    };
+
+    struct Percentiles {
+        size_t count = 0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    struct Stats {
+        uint64_t updates = 0;
+        uint64_t displayed = 0;
+        uint64_t coalesced = 0;             // superseded by a newer update before display
+        Percentiles total;                  // camera update to display
+        Percentiles toFrame;                // camera update to frame arrival
+        Percentiles toUpload;               // frame arrival to texture upload
+        Percentiles toDisplay;              // texture upload to buffer swap
+    };
+
+    CameraLatencySdk() : CameraLatencySdk(Settings()) {}
+    explicit CameraLatencySdk(const Settings& settings);
+
+    const Settings& settings() const { return m_settings; }
+
+    /**
+     * @brief The camera was sent to Octane, issued is the time before the setCamera() call.
+     * Returns the sequence number of the update.
+     */
+    uint64_t onCameraUpdate(Clock::time_point issued);
+
+    /**
+     * @brief A frame arrived. Returns the sequence number of the newest camera update it
+     * reflects, 0 if it answers none.
+     */
+    uint64_t onFrame(uint64_t changeLevel);
+
+#ifdef DO_GRPC_SDK_ENABLED
+    uint64_t onFrame(const Octane::ApiRenderImage& image);
+#endif
+
+    /**
+     * @brief The frame of sequence is in the texture, 0 is ignored
+     */
+    void onUploaded(uint64_t sequence);
+
+    /**
+     * @brief The frame of sequence is on screen, 0 is ignored
+     */
+    void onDisplayed(uint64_t sequence);
+
+    void setHudEnabled(bool enabled);
+    bool hudEnabled() const;
+
+    /**
+     * @brief One line for a window title or overlay, empty while the HUD is disabled
+     */
+    std::string hudText();
+
+    void reset();
+    Stats stats() const;
+    void printSummary(std::ostream& out) const;
+
+private:
+    struct Update {
+        uint64_t sequence;
+        uint64_t changeLevel;               // 0 if unknown
+        Clock::time_point issued;
+        Clock::time_point arrived;
+        Clock::time_point uploaded;
+        bool hasFrame;
+        bool hasUpload;
+    };
+
+    struct Sample {
+        double toFrame;
+        double toUpload;
+        double toDisplay;
+    };
+
+    Update* find(uint64_t sequence);
+    static Percentiles percentiles(std::vector<double>& values);
+
+    const Settings m_settings;
+
+    mutable std::mutex m_mutex;
+    std::deque<Update> m_pending;           // oldest first, answered ones until displayed
+    std::deque<Sample> m_samples;
+    uint64_t m_nextSequence;
+    uint64_t m_updates;
+    uint64_t m_displayed;
+    uint64_t m_coalesced;
+
+    bool m_hudEnabled;
+    Clock::time_point m_hudTime;
+    std::string m_hudText;
+};
+
+#endif // CAMERA_LATENCY_SDK_H
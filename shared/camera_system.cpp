@@ -44,6 +44,18 @@ void CameraController::processInput(GLFWwindow* window) {
     } else {
         keyboard.rKeyPressed = false;
     }
+
+    // Handle render pass capture (C key)
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) {
+        if (!keyboard.cKeyPressed) {
+            keyboard.cKeyPressed = true;
+            if (onCaptureAovs) {
+                onCaptureAovs();
+            }
+        }
+    } else {
+        keyboard.cKeyPressed = false;
+    }
 }
 
 void CameraController::resetCamera() {
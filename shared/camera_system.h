@@ -46,6 +46,7 @@ struct MouseState {
 struct KeyboardState {
     bool lKeyPressed = false;
     bool rKeyPressed = false;
+    bool cKeyPressed = false;
 };
 
 /**
@@ -60,6 +61,7 @@ public:
     // Callbacks for model loading
     std::function<void()> onLoadModel;
     std::function<void()> onResetModel;
+    std::function<void()> onCaptureAovs;
     std::function<void(const glm::vec3&, const glm::vec3&, const glm::vec3&)> onCameraUpdate;
     
     /**
@@ -0,0 +1,124 @@
+#include "content_hash.h"
+
+#include <cstring>
+
+namespace SharedUtils {
+
+namespace {
+
+    const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+    const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+    const uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+    const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+    const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+    inline uint64_t rotl64(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    // x86 and ARM are little endian, which is the byte order of the hash
+    inline uint64_t read64(const uint8_t* p)
+    {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t read32(const uint8_t* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t xxhRound(uint64_t acc, uint64_t input)
+    {
+        acc += input * PRIME64_2;
+        acc = rotl64(acc, 31);
+        return acc * PRIME64_1;
+    }
+
+    inline uint64_t mergeRound(uint64_t acc, uint64_t value)
+    {
+        acc ^= xxhRound(0, value);
+        return acc * PRIME64_1 + PRIME64_4;
+    }
+
+} // namespace
+
+uint64_t contentHash64(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* const end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        // four independent lanes, so the multiplies of a stripe overlap
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        const uint8_t* const limit = end - 32;
+        do {
+            v1 = xxhRound(v1, read64(p));
+            v2 = xxhRound(v2, read64(p + 8));
+            v3 = xxhRound(v3, read64(p + 16));
+            v4 = xxhRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+
+    h += static_cast<uint64_t>(size);
+
+    while (p + 8 <= end) {
+        h ^= xxhRound(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string ContentKey::toString() const
+{
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string text(16, '0');
+    for (int i = 0; i < 16; ++i) {
+        text[15 - i] = DIGITS[(hash >> (i * 4)) & 0xf];
+    }
+    return text + "-" + std::to_string(size);
+}
+
+ContentKey contentKey(const void* data, size_t size)
+{
+    ContentKey key;
+    key.hash = contentHash64(data, size);
+    key.size = size;
+    return key;
+}
+
+} // namespace SharedUtils
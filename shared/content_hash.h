@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace SharedUtils {
+
+    /**
+     * XXH64 of data, the 64 bit xxHash. Reads 32 bytes per step at several GB/s, fast enough to
+     * key a mesh or texture upload before deciding whether it has to be sent at all.
+     */
+    uint64_t contentHash64(const void* data, size_t size, uint64_t seed = 0);
+
+    /**
+     * Key of a content addressed blob. The size is part of the key, two blobs only share a key
+     * if their 64 bit hashes collide at the same length.
+     */
+    struct ContentKey
+    {
+        uint64_t hash = 0;
+        uint64_t size = 0;
+
+        bool operator==(const ContentKey& other) const { return hash == other.hash && size == other.size; }
+        bool operator!=(const ContentKey& other) const { return !(*this == other); }
+        bool operator<(const ContentKey& other) const
+        {
+            return hash != other.hash ? hash < other.hash : size < other.size;
+        }
+
+        /**
+         * 16 hex digits of the hash, a dash and the size, usable as a file name
+         */
+        std::string toString() const;
+    };
+
+    ContentKey contentKey(const void* data, size_t size);
+
+} // namespace SharedUtils
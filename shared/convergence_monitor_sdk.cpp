@@ -0,0 +1,295 @@
+#include "convergence_monitor_sdk.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include "image_writer.h"
+
+using SharedUtils::PixelConvert::PixelFormat;
+
+ConvergenceMonitorSdk::ConvergenceMonitorSdk(const Settings& settings)
+    : m_settings(settings)
+    , m_referenceFormat(SharedUtils::PixelConvert::PIXEL_FORMAT_LDR_RGBA)
+    , m_referenceWidth(0)
+    , m_referenceHeight(0)
+    , m_referenceSpp(0)
+    , m_hasReference(false)
+    , m_hasResult(false)
+    , m_passes(0)
+    , m_converged(false)
+    , m_paused(false)
+    , m_resetGeneration(0)
+    , m_comparisons(0)
+    , m_restarts(0)
+{
+}
+
+void ConvergenceMonitorSdk::setSettings(const Settings& settings) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_settings = settings;
+    m_passes = 0;
+}
+
+ConvergenceMonitorSdk::Settings ConvergenceMonitorSdk::settings() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+void ConvergenceMonitorSdk::setResultCallback(std::function<void(const Result&)> callback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_resultCallback = std::move(callback);
+}
+
+bool ConvergenceMonitorSdk::feed(PixelFormat format,
+                                 const void* pixels,
+                                 size_t pitch,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 uint32_t samplesPerPixel) {
+    if (!pixels || width == 0 || height == 0 ||
+        (format != SharedUtils::PixelConvert::PIXEL_FORMAT_LDR_RGBA &&
+         format != SharedUtils::PixelConvert::PIXEL_FORMAT_HDR_RGBA)) {
+        return false;
+    }
+
+    const size_t rowBytes = (size_t)width * SharedUtils::PixelConvert::bytesPerPixel(format);
+    Result result;
+    std::function<void(const Result&)> callback;
+    Action action = ACTION_NONE;
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const bool restarted = m_hasReference &&
+            (samplesPerPixel < m_referenceSpp || width != m_referenceWidth ||
+             height != m_referenceHeight || format != m_referenceFormat);
+        if (restarted) {
+            m_hasReference = false;
+            m_passes = 0;
+            m_converged = false;
+            ++m_restarts;
+        }
+
+        // compare only once enough samples were added, the frames in between are dropped
+        const bool compare = m_hasReference && !m_converged &&
+            (double)samplesPerPixel >= (double)m_referenceSpp * m_settings.sampleRatio &&
+            samplesPerPixel > m_referenceSpp;
+        if (m_hasReference && !compare) {
+            return false;
+        }
+
+        if (compare) {
+            const auto start = std::chrono::steady_clock::now();
+            if (!SharedUtils::compareFrames(format, m_reference.data(), rowBytes, pixels, pitch, width, height,
+                                            m_settings.tileSize, m_settings.clampValues, result.diff)) {
+                return false;
+            }
+            result.compareMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            result.samplesPerPixel = samplesPerPixel;
+            result.referenceSamplesPerPixel = m_referenceSpp;
+
+            const bool pass = samplesPerPixel >= m_settings.minSamplesPerPixel &&
+                              result.diff.psnr >= m_settings.minPsnr &&
+                              result.diff.maxTileError <= m_settings.maxTileError;
+            m_passes = pass ? m_passes + 1 : 0;
+            result.passes = m_passes;
+            result.converged = m_passes >= std::max(m_settings.consecutive, 1u);
+            m_converged = result.converged;
+            if (m_converged) {
+                action = m_settings.action;
+                // pending until takeAction() made the call, a reset() in between continues it
+                m_paused = action == ACTION_PAUSE;
+                generation = m_resetGeneration;
+            }
+
+            m_lastResult = result;
+            m_hasResult = true;
+            ++m_comparisons;
+            callback = m_resultCallback;
+        }
+
+        // the new frame is the reference for the next comparison
+        m_reference.resize(rowBytes * height);
+        for (uint32_t y = 0; y < height; ++y) {
+            std::memcpy(m_reference.data() + (size_t)y * rowBytes, (const uint8_t*)pixels + (size_t)y * pitch, rowBytes);
+        }
+        m_referenceFormat = format;
+        m_referenceWidth = width;
+        m_referenceHeight = height;
+        m_referenceSpp = samplesPerPixel;
+        m_hasReference = true;
+        if (!compare) {
+            return false;
+        }
+    }
+
+    if (callback) {
+        callback(result);
+    }
+    if (result.converged) {
+        std::cout << "ConvergenceMonitorSdk: converged at " << result.samplesPerPixel << " spp, PSNR "
+                  << std::fixed << std::setprecision(2) << result.diff.psnr << " dB, worst tile "
+                  << std::setprecision(4) << result.diff.maxTileError << std::endl;
+        takeAction(action, generation);
+    }
+    return result.converged;
+}
+
+#ifdef DO_GRPC_SDK_ENABLED
+bool ConvergenceMonitorSdk::feed(const Octane::ApiRenderImage& image) {
+    const PixelFormat format = static_cast<PixelFormat>(image.mType);
+    const size_t pitch = (size_t)image.mPitch * SharedUtils::PixelConvert::bytesPerPixel(format);
+    return feed(format, image.mBuffer, pitch, image.mSize.x, image.mSize.y,
+                static_cast<uint32_t>(image.mTonemappedSamplesPerPixel));
+}
+#endif
+
+bool ConvergenceMonitorSdk::takeAction(Action action, uint64_t generation) {
+    if (action == ACTION_NONE) {
+        return true;
+    }
+#ifdef DO_GRPC_SDK_ENABLED
+    try {
+        if (action == ACTION_PAUSE) {
+            OctaneGRPC::ApiRenderEngineProxy::pauseRendering();
+            bool outdated;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                outdated = m_resetGeneration != generation;
+            }
+            if (outdated) {
+                // the scene changed while the call was on its way, the new view must not stay paused
+                OctaneGRPC::ApiRenderEngineProxy::continueRendering();
+                std::cout << "ConvergenceMonitorSdk: reset during the pause, rendering continued" << std::endl;
+                return true;
+            }
+            std::cout << "ConvergenceMonitorSdk: rendering paused" << std::endl;
+        } else {
+            OctaneGRPC::ApiRenderEngineProxy::stopRendering();
+            std::cout << "ConvergenceMonitorSdk: rendering stopped" << std::endl;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "ConvergenceMonitorSdk: " << (action == ACTION_PAUSE ? "pauseRendering" : "stopRendering")
+                  << " failed: " << e.what() << std::endl;
+    }
+#endif
+    if (action == ACTION_PAUSE) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_resetGeneration == generation) {
+            m_paused = false;
+        }
+    }
+    return false;
+}
+
+void ConvergenceMonitorSdk::reset() {
+    bool paused;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_hasReference = false;
+        m_hasResult = false;
+        m_passes = 0;
+        m_converged = false;
+        m_reference.clear();
+        m_reference.shrink_to_fit();
+        paused = m_paused;
+        m_paused = false;
+        ++m_resetGeneration;
+    }
+#ifdef DO_GRPC_SDK_ENABLED
+    // a render paused by the monitor would otherwise stay paused after the scene changed
+    if (paused) {
+        try {
+            OctaneGRPC::ApiRenderEngineProxy::continueRendering();
+            std::cout << "ConvergenceMonitorSdk: rendering continued" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "ConvergenceMonitorSdk: continueRendering failed: " << e.what() << std::endl;
+        }
+    }
+#else
+    (void)paused;
+#endif
+}
+
+bool ConvergenceMonitorSdk::converged() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_converged;
+}
+
+bool ConvergenceMonitorSdk::lastResult(Result& result) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_hasResult) {
+        return false;
+    }
+    result = m_lastResult;
+    return true;
+}
+
+bool ConvergenceMonitorSdk::exportTileMap(const std::string& path) const {
+    Result result;
+    double threshold;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_hasResult) {
+            return false;
+        }
+        result = m_lastResult;
+        threshold = m_settings.maxTileError;
+    }
+    const SharedUtils::FrameDiff& diff = result.diff;
+
+    const size_t dot = path.rfind('.');
+    const std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    SharedUtils::ImageFileFormat fileFormat;
+    if (!SharedUtils::ImageWriter::formatFromName(extension, fileFormat)) {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "ConvergenceMonitorSdk: can't open " << path << std::endl;
+            return false;
+        }
+        out << "# " << diff.tilesX << "x" << diff.tilesY << " tiles of " << diff.tileSize << " pixels, "
+            << result.samplesPerPixel << " vs " << result.referenceSamplesPerPixel << " spp\n";
+        for (uint32_t ty = 0; ty < diff.tilesY; ++ty) {
+            for (uint32_t tx = 0; tx < diff.tilesX; ++tx) {
+                out << (tx ? "," : "") << diff.tileErrors[(size_t)ty * diff.tilesX + tx];
+            }
+            out << "\n";
+        }
+        return out.good();
+    }
+
+    // 8-bit files show the error relative to the threshold, EXR keeps the values
+    auto values = std::make_shared<std::vector<float>>(diff.tileErrors);
+    if (fileFormat != SharedUtils::IMAGE_FILE_EXR && threshold > 0.0) {
+        for (float& value : *values) {
+            value = (float)(value / threshold);
+        }
+    }
+    SharedUtils::ImageFrame frame;
+    frame.format = SharedUtils::PixelConvert::PIXEL_FORMAT_HDR_MONO;
+    frame.width = diff.tilesX;
+    frame.height = diff.tilesY;
+    frame.pitch = (size_t)diff.tilesX * sizeof(float);
+    frame.pixels = std::shared_ptr<const void>(values, values->data());
+
+    SharedUtils::ImageWriter writer(1, 1, 1);
+    return writer.write(path, fileFormat, frame);
+}
+
+void ConvergenceMonitorSdk::printSummary(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out << "Convergence monitor: " << m_comparisons << " comparisons, " << m_restarts << " restarts";
+    if (m_hasResult) {
+        const Result& r = m_lastResult;
+        out << ", last " << r.referenceSamplesPerPixel << " -> " << r.samplesPerPixel << " spp: PSNR "
+            << std::fixed << std::setprecision(2) << r.diff.psnr << " dB (min " << m_settings.minPsnr
+            << "), worst tile " << std::setprecision(4) << r.diff.maxTileError << " (max " << m_settings.maxTileError
+            << "), " << std::setprecision(2) << r.compareMs << " ms"
+            << (m_converged ? ", converged" : "");
+    }
+    out << std::endl;
+}
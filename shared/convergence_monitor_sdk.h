@@ -0,0 +1,144 @@
+#ifndef CONVERGENCE_MONITOR_SDK_H
+#define CONVERGENCE_MONITOR_SDK_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "frame_compare.h"
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apirenderengineclient.h"
+#endif
+
+/**
+ * @brief Pauses or stops the render once successive frames stop changing
+ *
+ * Max samples is the only stopping rule Octane has, so renders keep going long after
+ * the image stopped improving visibly. The monitor compares each new frame with an
+ * earlier one of the same render (SharedUtils::compareFrames: MSE, PSNR and a per tile
+ * relative error). The difference between two frames at n and k*n samples estimates
+ * the noise left in the image. When PSNR and the worst tile are within the thresholds
+ * for a number of comparisons in a row, the render is paused or stopped.
+ *
+ * Frames are fed from the new image callback. Only frames with enough new samples
+ * are compared, the others are dropped right away, so feeding every frame is cheap.
+ */
+class ConvergenceMonitorSdk {
+public:
+    enum Action {
+        ACTION_NONE = 0,        // only report
+        ACTION_PAUSE,           // pauseRendering(), the render can be continued
+        ACTION_STOP,            // stopRendering()
+    };
+
+    struct Settings {
+        double minPsnr = 45.0;              // dB between successive compared frames
+        double maxTileError = 0.02;         // relative error of the worst tile
+        uint32_t tileSize = 32;
+        uint32_t minSamplesPerPixel = 16;   // never converged before this
+        double sampleRatio = 1.5;           // compare once the samples grew by this factor
+        unsigned consecutive = 2;           // comparisons in a row within the thresholds
+        bool clampValues = true;            // clamp HDR values at 1 like calculateMeanSquareError
+        Action action = ACTION_PAUSE;
+    };
+
+    /**
+     * @brief Outcome of one comparison
+     */
+    struct Result {
+        uint32_t samplesPerPixel = 0;
+        uint32_t referenceSamplesPerPixel = 0;
+        SharedUtils::FrameDiff diff;
+        double compareMs = 0.0;
+        unsigned passes = 0;                // comparisons in a row within the thresholds
+        bool converged = false;
+    };
+
+    ConvergenceMonitorSdk() : ConvergenceMonitorSdk(Settings()) {}
+    explicit ConvergenceMonitorSdk(const Settings& settings);
+
+    void setSettings(const Settings& settings);
+    Settings settings() const;
+
+    /**
+     * @brief Called with each result, on the feeding thread
+     */
+    void setResultCallback(std::function<void(const Result&)> callback);
+
+    /**
+     * @brief Feed a frame. pitch is in bytes, only LDR and HDR RGBA frames are compared.
+     *
+     * Fewer samples than the reference or a new size mean the render restarted and
+     * start over. Returns true if this frame made the render converge.
+     */
+    bool feed(SharedUtils::PixelConvert::PixelFormat format,
+              const void* pixels,
+              size_t pitch,
+              uint32_t width,
+              uint32_t height,
+              uint32_t samplesPerPixel);
+
+#ifdef DO_GRPC_SDK_ENABLED
+    /**
+     * @brief Feed a render image as received by the new image callback
+     */
+    bool feed(const Octane::ApiRenderImage& image);
+#endif
+
+    /**
+     * @brief Forget the reference frame and the convergence state
+     *
+     * Continues the render if the monitor paused it, call it when the camera or the
+     * scene changed and when the monitor is switched on or off.
+     */
+    void reset();
+
+    bool converged() const;
+
+    /**
+     * @brief The last comparison, false if nothing was compared yet
+     */
+    bool lastResult(Result& result) const;
+
+    /**
+     * @brief Write the tile error map of the last comparison
+     *
+     * .csv writes one line per tile row; .exr keeps the errors as float values;
+     * .png, .bmp and .ppm scale maxTileError (the threshold) to white.
+     */
+    bool exportTileMap(const std::string& path) const;
+
+    void printSummary(std::ostream& out) const;
+
+private:
+    /**
+     * @brief generation is m_resetGeneration when the action was decided, a pause that
+     * lands after a later reset() is continued again
+     */
+    bool takeAction(Action action, uint64_t generation);
+
+    mutable std::mutex m_mutex;
+    Settings m_settings;
+    std::function<void(const Result&)> m_resultCallback;
+
+    std::vector<uint8_t> m_reference;
+    SharedUtils::PixelConvert::PixelFormat m_referenceFormat;
+    uint32_t m_referenceWidth;
+    uint32_t m_referenceHeight;
+    uint32_t m_referenceSpp;
+    bool m_hasReference;
+
+    Result m_lastResult;
+    bool m_hasResult;
+    unsigned m_passes;
+    bool m_converged;
+    bool m_paused;                      // the render was paused by takeAction(), or is about to be
+    uint64_t m_resetGeneration;         // calls of reset()
+    uint64_t m_comparisons;
+    uint64_t m_restarts;
+};
+
+#endif // CONVERGENCE_MONITOR_SDK_H
@@ -0,0 +1,417 @@
+#include "cryptomatte.h"
+#include "pixel_convert.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CRYPTOMATTE_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace SharedUtils {
+
+namespace {
+
+    inline uint32_t rotl32(uint32_t x, int r)
+    {
+        return (x << r) | (x >> (32 - r));
+    }
+
+    uint32_t murmurHash3(const uint8_t* data, size_t length, uint32_t seed)
+    {
+        const uint32_t c1 = 0xcc9e2d51;
+        const uint32_t c2 = 0x1b873593;
+        uint32_t h = seed;
+
+        const size_t blocks = length / 4;
+        for (size_t i = 0; i < blocks; ++i) {
+            uint32_t k = (uint32_t)data[i * 4] | ((uint32_t)data[i * 4 + 1] << 8) |
+                         ((uint32_t)data[i * 4 + 2] << 16) | ((uint32_t)data[i * 4 + 3] << 24);
+            k *= c1;
+            k = rotl32(k, 15);
+            k *= c2;
+            h ^= k;
+            h = rotl32(h, 13);
+            h = h * 5 + 0xe6546b64;
+        }
+
+        const uint8_t* tail = data + blocks * 4;
+        uint32_t k = 0;
+        switch (length & 3) {
+        case 3:
+            k ^= (uint32_t)tail[2] << 16;
+            // fall through
+        case 2:
+            k ^= (uint32_t)tail[1] << 8;
+            // fall through
+        case 1:
+            k ^= tail[0];
+            k *= c1;
+            k = rotl32(k, 15);
+            k *= c2;
+            h ^= k;
+        }
+
+        h ^= (uint32_t)length;
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35;
+        h ^= h >> 16;
+        return h;
+    }
+
+    inline bool matches(uint32_t id, const uint32_t* ids, size_t count)
+    {
+        for (size_t k = 0; k < count; ++k) {
+            if (ids[k] == id) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline uint8_t coverageToU8(float coverage)
+    {
+        coverage = coverage > 0.0f ? (coverage < 1.0f ? coverage : 1.0f) : 0.0f;
+        return (uint8_t)(coverage * 255.0f + 0.5f);
+    }
+
+    void maskRowScalar(const uint32_t* id0, const uint32_t* id1, const float* coverage0, const float* coverage1,
+                       size_t count, const uint32_t* ids, size_t idCount, uint8_t* out)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            float coverage = 0.0f;
+            if (matches(id0[i], ids, idCount)) {
+                coverage += coverage0[i];
+            }
+            if (matches(id1[i], ids, idCount)) {
+                coverage += coverage1[i];
+            }
+            out[i] = coverageToU8(coverage);
+        }
+    }
+
+    inline void tintPixel(uint8_t* pixel, const uint8_t color[3], int weight)
+    {
+        for (int c = 0; c < 3; ++c) {
+            pixel[c] = (uint8_t)(pixel[c] + (((color[c] - pixel[c]) * weight) >> 7));
+        }
+    }
+
+#if defined(CRYPTOMATTE_X86)
+
+    /**
+     * Four pixels per vector: the ID planes are compared with every selected ID and
+     * the matching coverages summed, then clamped and packed to bytes
+     */
+    void maskRowSse2(const uint32_t* id0, const uint32_t* id1, const float* coverage0, const float* coverage1,
+                     size_t count, const uint32_t* ids, size_t idCount, uint8_t* out)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 scale = _mm_set1_ps(255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(id0 + i));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(id1 + i));
+            __m128i matchA = _mm_setzero_si128();
+            __m128i matchB = _mm_setzero_si128();
+            for (size_t k = 0; k < idCount; ++k) {
+                const __m128i id = _mm_set1_epi32((int)ids[k]);
+                matchA = _mm_or_si128(matchA, _mm_cmpeq_epi32(a, id));
+                matchB = _mm_or_si128(matchB, _mm_cmpeq_epi32(b, id));
+            }
+            __m128 coverage = _mm_add_ps(_mm_and_ps(_mm_castsi128_ps(matchA), _mm_loadu_ps(coverage0 + i)),
+                                         _mm_and_ps(_mm_castsi128_ps(matchB), _mm_loadu_ps(coverage1 + i)));
+            coverage = _mm_min_ps(_mm_max_ps(coverage, zero), one);
+            __m128i value = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage, scale), half));
+            value = _mm_packs_epi32(value, value);
+            value = _mm_packus_epi16(value, value);
+            const int bytes = _mm_cvtsi128_si32(value);
+            std::memcpy(out + i, &bytes, 4);
+        }
+        maskRowScalar(id0 + i, id1 + i, coverage0 + i, coverage1 + i, count - i, ids, idCount, out + i);
+    }
+
+    /**
+     * Four pixels per vector in 16-bit lanes, the same arithmetic as tintPixel
+     */
+    void tintRowSse2(uint8_t* rgba, const uint8_t* mask, size_t count, const uint8_t color[3], const int* weights)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i colors = _mm_setr_epi16(color[0], color[1], color[2], 0, color[0], color[1], color[2], 0);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            if ((mask[i] | mask[i + 1] | mask[i + 2] | mask[i + 3]) == 0) {
+                continue;
+            }
+            const int w0 = weights[mask[i]], w1 = weights[mask[i + 1]];
+            const int w2 = weights[mask[i + 2]], w3 = weights[mask[i + 3]];
+            // alpha lanes get a zero weight
+            const __m128i weightLo = _mm_setr_epi16((short)w0, (short)w0, (short)w0, 0, (short)w1, (short)w1, (short)w1, 0);
+            const __m128i weightHi = _mm_setr_epi16((short)w2, (short)w2, (short)w2, 0, (short)w3, (short)w3, (short)w3, 0);
+
+            const __m128i pixels = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+            __m128i lo = _mm_unpacklo_epi8(pixels, zero);
+            __m128i hi = _mm_unpackhi_epi8(pixels, zero);
+            lo = _mm_add_epi16(lo, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(colors, lo), weightLo), 7));
+            hi = _mm_add_epi16(hi, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(colors, hi), weightHi), 7));
+            _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_packus_epi16(lo, hi));
+        }
+        for (; i < count; ++i) {
+            tintPixel(rgba + i * 4, color, weights[mask[i]]);
+        }
+    }
+
+#endif
+
+} // namespace
+
+uint32_t cryptomatteHash(const std::string& name)
+{
+    uint32_t hash = murmurHash3((const uint8_t*)name.data(), name.size(), 0);
+    // no denormals, infinities or NaNs
+    const uint32_t exponent = (hash >> 23) & 0xff;
+    if (exponent == 0 || exponent == 0xff) {
+        hash ^= 1u << 23;
+    }
+    return hash;
+}
+
+//--- CryptomatteManifest ---
+
+uint32_t CryptomatteManifest::add(const std::string& name)
+{
+    const uint32_t id = cryptomatteHash(name);
+    set(id, name);
+    return id;
+}
+
+void CryptomatteManifest::set(uint32_t id, const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mNames[id] = name;
+}
+
+bool CryptomatteManifest::find(uint32_t id, std::string& name) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mNames.find(id);
+    if (it == mNames.end()) {
+        return false;
+    }
+    name = it->second;
+    return true;
+}
+
+bool CryptomatteManifest::contains(uint32_t id) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNames.count(id) != 0;
+}
+
+size_t CryptomatteManifest::size() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNames.size();
+}
+
+void CryptomatteManifest::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mNames.clear();
+}
+
+size_t CryptomatteManifest::loadJson(const std::string& json)
+{
+    // reads the next JSON string starting at pos (which must be a quote)
+    auto readString = [&json](size_t& pos, std::string& out) {
+        out.clear();
+        for (++pos; pos < json.size(); ++pos) {
+            char c = json[pos];
+            if (c == '"') {
+                ++pos;
+                return true;
+            }
+            if (c == '\\' && pos + 1 < json.size()) {
+                c = json[++pos];
+                if (c == 'n') {
+                    c = '\n';
+                } else if (c == 't') {
+                    c = '\t';
+                }
+            }
+            out += c;
+        }
+        return false;
+    };
+
+    size_t entries = 0;
+    size_t pos = json.find('{');
+    std::string name, value;
+    while (pos != std::string::npos) {
+        pos = json.find('"', pos);
+        if (pos == std::string::npos || !readString(pos, name)) {
+            break;
+        }
+        pos = json.find_first_not_of(" \t\r\n", pos);
+        if (pos == std::string::npos || json[pos] != ':') {
+            break;
+        }
+        pos = json.find_first_not_of(" \t\r\n", pos + 1);
+        if (pos == std::string::npos || json[pos] != '"' || !readString(pos, value)) {
+            break;
+        }
+        char* end = nullptr;
+        const unsigned long id = std::strtoul(value.c_str(), &end, 16);
+        if (end && *end == '\0' && !value.empty()) {
+            set((uint32_t)id, name);
+            ++entries;
+        }
+    }
+    return entries;
+}
+
+//--- CryptomatteIdBuffer ---
+
+bool CryptomatteIdBuffer::decode(const float* rgba, size_t pitch, uint32_t width, uint32_t height)
+{
+    if (!rgba || width == 0 || height == 0) {
+        return false;
+    }
+    const size_t pixels = (size_t)width * height;
+    mWidth = width;
+    mHeight = height;
+    mId0.resize(pixels);
+    mId1.resize(pixels);
+    mCoverage0.resize(pixels);
+    mCoverage1.resize(pixels);
+    mDominant.resize(pixels);
+
+    PixelConvert::forEachRowRange(width, height, [&](uint32_t firstRow, uint32_t endRow) {
+        for (uint32_t y = firstRow; y < endRow; ++y) {
+            const float* row = (const float*)((const uint8_t*)rgba + (size_t)y * pitch);
+            const size_t offset = (size_t)y * width;
+            for (uint32_t x = 0; x < width; ++x) {
+                uint32_t id0, id1;
+                std::memcpy(&id0, row + x * 4, sizeof(id0));
+                std::memcpy(&id1, row + x * 4 + 2, sizeof(id1));
+                float coverage0 = row[x * 4 + 1];
+                float coverage1 = row[x * 4 + 3];
+                // empty ranks may hold garbage IDs
+                coverage0 = coverage0 > 0.0f ? coverage0 : 0.0f;
+                coverage1 = coverage1 > 0.0f ? coverage1 : 0.0f;
+                mId0[offset + x] = coverage0 > 0.0f ? id0 : 0;
+                mId1[offset + x] = coverage1 > 0.0f ? id1 : 0;
+                mCoverage0[offset + x] = coverage0;
+                mCoverage1[offset + x] = coverage1;
+                mDominant[offset + x] = coverage0 >= coverage1 ? mId0[offset + x] : mId1[offset + x];
+            }
+        }
+    });
+    return true;
+}
+
+float CryptomatteIdBuffer::coverageAt(uint32_t x, uint32_t y, uint32_t id) const
+{
+    if (x >= mWidth || y >= mHeight || id == 0) {
+        return 0.0f;
+    }
+    const size_t i = (size_t)y * mWidth + x;
+    return (mId0[i] == id ? mCoverage0[i] : 0.0f) + (mId1[i] == id ? mCoverage1[i] : 0.0f);
+}
+
+std::vector<uint32_t> CryptomatteIdBuffer::ids() const
+{
+    std::vector<uint32_t> result;
+    uint32_t last = 0;
+    for (const std::vector<uint32_t>* plane : { &mId0, &mId1 }) {
+        for (uint32_t id : *plane) {
+            // runs of the same ID are common, skip them before sorting
+            if (id != 0 && id != last) {
+                result.push_back(id);
+                last = id;
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+void CryptomatteIdBuffer::buildMask(const uint32_t* ids, size_t count, uint8_t* mask, size_t maskPitch) const
+{
+    if (!mask || empty()) {
+        return;
+    }
+    // 0 marks empty ranks, it never matches
+    std::vector<uint32_t> selected;
+    for (size_t k = 0; k < count; ++k) {
+        if (ids[k] != 0) {
+            selected.push_back(ids[k]);
+        }
+    }
+
+    auto row = maskRowScalar;
+#if defined(CRYPTOMATTE_X86)
+    if (PixelConvert::activeSimdLevel() != PixelConvert::SIMD_SCALAR) {
+        row = maskRowSse2;
+    }
+#endif
+    PixelConvert::forEachRowRange(mWidth, mHeight, [&](uint32_t firstRow, uint32_t endRow) {
+        for (uint32_t y = firstRow; y < endRow; ++y) {
+            const size_t offset = (size_t)y * mWidth;
+            row(mId0.data() + offset, mId1.data() + offset, mCoverage0.data() + offset, mCoverage1.data() + offset,
+                mWidth, selected.data(), selected.size(), mask + (size_t)y * maskPitch);
+        }
+    });
+}
+
+void tintRgba8(uint8_t* rgba,
+               size_t pitch,
+               const uint8_t* mask,
+               size_t maskPitch,
+               uint32_t width,
+               uint32_t height,
+               const uint8_t color[3],
+               float strength)
+{
+    if (!rgba || !mask || width == 0 || height == 0) {
+        return;
+    }
+    // weight in 1/128 steps per mask value, so the 16-bit products can't overflow
+    strength = strength > 0.0f ? (strength < 1.0f ? strength : 1.0f) : 0.0f;
+    const int scale = (int)(strength * 128.0f + 0.5f);
+    int weights[256];
+    for (int m = 0; m < 256; ++m) {
+        weights[m] = (m * scale + 127) / 255;
+    }
+
+    const bool simd = PixelConvert::activeSimdLevel() != PixelConvert::SIMD_SCALAR;
+    (void)simd;
+    PixelConvert::forEachRowRange(width, height, [&](uint32_t firstRow, uint32_t endRow) {
+        for (uint32_t y = firstRow; y < endRow; ++y) {
+            uint8_t* row = rgba + (size_t)y * pitch;
+            const uint8_t* maskRow = mask + (size_t)y * maskPitch;
+#if defined(CRYPTOMATTE_X86)
+            if (simd) {
+                tintRowSse2(row, maskRow, width, color, weights);
+                continue;
+            }
+#endif
+            for (uint32_t x = 0; x < width; ++x) {
+                if (maskRow[x]) {
+                    tintPixel(row + x * 4, color, weights[maskRow[x]]);
+                }
+            }
+        }
+    });
+}
+
+} // namespace SharedUtils
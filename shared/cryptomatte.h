@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SharedUtils {
+
+    /**
+     * Cryptomatte ID of a matte name: MurmurHash3 (x86, 32 bit, seed 0) of the name,
+     * with the exponent bits adjusted so the ID is a finite, normal float when stored
+     * in an image channel
+     */
+    uint32_t cryptomatteHash(const std::string& name);
+
+    /**
+     * Matte names by cryptomatte ID
+     */
+    class CryptomatteManifest
+    {
+    public:
+        /**
+         * Add a name, returns its ID
+         */
+        uint32_t add(const std::string& name);
+
+        /**
+         * Add a name with a known ID, e.g. one picked from the render
+         */
+        void set(uint32_t id, const std::string& name);
+
+        bool find(uint32_t id, std::string& name) const;
+        bool contains(uint32_t id) const;
+        size_t size() const;
+        void clear();
+
+        /**
+         * Read a manifest as stored in cryptomatte EXR metadata: a JSON object mapping
+         * names to IDs in hex ({"name": "3f800000", ...}). Returns the number of entries
+         * read, the existing entries are kept.
+         */
+        size_t loadJson(const std::string& json);
+
+    private:
+        mutable std::mutex mMutex;
+        std::map<uint32_t, std::string> mNames;
+    };
+
+    /**
+     * Decoded cryptomatte layer of a frame, for picking and highlighting without a
+     * round trip to the render server.
+     *
+     * A layer has two ranks per pixel, (id0, coverage0, id1, coverage1) in RGBA, with
+     * the IDs stored as the bits of the float channel. They are kept as separate ID and
+     * coverage planes, plus the ID with the most coverage of each pixel, so a pick is a
+     * single load.
+     */
+    class CryptomatteIdBuffer
+    {
+    public:
+        /**
+         * Decode a float RGBA cryptomatte layer. Pitch is in bytes.
+         */
+        bool decode(const float* rgba, size_t pitch, uint32_t width, uint32_t height);
+
+        uint32_t width() const { return mWidth; }
+        uint32_t height() const { return mHeight; }
+        bool empty() const { return mWidth == 0 || mHeight == 0; }
+
+        /**
+         * ID with the most coverage at a pixel, 0 for empty pixels and positions outside
+         */
+        uint32_t idAt(uint32_t x, uint32_t y) const
+        {
+            return x < mWidth && y < mHeight ? mDominant[(size_t)y * mWidth + x] : 0;
+        }
+
+        /**
+         * Coverage of one ID at a pixel
+         */
+        float coverageAt(uint32_t x, uint32_t y, uint32_t id) const;
+
+        /**
+         * Distinct IDs in the layer, sorted
+         */
+        std::vector<uint32_t> ids() const;
+
+        /**
+         * 8-bit mask of the coverage of the given IDs (anti-aliased edges), width x height
+         * with a pitch in bytes. Uses SSE2 for 4 pixels at a time unless
+         * PixelConvert::activeSimdLevel() is SIMD_SCALAR; rows are split across threads.
+         */
+        void buildMask(const uint32_t* ids, size_t count, uint8_t* mask, size_t maskPitch) const;
+        void buildMask(uint32_t id, uint8_t* mask, size_t maskPitch) const { buildMask(&id, 1, mask, maskPitch); }
+
+    private:
+        uint32_t mWidth = 0;
+        uint32_t mHeight = 0;
+        std::vector<uint32_t> mId0;
+        std::vector<uint32_t> mId1;
+        std::vector<float> mCoverage0;
+        std::vector<float> mCoverage1;
+        std::vector<uint32_t> mDominant;
+    };
+
+    /**
+     * Blend a color over 8-bit RGBA pixels weighted by a mask of the same size:
+     * rgb += (color - rgb) * mask / 255 * strength. Alpha is kept. Pitches are in bytes.
+     */
+    void tintRgba8(uint8_t* rgba,
+                   size_t pitch,
+                   const uint8_t* mask,
+                   size_t maskPitch,
+                   uint32_t width,
+                   uint32_t height,
+                   const uint8_t color[3],
+                   float strength);
+
+} // namespace SharedUtils
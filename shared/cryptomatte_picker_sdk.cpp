@@ -0,0 +1,278 @@
+#include "cryptomatte_picker_sdk.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+double msSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+}
+
+CryptomattePickerSdk::CryptomattePickerSdk(const Settings& settings)
+    : m_stop(false)
+    , m_settings(settings)
+    , m_enabled(false)
+    , m_changeLevel(0)
+    , m_requestedLevel(0)
+    , m_fetchPending(false)
+    , m_hasRequested(false)
+    , m_bufferLevel(0)
+    , m_generation(0)
+{
+    m_worker = std::thread(&CryptomattePickerSdk::workerLoop, this);
+}
+
+CryptomattePickerSdk::~CryptomattePickerSdk() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+void CryptomattePickerSdk::setSettings(const Settings& settings) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (settings.pass != m_settings.pass) {
+        // IDs of another pass, fetch again on the next frame
+        m_buffer.reset();
+        m_hasRequested = false;
+        m_requestedNames.clear();
+        m_lookups.clear();
+        ++m_generation;
+    }
+    m_settings = settings;
+}
+
+CryptomattePickerSdk::Settings CryptomattePickerSdk::settings() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+void CryptomattePickerSdk::setEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = enabled;
+    if (!enabled) {
+        m_buffer.reset();
+        m_hasRequested = false;
+        m_fetchPending = false;
+        m_lookups.clear();
+        m_requestedNames.clear();
+        ++m_generation;
+    }
+}
+
+bool CryptomattePickerSdk::enabled() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_enabled;
+}
+
+void CryptomattePickerSdk::onFrame(float samplesPerPixel, float maxSamplesPerPixel, uint64_t changeLevel) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_changeLevel = changeLevel;
+        if (!m_enabled || (m_hasRequested && m_requestedLevel == changeLevel)) {
+            return;
+        }
+        const float needed = maxSamplesPerPixel > 0.0f ? std::min(maxSamplesPerPixel, m_settings.minSamplesPerPixel)
+                                                        : m_settings.minSamplesPerPixel;
+        if (samplesPerPixel < needed) {
+            return;
+        }
+        m_requestedLevel = changeLevel;
+        m_hasRequested = true;
+        m_fetchPending = true;
+    }
+    m_wake.notify_all();
+}
+
+#ifdef DO_GRPC_SDK_ENABLED
+void CryptomattePickerSdk::onFrame(const Octane::ApiRenderImage& image) {
+    onFrame(image.mTonemappedSamplesPerPixel, image.mMaxSamplesPerPixel, image.mChangeLevel);
+}
+#endif
+
+void CryptomattePickerSdk::refresh() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_enabled) {
+            return;
+        }
+        m_requestedLevel = m_changeLevel;
+        m_hasRequested = true;
+        m_fetchPending = true;
+    }
+    m_wake.notify_all();
+}
+
+uint32_t CryptomattePickerSdk::idAt(double u, double v) {
+    bool wake = false;
+    uint32_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // a buffer of an earlier change level may not match the image any more
+        if (!m_buffer || m_bufferLevel != m_changeLevel || u < 0.0 || v < 0.0 || u >= 1.0 || v >= 1.0) {
+            return 0;
+        }
+        const uint32_t x = std::min((uint32_t)(u * m_buffer->width()), m_buffer->width() - 1);
+        const uint32_t y = std::min((uint32_t)(v * m_buffer->height()), m_buffer->height() - 1);
+        id = m_buffer->idAt(x, y);
+        ++m_stats.picks;
+
+        if (id != 0 && m_settings.lookupNames && !m_manifest.contains(id) && m_requestedNames.insert(id).second) {
+            m_lookups.push_back(NameLookup{ id, x, y });
+            wake = true;
+        }
+    }
+    if (wake) {
+        m_wake.notify_all();
+    }
+    return id;
+}
+
+bool CryptomattePickerSdk::matteName(uint32_t id, std::string& name) const {
+    return m_manifest.find(id, name);
+}
+
+std::shared_ptr<const SharedUtils::CryptomatteIdBuffer> CryptomattePickerSdk::buffer() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bufferLevel == m_changeLevel ? m_buffer : nullptr;
+}
+
+uint64_t CryptomattePickerSdk::generation() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generation;
+}
+
+void CryptomattePickerSdk::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return m_stop || m_fetchPending || !m_lookups.empty(); });
+        if (m_stop) {
+            return;
+        }
+        const int pass = m_settings.pass;
+        // the IDs first, names are only asked for IDs that are hovered
+        if (m_fetchPending) {
+            m_fetchPending = false;
+            const uint64_t level = m_requestedLevel;
+            lock.unlock();
+            fetch(pass, level);
+            lock.lock();
+        } else {
+            const NameLookup lookup = m_lookups.front();
+            m_lookups.pop_front();
+            lock.unlock();
+            lookupName(pass, lookup);
+            lock.lock();
+        }
+    }
+}
+
+void CryptomattePickerSdk::fetch(int pass, uint64_t changeLevel) {
+#ifdef DO_GRPC_SDK_ENABLED
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<Octane::ApiRenderImage> images;
+    bool ok = false;
+    try {
+        const Octane::RenderPassId passId = static_cast<Octane::RenderPassId>(pass);
+        // no false color, the raw IDs and coverage need float
+        ok = OctaneGRPC::ApiRenderEngineProxy::synchronousTonemap(&passId, 1,
+            Octane::TONEMAP_BUFFER_TYPE_HDR_FLOAT,
+            false,
+            Octane::NAMED_COLOR_SPACE_LINEAR_SRGB,
+            Octane::PREMULTIPLIED_ALPHA_TYPE_NONE,
+            images);
+    } catch (const std::exception& e) {
+        std::cout << "CryptomattePickerSdk: synchronousTonemap failed: " << e.what() << std::endl;
+    }
+    const double fetchMs = msSince(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    auto decoded = std::make_shared<SharedUtils::CryptomatteIdBuffer>();
+    bool valid = false;
+    if (ok && !images.empty() && images[0].mType == Octane::IMAGE_TYPE_HDR_RGBA && images[0].mBuffer) {
+        const Octane::ApiRenderImage& image = images[0];
+        valid = decoded->decode(static_cast<const float*>(image.mBuffer), static_cast<size_t>(image.mPitch) * 4 * sizeof(float),
+                                image.mSize.x, image.mSize.y);
+    }
+    for (const Octane::ApiRenderImage& image : images) {
+        delete[] static_cast<const char*>(image.mBuffer);
+    }
+    const size_t mattes = valid ? decoded->ids().size() : 0;
+    const double decodeMs = msSince(start);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!valid) {
+        ++m_stats.failedFetches;
+        return;
+    }
+    ++m_stats.fetches;
+    m_stats.lastFetchMs = fetchMs;
+    m_stats.lastDecodeMs = decodeMs;
+    m_stats.mattes = mattes;
+    if (!m_enabled || pass != m_settings.pass) {
+        return;
+    }
+    m_buffer = decoded;
+    m_bufferLevel = changeLevel;
+    // names that failed before are asked for again with the new buffer
+    m_requestedNames.clear();
+    ++m_generation;
+#else
+    (void)pass;
+    (void)changeLevel;
+#endif
+}
+
+void CryptomattePickerSdk::lookupName(int pass, const NameLookup& lookup) {
+#ifdef DO_GRPC_SDK_ENABLED
+    std::string name;
+    unsigned int bufferSize = 256;
+    bool ok = false;
+    try {
+        ok = OctaneGRPC::ApiRenderEngineProxy::pickCryptomatteMatte(lookup.x, lookup.y,
+            static_cast<Octane::RenderPassId>(pass), name, bufferSize);
+        if (!ok && bufferSize > 256) {
+            // the name didn't fit, bufferSize is the size needed now
+            ok = OctaneGRPC::ApiRenderEngineProxy::pickCryptomatteMatte(lookup.x, lookup.y,
+                static_cast<Octane::RenderPassId>(pass), name, bufferSize);
+        }
+    } catch (const std::exception& e) {
+        std::cout << "CryptomattePickerSdk: pickCryptomatteMatte failed: " << e.what() << std::endl;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.nameLookups;
+    }
+    if (ok && !name.empty()) {
+        m_manifest.set(lookup.id, name);
+    }
+#else
+    (void)pass;
+    (void)lookup;
+#endif
+}
+
+CryptomattePickerSdk::Stats CryptomattePickerSdk::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void CryptomattePickerSdk::printSummary(std::ostream& out) const {
+    const Stats s = stats();
+    out << "Cryptomatte picker: " << s.fetches << " fetches (" << s.failedFetches << " failed), "
+        << s.picks << " local picks, " << s.nameLookups << " name lookups, "
+        << m_manifest.size() << " names";
+    if (s.fetches > 0) {
+        out << ", last fetch " << std::fixed << std::setprecision(1) << s.lastFetchMs << " ms + decode "
+            << s.lastDecodeMs << " ms, " << s.mattes << " mattes";
+    }
+    out << std::endl;
+}
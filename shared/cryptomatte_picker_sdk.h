@@ -0,0 +1,138 @@
+#ifndef CRYPTOMATTE_PICKER_SDK_H
+#define CRYPTOMATTE_PICKER_SDK_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <thread>
+#include "cryptomatte.h"
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apirenderengineclient.h"
+#endif
+
+/**
+ * @brief Answers matte picks and hover queries from a local copy of a cryptomatte pass
+ *
+ * pickCryptomatteMatte() is a round trip per query, too slow to follow the mouse. The
+ * picker fetches the raw cryptomatte pass (HDR float, no false color) once the render
+ * reached enough samples, decodes it into a SharedUtils::CryptomatteIdBuffer and answers
+ * idAt() with a single load. Matte names are looked up once per ID with
+ * pickCryptomatteMatte() at a pixel the ID was picked at and kept in a manifest, so
+ * hovering never costs more than one RPC per new matte.
+ *
+ * Coverage settles long before the beauty pass converges, so the pass is fetched at
+ * minSamplesPerPixel (or max samples if lower), once per change level. Fetches and name
+ * lookups run on a worker thread, onFrame() only compares a few numbers.
+ */
+class CryptomattePickerSdk {
+public:
+    struct Settings {
+        int pass = 2003;                        // Octane::RENDER_PASS_CRYPTOMATTE_OBJECT_NODE_NAME
+        float minSamplesPerPixel = 32.0f;       // fetch once the frame has this many samples
+        bool lookupNames = true;                // pickCryptomatteMatte() once per new ID
+    };
+
+    struct Stats {
+        uint64_t fetches = 0;
+        uint64_t failedFetches = 0;
+        uint64_t picks = 0;                     // answered locally
+        uint64_t nameLookups = 0;               // RPCs
+        double lastFetchMs = 0.0;               // tonemap and transfer
+        double lastDecodeMs = 0.0;
+        size_t mattes = 0;                      // distinct IDs in the current buffer
+    };
+
+    CryptomattePickerSdk() : CryptomattePickerSdk(Settings()) {}
+    explicit CryptomattePickerSdk(const Settings& settings);
+    ~CryptomattePickerSdk();
+
+    void setSettings(const Settings& settings);
+    Settings settings() const;
+
+    /**
+     * @brief Off by default. Disabling drops the buffer and stops fetching.
+     */
+    void setEnabled(bool enabled);
+    bool enabled() const;
+
+    /**
+     * @brief A frame arrived, schedules a fetch when it is far enough along
+     */
+    void onFrame(float samplesPerPixel, float maxSamplesPerPixel, uint64_t changeLevel);
+
+#ifdef DO_GRPC_SDK_ENABLED
+    void onFrame(const Octane::ApiRenderImage& image);
+#endif
+
+    /**
+     * @brief Fetch the pass again without waiting for the next frame
+     */
+    void refresh();
+
+    /**
+     * @brief ID at a position in normalized image coordinates (0,0 top left), 0 if there
+     * is no matte or no buffer for the current change level
+     */
+    uint32_t idAt(double u, double v);
+
+    /**
+     * @brief Name of a matte, false while the lookup is still pending
+     */
+    bool matteName(uint32_t id, std::string& name) const;
+
+    /**
+     * @brief Decoded buffer of the current change level, null while there is none. It is
+     * replaced, never modified, so it can be used after the next fetch.
+     */
+    std::shared_ptr<const SharedUtils::CryptomatteIdBuffer> buffer() const;
+
+    /**
+     * @brief Incremented every time the buffer is replaced or dropped
+     */
+    uint64_t generation() const;
+
+    SharedUtils::CryptomatteManifest& manifest() { return m_manifest; }
+
+    Stats stats() const;
+    void printSummary(std::ostream& out) const;
+
+private:
+    struct NameLookup {
+        uint32_t id;
+        uint32_t x;
+        uint32_t y;
+    };
+
+    void workerLoop();
+    void fetch(int pass, uint64_t changeLevel);
+    void lookupName(int pass, const NameLookup& lookup);
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::thread m_worker;
+    bool m_stop;
+
+    Settings m_settings;
+    bool m_enabled;
+    uint64_t m_changeLevel;                     // of the latest frame
+    uint64_t m_requestedLevel;                  // fetch pending or done for this level
+    bool m_fetchPending;
+    bool m_hasRequested;
+    std::deque<NameLookup> m_lookups;
+    std::set<uint32_t> m_requestedNames;
+
+    std::shared_ptr<const SharedUtils::CryptomatteIdBuffer> m_buffer;
+    uint64_t m_bufferLevel;
+    uint64_t m_generation;
+    Stats m_stats;
+
+    SharedUtils::CryptomatteManifest m_manifest;
+};
+
+#endif // CRYPTOMATTE_PICKER_SDK_H
@@ -0,0 +1,541 @@
+#include "display_lut.h"
+#include "pixel_convert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define DISPLAY_LUT_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace SharedUtils {
+
+namespace {
+
+    const float kMiddleGray = 0.18f;
+
+    // keeps the tone curves finite for huge and infinite input
+    const float kMaxInput = 65504.0f;
+
+    inline float clamp01(float v)
+    {
+        // written so that NaN ends up as 0
+        v = v > 0.0f ? v : 0.0f;
+        return v < 1.0f ? v : 1.0f;
+    }
+
+    inline uint8_t unitToU8(float v)
+    {
+        return (uint8_t)(clamp01(v) * 255.0f + 0.5f);
+    }
+
+    float srgbEncode(float v)
+    {
+        v = clamp01(v);
+        return v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+    }
+
+    const DisplayLut3D& defaultLut()
+    {
+        static const std::shared_ptr<DisplayLut3D> lut = DisplayLut3D::srgbDisplay(33);
+        return *lut;
+    }
+
+    /**
+     * Trilinear lookup at LUT coordinates in [0, 1]
+     */
+    void lookup(const DisplayLut3D& lut, const float coord[3], float rgbOut[3])
+    {
+        const unsigned n = lut.size();
+        const float* data = lut.data().data();
+
+        unsigned i0[3];
+        float f[3];
+        for (int c = 0; c < 3; ++c) {
+            float p = coord[c] * (float)(n - 1);
+            unsigned i = (unsigned)p;
+            i = std::min(i, n - 2);
+            i0[c] = i;
+            f[c] = p - (float)i;
+        }
+
+        const size_t strideG = n;
+        const size_t strideB = (size_t)n * n;
+        const float* base = data + ((size_t)i0[2] * strideB + (size_t)i0[1] * strideG + i0[0]) * 3;
+
+        for (int c = 0; c < 3; ++c) {
+            float c000 = base[c];
+            float c100 = base[3 + c];
+            float c010 = base[strideG * 3 + c];
+            float c110 = base[strideG * 3 + 3 + c];
+            float c001 = base[strideB * 3 + c];
+            float c101 = base[strideB * 3 + 3 + c];
+            float c011 = base[(strideB + strideG) * 3 + c];
+            float c111 = base[(strideB + strideG) * 3 + 3 + c];
+
+            float c00 = c000 + (c100 - c000) * f[0];
+            float c10 = c010 + (c110 - c010) * f[0];
+            float c01 = c001 + (c101 - c001) * f[0];
+            float c11 = c011 + (c111 - c011) * f[0];
+            float c0 = c00 + (c10 - c00) * f[1];
+            float c1 = c01 + (c11 - c01) * f[1];
+            rgbOut[c] = c0 + (c1 - c0) * f[2];
+        }
+    }
+
+    void transformRowScalar(const float* src, uint8_t* dst, size_t count, float scale, ToneCurve curve, const DisplayLut3D& lut)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            const float* px = src + i * 4;
+            float coord[3];
+            for (int c = 0; c < 3; ++c) {
+                coord[c] = lut.shape(applyToneCurve(curve, px[c] * scale));
+            }
+            float rgb[3];
+            lookup(lut, coord, rgb);
+            dst[i * 4 + 0] = unitToU8(rgb[0]);
+            dst[i * 4 + 1] = unitToU8(rgb[1]);
+            dst[i * 4 + 2] = unitToU8(rgb[2]);
+            dst[i * 4 + 3] = unitToU8(px[3]);
+        }
+    }
+
+#if defined(DISPLAY_LUT_X86)
+
+    /**
+     * log2 for positive input, max error about 1e-5 which is far below a LUT cell
+     */
+    inline __m128 log2_sse2(__m128 x)
+    {
+        const __m128i bits = _mm_castps_si128(x);
+        const __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+        const __m128 one = _mm_set1_ps(1.0f);
+        // mantissa in [1, 2)
+        const __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_castps_si128(one)));
+
+        // ln(m) = 2 * atanh(t) with t = (m - 1) / (m + 1) in [0, 1/3)
+        const __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+        const __m128 t2 = _mm_mul_ps(t, t);
+        __m128 p = _mm_set1_ps(1.0f / 9.0f);
+        p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 7.0f));
+        p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 5.0f));
+        p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 3.0f));
+        p = _mm_add_ps(_mm_mul_ps(p, t2), one);
+        const __m128 lnm = _mm_mul_ps(_mm_mul_ps(p, t), _mm_set1_ps(2.0f));
+        return _mm_add_ps(e, _mm_mul_ps(lnm, _mm_set1_ps(1.4426950408889634f)));
+    }
+
+    inline __m128 toneCurve_sse2(__m128 x, ToneCurve curve)
+    {
+        // NaN and negative input become 0
+        x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(kMaxInput));
+        switch (curve) {
+        case TONE_CURVE_REINHARD:
+            return _mm_div_ps(x, _mm_add_ps(x, _mm_set1_ps(1.0f)));
+        case TONE_CURVE_ACES_FILMIC: {
+            __m128 num = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+            __m128 den = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+            return _mm_min_ps(_mm_div_ps(num, den), _mm_set1_ps(1.0f));
+        }
+        default:
+            return x;
+        }
+    }
+
+    inline __m128 lerp_sse2(__m128 a, __m128 b, __m128 f)
+    {
+        return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), f));
+    }
+
+    /**
+     * Four pixels at a time: exposure, curve, shaper and the cell index are computed
+     * on the transposed channels, the corners are then fetched per pixel as RGB
+     * vectors and interpolated with all channels in one register.
+     */
+    void transformRowSse2(const float* src, uint8_t* dst, size_t count, float scale, ToneCurve curve, const DisplayLut3D& lut)
+    {
+        const unsigned n = lut.size();
+        const float* data = lut.data().data();
+        const size_t strideG = (size_t)n * 3;
+        const size_t strideB = (size_t)n * n * 3;
+
+        const __m128 scaleV = _mm_set1_ps(scale);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 cells = _mm_set1_ps((float)(n - 1));
+        const __m128i maxCell = _mm_set1_epi32((int)n - 2);
+        const bool log2Shaper = lut.shaper() == DisplayLut3D::SHAPER_LOG2;
+        const float range = lut.domainMax() - lut.domainMin();
+        const __m128 domainMin = _mm_set1_ps(lut.domainMin());
+        const __m128 invRange = _mm_set1_ps(range > 0.0f ? 1.0f / range : 0.0f);
+        const __m128 invGray = _mm_set1_ps(1.0f / kMiddleGray);
+        const __m128 tiny = _mm_set1_ps(1e-10f);
+        const __m128 u8Scale = _mm_set1_ps(255.0f);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 c[4] = { _mm_loadu_ps(src + i * 4),
+                            _mm_loadu_ps(src + i * 4 + 4),
+                            _mm_loadu_ps(src + i * 4 + 8),
+                            _mm_loadu_ps(src + i * 4 + 12) };
+            // c[0..3] become r, g, b, a of the four pixels
+            _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+
+            alignas(16) int32_t cell[3][4];
+            alignas(16) float frac[3][4];
+            for (int ch = 0; ch < 3; ++ch) {
+                __m128 v = toneCurve_sse2(_mm_mul_ps(c[ch], scaleV), curve);
+                if (log2Shaper) {
+                    v = log2_sse2(_mm_max_ps(_mm_mul_ps(v, invGray), tiny));
+                }
+                v = _mm_mul_ps(_mm_sub_ps(v, domainMin), invRange);
+                v = _mm_min_ps(_mm_max_ps(v, zero), one);
+                v = _mm_mul_ps(v, cells);
+
+                __m128i idx = _mm_cvttps_epi32(v);
+                // min for 32 bit ints needs SSE4.1
+                __m128i over = _mm_cmpgt_epi32(idx, maxCell);
+                idx = _mm_or_si128(_mm_and_si128(over, maxCell), _mm_andnot_si128(over, idx));
+                _mm_store_si128((__m128i*)cell[ch], idx);
+                _mm_store_ps(frac[ch], _mm_sub_ps(v, _mm_cvtepi32_ps(idx)));
+            }
+
+            __m128 rgb[4];
+            for (int p = 0; p < 4; ++p) {
+                const float* base = data + (size_t)cell[2][p] * strideB + (size_t)cell[1][p] * strideG + (size_t)cell[0][p] * 3;
+                const __m128 fr = _mm_set1_ps(frac[0][p]);
+                const __m128 fg = _mm_set1_ps(frac[1][p]);
+                const __m128 fb = _mm_set1_ps(frac[2][p]);
+                // the fourth lane reads the next entry, or the padding, and is ignored
+                __m128 c00 = lerp_sse2(_mm_loadu_ps(base), _mm_loadu_ps(base + 3), fr);
+                __m128 c10 = lerp_sse2(_mm_loadu_ps(base + strideG), _mm_loadu_ps(base + strideG + 3), fr);
+                __m128 c01 = lerp_sse2(_mm_loadu_ps(base + strideB), _mm_loadu_ps(base + strideB + 3), fr);
+                __m128 c11 = lerp_sse2(_mm_loadu_ps(base + strideB + strideG), _mm_loadu_ps(base + strideB + strideG + 3), fr);
+                rgb[p] = lerp_sse2(lerp_sse2(c00, c10, fg), lerp_sse2(c01, c11, fg), fb);
+            }
+
+            // back to r, g, b, a per channel to put the source alpha in place
+            _MM_TRANSPOSE4_PS(rgb[0], rgb[1], rgb[2], rgb[3]);
+            rgb[3] = c[3];
+
+            __m128i q[4];
+            for (int ch = 0; ch < 4; ++ch) {
+                __m128 v = _mm_min_ps(_mm_max_ps(rgb[ch], zero), one);
+                q[ch] = _mm_cvtps_epi32(_mm_mul_ps(v, u8Scale));
+            }
+            // r0 r1 r2 r3 g0 .. | b0 .. a0 .. -> interleave to r0 g0 b0 a0 ..
+            __m128i rg = _mm_packs_epi32(q[0], q[1]);
+            __m128i ba = _mm_packs_epi32(q[2], q[3]);
+            __m128i rb = _mm_unpacklo_epi16(rg, ba);    // r0 b0 r1 b1 r2 b2 r3 b3
+            __m128i ga = _mm_unpackhi_epi16(rg, ba);    // g0 a0 g1 a1 ...
+            __m128i lo = _mm_unpacklo_epi16(rb, ga);    // r0 g0 b0 a0 r1 g1 b1 a1
+            __m128i hi = _mm_unpackhi_epi16(rb, ga);
+            _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_packus_epi16(lo, hi));
+        }
+
+        transformRowScalar(src + i * 4, dst + i * 4, count - i, scale, curve, lut);
+    }
+
+#endif
+
+} // namespace
+
+const char* toneCurveName(ToneCurve curve)
+{
+    switch (curve) {
+    case TONE_CURVE_NONE:           return "none";
+    case TONE_CURVE_REINHARD:       return "Reinhard";
+    case TONE_CURVE_ACES_FILMIC:    return "ACES filmic";
+    }
+    return "unknown";
+}
+
+float DisplaySettings::exposureScale() const
+{
+    return std::exp2(exposure);
+}
+
+float applyToneCurve(ToneCurve curve, float x)
+{
+    x = x > 0.0f ? x : 0.0f;
+    x = x < kMaxInput ? x : kMaxInput;
+    switch (curve) {
+    case TONE_CURVE_REINHARD:
+        return x / (1.0f + x);
+    case TONE_CURVE_ACES_FILMIC:
+        return std::min((x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f), 1.0f);
+    default:
+        return x;
+    }
+}
+
+//--- DisplayLut3D ---
+
+std::shared_ptr<DisplayLut3D> DisplayLut3D::bake(unsigned size, Shaper shaper, float domainMin, float domainMax, const TransformFn& transform)
+{
+    if (size < 2 || !(domainMax > domainMin) || !transform) {
+        return nullptr;
+    }
+
+    auto lut = std::make_shared<DisplayLut3D>();
+    lut->mSize = size;
+    lut->mShaper = shaper;
+    lut->mDomainMin = domainMin;
+    lut->mDomainMax = domainMax;
+
+    const size_t entries = (size_t)size * size * size;
+    std::vector<float> input(entries * 3);
+    std::vector<float> axis(size);
+    for (unsigned i = 0; i < size; ++i) {
+        float t = domainMin + (domainMax - domainMin) * (float)i / (float)(size - 1);
+        axis[i] = shaper == SHAPER_LOG2 ? kMiddleGray * std::exp2(t) : t;
+    }
+    size_t k = 0;
+    for (unsigned b = 0; b < size; ++b) {
+        for (unsigned g = 0; g < size; ++g) {
+            for (unsigned r = 0; r < size; ++r) {
+                input[k++] = axis[r];
+                input[k++] = axis[g];
+                input[k++] = axis[b];
+            }
+        }
+    }
+
+    lut->mData.assign(entries * 3 + 1, 0.0f);
+    transform(input.data(), lut->mData.data(), entries);
+    return lut;
+}
+
+std::shared_ptr<DisplayLut3D> DisplayLut3D::srgbDisplay(unsigned size)
+{
+    // a linear shaper loses the shadows, the sRGB curve is steep near black. In log2
+    // space it is smooth; the top of the domain is linear 1.0.
+    auto lut = bake(size, SHAPER_LOG2, -14.0f, std::log2(1.0f / kMiddleGray), [](const float* in, float* out, size_t count) {
+        for (size_t i = 0; i < count * 3; ++i) {
+            out[i] = srgbEncode(in[i]);
+        }
+    });
+    if (lut) {
+        lut->mTitle = "sRGB display";
+    }
+    return lut;
+}
+
+std::shared_ptr<DisplayLut3D> DisplayLut3D::loadCube(const std::string& path, std::string* error)
+{
+    auto fail = [error](const std::string& message) -> std::shared_ptr<DisplayLut3D> {
+        if (error) {
+            *error = message;
+        }
+        return nullptr;
+    };
+
+    std::ifstream file(path);
+    if (!file) {
+        return fail("cannot open " + path);
+    }
+
+    auto lut = std::make_shared<DisplayLut3D>();
+    size_t expected = 0;
+    size_t values = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+        std::istringstream in(line.substr(start));
+        if (std::isdigit((unsigned char)line[start]) || line[start] == '-' || line[start] == '.') {
+            if (expected == 0) {
+                return fail("LUT_3D_SIZE missing before the data");
+            }
+            float r, g, b;
+            if (!(in >> r >> g >> b)) {
+                return fail("bad data line: " + line);
+            }
+            if (values >= expected) {
+                return fail("more entries than LUT_3D_SIZE");
+            }
+            lut->mData[values * 3 + 0] = r;
+            lut->mData[values * 3 + 1] = g;
+            lut->mData[values * 3 + 2] = b;
+            ++values;
+            continue;
+        }
+
+        std::string keyword;
+        in >> keyword;
+        if (keyword == "TITLE") {
+            std::string title;
+            std::getline(in, title);
+            size_t first = title.find('"');
+            size_t last = title.rfind('"');
+            lut->mTitle = first != std::string::npos && last > first ? title.substr(first + 1, last - first - 1) : title;
+        } else if (keyword == "LUT_3D_SIZE") {
+            unsigned size = 0;
+            if (!(in >> size) || size < 2 || size > 256) {
+                return fail("bad LUT_3D_SIZE");
+            }
+            lut->mSize = size;
+            expected = (size_t)size * size * size;
+            lut->mData.assign(expected * 3 + 1, 0.0f);
+        } else if (keyword == "DOMAIN_MIN" || keyword == "DOMAIN_MAX") {
+            float r, g, b;
+            if (!(in >> r >> g >> b)) {
+                return fail("bad " + keyword);
+            }
+            if (r != g || r != b) {
+                return fail("per channel domains are not supported");
+            }
+            (keyword == "DOMAIN_MIN" ? lut->mDomainMin : lut->mDomainMax) = r;
+        } else if (keyword == "LUT_1D_SIZE") {
+            return fail("1D LUTs are not supported");
+        }
+        // other keywords (LUT_3D_INPUT_RANGE of older writers etc.) are ignored
+    }
+
+    if (expected == 0 || values != expected) {
+        return fail("expected " + std::to_string(expected) + " entries, found " + std::to_string(values));
+    }
+    if (!(lut->mDomainMax > lut->mDomainMin)) {
+        return fail("empty domain");
+    }
+    return lut;
+}
+
+bool DisplayLut3D::saveCube(const std::string& path) const
+{
+    if (mSize < 2 || mShaper != SHAPER_LINEAR) {
+        return false;
+    }
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    if (!mTitle.empty()) {
+        std::fprintf(file, "TITLE \"%s\"\n", mTitle.c_str());
+    }
+    std::fprintf(file, "LUT_3D_SIZE %u\n", mSize);
+    std::fprintf(file, "DOMAIN_MIN %g %g %g\n", mDomainMin, mDomainMin, mDomainMin);
+    std::fprintf(file, "DOMAIN_MAX %g %g %g\n", mDomainMax, mDomainMax, mDomainMax);
+    const size_t entries = (size_t)mSize * mSize * mSize;
+    for (size_t i = 0; i < entries; ++i) {
+        std::fprintf(file, "%.6f %.6f %.6f\n", mData[i * 3], mData[i * 3 + 1], mData[i * 3 + 2]);
+    }
+    return std::fclose(file) == 0;
+}
+
+float DisplayLut3D::shape(float value) const
+{
+    if (mShaper == SHAPER_LOG2) {
+        value = std::log2(std::max(value / kMiddleGray, 1e-10f));
+    }
+    return clamp01((value - mDomainMin) / (mDomainMax - mDomainMin));
+}
+
+void DisplayLut3D::apply(const float rgbIn[3], float rgbOut[3]) const
+{
+    float coord[3] = { shape(rgbIn[0]), shape(rgbIn[1]), shape(rgbIn[2]) };
+    lookup(*this, coord, rgbOut);
+}
+
+//--- DisplayLutCache ---
+
+std::shared_ptr<const DisplayLut3D> DisplayLutCache::find(const std::string& key) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mLuts.find(key);
+    return it != mLuts.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<const DisplayLut3D> DisplayLutCache::getOrBake(const std::string& key, const BakeFn& bake)
+{
+    if (auto lut = find(key)) {
+        return lut;
+    }
+
+    // bake outside the lock, it may fetch files or make calls
+    std::shared_ptr<const DisplayLut3D> baked = bake ? bake() : nullptr;
+    if (!baked) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    // another thread may have baked the same key in the meantime, keep the first one
+    auto inserted = mLuts.emplace(key, baked);
+    return inserted.first->second;
+}
+
+void DisplayLutCache::erasePrefix(const std::string& prefix)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mLuts.lower_bound(prefix); it != mLuts.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+        it = mLuts.erase(it);
+    }
+}
+
+void DisplayLutCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLuts.clear();
+}
+
+size_t DisplayLutCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mLuts.size();
+}
+
+//--- Transform ---
+
+void applyDisplayTransform(const float rgbIn[3], float rgbOut[3], const DisplaySettings& settings, const DisplayLut3D* lut)
+{
+    const DisplayLut3D& table = lut && lut->size() >= 2 ? *lut : defaultLut();
+    const float scale = settings.exposureScale();
+    float coord[3];
+    for (int c = 0; c < 3; ++c) {
+        coord[c] = table.shape(applyToneCurve(settings.toneCurve, rgbIn[c] * scale));
+    }
+    lookup(table, coord, rgbOut);
+    for (int c = 0; c < 3; ++c) {
+        rgbOut[c] = clamp01(rgbOut[c]);
+    }
+}
+
+void applyDisplayTransform(const float* src,
+                           size_t srcPitch,
+                           uint32_t width,
+                           uint32_t height,
+                           uint8_t* dst,
+                           size_t dstPitch,
+                           const DisplaySettings& settings,
+                           const DisplayLut3D* lut)
+{
+    if (!src || !dst || width == 0 || height == 0) {
+        return;
+    }
+
+    const DisplayLut3D& table = lut && lut->size() >= 2 ? *lut : defaultLut();
+    const float scale = settings.exposureScale();
+    const ToneCurve curve = settings.toneCurve;
+
+    auto row = transformRowScalar;
+#if defined(DISPLAY_LUT_X86)
+    if (PixelConvert::activeSimdLevel() != PixelConvert::SIMD_SCALAR) {
+        row = transformRowSse2;
+    }
+#endif
+
+    PixelConvert::forEachRowRange(width, height, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; ++y) {
+            const float* srcRow = (const float*)((const uint8_t*)src + (size_t)y * srcPitch);
+            row(srcRow, dst + (size_t)y * dstPitch, width, scale, curve, table);
+        }
+    });
+}
+
+} // namespace SharedUtils
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SharedUtils {
+
+    /**
+     * Tone curve applied after the exposure and before the display LUT
+     */
+    enum ToneCurve
+    {
+        TONE_CURVE_NONE = 0,        // the LUT does all the tone mapping, or values are clipped
+        TONE_CURVE_REINHARD,        // x / (1 + x)
+        TONE_CURVE_ACES_FILMIC,     // Narkowicz fit of the ACES RRT + ODT
+    };
+
+    const char* toneCurveName(ToneCurve curve);
+
+    /**
+     * Client side display settings. Changing them costs no round trip, the frame is
+     * only transformed again.
+     */
+    struct DisplaySettings
+    {
+        float exposure = 0.0f;              // in stops
+        ToneCurve toneCurve = TONE_CURVE_NONE;
+
+        /**
+         * Linear multiplier for the exposure
+         */
+        float exposureScale() const;
+    };
+
+    /**
+     * 3D display LUT mapping linear RGB to display encoded RGB in [0, 1].
+     *
+     * The input is mapped into the LUT through a shaper: linear for LUTs that take
+     * display referred input in [domainMin, domainMax], log2 for LUTs that cover a
+     * scene referred range of stops around middle gray. The LUT is evaluated with
+     * trilinear interpolation on the CPU, which is what the GL texture filter does, so
+     * both display paths give the same result.
+     */
+    class DisplayLut3D {
+    public:
+        enum Shaper
+        {
+            SHAPER_LINEAR = 0,
+            SHAPER_LOG2,
+        };
+
+        /**
+         * Maps count RGB triplets, used to bake a LUT
+         */
+        typedef std::function<void(const float* rgbIn, float* rgbOut, size_t count)> TransformFn;
+
+        DisplayLut3D() = default;
+
+        /**
+         * Bake a LUT of size^3 entries by evaluating transform at the grid points.
+         * For SHAPER_LOG2, domainMin and domainMax are stops relative to 0.18.
+         */
+        static std::shared_ptr<DisplayLut3D> bake(unsigned size,
+                                                  Shaper shaper,
+                                                  float domainMin,
+                                                  float domainMax,
+                                                  const TransformFn& transform);
+
+        /**
+         * sRGB display encoding of linear [0, 1] input, through a log2 shaper so the
+         * shadows keep their precision
+         */
+        static std::shared_ptr<DisplayLut3D> srgbDisplay(unsigned size = 33);
+
+        /**
+         * Load a .cube LUT (Resolve / Adobe format, as written by ociobakelut).
+         * Only 3D LUTs are supported. Returns null and sets error on failure.
+         */
+        static std::shared_ptr<DisplayLut3D> loadCube(const std::string& path, std::string* error = nullptr);
+
+        /**
+         * Write the LUT as .cube. A log2 shaper can't be expressed in the format and
+         * fails.
+         */
+        bool saveCube(const std::string& path) const;
+
+        unsigned size() const { return mSize; }
+        Shaper shaper() const { return mShaper; }
+        float domainMin() const { return mDomainMin; }
+        float domainMax() const { return mDomainMax; }
+
+        /**
+         * RGB entries, red changing fastest (the .cube order and the layout of a
+         * GL_TEXTURE_3D with width = red)
+         */
+        const std::vector<float>& data() const { return mData; }
+
+        const std::string& title() const { return mTitle; }
+        void setTitle(const std::string& title) { mTitle = title; }
+
+        /**
+         * Map a linear value to a LUT coordinate in [0, 1]
+         */
+        float shape(float value) const;
+
+        /**
+         * Evaluate the LUT for one linear RGB value
+         */
+        void apply(const float rgbIn[3], float rgbOut[3]) const;
+
+    private:
+        unsigned mSize = 0;
+        Shaper mShaper = SHAPER_LINEAR;
+        float mDomainMin = 0.0f;
+        float mDomainMax = 1.0f;
+        // padded by one float so a corner can be loaded as 4 floats
+        std::vector<float> mData;
+        std::string mTitle;
+    };
+
+    /**
+     * LUTs by key, e.g. "config|display|view|look". A LUT is baked once per key and
+     * shared, so switching back to a view or changing the exposure needs no bake.
+     */
+    class DisplayLutCache {
+    public:
+        typedef std::function<std::shared_ptr<DisplayLut3D>()> BakeFn;
+
+        /**
+         * The cached LUT, or null
+         */
+        std::shared_ptr<const DisplayLut3D> find(const std::string& key) const;
+
+        /**
+         * The cached LUT, baking and storing it on the first request. A failed bake
+         * (null) is not cached.
+         */
+        std::shared_ptr<const DisplayLut3D> getOrBake(const std::string& key, const BakeFn& bake);
+
+        /**
+         * Drop all LUTs whose key starts with prefix, e.g. after a config reload
+         */
+        void erasePrefix(const std::string& prefix);
+
+        void clear();
+        size_t size() const;
+
+    private:
+        mutable std::mutex mMutex;
+        std::map<std::string, std::shared_ptr<const DisplayLut3D>> mLuts;
+    };
+
+    /**
+     * Transform float RGBA pixels to 8-bit RGBA for display: exposure, tone curve and
+     * LUT. Without a LUT the sRGB display encoding is used. Alpha is copied clamped.
+     * Pitches are in bytes. Rows are split across threads like PixelConvert, and the
+     * SIMD path follows PixelConvert::activeSimdLevel().
+     */
+    void applyDisplayTransform(const float* src,
+                               size_t srcPitch,
+                               uint32_t width,
+                               uint32_t height,
+                               uint8_t* dst,
+                               size_t dstPitch,
+                               const DisplaySettings& settings,
+                               const DisplayLut3D* lut);
+
+    /**
+     * Single pixel version of the transform, RGB only, result in [0, 1]
+     */
+    void applyDisplayTransform(const float rgbIn[3],
+                               float rgbOut[3],
+                               const DisplaySettings& settings,
+                               const DisplayLut3D* lut);
+
+    /**
+     * The tone curve for one value
+     */
+    float applyToneCurve(ToneCurve curve, float value);
+
+} // namespace SharedUtils
@@ -0,0 +1,205 @@
+#include "dynamic_resolution_sdk.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+unsigned levelFromSubSampling(unsigned subSampling) {
+    return subSampling >= 4 ? 2 : (subSampling >= 2 ? 1 : 0);
+}
+
+}
+
+DynamicResolutionSdk::DynamicResolutionSdk(const Settings& settings)
+    : m_settings(settings)
+    , m_enabled(true)
+    , m_hasInteraction(false)
+    , m_pending(false)
+    , m_interacting(false)
+    , m_latencyMs(0.0)
+    , m_latencyLevel(0)
+    , m_hasLatency(false)
+    , m_samplesPerSecond(0.0)
+    , m_fullPixels(0)
+    , m_level(0)
+    , m_motionLevel(0)
+    , m_levelChanges(0)
+    , m_latencySamples(0)
+    , m_maxLatencyMs(0.0)
+{
+}
+
+void DynamicResolutionSdk::setSettings(const Settings& settings) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_settings = settings;
+    m_motionLevel = std::min(m_motionLevel, settings.maxLevel);
+}
+
+DynamicResolutionSdk::Settings DynamicResolutionSdk::settings() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+void DynamicResolutionSdk::setEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = enabled;
+}
+
+bool DynamicResolutionSdk::enabled() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_enabled;
+}
+
+void DynamicResolutionSdk::notifyInteraction() {
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lastInteraction = now;
+    m_hasInteraction = true;
+    if (!m_pending) {
+        m_pendingSince = now;
+        m_pending = true;
+    }
+}
+
+void DynamicResolutionSdk::onFrame(uint32_t width, uint32_t height, float samplesPerSecond, unsigned subSampling) {
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fullPixels = std::max(m_fullPixels, (uint64_t)width * height);
+    if (samplesPerSecond > 0.0f) {
+        m_samplesPerSecond = samplesPerSecond;
+    }
+    if (!m_pending) {
+        return;
+    }
+    m_pending = false;
+
+    // the first frame after a camera change, latencies of another level start over
+    const double latency = elapsedMs(m_pendingSince, now);
+    const unsigned level = levelFromSubSampling(subSampling);
+    if (!m_hasLatency || level != m_latencyLevel) {
+        m_latencyMs = latency;
+    } else {
+        m_latencyMs += m_settings.smoothing * (latency - m_latencyMs);
+    }
+    m_latencyLevel = level;
+    m_hasLatency = true;
+    m_maxLatencyMs = std::max(m_maxLatencyMs, latency);
+    ++m_latencySamples;
+}
+
+#ifdef DO_GRPC_SDK_ENABLED
+void DynamicResolutionSdk::onFrame(const Octane::ApiRenderImage& image) {
+    onFrame(image.mSize.x, image.mSize.y, image.mSamplesPerSecond, (unsigned)image.mSubSampling);
+}
+#endif
+
+double DynamicResolutionSdk::predictLatencyMs(unsigned level) const {
+    // latency = overhead + rendered pixels / samples per second, the overhead (network,
+    // restart, tonemapping) stays and the render part scales with the pixel count
+    const double scale = (double)(factor(m_latencyLevel) * factor(m_latencyLevel)) / (double)(factor(level) * factor(level));
+    if (m_samplesPerSecond <= 0.0 || m_fullPixels == 0) {
+        return m_latencyMs * scale;
+    }
+    const double renderMs = std::min(m_latencyMs,
+        1000.0 * (double)m_fullPixels / (double)(factor(m_latencyLevel) * factor(m_latencyLevel)) / m_samplesPerSecond);
+    return (m_latencyMs - renderMs) + renderMs * scale;
+}
+
+bool DynamicResolutionSdk::update() {
+    const Clock::time_point now = Clock::now();
+    unsigned target;
+    bool interacting;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const bool wasInteracting = m_interacting;
+        m_interacting = m_enabled && m_hasInteraction && elapsedMs(m_lastInteraction, now) < m_settings.settleMs;
+
+        target = m_level;
+        if (!m_interacting) {
+            // settled, full resolution for the final image
+            target = 0;
+            m_pending = false;
+        } else if (!wasInteracting) {
+            // a new drag starts where the last one ended up
+            target = std::min(m_motionLevel, m_settings.maxLevel);
+        } else if (elapsedMs(m_lastChange, now) >= m_settings.minHoldMs) {
+            const double upper = m_settings.targetLatencyMs * (1.0 + m_settings.hysteresis);
+            const bool measured = m_hasLatency && m_latencyLevel == m_level;
+            // a frame that is already overdue counts as slow, no need to wait for it
+            const bool slow = (measured && m_latencyMs > upper) ||
+                              (m_pending && elapsedMs(std::max(m_pendingSince, m_lastChange), now) > upper);
+            if (slow && m_level < m_settings.maxLevel) {
+                target = m_level + 1;
+            } else if (!slow && measured && m_level > 0 &&
+                       predictLatencyMs(m_level - 1) < m_settings.targetLatencyMs * (1.0 - m_settings.hysteresis)) {
+                target = m_level - 1;
+            }
+        }
+        interacting = m_interacting;
+        if (target == m_level) {
+            if (interacting) {
+                m_motionLevel = target;
+            }
+            return false;
+        }
+    }
+    // the level only counts once Octane has it, a failed change is tried again on the next update
+    if (!applyLevel(target)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (interacting) {
+        m_motionLevel = target;
+    }
+    m_level = target;
+    m_lastChange = now;
+    ++m_levelChanges;
+    return true;
+}
+
+bool DynamicResolutionSdk::applyLevel(unsigned level) {
+#ifdef DO_GRPC_SDK_ENABLED
+    const Octane::SubSampleMode mode = level >= 2 ? Octane::SUBSAMPLEMODE_4X4
+                                     : (level == 1 ? Octane::SUBSAMPLEMODE_2X2 : Octane::SUBSAMPLEMODE_NONE);
+    try {
+        OctaneGRPC::ApiRenderEngineProxy::setSubSampleMode(mode);
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "DynamicResolutionSdk: setSubSampleMode failed: " << e.what() << std::endl;
+    }
+#else
+    (void)level;
+#endif
+    return false;
+}
+
+unsigned DynamicResolutionSdk::level() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_level;
+}
+
+bool DynamicResolutionSdk::interacting() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_interacting;
+}
+
+double DynamicResolutionSdk::latencyMs() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_latencyMs;
+}
+
+void DynamicResolutionSdk::printSummary(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out << "Dynamic resolution: " << m_levelChanges << " level changes, " << m_latencySamples << " latency samples";
+    if (m_hasLatency) {
+        out << ", last " << std::fixed << std::setprecision(1) << m_latencyMs << " ms at "
+            << factor(m_latencyLevel) << "x" << factor(m_latencyLevel) << ", max " << m_maxLatencyMs
+            << " ms (target " << m_settings.targetLatencyMs << " ms)";
+    }
+    out << std::endl;
+}
@@ -0,0 +1,117 @@
+#ifndef DYNAMIC_RESOLUTION_SDK_H
+#define DYNAMIC_RESOLUTION_SDK_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apirenderengineclient.h"
+#endif
+
+/**
+ * @brief Lowers the render resolution while the camera moves
+ *
+ * Every camera change restarts the render at full resolution, so dragging the camera
+ * waits for a full resolution frame each time. The controller measures the time from a
+ * camera change to the next frame and switches Octane's sub-sampling (2x2, 4x4) while
+ * that latency is above the target. Once the camera stopped moving for settleMs, full
+ * resolution is restored and the render converges as usual.
+ *
+ * The level only goes coarser above targetLatencyMs * (1 + hysteresis) and only goes
+ * finer if the finer level is predicted (from the latency and the samples per second
+ * of the frames) to stay below targetLatencyMs * (1 - hysteresis). Changes are at least
+ * minHoldMs apart. The level used during the last drag is where the next drag starts.
+ *
+ * Sub-sampled frames are smaller or blocky, either way the display quad scales them
+ * to the viewport with linear filtering.
+ *
+ * notifyInteraction() and update() are called by the render loop, onFrame() by the
+ * new image callback.
+ */
+class DynamicResolutionSdk {
+public:
+    struct Settings {
+        double targetLatencyMs = 50.0;      // camera change to frame
+        double hysteresis = 0.25;           // dead band around the target, relative
+        double settleMs = 250.0;            // no camera change this long restores full resolution
+        double minHoldMs = 200.0;           // between two level changes while moving
+        unsigned maxLevel = 2;              // 1 allows 2x2, 2 allows 4x4
+        double smoothing = 0.3;             // weight of a new latency sample
+    };
+
+    DynamicResolutionSdk() : DynamicResolutionSdk(Settings()) {}
+    explicit DynamicResolutionSdk(const Settings& settings);
+
+    void setSettings(const Settings& settings);
+    Settings settings() const;
+
+    /**
+     * @brief Enabling or disabling restores full resolution on the next update()
+     */
+    void setEnabled(bool enabled);
+    bool enabled() const;
+
+    /**
+     * @brief The camera changed, the latency is measured from the first change not
+     * answered by a frame yet
+     */
+    void notifyInteraction();
+
+    /**
+     * @brief A frame arrived. subSampling is 1, 2 or 4 like Octane::SubSampleMode.
+     */
+    void onFrame(uint32_t width, uint32_t height, float samplesPerSecond, unsigned subSampling);
+
+#ifdef DO_GRPC_SDK_ENABLED
+    void onFrame(const Octane::ApiRenderImage& image);
+#endif
+
+    /**
+     * @brief Pick the level and apply it if it changed. Returns true on a change Octane
+     * accepted, a refused one is tried again by the next call.
+     */
+    bool update();
+
+    /**
+     * @brief 0 is full resolution, 1 is 2x2 and 2 is 4x4 sub-sampling
+     */
+    unsigned level() const;
+    bool interacting() const;
+    double latencyMs() const;
+
+    void printSummary(std::ostream& out) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static unsigned factor(unsigned level) { return 1u << level; }
+    double predictLatencyMs(unsigned level) const;
+    bool applyLevel(unsigned level);
+
+    mutable std::mutex m_mutex;
+    Settings m_settings;
+    bool m_enabled;
+
+    Clock::time_point m_lastInteraction;
+    Clock::time_point m_pendingSince;
+    Clock::time_point m_lastChange;
+    bool m_hasInteraction;
+    bool m_pending;
+    bool m_interacting;
+
+    double m_latencyMs;                     // smoothed, at m_latencyLevel
+    unsigned m_latencyLevel;
+    bool m_hasLatency;
+    double m_samplesPerSecond;
+    uint64_t m_fullPixels;                  // largest frame seen
+
+    unsigned m_level;                       // applied
+    unsigned m_motionLevel;                 // last level used while moving
+    uint64_t m_levelChanges;
+    uint64_t m_latencySamples;
+    double m_maxLatencyMs;
+};
+
+#endif // DYNAMIC_RESOLUTION_SDK_H
@@ -0,0 +1,264 @@
+#include "frame_compare.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FRAME_COMPARE_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace SharedUtils {
+
+namespace {
+
+    /**
+     * Sums over the color channels of a run of pixels
+     */
+    struct ErrorSums
+    {
+        double squared = 0.0;       // sum (a - b)^2
+        double absolute = 0.0;      // sum |a - b|
+        double magnitude = 0.0;     // sum (|a| + |b|) / 2
+    };
+
+    typedef void (*SegmentFn)(const void* a, const void* b, size_t count, bool clampValues, ErrorSums& sums);
+
+    inline float sanitize(float v, bool clampValues)
+    {
+        // written so that NaN ends up as 0
+        if (clampValues) {
+            v = v > 0.0f ? v : 0.0f;
+            return v < 1.0f ? v : 1.0f;
+        }
+        return v == v ? v : 0.0f;
+    }
+
+    void segmentFloatScalar(const void* a, const void* b, size_t count, bool clampValues, ErrorSums& sums)
+    {
+        const float* pa = (const float*)a;
+        const float* pb = (const float*)b;
+        double squared = 0.0, absolute = 0.0, magnitude = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                float va = sanitize(pa[i * 4 + c], clampValues);
+                float vb = sanitize(pb[i * 4 + c], clampValues);
+                float d = va - vb;
+                squared += d * d;
+                absolute += std::fabs(d);
+                magnitude += 0.5f * (std::fabs(va) + std::fabs(vb));
+            }
+        }
+        sums.squared += squared;
+        sums.absolute += absolute;
+        sums.magnitude += magnitude;
+    }
+
+    void segmentU8Scalar(const void* a, const void* b, size_t count, bool, ErrorSums& sums)
+    {
+        const uint8_t* pa = (const uint8_t*)a;
+        const uint8_t* pb = (const uint8_t*)b;
+        uint64_t squared = 0, absolute = 0, magnitude = 0;
+        for (size_t i = 0; i < count; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                int d = (int)pa[i * 4 + c] - (int)pb[i * 4 + c];
+                squared += (uint64_t)(d * d);
+                absolute += (uint64_t)(d < 0 ? -d : d);
+                magnitude += (uint64_t)pa[i * 4 + c] + pb[i * 4 + c];
+            }
+        }
+        sums.squared += (double)squared / (255.0 * 255.0);
+        sums.absolute += (double)absolute / 255.0;
+        sums.magnitude += (double)magnitude / (2.0 * 255.0);
+    }
+
+#if defined(FRAME_COMPARE_X86)
+
+    inline double horizontalSum(__m128 v)
+    {
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, v);
+        return (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    /**
+     * One pixel per vector, alpha masked off. Partial sums stay in float for one
+     * segment (a tile row) and are added to the doubles afterwards.
+     */
+    void segmentFloatSse2(const void* a, const void* b, size_t count, bool clampValues, ErrorSums& sums)
+    {
+        const float* pa = (const float*)a;
+        const float* pb = (const float*)b;
+        const __m128 colorMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+
+        __m128 squared = zero, absolute = zero, magnitude = zero;
+        for (size_t i = 0; i < count; ++i) {
+            __m128 va = _mm_loadu_ps(pa + i * 4);
+            __m128 vb = _mm_loadu_ps(pb + i * 4);
+            if (clampValues) {
+                // max returns the second operand for NaN, so NaN becomes 0
+                va = _mm_min_ps(_mm_max_ps(va, zero), one);
+                vb = _mm_min_ps(_mm_max_ps(vb, zero), one);
+            } else {
+                va = _mm_and_ps(va, _mm_cmpord_ps(va, va));
+                vb = _mm_and_ps(vb, _mm_cmpord_ps(vb, vb));
+            }
+            va = _mm_and_ps(va, colorMask);
+            vb = _mm_and_ps(vb, colorMask);
+            __m128 d = _mm_sub_ps(va, vb);
+            squared = _mm_add_ps(squared, _mm_mul_ps(d, d));
+            absolute = _mm_add_ps(absolute, _mm_and_ps(d, absMask));
+            magnitude = _mm_add_ps(magnitude, _mm_mul_ps(_mm_add_ps(_mm_and_ps(va, absMask), _mm_and_ps(vb, absMask)), half));
+        }
+        sums.squared += horizontalSum(squared);
+        sums.absolute += horizontalSum(absolute);
+        sums.magnitude += horizontalSum(magnitude);
+    }
+
+    /**
+     * Four pixels per vector. _mm_sad_epu8 gives the absolute differences and the
+     * magnitudes, the squares come from 16-bit differences and _mm_madd_epi16. All
+     * sums are exact integers.
+     */
+    void segmentU8Sse2(const void* a, const void* b, size_t count, bool clampValues, ErrorSums& sums)
+    {
+        const uint8_t* pa = (const uint8_t*)a;
+        const uint8_t* pb = (const uint8_t*)b;
+        const __m128i colorMask = _mm_set1_epi32(0x00ffffff);
+        const __m128i zero = _mm_setzero_si128();
+
+        __m128i absolute = zero, magnitude = zero, squared = zero;
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i va = _mm_and_si128(_mm_loadu_si128((const __m128i*)(pa + i * 4)), colorMask);
+            __m128i vb = _mm_and_si128(_mm_loadu_si128((const __m128i*)(pb + i * 4)), colorMask);
+            absolute = _mm_add_epi64(absolute, _mm_sad_epu8(va, vb));
+            magnitude = _mm_add_epi64(magnitude, _mm_add_epi64(_mm_sad_epu8(va, zero), _mm_sad_epu8(vb, zero)));
+
+            __m128i dLo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+            __m128i dHi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+            __m128i sq = _mm_add_epi32(_mm_madd_epi16(dLo, dLo), _mm_madd_epi16(dHi, dHi));
+            // widen to 64 bit so long segments can't overflow
+            squared = _mm_add_epi64(squared, _mm_add_epi64(_mm_unpacklo_epi32(sq, zero), _mm_unpackhi_epi32(sq, zero)));
+        }
+
+        alignas(16) uint64_t lanes[2];
+        _mm_store_si128((__m128i*)lanes, absolute);
+        const uint64_t absoluteSum = lanes[0] + lanes[1];
+        _mm_store_si128((__m128i*)lanes, magnitude);
+        const uint64_t magnitudeSum = lanes[0] + lanes[1];
+        _mm_store_si128((__m128i*)lanes, squared);
+        const uint64_t squaredSum = lanes[0] + lanes[1];
+
+        sums.squared += (double)squaredSum / (255.0 * 255.0);
+        sums.absolute += (double)absoluteSum / 255.0;
+        sums.magnitude += (double)magnitudeSum / (2.0 * 255.0);
+
+        segmentU8Scalar(pa + i * 4, pb + i * 4, count - i, clampValues, sums);
+    }
+
+#endif
+
+    double relativeError(const ErrorSums& sums, size_t values)
+    {
+        // the floor keeps black regions from turning tiny noise into a large error
+        const double floor = 1e-4 * (double)values;
+        return sums.absolute / std::max(sums.magnitude, floor);
+    }
+
+} // namespace
+
+bool compareFrames(PixelConvert::PixelFormat format,
+                   const void* a,
+                   size_t pitchA,
+                   const void* b,
+                   size_t pitchB,
+                   uint32_t width,
+                   uint32_t height,
+                   uint32_t tileSize,
+                   bool clampValues,
+                   FrameDiff& diff)
+{
+    if (!a || !b || width == 0 || height == 0) {
+        return false;
+    }
+
+    SegmentFn segment = nullptr;
+    const bool simd = PixelConvert::activeSimdLevel() != PixelConvert::SIMD_SCALAR;
+    switch (format) {
+    case PixelConvert::PIXEL_FORMAT_HDR_RGBA:
+        segment = segmentFloatScalar;
+#if defined(FRAME_COMPARE_X86)
+        if (simd) {
+            segment = segmentFloatSse2;
+        }
+#endif
+        break;
+    case PixelConvert::PIXEL_FORMAT_LDR_RGBA:
+        segment = segmentU8Scalar;
+#if defined(FRAME_COMPARE_X86)
+        if (simd) {
+            segment = segmentU8Sse2;
+        }
+#endif
+        break;
+    default:
+        return false;
+    }
+    (void)simd;
+
+    tileSize = std::max(tileSize, 1u);
+    const size_t bpp = PixelConvert::bytesPerPixel(format);
+    diff.tileSize = tileSize;
+    diff.tilesX = (width + tileSize - 1) / tileSize;
+    diff.tilesY = (height + tileSize - 1) / tileSize;
+
+    std::vector<ErrorSums> tileSums((size_t)diff.tilesX * diff.tilesY);
+
+    // one "row" of the range is a row of tiles, so a tile is never split across threads
+    PixelConvert::forEachRowRange(width * tileSize, diff.tilesY, [&](uint32_t firstTileRow, uint32_t endTileRow) {
+        for (uint32_t ty = firstTileRow; ty < endTileRow; ++ty) {
+            ErrorSums* rowSums = tileSums.data() + (size_t)ty * diff.tilesX;
+            const uint32_t yEnd = std::min(height, (ty + 1) * tileSize);
+            for (uint32_t y = ty * tileSize; y < yEnd; ++y) {
+                const uint8_t* rowA = (const uint8_t*)a + (size_t)y * pitchA;
+                const uint8_t* rowB = (const uint8_t*)b + (size_t)y * pitchB;
+                for (uint32_t tx = 0; tx < diff.tilesX; ++tx) {
+                    const uint32_t x = tx * tileSize;
+                    const uint32_t count = std::min(tileSize, width - x);
+                    segment(rowA + x * bpp, rowB + x * bpp, count, clampValues, rowSums[tx]);
+                }
+            }
+        }
+    });
+
+    ErrorSums total;
+    diff.tileErrors.resize(tileSums.size());
+    diff.maxTileError = 0.0;
+    for (uint32_t ty = 0; ty < diff.tilesY; ++ty) {
+        const uint32_t tileHeight = std::min(tileSize, height - ty * tileSize);
+        for (uint32_t tx = 0; tx < diff.tilesX; ++tx) {
+            const uint32_t tileWidth = std::min(tileSize, width - tx * tileSize);
+            const ErrorSums& sums = tileSums[(size_t)ty * diff.tilesX + tx];
+            const double error = relativeError(sums, (size_t)tileWidth * tileHeight * 3);
+            diff.tileErrors[(size_t)ty * diff.tilesX + tx] = (float)error;
+            diff.maxTileError = std::max(diff.maxTileError, error);
+            total.squared += sums.squared;
+            total.absolute += sums.absolute;
+            total.magnitude += sums.magnitude;
+        }
+    }
+
+    const size_t values = (size_t)width * height * 3;
+    diff.mse = total.squared / (double)values;
+    diff.psnr = diff.mse > 0.0 ? 10.0 * std::log10(1.0 / diff.mse) : std::numeric_limits<double>::infinity();
+    diff.relativeError = relativeError(total, values);
+    return true;
+}
+
+} // namespace SharedUtils
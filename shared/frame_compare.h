@@ -0,0 +1,47 @@
+#pragma once
+
+#include "pixel_convert.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SharedUtils {
+
+    /**
+     * Difference between two frames of the same size and format, over the color
+     * channels (alpha is ignored)
+     */
+    struct FrameDiff
+    {
+        double mse = 0.0;                   // mean square error per color channel
+        double psnr = 0.0;                  // 10 * log10(1 / mse), peak 1.0; infinite for equal frames
+        double relativeError = 0.0;         // sum |a - b| / sum (|a| + |b|) / 2 over the frame
+        double maxTileError = 0.0;          // largest relative error of a tile
+        uint32_t tileSize = 0;
+        uint32_t tilesX = 0;
+        uint32_t tilesY = 0;
+        std::vector<float> tileErrors;      // relative error per tile, row major
+    };
+
+    /**
+     * Compare two frames, like ApiImageBuffer::calculateMeanSquareError but on the
+     * client and with a per tile relative error map. 8-bit values are scaled to
+     * [0, 1]; with clampValues, float values are clamped to [0, 1] first. Pitches are
+     * in bytes. Tile rows are split across threads like PixelConvert, and the SIMD
+     * path follows PixelConvert::activeSimdLevel().
+     * Supports PIXEL_FORMAT_LDR_RGBA and PIXEL_FORMAT_HDR_RGBA; returns false for other
+     * formats.
+     */
+    bool compareFrames(PixelConvert::PixelFormat format,
+                       const void* a,
+                       size_t pitchA,
+                       const void* b,
+                       size_t pitchB,
+                       uint32_t width,
+                       uint32_t height,
+                       uint32_t tileSize,
+                       bool clampValues,
+                       FrameDiff& diff);
+
+} // namespace SharedUtils
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace SharedUtils {
+
+    /**
+     * Lock-free latest-wins mailbox (triple buffer) for handing frames from one
+     * producer thread to one consumer thread.
+     *
+     * The producer fills producerSlot() and calls publish(); it never waits. The
+     * consumer calls consume() and, when it returns true, reads consumerSlot();
+     * it never waits either. If the producer publishes again before the consumer
+     * picked up the previous frame, that frame is replaced and counted as dropped.
+     *
+     * Slots are recycled rather than reallocated, so a T that owns its pixel
+     * storage keeps its capacity from frame to frame. A slot handed back to the
+     * producer holds either an already consumed or a dropped frame.
+     */
+    template<typename T>
+    class FrameMailbox {
+    public:
+        FrameMailbox() = default;
+        FrameMailbox(const FrameMailbox&) = delete;
+        FrameMailbox& operator=(const FrameMailbox&) = delete;
+
+        /**
+         * Slot owned by the producer. Only valid on the producer thread until publish().
+         */
+        T& producerSlot() { return mSlots[mBack].value; }
+
+        /**
+         * Make the producer slot the newest frame and take a recycled slot in exchange
+         */
+        void publish()
+        {
+            uint8_t previous = mMiddle.exchange(static_cast<uint8_t>(mBack | FRESH_BIT), std::memory_order_acq_rel);
+            mBack = previous & INDEX_MASK;
+            mPublished.fetch_add(1, std::memory_order_relaxed);
+            if (previous & FRESH_BIT)
+            {
+                mDropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * Take the newest published frame, if any. Returns false when nothing new
+         * was published since the last call, in which case consumerSlot() still
+         * holds the previous frame.
+         */
+        bool consume()
+        {
+            if (!(mMiddle.load(std::memory_order_relaxed) & FRESH_BIT))
+            {
+                return false;
+            }
+            uint8_t previous = mMiddle.exchange(mFront, std::memory_order_acq_rel);
+            mFront = previous & INDEX_MASK;
+            mConsumed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /**
+         * Slot owned by the consumer. Only valid on the consumer thread.
+         */
+        T& consumerSlot() { return mSlots[mFront].value; }
+        const T& consumerSlot() const { return mSlots[mFront].value; }
+
+        /**
+         * True if a frame was published that the consumer has not taken yet
+         */
+        bool hasNewFrame() const { return (mMiddle.load(std::memory_order_acquire) & FRESH_BIT) != 0; }
+
+        uint64_t publishedCount() const { return mPublished.load(std::memory_order_relaxed); }
+        uint64_t consumedCount() const { return mConsumed.load(std::memory_order_relaxed); }
+        uint64_t droppedCount() const { return mDropped.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr uint8_t INDEX_MASK = 0x3;
+        static constexpr uint8_t FRESH_BIT = 0x4;
+
+        // keep the slots on separate cache lines, the producer and consumer touch them concurrently
+        struct alignas(64) Slot
+        {
+            T value{};
+        };
+
+        Slot mSlots[3];
+
+        // producer side
+        alignas(64) uint8_t mBack = 0;
+        // shared index of the slot in the middle, plus FRESH_BIT when it holds an unconsumed frame
+        alignas(64) std::atomic<uint8_t> mMiddle{ 1 };
+        // consumer side
+        alignas(64) uint8_t mFront = 2;
+
+        alignas(64) std::atomic<uint64_t> mPublished{ 0 };
+        std::atomic<uint64_t> mConsumed{ 0 };
+        std::atomic<uint64_t> mDropped{ 0 };
+    };
+
+};
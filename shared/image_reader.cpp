@@ -0,0 +1,502 @@
+#include "image_reader.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <zlib.h>
+
+namespace SharedUtils {
+
+namespace {
+
+    const uint8_t PNG_SIGNATURE[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+
+    // larger images are refused before anything is allocated for them
+    const uint64_t MAX_PIXELS = 1ull << 28;
+
+    enum PngColorType
+    {
+        PNG_GRAY = 0,
+        PNG_RGB = 2,
+        PNG_PALETTE = 3,
+        PNG_GRAY_ALPHA = 4,
+        PNG_RGBA = 6,
+    };
+
+    inline uint32_t get32BE(const uint8_t* p)
+    {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    inline uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+    {
+        const int p = (int)a + b - c;
+        const int pa = std::abs(p - a);
+        const int pb = std::abs(p - b);
+        const int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc)
+        {
+            return a;
+        }
+        return pb <= pc ? b : c;
+    }
+
+    int pngChannels(uint8_t colorType)
+    {
+        switch (colorType)
+        {
+        case PNG_GRAY:       return 1;
+        case PNG_RGB:        return 3;
+        case PNG_PALETTE:    return 1;
+        case PNG_GRAY_ALPHA: return 2;
+        case PNG_RGBA:       return 4;
+        default:             return 0;
+        }
+    }
+
+    bool validBitDepth(uint8_t colorType, uint8_t bitDepth)
+    {
+        switch (colorType)
+        {
+        case PNG_GRAY:
+            return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+        case PNG_PALETTE:
+            return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+        default:
+            return bitDepth == 8 || bitDepth == 16;
+        }
+    }
+
+    // Reverses the PNG row filters in place, rows are preceded by their filter byte
+    bool unfilter(uint8_t* raw, uint32_t height, size_t rowBytes, size_t pixelBytes)
+    {
+        const uint8_t* previous = nullptr;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* row = raw + (size_t)y * (rowBytes + 1);
+            const uint8_t filter = row[0];
+            uint8_t* current = row + 1;
+            switch (filter)
+            {
+            case 0:
+                break;
+            case 1:
+                for (size_t i = pixelBytes; i < rowBytes; ++i)
+                {
+                    current[i] = (uint8_t)(current[i] + current[i - pixelBytes]);
+                }
+                break;
+            case 2:
+                if (previous)
+                {
+                    for (size_t i = 0; i < rowBytes; ++i)
+                    {
+                        current[i] = (uint8_t)(current[i] + previous[i]);
+                    }
+                }
+                break;
+            case 3:
+                for (size_t i = 0; i < rowBytes; ++i)
+                {
+                    const unsigned left = i >= pixelBytes ? current[i - pixelBytes] : 0;
+                    const unsigned up = previous ? previous[i] : 0;
+                    current[i] = (uint8_t)(current[i] + ((left + up) >> 1));
+                }
+                break;
+            case 4:
+                for (size_t i = 0; i < rowBytes; ++i)
+                {
+                    const uint8_t left = i >= pixelBytes ? current[i - pixelBytes] : 0;
+                    const uint8_t up = previous ? previous[i] : 0;
+                    const uint8_t upLeft = previous && i >= pixelBytes ? previous[i - pixelBytes] : 0;
+                    current[i] = (uint8_t)(current[i] + paeth(left, up, upLeft));
+                }
+                break;
+            default:
+                return false;
+            }
+            previous = current;
+        }
+        return true;
+    }
+
+    // Sample c of pixel x of an unfiltered row at full precision
+    inline uint32_t sampleOf(const uint8_t* row, uint32_t x, int c, int channels, uint8_t bitDepth)
+    {
+        if (bitDepth == 8)
+        {
+            return row[(size_t)x * channels + c];
+        }
+        if (bitDepth == 16)
+        {
+            const uint8_t* p = row + ((size_t)x * channels + c) * 2;
+            return ((uint32_t)p[0] << 8) | p[1];
+        }
+        // below 8 bits there is one channel, packed from the high bits down
+        const size_t bit = (size_t)x * bitDepth;
+        const unsigned shift = 8 - bitDepth - (unsigned)(bit & 7);
+        return (row[bit >> 3] >> shift) & ((1u << bitDepth) - 1);
+    }
+
+    inline uint8_t to8Bit(uint32_t value, uint8_t bitDepth)
+    {
+        if (bitDepth == 16)
+        {
+            return (uint8_t)(value >> 8);
+        }
+        return bitDepth == 8 ? (uint8_t)value : (uint8_t)(value * 255 / ((1u << bitDepth) - 1));
+    }
+
+    // Next header value of a PNM file, skipping whitespace and comments
+    bool pnmValue(const uint8_t* data, size_t size, size_t& offset, uint32_t& value)
+    {
+        for (;;)
+        {
+            while (offset < size && (data[offset] == ' ' || data[offset] == '\t' || data[offset] == '\r' ||
+                                     data[offset] == '\n'))
+            {
+                ++offset;
+            }
+            if (offset < size && data[offset] == '#')
+            {
+                while (offset < size && data[offset] != '\n')
+                {
+                    ++offset;
+                }
+                continue;
+            }
+            break;
+        }
+        uint64_t result = 0;
+        const size_t first = offset;
+        while (offset < size && data[offset] >= '0' && data[offset] <= '9' && result <= 0xffffffffu)
+        {
+            result = result * 10 + (data[offset++] - '0');
+        }
+        value = (uint32_t)result;
+        return offset > first && result <= 0xffffffffu;
+    }
+
+}
+
+    bool ImageReader::canDecode(const void* data, size_t size)
+    {
+        const uint8_t* bytes = (const uint8_t*)data;
+        if (size >= sizeof(PNG_SIGNATURE) && std::memcmp(bytes, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0)
+        {
+            return true;
+        }
+        return size >= 2 && bytes[0] == 'P' && (bytes[1] == '5' || bytes[1] == '6');
+    }
+
+    bool ImageReader::decode(const void* data, size_t size, DecodedImage& image, std::string* error)
+    {
+        std::string reason;
+        const uint8_t* bytes = (const uint8_t*)data;
+        bool ok = false;
+        if (size >= sizeof(PNG_SIGNATURE) && std::memcmp(bytes, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0)
+        {
+            ok = decodePng(bytes, size, image, reason);
+        }
+        else if (size >= 2 && bytes[0] == 'P' && (bytes[1] == '5' || bytes[1] == '6'))
+        {
+            ok = decodePnm(bytes, size, image, reason);
+        }
+        else
+        {
+            reason = "not a PNG or binary PPM/PGM file";
+        }
+        if (!ok && error)
+        {
+            *error = reason;
+        }
+        return ok;
+    }
+
+    bool ImageReader::decodePng(const uint8_t* data, size_t size, DecodedImage& image, std::string& error)
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint8_t bitDepth = 0;
+        uint8_t colorType = 0;
+        const uint8_t* palette = nullptr;
+        size_t paletteEntries = 0;
+        const uint8_t* transparency = nullptr;
+        size_t transparencyBytes = 0;
+        // the image data is usually one IDAT chunk, which is inflated straight from the file
+        const uint8_t* compressed = nullptr;
+        size_t compressedSize = 0;
+        std::vector<uint8_t> joined;
+
+        size_t offset = sizeof(PNG_SIGNATURE);
+        bool ended = false;
+        while (!ended && offset + 12 <= size)
+        {
+            const uint32_t length = get32BE(data + offset);
+            const uint8_t* type = data + offset + 4;
+            const uint8_t* chunk = data + offset + 8;
+            if (length > size - offset - 12)
+            {
+                error = "truncated PNG chunk";
+                return false;
+            }
+            offset += 12 + (size_t)length;
+
+            if (std::memcmp(type, "IHDR", 4) == 0)
+            {
+                if (length < 13)
+                {
+                    error = "invalid PNG header";
+                    return false;
+                }
+                width = get32BE(chunk);
+                height = get32BE(chunk + 4);
+                bitDepth = chunk[8];
+                colorType = chunk[9];
+                if (pngChannels(colorType) == 0 || !validBitDepth(colorType, bitDepth) || chunk[10] != 0 ||
+                    chunk[11] != 0)
+                {
+                    error = "unsupported PNG color type or bit depth";
+                    return false;
+                }
+                if (chunk[12] != 0)
+                {
+                    error = "interlaced PNG";
+                    return false;
+                }
+            }
+            else if (std::memcmp(type, "PLTE", 4) == 0)
+            {
+                palette = chunk;
+                paletteEntries = length / 3;
+            }
+            else if (std::memcmp(type, "tRNS", 4) == 0)
+            {
+                transparency = chunk;
+                transparencyBytes = length;
+            }
+            else if (std::memcmp(type, "IDAT", 4) == 0)
+            {
+                if (!compressed)
+                {
+                    compressed = chunk;
+                    compressedSize = length;
+                }
+                else
+                {
+                    if (joined.empty())
+                    {
+                        joined.assign(compressed, compressed + compressedSize);
+                    }
+                    joined.insert(joined.end(), chunk, chunk + length);
+                }
+            }
+            else if (std::memcmp(type, "IEND", 4) == 0)
+            {
+                ended = true;
+            }
+        }
+        if (!joined.empty())
+        {
+            compressed = joined.data();
+            compressedSize = joined.size();
+        }
+        if (width == 0 || height == 0 || !compressed)
+        {
+            error = "PNG without header or image data";
+            return false;
+        }
+        if ((uint64_t)width * height > MAX_PIXELS)
+        {
+            error = "PNG too large";
+            return false;
+        }
+        if (colorType == PNG_PALETTE && !palette)
+        {
+            error = "PNG without palette";
+            return false;
+        }
+
+        const int channels = pngChannels(colorType);
+        const size_t bitsPerPixel = (size_t)channels * bitDepth;
+        const size_t rowBytes = ((size_t)width * bitsPerPixel + 7) / 8;
+        const size_t pixelBytes = std::max<size_t>(1, bitsPerPixel / 8);
+        std::vector<uint8_t> raw((size_t)height * (rowBytes + 1));
+        uLongf rawSize = (uLongf)raw.size();
+        if (uncompress(raw.data(), &rawSize, compressed, (uLong)compressedSize) != Z_OK || rawSize != raw.size())
+        {
+            error = "corrupt PNG image data";
+            return false;
+        }
+        if (!unfilter(raw.data(), height, rowBytes, pixelBytes))
+        {
+            error = "invalid PNG row filter";
+            return false;
+        }
+
+        // tRNS of gray and RGB images names the one color that is transparent
+        const bool colorKey = transparency && colorType != PNG_PALETTE &&
+                              transparencyBytes >= (colorType == PNG_GRAY ? 2u : 6u);
+        uint32_t key[3] = {};
+        if (colorKey)
+        {
+            for (int c = 0; c < (colorType == PNG_GRAY ? 1 : 3); ++c)
+            {
+                key[c] = ((uint32_t)transparency[c * 2] << 8) | transparency[c * 2 + 1];
+            }
+        }
+
+        image.width = width;
+        image.height = height;
+        image.rgba.resize((size_t)width * height * 4);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t* row = raw.data() + (size_t)y * (rowBytes + 1) + 1;
+            uint8_t* out = image.rgba.data() + (size_t)y * width * 4;
+            if (colorType == PNG_RGBA && bitDepth == 8)
+            {
+                std::memcpy(out, row, (size_t)width * 4);
+                continue;
+            }
+            for (uint32_t x = 0; x < width; ++x, out += 4)
+            {
+                switch (colorType)
+                {
+                case PNG_GRAY:
+                {
+                    const uint32_t gray = sampleOf(row, x, 0, 1, bitDepth);
+                    out[0] = out[1] = out[2] = to8Bit(gray, bitDepth);
+                    out[3] = colorKey && gray == key[0] ? 0 : 255;
+                    break;
+                }
+                case PNG_RGB:
+                {
+                    uint32_t rgb[3];
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        rgb[c] = sampleOf(row, x, c, 3, bitDepth);
+                        out[c] = to8Bit(rgb[c], bitDepth);
+                    }
+                    out[3] = colorKey && rgb[0] == key[0] && rgb[1] == key[1] && rgb[2] == key[2] ? 0 : 255;
+                    break;
+                }
+                case PNG_PALETTE:
+                {
+                    const uint32_t index = sampleOf(row, x, 0, 1, bitDepth);
+                    if (index >= paletteEntries)
+                    {
+                        error = "PNG palette index out of range";
+                        return false;
+                    }
+                    std::memcpy(out, palette + index * 3, 3);
+                    out[3] = transparency && index < transparencyBytes ? transparency[index] : 255;
+                    break;
+                }
+                case PNG_GRAY_ALPHA:
+                    out[0] = out[1] = out[2] = to8Bit(sampleOf(row, x, 0, 2, bitDepth), bitDepth);
+                    out[3] = to8Bit(sampleOf(row, x, 1, 2, bitDepth), bitDepth);
+                    break;
+                default:
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        out[c] = to8Bit(sampleOf(row, x, c, 4, bitDepth), bitDepth);
+                    }
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool ImageReader::decodePnm(const uint8_t* data, size_t size, DecodedImage& image, std::string& error)
+    {
+        const int channels = data[1] == '6' ? 3 : 1;
+        size_t offset = 2;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t maxValue = 0;
+        if (!pnmValue(data, size, offset, width) || !pnmValue(data, size, offset, height) ||
+            !pnmValue(data, size, offset, maxValue) || offset >= size)
+        {
+            error = "invalid PPM header";
+            return false;
+        }
+        // exactly one whitespace character separates the header from the pixels
+        ++offset;
+        if (width == 0 || height == 0 || maxValue == 0 || maxValue > 65535)
+        {
+            error = "unsupported PPM size or maximum value";
+            return false;
+        }
+        if ((uint64_t)width * height > MAX_PIXELS)
+        {
+            error = "PPM too large";
+            return false;
+        }
+        const size_t sampleBytes = maxValue > 255 ? 2 : 1;
+        const size_t pixels = (size_t)width * height;
+        if (size - offset < pixels * channels * sampleBytes)
+        {
+            error = "truncated PPM";
+            return false;
+        }
+
+        image.width = width;
+        image.height = height;
+        image.rgba.resize(pixels * 4);
+        const uint8_t* in = data + offset;
+        uint8_t* out = image.rgba.data();
+        for (size_t i = 0; i < pixels; ++i, out += 4)
+        {
+            for (int c = 0; c < channels; ++c, in += sampleBytes)
+            {
+                const uint32_t value = sampleBytes == 2 ? ((uint32_t)in[0] << 8) | in[1] : in[0];
+                out[c] = maxValue == 255 ? (uint8_t)value : (uint8_t)(std::min(value, maxValue) * 255 / maxValue);
+            }
+            if (channels == 1)
+            {
+                out[1] = out[2] = out[0];
+            }
+            out[3] = 255;
+        }
+        return true;
+    }
+
+    void ImageReader::downsample(DecodedImage& image, uint32_t maxSize)
+    {
+        if (maxSize == 0)
+        {
+            return;
+        }
+        while (image.width > maxSize || image.height > maxSize)
+        {
+            const uint32_t width = image.width;
+            const uint32_t height = image.height;
+            const uint32_t halfWidth = (width + 1) / 2;
+            const uint32_t halfHeight = (height + 1) / 2;
+            // in place: a pixel is written before any pixel at or after it is read for a later one
+            uint8_t* pixels = image.rgba.data();
+            for (uint32_t y = 0; y < halfHeight; ++y)
+            {
+                const uint8_t* row0 = pixels + (size_t)(2 * y) * width * 4;
+                const uint8_t* row1 = pixels + (size_t)std::min(2 * y + 1, height - 1) * width * 4;
+                uint8_t* out = pixels + (size_t)y * halfWidth * 4;
+                for (uint32_t x = 0; x < halfWidth; ++x, out += 4)
+                {
+                    const size_t left = (size_t)(2 * x) * 4;
+                    const size_t right = (size_t)std::min(2 * x + 1, width - 1) * 4;
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        out[c] = (uint8_t)((row0[left + c] + row0[right + c] + row1[left + c] + row1[right + c] + 2) >> 2);
+                    }
+                }
+            }
+            image.width = halfWidth;
+            image.height = halfHeight;
+            image.rgba.resize((size_t)halfWidth * halfHeight * 4);
+        }
+        image.rgba.shrink_to_fit();
+    }
+
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SharedUtils {
+
+    /**
+     * An image decoded to 8-bit RGBA, rows top down without padding. The layout of
+     * Octane's IMAGE_TYPE_LDR_RGBA, so the pixels can be set as A_BUFFER of an image
+     * texture as they are.
+     */
+    struct DecodedImage
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> rgba;
+    };
+
+    /**
+     * Decoder for the lossless formats image textures of the examples come in: PNG (all
+     * color types, 1 to 16 bits, not interlaced) and binary PPM/PGM (P6/P5, 8-bit). Other
+     * files, e.g. JPEG, are left to the image loaders of Octane.
+     */
+    class ImageReader {
+    public:
+        /**
+         * True if the data starts like a file decode() reads
+         */
+        static bool canDecode(const void* data, size_t size);
+
+        /**
+         * Decodes a complete file image, on failure error says why
+         */
+        static bool decode(const void* data, size_t size, DecodedImage& image, std::string* error = nullptr);
+
+        /**
+         * Halves the image with a 2x2 box filter until neither side is above maxSize.
+         * 0 keeps the image as it is.
+         */
+        static void downsample(DecodedImage& image, uint32_t maxSize);
+
+    private:
+        static bool decodePng(const uint8_t* data, size_t size, DecodedImage& image, std::string& error);
+        static bool decodePnm(const uint8_t* data, size_t size, DecodedImage& image, std::string& error);
+    };
+
+};
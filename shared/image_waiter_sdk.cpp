@@ -0,0 +1,197 @@
+#include "image_waiter_sdk.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "protos/render_image_wait.grpc.pb.h"
+#include "protos/render_image_wait.pb.h"
+
+namespace {
+
+double msSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+std::shared_ptr<grpc::Channel> createChannel(const std::string& address) {
+    // a response holds whole images, well above the default 4 MB receive limit
+    grpc::ChannelArguments arguments;
+    arguments.SetMaxReceiveMessageSize(-1);
+    return grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), arguments);
+}
+
+void convert(const octaneimagewait::RenderImage& in, Octane::ApiRenderImage& out, std::vector<char>& buffer) {
+    buffer.assign(in.buffer().begin(), in.buffer().end());
+    out = Octane::ApiRenderImage();
+    out.mType = static_cast<Octane::ImageType>(in.type());
+    out.mColorSpace = static_cast<Octane::NamedColorSpace>(in.colorspace());
+    out.mIsLinear = in.islinear();
+    out.mSize.x = in.width();
+    out.mSize.y = in.height();
+    out.mPitch = in.pitch();
+    out.mBuffer = buffer.empty() ? nullptr : buffer.data();
+    out.mRenderPassId = static_cast<Octane::RenderPassId>(in.renderpassid());
+    out.mTonemappedSamplesPerPixel = in.tonemappedsamplesperpixel();
+    out.mCalculatedSamplesPerPixel = in.calculatedsamplesperpixel();
+    out.mRegionSamplesPerPixel = in.regionsamplesperpixel();
+    out.mMaxSamplesPerPixel = in.maxsamplesperpixel();
+    out.mSamplesPerSecond = in.samplespersecond();
+    out.mRenderTime = in.rendertime();
+    out.mChangeLevel = static_cast<Octane::CLevelT>(in.changelevel());
+    out.mHasPendingUpdates = in.haspendingupdates();
+    out.mSubSampling = static_cast<Octane::SubSampleMode>(in.subsampling());
+    out.mHasAlpha = in.hasalpha();
+    out.mPremultipliedAlphaType = static_cast<Octane::PremultipliedAlphaType>(in.premultipliedalphatype());
+    out.mKeepEnvironment = in.keepenvironment();
+}
+
+}
+
+ImageWaiterSdk::ImageWaiterSdk(const Settings& settings)
+    : ImageWaiterSdk(settings, createChannel(settings.address))
+{
+}
+
+ImageWaiterSdk::ImageWaiterSdk(const Settings& settings, std::shared_ptr<grpc::Channel> channel)
+    : m_settings(settings)
+    , m_channel(std::move(channel))
+    , m_running(false)
+    , m_minChangeLevel(0)
+    , m_threadContext(nullptr)
+{
+}
+
+ImageWaiterSdk::~ImageWaiterSdk() {
+    stop();
+}
+
+bool ImageWaiterSdk::waitForImage(uint64_t minChangeLevel,
+                                  uint64_t afterSequence,
+                                  unsigned timeoutMs,
+                                  bool includeImage,
+                                  Frame& frame,
+                                  std::string* error) {
+    grpc::ClientContext context;
+    return wait(context, minChangeLevel, afterSequence, timeoutMs, includeImage, frame, error);
+}
+
+bool ImageWaiterSdk::wait(grpc::ClientContext& context,
+                          uint64_t minChangeLevel,
+                          uint64_t afterSequence,
+                          unsigned timeoutMs,
+                          bool includeImage,
+                          Frame& frame,
+                          std::string* error) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    // the service answers empty at the timeout, the deadline only catches a lost service
+    context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(timeoutMs + 5000));
+
+    octaneimagewait::WaitForImageRequest request;
+    request.set_minchangelevel(minChangeLevel);
+    request.set_aftersequence(afterSequence);
+    request.set_timeoutms(timeoutMs);
+    request.set_includeimage(includeImage);
+    octaneimagewait::WaitForImageResponse response;
+    const grpc::Status status = octaneimagewait::RenderImageWait::NewStub(m_channel)->waitForImage(&context, request, &response);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.waits;
+    if (!status.ok()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = "waitForImage: " + status.error_message();
+        }
+        return false;
+    }
+    if (!response.ready()) {
+        ++m_stats.timeouts;
+        return false;
+    }
+
+    frame.sequence = response.sequence();
+    frame.changeLevel = response.changelevel();
+    frame.tonemappedSamplesPerPixel = response.tonemappedsamplesperpixel();
+    // the vectors of a recycled frame keep their capacity
+    frame.images.resize(static_cast<size_t>(response.images_size()));
+    frame.buffers.resize(frame.images.size());
+    for (size_t i = 0; i < frame.images.size(); ++i) {
+        convert(response.images(static_cast<int>(i)), frame.images[i], frame.buffers[i]);
+        m_stats.bytes += frame.buffers[i].size();
+    }
+    ++m_stats.images;
+    m_stats.waitMs += msSince(start);
+    return true;
+}
+
+void ImageWaiterSdk::start() {
+    if (m_running.exchange(true)) {
+        return;
+    }
+    m_thread = std::thread(&ImageWaiterSdk::run, this);
+}
+
+void ImageWaiterSdk::stop() {
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_threadContext) {
+            m_threadContext->TryCancel();
+        }
+    }
+    m_thread.join();
+}
+
+void ImageWaiterSdk::run() {
+    uint64_t sequence = 0;
+    while (m_running) {
+        grpc::ClientContext context;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_threadContext = &context;
+        }
+        // stop() may have missed the context
+        if (!m_running) {
+            break;
+        }
+        std::string error;
+        Frame& frame = m_frames.producerSlot();
+        const bool ready = wait(context, m_minChangeLevel, sequence, m_settings.timeoutMs,
+                                m_settings.includeImage, frame, &error);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_threadContext = nullptr;
+        }
+        if (ready) {
+            sequence = frame.sequence;
+            m_frames.publish();
+        } else if (!error.empty() && m_running) {
+            std::cerr << "ImageWaiterSdk: " << error << std::endl;
+            for (unsigned waited = 0; waited < m_settings.retryMs && m_running; waited += 50) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threadContext = nullptr;
+}
+
+ImageWaiterSdk::Stats ImageWaiterSdk::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void ImageWaiterSdk::printSummary(std::ostream& out) const {
+    const Stats s = stats();
+    out << "ImageWaiterSdk: " << s.waits << " waits, " << s.images << " images ("
+        << std::fixed << std::setprecision(1) << s.bytes / (1024.0 * 1024.0) << " MB), "
+        << s.timeouts << " timed out, " << s.errors << " failed";
+    if (s.images > 0) {
+        out << ", " << s.waitMs / s.images << " ms per image";
+    }
+    out << std::endl;
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef IMAGE_WAITER_SDK_H
+#define IMAGE_WAITER_SDK_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_mailbox.h"
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include <grpcpp/grpcpp.h>
+#include "apirender.h"
+
+/**
+ * @brief Render images by long poll, for clients without the new image callback
+ *
+ * Without ApiRenderEngineProxy::setOnNewImageCallback() a client has to call isImageReady(),
+ * hasPendingRenderData() or getRenderImageChangeLevel() in a loop, which costs an RPC per
+ * poll and shows a new image up to a poll interval late. waitForImage() asks
+ * octane_imagewait (grpc-api-examples/image-wait) on the Octane host instead, the call returns
+ * as soon as a newer render result exists, optionally with the images.
+ *
+ * start() runs the waits on a background thread and publishes every new result to frames(),
+ * the render loop takes the newest with consume() and never waits.
+ */
+class ImageWaiterSdk {
+public:
+    struct Settings {
+        std::string address = "127.0.0.1:50054";    // octane_imagewait next to Octane
+        unsigned timeoutMs = 1000;                  // of one wait, the thread asks again after it
+        bool includeImage = true;                   // the thread fetches the pixels with the result
+        unsigned retryMs = 500;                     // before the thread asks again after an error
+    };
+
+    /**
+     * @brief One render result, an image per tonemapped render pass. mBuffer of each image
+     * points into the buffer of the same index, which the frame owns.
+     */
+    struct Frame {
+        std::vector<Octane::ApiRenderImage> images;
+        std::vector<std::vector<char>> buffers;
+        uint64_t sequence = 0;
+        uint64_t changeLevel = 0;
+        float tonemappedSamplesPerPixel = 0.0f;
+    };
+
+    struct Stats {
+        uint64_t waits = 0;
+        uint64_t images = 0;
+        uint64_t timeouts = 0;
+        uint64_t errors = 0;
+        uint64_t bytes = 0;
+        double waitMs = 0.0;                        // inside waits that returned an image
+    };
+
+    ImageWaiterSdk() : ImageWaiterSdk(Settings()) {}
+    explicit ImageWaiterSdk(const Settings& settings);
+
+    /**
+     * @brief Use a channel of its own instead of one to settings.address. It must accept
+     * messages of a whole render result.
+     */
+    ImageWaiterSdk(const Settings& settings, std::shared_ptr<grpc::Channel> channel);
+    ~ImageWaiterSdk();
+
+    const Settings& settings() const { return m_settings; }
+
+    /**
+     * @brief Wait until the render result is newer than afterSequence and has at least
+     * minChangeLevel. Returns false on timeout or error. frame receives the result, with the
+     * images if includeImage is set. Can be called from any thread.
+     */
+    bool waitForImage(uint64_t minChangeLevel,
+                      uint64_t afterSequence,
+                      unsigned timeoutMs,
+                      bool includeImage,
+                      Frame& frame,
+                      std::string* error = nullptr);
+
+    /**
+     * @brief Start or stop the thread feeding frames()
+     */
+    void start();
+    void stop();
+    bool running() const { return m_running; }
+
+    /**
+     * @brief The thread skips results below this change level, e.g. the ones rendered
+     * before the last scene change
+     */
+    void setMinChangeLevel(uint64_t changeLevel) { m_minChangeLevel = changeLevel; }
+
+    /**
+     * @brief Newest result of the thread, the consumer side belongs to one thread
+     */
+    SharedUtils::FrameMailbox<Frame>& frames() { return m_frames; }
+
+    Stats stats() const;
+    void printSummary(std::ostream& out) const;
+
+private:
+    void run();
+    bool wait(grpc::ClientContext& context, uint64_t minChangeLevel, uint64_t afterSequence,
+              unsigned timeoutMs, bool includeImage, Frame& frame, std::string* error);
+
+    const Settings m_settings;
+    std::shared_ptr<grpc::Channel> m_channel;
+
+    SharedUtils::FrameMailbox<Frame> m_frames;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::atomic<uint64_t> m_minChangeLevel;
+
+    mutable std::mutex m_mutex;
+    grpc::ClientContext* m_threadContext;   // wait of the thread, cancelled by stop()
+    Stats m_stats;
+};
+#endif
+
+#endif // IMAGE_WAITER_SDK_H
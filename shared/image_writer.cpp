@@ -0,0 +1,597 @@
+#include "image_writer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <zlib.h>
+
+namespace SharedUtils {
+
+namespace {
+
+    // bytes of encoded data per parallel task, smaller tasks cost more than they gain
+    const size_t MIN_BYTES_PER_TASK = 256 * 1024;
+
+    inline void put16(uint8_t* p, uint16_t v)
+    {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+    }
+
+    inline void put32(uint8_t* p, uint32_t v)
+    {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+        p[2] = (uint8_t)(v >> 16);
+        p[3] = (uint8_t)(v >> 24);
+    }
+
+    inline void put32BE(uint8_t* p, uint32_t v)
+    {
+        p[0] = (uint8_t)(v >> 24);
+        p[1] = (uint8_t)(v >> 16);
+        p[2] = (uint8_t)(v >> 8);
+        p[3] = (uint8_t)v;
+    }
+
+    inline void append(std::vector<uint8_t>& out, const void* data, size_t size)
+    {
+        const uint8_t* bytes = (const uint8_t*)data;
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    inline void appendString(std::vector<uint8_t>& out, const char* s)
+    {
+        append(out, s, std::strlen(s) + 1);
+    }
+
+    inline void append32(std::vector<uint8_t>& out, uint32_t v)
+    {
+        uint8_t b[4];
+        put32(b, v);
+        append(out, b, 4);
+    }
+
+    inline const uint8_t* rowOf(const ImageFrame& frame, uint32_t y)
+    {
+        return (const uint8_t*)frame.pixels.get() + (size_t)y * frame.pitch;
+    }
+
+    bool validFrame(const ImageFrame& frame)
+    {
+        const size_t bpp = PixelConvert::bytesPerPixel(frame.format);
+        return frame.pixels && bpp != 0 && frame.width != 0 && frame.height != 0 &&
+               frame.pitch >= frame.width * bpp;
+    }
+
+    // Rows per parallel task for rows of rowBytes encoded bytes
+    size_t minRowsPerTask(size_t rowBytes)
+    {
+        return std::max<size_t>(1, MIN_BYTES_PER_TASK / std::max<size_t>(rowBytes, 1));
+    }
+
+    double msSince(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+} // namespace
+
+
+ImageWriter::ImageWriter(unsigned workerCount, size_t maxQueued, unsigned encodeThreads)
+    : mEncodePool(encodeThreads),
+      mMaxQueued(std::max<size_t>(maxQueued, 1))
+{
+    workerCount = std::max(workerCount, 1u);
+    mWorkers.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; ++i)
+    {
+        mWorkers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ImageWriter::~ImageWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mQueueChanged.notify_all();
+    for (std::thread& worker : mWorkers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+}
+
+bool ImageWriter::enqueue(const std::string& path, ImageFileFormat fileFormat, ImageFrame frame, bool waitIfFull,
+                          Completion onWritten)
+{
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (mQueue.size() >= mMaxQueued)
+        {
+            if (!waitIfFull)
+            {
+                ++mStats.dropped;
+                return false;
+            }
+            mQueueChanged.wait(lock, [this]() { return mQueue.size() < mMaxQueued; });
+        }
+        mQueue.push_back(Job{ path, fileFormat, std::move(frame), std::move(onWritten) });
+        ++mStats.queued;
+    }
+    mQueueChanged.notify_all();
+    return true;
+}
+
+void ImageWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mQueueChanged.wait(lock, [this]() { return mQueue.empty() && mBusy == 0; });
+}
+
+ImageWriter::Stats ImageWriter::stats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void ImageWriter::workerLoop()
+{
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mQueueChanged.wait(lock, [this]() { return mStopping || !mQueue.empty(); });
+            if (mQueue.empty())
+            {
+                return;
+            }
+            job = std::move(mQueue.front());
+            mQueue.pop_front();
+            ++mBusy;
+        }
+        // wake a producer waiting for space
+        mQueueChanged.notify_all();
+
+        const JobResult result = writeFile(job.path, job.fileFormat, job.frame);
+        // release the pixels before reporting the job as done
+        job.frame.pixels.reset();
+        if (job.onWritten)
+        {
+            job.onWritten(result);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            --mBusy;
+        }
+        mQueueChanged.notify_all();
+    }
+}
+
+bool ImageWriter::write(const std::string& path, ImageFileFormat fileFormat, const ImageFrame& frame)
+{
+    return writeFile(path, fileFormat, frame).ok;
+}
+
+ImageWriter::JobResult ImageWriter::writeFile(const std::string& path, ImageFileFormat fileFormat, const ImageFrame& frame)
+{
+    // keeps its capacity between frames of the same size
+    thread_local std::vector<uint8_t> file;
+
+    JobResult result;
+    auto start = std::chrono::high_resolution_clock::now();
+    bool ok = encode(fileFormat, frame, file);
+    result.encodeMs = msSince(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    if (ok)
+    {
+        std::FILE* out = std::fopen(path.c_str(), "wb");
+        if (out)
+        {
+            // the file is complete in memory, write it in one go without stdio buffering
+            std::setvbuf(out, nullptr, _IONBF, 0);
+            ok = std::fwrite(file.data(), 1, file.size(), out) == file.size();
+            ok = (std::fclose(out) == 0) && ok;
+        }
+        else
+        {
+            ok = false;
+        }
+    }
+    result.writeMs = msSince(start);
+    result.ok = ok;
+    result.bytes = ok ? file.size() : 0;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (ok)
+    {
+        ++mStats.written;
+        mStats.bytesWritten += file.size();
+        mStats.lastEncodeMs = result.encodeMs;
+        mStats.lastWriteMs = result.writeMs;
+    }
+    else
+    {
+        ++mStats.failed;
+    }
+    return result;
+}
+
+bool ImageWriter::encode(ImageFileFormat fileFormat, const ImageFrame& frame, std::vector<uint8_t>& file)
+{
+    if (!validFrame(frame))
+    {
+        return false;
+    }
+    switch (fileFormat)
+    {
+    case IMAGE_FILE_BMP: return encodeBmp(frame, file);
+    case IMAGE_FILE_PPM: return encodePpm(frame, file);
+    case IMAGE_FILE_PNG: return encodePng(frame, file);
+    case IMAGE_FILE_EXR: return encodeExr(frame, file);
+    default:             return false;
+    }
+}
+
+bool ImageWriter::formatFromName(const std::string& name, ImageFileFormat& fileFormat)
+{
+    std::string ext = name.substr(name.find_last_of('.') + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    const ImageFileFormat formats[] = { IMAGE_FILE_BMP, IMAGE_FILE_PPM, IMAGE_FILE_PNG, IMAGE_FILE_EXR };
+    for (ImageFileFormat f : formats)
+    {
+        if (ext == extension(f))
+        {
+            fileFormat = f;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* ImageWriter::extension(ImageFileFormat fileFormat)
+{
+    switch (fileFormat)
+    {
+    case IMAGE_FILE_BMP: return "bmp";
+    case IMAGE_FILE_PPM: return "ppm";
+    case IMAGE_FILE_PNG: return "png";
+    case IMAGE_FILE_EXR: return "exr";
+    default:             return "";
+    }
+}
+
+bool ImageWriter::encodeBmp(const ImageFrame& frame, std::vector<uint8_t>& file)
+{
+    const uint32_t rowSize = frame.width * 4;
+    const uint32_t imageSize = rowSize * frame.height;
+    const uint32_t headerSize = 14 + 40;
+    file.resize(headerSize + (size_t)imageSize);
+
+    // BITMAPFILEHEADER
+    uint8_t* h = file.data();
+    h[0] = 'B';
+    h[1] = 'M';
+    put32(h + 2, headerSize + imageSize);
+    put32(h + 6, 0);
+    put32(h + 10, headerSize);
+    // BITMAPINFOHEADER, a positive height stores the rows bottom up
+    put32(h + 14, 40);
+    put32(h + 18, frame.width);
+    put32(h + 22, frame.height);
+    put16(h + 26, 1);
+    put16(h + 28, 32);
+    put32(h + 30, 0);
+    put32(h + 34, imageSize);
+    put32(h + 38, 2835);   // 72 DPI
+    put32(h + 42, 2835);
+    put32(h + 46, 0);
+    put32(h + 50, 0);
+
+    static const uint8_t toBgra[4] = { 2, 1, 0, 3 };
+    uint8_t* pixels = file.data() + headerSize;
+    mEncodePool.parallelFor(frame.height, minRowsPerTask(rowSize), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y)
+        {
+            uint8_t* dst = pixels + (frame.height - 1 - y) * rowSize;
+            PixelConvert::convertToRgba8(frame.format, rowOf(frame, (uint32_t)y), frame.pitch, frame.width, 1, dst, rowSize);
+            PixelConvert::swizzle8(dst, dst, frame.width, toBgra);
+        }
+    });
+    return true;
+}
+
+bool ImageWriter::encodePpm(const ImageFrame& frame, std::vector<uint8_t>& file)
+{
+    const std::string header = "P6\n" + std::to_string(frame.width) + " " + std::to_string(frame.height) + "\n255\n";
+    const size_t rowSize = (size_t)frame.width * 3;
+    file.resize(header.size() + rowSize * frame.height);
+    std::memcpy(file.data(), header.data(), header.size());
+
+    uint8_t* pixels = file.data() + header.size();
+    mEncodePool.parallelFor(frame.height, minRowsPerTask(rowSize), [&](size_t begin, size_t end) {
+        std::vector<uint8_t> rgba((size_t)frame.width * 4);
+        for (size_t y = begin; y < end; ++y)
+        {
+            PixelConvert::convertToRgba8(frame.format, rowOf(frame, (uint32_t)y), frame.pitch, frame.width, 1, rgba.data(), rgba.size());
+            const uint8_t* src = rgba.data();
+            uint8_t* dst = pixels + y * rowSize;
+            for (uint32_t x = 0; x < frame.width; ++x, src += 4, dst += 3)
+            {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+            }
+        }
+    });
+    return true;
+}
+
+/**
+ * The image data is split into row groups that are filtered and deflated in parallel,
+ * each ending on a byte boundary (Z_SYNC_FLUSH) so the raw deflate blocks concatenate
+ * into one zlib stream. Every group becomes its own IDAT chunk, the Adler-32 of the
+ * whole stream is combined from the per-group checksums.
+ */
+bool ImageWriter::encodePng(const ImageFrame& frame, std::vector<uint8_t>& file)
+{
+    const size_t rowSize = (size_t)frame.width * 4;
+    const size_t filteredRowSize = rowSize + 1;
+    const size_t groupCount = std::max<size_t>(1, std::min<size_t>(mEncodePool.threadCount() + 1,
+        filteredRowSize * frame.height / MIN_BYTES_PER_TASK));
+    const size_t groupRows = (frame.height + groupCount - 1) / groupCount;
+
+    struct Group
+    {
+        std::vector<uint8_t> chunk;     // complete IDAT chunk
+        uLong adler = 0;
+        size_t filteredSize = 0;
+        bool ok = false;
+    };
+    std::vector<Group> groups(groupCount);
+
+    mEncodePool.parallelFor(groupCount, 1, [&](size_t firstGroup, size_t endGroup) {
+        std::vector<uint8_t> rows;
+        for (size_t g = firstGroup; g < endGroup; ++g)
+        {
+            Group& group = groups[g];
+            const uint32_t firstRow = (uint32_t)std::min<size_t>(g * groupRows, frame.height);
+            const uint32_t endRow = (uint32_t)std::min<size_t>(firstRow + groupRows, frame.height);
+
+            // RGBA rows, each preceded by its filter type. The Sub filter only looks at
+            // the same row, so groups don't depend on each other.
+            group.filteredSize = filteredRowSize * (endRow - firstRow);
+            rows.resize(group.filteredSize);
+            std::vector<uint8_t> rgba(rowSize);
+            for (uint32_t y = firstRow; y < endRow; ++y)
+            {
+                PixelConvert::convertToRgba8(frame.format, rowOf(frame, y), frame.pitch, frame.width, 1, rgba.data(), rowSize, false);
+                uint8_t* dst = rows.data() + (y - firstRow) * filteredRowSize;
+                dst[0] = 1;
+                std::memcpy(dst + 1, rgba.data(), 4);
+                for (size_t i = 4; i < rowSize; ++i)
+                {
+                    dst[1 + i] = (uint8_t)(rgba[i] - rgba[i - 4]);
+                }
+            }
+            group.adler = adler32(adler32(0L, Z_NULL, 0), rows.data(), (uInt)rows.size());
+
+            z_stream stream = {};
+            if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            {
+                continue;
+            }
+            // chunk length, "IDAT", the zlib header in the first group, data, CRC
+            const size_t prefix = 8 + (g == 0 ? 2 : 0);
+            group.chunk.resize(prefix + deflateBound(&stream, (uLong)rows.size()) + 16 + 4);
+            stream.next_in = rows.data();
+            stream.avail_in = (uInt)rows.size();
+            stream.next_out = group.chunk.data() + prefix;
+            stream.avail_out = (uInt)(group.chunk.size() - prefix - 4);
+            const bool last = g + 1 == groupCount;
+            const int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+            const size_t compressed = stream.total_out;
+            deflateEnd(&stream);
+            if (result != (last ? Z_STREAM_END : Z_OK) || stream.avail_in != 0)
+            {
+                continue;
+            }
+
+            uint8_t* chunk = group.chunk.data();
+            const uint32_t length = (uint32_t)(prefix - 8 + compressed);
+            put32BE(chunk, length);
+            std::memcpy(chunk + 4, "IDAT", 4);
+            if (g == 0)
+            {
+                // CMF/FLG for a 32K window at the fastest level
+                chunk[8] = 0x78;
+                chunk[9] = 0x01;
+            }
+            put32BE(chunk + 8 + length, (uint32_t)crc32(0L, chunk + 4, length + 4));
+            group.chunk.resize(8 + length + 4);
+            group.ok = true;
+        }
+    });
+
+    uLong adler = adler32(0L, Z_NULL, 0);
+    size_t total = 8 + 25 + 16 + 12;
+    for (const Group& group : groups)
+    {
+        if (!group.ok)
+        {
+            return false;
+        }
+        adler = adler32_combine(adler, group.adler, (z_off_t)group.filteredSize);
+        total += group.chunk.size();
+    }
+
+    file.clear();
+    file.reserve(total);
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    append(file, signature, 8);
+
+    uint8_t ihdr[25];
+    put32BE(ihdr, 13);
+    std::memcpy(ihdr + 4, "IHDR", 4);
+    put32BE(ihdr + 8, frame.width);
+    put32BE(ihdr + 12, frame.height);
+    ihdr[16] = 8;      // bit depth
+    ihdr[17] = 6;      // RGBA
+    ihdr[18] = 0;      // deflate
+    ihdr[19] = 0;      // adaptive filtering
+    ihdr[20] = 0;      // no interlace
+    put32BE(ihdr + 21, (uint32_t)crc32(0L, ihdr + 4, 17));
+    append(file, ihdr, sizeof(ihdr));
+
+    for (const Group& group : groups)
+    {
+        append(file, group.chunk.data(), group.chunk.size());
+    }
+
+    // the zlib trailer goes into a chunk of its own
+    uint8_t trailer[16];
+    put32BE(trailer, 4);
+    std::memcpy(trailer + 4, "IDAT", 4);
+    put32BE(trailer + 8, (uint32_t)adler);
+    put32BE(trailer + 12, (uint32_t)crc32(0L, trailer + 4, 8));
+    append(file, trailer, sizeof(trailer));
+
+    uint8_t iend[12];
+    put32BE(iend, 0);
+    std::memcpy(iend + 4, "IEND", 4);
+    put32BE(iend + 8, (uint32_t)crc32(0L, iend + 4, 4));
+    append(file, iend, sizeof(iend));
+    return true;
+}
+
+/**
+ * Uncompressed scanline OpenEXR with half channels, one scanline per block. Float and
+ * half images keep their values, 8-bit images are written as value / 255.
+ */
+bool ImageWriter::encodeExr(const ImageFrame& frame, std::vector<uint8_t>& file)
+{
+    const unsigned channels = PixelConvert::channelCount(frame.format);
+    // channels are stored in alphabetical order, as indices into the interleaved source pixel
+    static const char* const rgbaNames[4] = { "A", "B", "G", "R" };
+    static const unsigned rgbaOrder[4] = { 3, 2, 1, 0 };
+    static const char* const monoAlphaNames[2] = { "A", "Y" };
+    static const unsigned monoAlphaOrder[2] = { 1, 0 };
+    static const char* const monoNames[1] = { "Y" };
+    static const unsigned monoOrder[1] = { 0 };
+    const char* const* names = channels == 4 ? rgbaNames : (channels == 2 ? monoAlphaNames : monoNames);
+    const unsigned* order = channels == 4 ? rgbaOrder : (channels == 2 ? monoAlphaOrder : monoOrder);
+
+    std::vector<uint8_t> header;
+    append32(header, 20000630);     // magic
+    append32(header, 2);            // version 2, single part scanline
+
+    auto attribute = [&header](const char* name, const char* type, uint32_t size) {
+        appendString(header, name);
+        appendString(header, type);
+        append32(header, size);
+    };
+
+    uint32_t chlistSize = 1;
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        chlistSize += (uint32_t)std::strlen(names[c]) + 1 + 16;
+    }
+    attribute("channels", "chlist", chlistSize);
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        appendString(header, names[c]);
+        append32(header, 1);        // HALF
+        append32(header, 0);        // pLinear and reserved
+        append32(header, 1);        // x sampling
+        append32(header, 1);        // y sampling
+    }
+    header.push_back(0);
+
+    attribute("compression", "compression", 1);
+    header.push_back(0);            // NO_COMPRESSION
+    const uint32_t window[4] = { 0, 0, frame.width - 1, frame.height - 1 };
+    attribute("dataWindow", "box2i", 16);
+    append(header, window, 16);
+    attribute("displayWindow", "box2i", 16);
+    append(header, window, 16);
+    attribute("lineOrder", "lineOrder", 1);
+    header.push_back(0);            // INCREASING_Y
+    const float one = 1.f;
+    const float center[2] = { 0.f, 0.f };
+    attribute("pixelAspectRatio", "float", 4);
+    append(header, &one, 4);
+    attribute("screenWindowCenter", "v2f", 8);
+    append(header, center, 8);
+    attribute("screenWindowWidth", "float", 4);
+    append(header, &one, 4);
+    header.push_back(0);
+
+    const size_t blockDataSize = (size_t)frame.width * channels * 2;
+    const size_t blockSize = 8 + blockDataSize;
+    const size_t offsetTable = header.size();
+    const size_t firstBlock = offsetTable + (size_t)frame.height * 8;
+    file.resize(firstBlock + blockSize * frame.height);
+    std::memcpy(file.data(), header.data(), header.size());
+
+    mEncodePool.parallelFor(frame.height, minRowsPerTask(blockSize), [&](size_t begin, size_t end) {
+        std::vector<float> floats;
+        std::vector<uint16_t> halfs((size_t)frame.width * channels);
+        for (size_t y = begin; y < end; ++y)
+        {
+            const uint64_t offset = firstBlock + y * blockSize;
+            std::memcpy(file.data() + offsetTable + y * 8, &offset, 8);
+
+            uint8_t* block = file.data() + offset;
+            put32(block, (uint32_t)y);
+            put32(block + 4, (uint32_t)blockDataSize);
+
+            // interleaved half row
+            const uint8_t* src = rowOf(frame, (uint32_t)y);
+            const uint16_t* interleaved = halfs.data();
+            switch (frame.format)
+            {
+            case PixelConvert::PIXEL_FORMAT_HALF_RGBA:
+            case PixelConvert::PIXEL_FORMAT_HALF_MONO:
+            case PixelConvert::PIXEL_FORMAT_HALF_MONO_ALPHA:
+                interleaved = (const uint16_t*)src;
+                break;
+            case PixelConvert::PIXEL_FORMAT_HDR_RGBA:
+            case PixelConvert::PIXEL_FORMAT_HDR_MONO:
+            case PixelConvert::PIXEL_FORMAT_HDR_MONO_ALPHA:
+                PixelConvert::floatToHalf((const float*)src, halfs.data(), halfs.size());
+                break;
+            default:
+                floats.resize(halfs.size());
+                for (size_t i = 0; i < floats.size(); ++i)
+                {
+                    floats[i] = src[i] * (1.f / 255.f);
+                }
+                PixelConvert::floatToHalf(floats.data(), halfs.data(), halfs.size());
+                break;
+            }
+
+            uint8_t* dst = block + 8;
+            for (unsigned c = 0; c < channels; ++c)
+            {
+                const uint16_t* channel = interleaved + order[c];
+                for (uint32_t x = 0; x < frame.width; ++x, channel += channels, dst += 2)
+                {
+                    put16(dst, *channel);
+                }
+            }
+        }
+    });
+    return true;
+}
+
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "pixel_convert.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SharedUtils {
+
+    /**
+     * File formats the image writer can encode
+     */
+    enum ImageFileFormat
+    {
+        IMAGE_FILE_BMP = 0,     // 32-bit BGRA, bottom up
+        IMAGE_FILE_PPM,         // binary P6, 8-bit RGB
+        IMAGE_FILE_PNG,         // 8-bit RGBA, fast zlib level
+        IMAGE_FILE_EXR,         // uncompressed scanline OpenEXR, half channels
+    };
+
+    /**
+     * A render image handed to the writer. The pixels are shared, so the receiver can
+     * pass ownership of the buffer it got from Octane without copying it. Any
+     * PixelConvert format is accepted; 8-bit files are converted like convertToRgba8(),
+     * EXR files keep the HDR values.
+     */
+    struct ImageFrame
+    {
+        PixelConvert::PixelFormat format = PixelConvert::PIXEL_FORMAT_LDR_RGBA;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t pitch = 0;                       // bytes per row
+        std::shared_ptr<const void> pixels;
+    };
+
+    /**
+     * Asynchronous image file writer for frame dumps. Frames are queued by the thread
+     * that receives them and encoded by worker threads; the rows of one frame are
+     * encoded in parallel on a separate pool and each file is written with a few large
+     * writes. The queue is bounded so a slow disk can't pile up frames without limit.
+     */
+    class ImageWriter {
+    public:
+        struct Stats
+        {
+            uint64_t queued = 0;
+            uint64_t written = 0;
+            uint64_t dropped = 0;           // rejected because the queue was full
+            uint64_t failed = 0;
+            uint64_t bytesWritten = 0;
+            double lastEncodeMs = 0.0;
+            double lastWriteMs = 0.0;
+        };
+
+        /**
+         * Outcome of one queued frame, passed to its completion callback on the worker thread
+         */
+        struct JobResult
+        {
+            bool ok = false;
+            size_t bytes = 0;
+            double encodeMs = 0.0;
+            double writeMs = 0.0;
+        };
+        using Completion = std::function<void(const JobResult&)>;
+
+        /**
+         * workerCount frames are encoded at the same time, each with up to
+         * encodeThreads + 1 threads. 0 encode threads uses one per hardware thread.
+         */
+        explicit ImageWriter(unsigned workerCount = 2, size_t maxQueued = 8, unsigned encodeThreads = 0);
+
+        /**
+         * Writes the frames that are still queued, then stops the workers
+         */
+        ~ImageWriter();
+
+        ImageWriter(const ImageWriter&) = delete;
+        ImageWriter& operator=(const ImageWriter&) = delete;
+
+        /**
+         * Queue a frame. With waitIfFull false a full queue drops the frame and
+         * returns false, so the caller never blocks on disk I/O. onWritten is called
+         * once the file is written or failed, it is not called for dropped frames.
+         */
+        bool enqueue(const std::string& path, ImageFileFormat fileFormat, ImageFrame frame, bool waitIfFull = false,
+                     Completion onWritten = nullptr);
+
+        /**
+         * Wait until all queued frames are written
+         */
+        void flush();
+
+        Stats stats() const;
+
+        /**
+         * Encode and write one frame on the calling thread. Returns false on failure.
+         */
+        bool write(const std::string& path, ImageFileFormat fileFormat, const ImageFrame& frame);
+
+        /**
+         * Encode a frame into a complete file image in memory
+         */
+        bool encode(ImageFileFormat fileFormat, const ImageFrame& frame, std::vector<uint8_t>& file);
+
+        /**
+         * File format for an extension (bmp, ppm, png, exr), false if unknown
+         */
+        static bool formatFromName(const std::string& name, ImageFileFormat& fileFormat);
+        static const char* extension(ImageFileFormat fileFormat);
+
+    private:
+        struct Job
+        {
+            std::string path;
+            ImageFileFormat fileFormat;
+            ImageFrame frame;
+            Completion onWritten;
+        };
+
+        void workerLoop();
+        JobResult writeFile(const std::string& path, ImageFileFormat fileFormat, const ImageFrame& frame);
+
+        bool encodeBmp(const ImageFrame& frame, std::vector<uint8_t>& file);
+        bool encodePpm(const ImageFrame& frame, std::vector<uint8_t>& file);
+        bool encodePng(const ImageFrame& frame, std::vector<uint8_t>& file);
+        bool encodeExr(const ImageFrame& frame, std::vector<uint8_t>& file);
+
+        ThreadPool mEncodePool;
+        std::vector<std::thread> mWorkers;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mQueueChanged;
+        std::deque<Job> mQueue;
+        size_t mMaxQueued;
+        unsigned mBusy = 0;
+        bool mStopping = false;
+        Stats mStats;
+    };
+
+};
@@ -0,0 +1,859 @@
+#include "item_array_sdk.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <utility>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "protos/item_array_transfer.grpc.pb.h"
+#include "protos/item_array_transfer.pb.h"
+#include "apitimesampling.h"
+
+// the packed layout is the memory layout of these types, with no padding between elements
+static_assert(sizeof(OctaneVec::int32_3) == 12, "int32_3 is not tightly packed");
+static_assert(sizeof(OctaneVec::int64_2) == 16, "int64_2 is not tightly packed");
+static_assert(sizeof(OctaneVec::float_3) == 12, "float_3 is not tightly packed");
+static_assert(sizeof(OctaneVec::MatrixF) == 48, "MatrixF is not 3 rows of float_4");
+static_assert(static_cast<int>(ItemArraySdk::ElementType::Float3) == octanearrays::PACKED_FLOAT3, "ElementType out of sync");
+static_assert(static_cast<int>(ItemArraySdk::ElementType::Byte) == octanearrays::PACKED_BYTE, "ElementType out of sync");
+
+namespace {
+
+double msSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+std::shared_ptr<grpc::Channel> createChannel(const std::string& address) {
+    // arrays of a big mesh are well above the default 4 MB receive limit
+    grpc::ChannelArguments arguments;
+    arguments.SetMaxReceiveMessageSize(-1);
+    return grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), arguments);
+}
+
+// protobuf wire types
+const uint32_t WIRE_VARINT = 0;
+const uint32_t WIRE_FIXED64 = 1;
+const uint32_t WIRE_BYTES = 2;
+const uint32_t WIRE_FIXED32 = 5;
+
+/**
+ * @brief Reads protobuf wire format across the slices of a received message
+ */
+class SliceReader {
+public:
+    explicit SliceReader(const std::vector<grpc::Slice>& slices)
+        : m_slices(slices), m_slice(0), m_offset(0), m_position(0) {}
+
+    size_t position() const { return m_position; }
+
+    bool atEnd() {
+        while (m_slice < m_slices.size() && m_offset == m_slices[m_slice].size()) {
+            ++m_slice;
+            m_offset = 0;
+        }
+        return m_slice == m_slices.size();
+    }
+
+    bool varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (atEnd()) {
+                return false;
+            }
+            const uint8_t byte = m_slices[m_slice].begin()[m_offset++];
+            ++m_position;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // out may be null to skip the bytes
+    bool copy(void* out, size_t size) {
+        char* dst = static_cast<char*>(out);
+        while (size > 0) {
+            if (atEnd()) {
+                return false;
+            }
+            const size_t chunk = std::min(size, m_slices[m_slice].size() - m_offset);
+            if (dst) {
+                std::memcpy(dst, m_slices[m_slice].begin() + m_offset, chunk);
+                dst += chunk;
+            }
+            m_offset += chunk;
+            m_position += chunk;
+            size -= chunk;
+        }
+        return true;
+    }
+
+    bool skipField(uint32_t wireType) {
+        uint64_t value = 0;
+        switch (wireType) {
+        case WIRE_VARINT:  return varint(value);
+        case WIRE_FIXED64: return copy(nullptr, 8);
+        case WIRE_BYTES:   return varint(value) && copy(nullptr, static_cast<size_t>(value));
+        case WIRE_FIXED32: return copy(nullptr, 4);
+        default:           return false;
+        }
+    }
+
+private:
+    const std::vector<grpc::Slice>& m_slices;
+    size_t m_slice;
+    size_t m_offset;
+    size_t m_position;
+};
+
+/**
+ * @brief Decodes the PackedArray of a GetPackedArrayResponse. The data goes to out if it holds
+ * at most capacity bytes, fits is false otherwise.
+ */
+bool decodePackedArray(SliceReader& in, size_t end, uint64_t& type, uint64_t& count,
+                       void* out, size_t capacity, size_t& bytes, bool& fits) {
+    while (in.position() < end) {
+        uint64_t key = 0;
+        if (!in.varint(key)) {
+            return false;
+        }
+        const uint32_t field = static_cast<uint32_t>(key >> 3);
+        const uint32_t wireType = static_cast<uint32_t>(key & 7);
+        if (field == 1 && wireType == WIRE_VARINT) {
+            if (!in.varint(type)) {
+                return false;
+            }
+        } else if (field == 2 && wireType == WIRE_VARINT) {
+            if (!in.varint(count)) {
+                return false;
+            }
+        } else if (field == 3 && wireType == WIRE_BYTES) {
+            uint64_t size = 0;
+            if (!in.varint(size)) {
+                return false;
+            }
+            bytes = static_cast<size_t>(size);
+            fits = bytes <= capacity;
+            if (!in.copy(fits ? out : nullptr, bytes)) {
+                return false;
+            }
+        } else if (!in.skipField(wireType)) {
+            return false;
+        }
+    }
+    return in.position() == end;
+}
+
+}
+
+ItemArraySdk::ItemArraySdk(const Settings& settings)
+    : ItemArraySdk(settings, createChannel(settings.address))
+{
+}
+
+ItemArraySdk::ItemArraySdk(const Settings& settings, std::shared_ptr<grpc::Channel> channel)
+    : m_settings(settings)
+    , m_channel(std::move(channel))
+    , m_genericStub(m_channel)
+{
+}
+
+size_t ItemArraySdk::elementSize(ElementType type) {
+    switch (type) {
+    case ElementType::Bool:   return 1;
+    case ElementType::Int:    return sizeof(int32_t);
+    case ElementType::Int2:   return sizeof(OctaneVec::int32_2);
+    case ElementType::Int3:   return sizeof(OctaneVec::int32_3);
+    case ElementType::Int4:   return sizeof(OctaneVec::int32_4);
+    case ElementType::Long:   return sizeof(int64_t);
+    case ElementType::Long2:  return sizeof(OctaneVec::int64_2);
+    case ElementType::Float:  return sizeof(float);
+    case ElementType::Float2: return sizeof(OctaneVec::float_2);
+    case ElementType::Float3: return sizeof(OctaneVec::float_3);
+    case ElementType::Float4: return sizeof(OctaneVec::float_4);
+    case ElementType::Matrix: return sizeof(OctaneVec::MatrixF);
+    case ElementType::Byte:   return 1;
+    }
+    return 0;
+}
+
+bool ItemArraySdk::setPacked(const OctaneGRPC::ApiItemProxy& item,
+                             Octane::AttributeId id,
+                             ElementType type,
+                             const void* data,
+                             size_t count,
+                             bool evaluate,
+                             std::string* error) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    octanearrays::SetPackedArrayRequest request;
+    request.set_itemhandle(static_cast<uint64_t>(item.getObjectHandle()));
+    request.set_attributeid(static_cast<uint32_t>(id));
+    request.set_evaluate(evaluate);
+    octanearrays::PackedArray* array = request.mutable_array();
+    array->set_type(static_cast<octanearrays::PackedType>(type));
+    array->set_count(count);
+    // x86 and ARM are little endian, the memory is the wire format
+    array->set_data(data, count * elementSize(type));
+
+    grpc::ClientContext context;
+    octanearrays::SetPackedArrayResponse response;
+    const grpc::Status status = octanearrays::ItemArrayTransfer::NewStub(m_channel)->setPackedArray(&context, request, &response);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!status.ok()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = "setPackedArray: " + status.error_message();
+        }
+        return false;
+    }
+    if (!response.success()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = "setPackedArray: refused by Octane";
+        }
+        return false;
+    }
+    ++m_stats.sets;
+    m_stats.bytesSent += array->data().size();
+    m_stats.setMs += msSince(start);
+    return true;
+}
+
+bool ItemArraySdk::setStream(const OctaneGRPC::ApiItemProxy& item,
+                             Octane::AttributeId id,
+                             ElementType type,
+                             const void* data,
+                             size_t count,
+                             bool evaluate,
+                             const ProgressCallback& progress,
+                             std::string* error) {
+    const char* next = static_cast<const char*>(data);
+    size_t left = count * elementSize(type);
+    const ChunkSource source = [&next, &left](void* buffer, size_t capacity) {
+        const size_t size = std::min(capacity, left);
+        std::memcpy(buffer, next, size);
+        next += size;
+        left -= size;
+        return size;
+    };
+    return setStream(item, id, type, source, count, evaluate, progress, error);
+}
+
+bool ItemArraySdk::setStream(const OctaneGRPC::ApiItemProxy& item,
+                             Octane::AttributeId id,
+                             ElementType type,
+                             const ChunkSource& source,
+                             uint64_t count,
+                             bool evaluate,
+                             const ProgressCallback& progress,
+                             std::string* error) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    // whole elements per chunk, so the service doesn't have to join split ones
+    const size_t size = elementSize(type);
+    const size_t chunkBytes = std::max(size, m_settings.chunkBytes / size * size);
+
+    grpc::ClientContext context;
+    octanearrays::SetPackedArrayResponse response;
+    std::unique_ptr<grpc::ClientWriter<octanearrays::SetArrayChunk>> writer =
+        octanearrays::ItemArrayTransfer::NewStub(m_channel)->setArrayStream(&context, &response);
+
+    octanearrays::SetArrayChunk chunk;
+    chunk.set_itemhandle(static_cast<uint64_t>(item.getObjectHandle()));
+    chunk.set_attributeid(static_cast<uint32_t>(id));
+    chunk.set_evaluate(evaluate);
+    chunk.set_type(static_cast<octanearrays::PackedType>(type));
+    chunk.set_count(count);
+
+    UploadProgress state;
+    state.totalBytes = count * size;
+    std::string* buffer = chunk.mutable_data();
+    bool cancelled = false;
+    while (true) {
+        buffer->resize(chunkBytes);
+        const size_t filled = source(&(*buffer)[0], chunkBytes);
+        // an empty array still needs the first chunk for the item and attribute
+        if (filled == 0 && state.chunks > 0) {
+            break;
+        }
+        buffer->resize(filled);
+        if (!writer->Write(chunk)) {
+            break;                                  // the service gave up, Finish() tells why
+        }
+        if (state.chunks == 0) {
+            chunk.clear_itemhandle();
+            chunk.clear_attributeid();
+            chunk.clear_evaluate();
+            chunk.clear_type();
+            chunk.clear_count();
+        }
+        state.bytesSent += filled;
+        ++state.chunks;
+        if (filled == 0) {
+            break;
+        }
+        if (progress && !progress(state)) {
+            cancelled = true;
+            context.TryCancel();
+            break;
+        }
+    }
+    if (!cancelled) {
+        writer->WritesDone();
+    }
+    const grpc::Status status = writer->Finish();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!status.ok()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = cancelled ? "setArrayStream: cancelled after " + std::to_string(state.bytesSent) + " bytes"
+                               : "setArrayStream: " + status.error_message();
+        }
+        return false;
+    }
+    if (!response.success()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = "setArrayStream: refused by Octane";
+        }
+        return false;
+    }
+    ++m_stats.sets;
+    ++m_stats.streams;
+    m_stats.chunks += state.chunks;
+    m_stats.bytesSent += state.bytesSent;
+    m_stats.setMs += msSince(start);
+    return true;
+}
+
+void ItemArraySdk::ArrayBatch::add(Octane::AttributeId id, const char* const* arr, size_t size) {
+    m_entries.push_back({ id, ElementType::Byte, nullptr, size, true, std::vector<std::string>(arr, arr + size) });
+}
+
+void ItemArraySdk::ArrayBatch::addPacked(Octane::AttributeId id, ElementType type, const void* data, size_t count) {
+    m_entries.push_back({ id, type, data, count, false, {} });
+}
+
+bool ItemArraySdk::setAnimStream(const OctaneGRPC::ApiItemProxy& item,
+                                 Octane::AttributeId id,
+                                 ElementType type,
+                                 const Octane::ApiTimeSampling& times,
+                                 size_t count,
+                                 size_t samples,
+                                 const SampleSource& source,
+                                 const AnimOptions& options,
+                                 bool evaluate,
+                                 std::string* error) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    SharedUtils::SampleFormat format;
+    format.encoding = options.encoding;
+    format.delta = options.delta;
+    format.rangeMin = options.rangeMin;
+    format.rangeMax = options.rangeMax;
+    format.sampleBytes = count * elementSize(type);
+    format.floats = type >= ElementType::Float && type <= ElementType::Matrix;
+    const std::string problem = samples == 0 ? std::string("no samples") : format.check();
+    if (!problem.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.errors;
+        if (error) {
+            *error = "setAnimStream: " + problem;
+        }
+        return false;
+    }
+
+    grpc::ClientContext context;
+    octanearrays::SetPackedArrayResponse response;
+    std::unique_ptr<grpc::ClientWriter<octanearrays::AnimSample>> writer =
+        octanearrays::ItemArrayTransfer::NewStub(m_channel)->setAnimStream(&context, &response);
+
+    octanearrays::AnimSample message;
+    message.set_itemhandle(static_cast<uint64_t>(item.getObjectHandle()));
+    message.set_attributeid(static_cast<uint32_t>(id));
+    message.set_evaluate(evaluate);
+    message.set_type(static_cast<octanearrays::PackedType>(type));
+    message.set_count(count);
+    message.set_samples(static_cast<uint32_t>(samples));
+    octanearrays::AnimTiming* timing = message.mutable_timing();
+    for (size_t i = 0; i < times.mPatternSize; ++i) {
+        timing->add_pattern(times.mPattern[i]);
+    }
+    timing->set_period(times.mPeriod);
+    timing->set_endtime(times.mEndTime);
+    timing->set_animationtype(static_cast<uint32_t>(times.mAnimationType));
+    message.set_encoding(static_cast<octanearrays::SampleEncoding>(options.encoding));
+    message.set_delta(options.delta);
+    message.set_rangemin(options.rangeMin);
+    message.set_rangemax(options.rangeMax);
+
+    SharedUtils::SampleEncoder encoder(format);
+    std::vector<char> values(format.sampleBytes);
+    uint64_t bytes = 0;
+    size_t sent = 0;
+    bool cancelled = false;
+    for (; sent < samples; ++sent) {
+        if (!source(sent, values.data())) {
+            cancelled = true;
+            context.TryCancel();
+            break;
+        }
+        encoder.encode(values.data(), *message.mutable_data());
+        if (!writer->Write(message)) {
+            break;                                  // the service gave up, Finish() tells why
+        }
+        bytes += message.data().size();
+        if (sent == 0) {
+            // only data after the first sample, the next encode() overwrites it
+            message.Clear();
+        }
+    }
+    if (!cancelled) {
+        writer->WritesDone();
+    }
+    const grpc::Status status = writer->Finish();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!status.ok()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = cancelled ? "setAnimStream: cancelled after " + std::to_string(sent) + " samples"
+                               : "setAnimStream: " + status.error_message();
+        }
+        return false;
+    }
+    if (!response.success()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = "setAnimStream: refused by Octane";
+        }
+        return false;
+    }
+    ++m_stats.sets;
+    ++m_stats.animations;
+    m_stats.animSamples += sent;
+    m_stats.animRawBytes += sent * format.sampleBytes;
+    m_stats.bytesSent += bytes;
+    m_stats.setMs += msSince(start);
+    return true;
+}
+
+bool ItemArraySdk::setMany(const OctaneGRPC::ApiItemProxy& item,
+                           const ArrayBatch& batch,
+                           bool evaluate,
+                           std::string* error) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    octanearrays::SetArraysRequest request;
+    request.set_itemhandle(static_cast<uint64_t>(item.getObjectHandle()));
+    request.set_evaluate(evaluate);
+    uint64_t bytes = 0;
+    for (const ArrayBatch::Entry& entry : batch.m_entries) {
+        octanearrays::AttributeArray* attribute = request.add_arrays();
+        attribute->set_attributeid(static_cast<uint32_t>(entry.id));
+        if (entry.isStrings) {
+            for (const std::string& value : entry.strings) {
+                attribute->mutable_strings()->add_data(value);
+            }
+            continue;
+        }
+        octanearrays::PackedArray* array = attribute->mutable_array();
+        array->set_type(static_cast<octanearrays::PackedType>(entry.type));
+        array->set_count(entry.count);
+        array->set_data(entry.data, entry.count * elementSize(entry.type));
+        bytes += array->data().size();
+    }
+
+    grpc::ClientContext context;
+    octanearrays::SetPackedArrayResponse response;
+    const grpc::Status status = octanearrays::ItemArrayTransfer::NewStub(m_channel)->setArrays(&context, request, &response);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!status.ok()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = "setArrays: " + status.error_message();
+        }
+        return false;
+    }
+    if (!response.success()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = "setArrays: refused by Octane";
+        }
+        return false;
+    }
+    ++m_stats.transactions;
+    m_stats.sets += batch.m_entries.size();
+    m_stats.bytesSent += bytes;
+    m_stats.setMs += msSince(start);
+    return true;
+}
+
+bool ItemArraySdk::getPacked(const OctaneGRPC::ApiItemProxy& item,
+                             Octane::AttributeId id,
+                             ElementType type,
+                             std::string& data,
+                             std::string* error) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    octanearrays::GetPackedArrayRequest request;
+    request.set_itemhandle(static_cast<uint64_t>(item.getObjectHandle()));
+    request.set_attributeid(static_cast<uint32_t>(id));
+    request.set_type(static_cast<octanearrays::PackedType>(type));
+
+    grpc::ClientContext context;
+    octanearrays::GetPackedArrayResponse response;
+    const grpc::Status status = octanearrays::ItemArrayTransfer::NewStub(m_channel)->getPackedArray(&context, request, &response);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const octanearrays::PackedArray& array = response.array();
+    std::string failure;
+    if (!status.ok()) {
+        failure = "getPackedArray: " + status.error_message();
+    } else if (array.data().size() != array.count() * elementSize(type)) {
+        failure = "getPackedArray: " + std::to_string(array.count()) + " elements in " +
+                  std::to_string(array.data().size()) + " bytes";
+    }
+    if (!failure.empty()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = failure;
+        }
+        return false;
+    }
+    data.swap(*response.mutable_array()->mutable_data());
+    ++m_stats.gets;
+    m_stats.bytesReceived += data.size();
+    m_stats.getMs += msSince(start);
+    return true;
+}
+
+bool ItemArraySdk::size(const OctaneGRPC::ApiItemProxy& item,
+                        Octane::AttributeId id,
+                        ElementType type,
+                        size_t& count,
+                        std::string* error) {
+    octanearrays::GetPackedArrayRequest request;
+    request.set_itemhandle(static_cast<uint64_t>(item.getObjectHandle()));
+    request.set_attributeid(static_cast<uint32_t>(id));
+    request.set_type(static_cast<octanearrays::PackedType>(type));
+    request.set_sizeonly(true);
+
+    grpc::ClientContext context;
+    octanearrays::GetPackedArrayResponse response;
+    const grpc::Status status = octanearrays::ItemArrayTransfer::NewStub(m_channel)->getPackedArray(&context, request, &response);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!status.ok()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = "getPackedArray: " + status.error_message();
+        }
+        return false;
+    }
+    ++m_stats.sizeQueries;
+    count = static_cast<size_t>(response.array().count());
+    return true;
+}
+
+bool ItemArraySdk::readPacked(const OctaneGRPC::ApiItemProxy& item,
+                              Octane::AttributeId id,
+                              ElementType type,
+                              void* out,
+                              size_t capacity,
+                              size_t& count,
+                              std::string* error) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    octanearrays::GetPackedArrayRequest request;
+    request.set_itemhandle(static_cast<uint64_t>(item.getObjectHandle()));
+    request.set_attributeid(static_cast<uint32_t>(id));
+    request.set_type(static_cast<octanearrays::PackedType>(type));
+
+    // the response stays in the slices gRPC received it in, nothing is parsed into a message
+    grpc::Slice requestSlice(request.SerializeAsString());
+    const grpc::ByteBuffer requestBuffer(&requestSlice, 1);
+    grpc::ClientContext context;
+    grpc::CompletionQueue queue;
+    grpc::ByteBuffer received;
+    grpc::Status status;
+    std::unique_ptr<grpc::GenericClientAsyncResponseReader> call =
+        m_genericStub.PrepareUnaryCall(&context, "/octanearrays.ItemArrayTransfer/getPackedArray", requestBuffer, &queue);
+    call->StartCall();
+    call->Finish(&received, &status, call.get());
+    void* tag = nullptr;
+    bool finished = false;
+    if (!queue.Next(&tag, &finished) || !finished) {
+        status = grpc::Status(grpc::StatusCode::INTERNAL, "the call did not complete");
+    }
+    // a completion queue has to be drained before it is destroyed
+    queue.Shutdown();
+    while (queue.Next(&tag, &finished)) {
+    }
+
+    // the slice list of the thread is reused by the next read
+    thread_local std::vector<grpc::Slice> slices;
+    const size_t elementBytes = elementSize(type);
+    uint64_t receivedType = 0;
+    uint64_t receivedCount = 0;
+    size_t bytes = 0;
+    bool fits = true;
+    std::string failure;
+    if (status.ok()) {
+        status = received.Dump(&slices);
+    }
+    if (!status.ok()) {
+        failure = "getPackedArray: " + status.error_message();
+    } else {
+        SliceReader in(slices);
+        bool decoded = true;
+        while (decoded && !in.atEnd()) {
+            uint64_t key = 0;
+            uint64_t size = 0;
+            decoded = in.varint(key);
+            if (!decoded) {
+                break;
+            }
+            if (key == ((1 << 3) | WIRE_BYTES)) {
+                // GetPackedArrayResponse.array
+                decoded = in.varint(size) &&
+                          decodePackedArray(in, in.position() + static_cast<size_t>(size), receivedType,
+                                            receivedCount, out, capacity * elementBytes, bytes, fits);
+            } else {
+                decoded = in.skipField(static_cast<uint32_t>(key & 7));
+            }
+        }
+        if (!decoded) {
+            failure = "getPackedArray: malformed response";
+        } else if (receivedType != static_cast<uint64_t>(type) || bytes != receivedCount * elementBytes) {
+            failure = "getPackedArray: " + std::to_string(receivedCount) + " elements in " +
+                      std::to_string(bytes) + " bytes";
+        }
+    }
+    slices.clear();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (failure.empty() && !fits) {
+        failure = "getPackedArray: " + std::to_string(receivedCount) + " elements don't fit into " +
+                  std::to_string(capacity);
+    }
+    count = static_cast<size_t>(receivedCount);
+    if (!failure.empty()) {
+        ++m_stats.errors;
+        if (error) {
+            *error = failure;
+        }
+        return false;
+    }
+    ++m_stats.gets;
+    m_stats.bytesReceived += bytes;
+    m_stats.getMs += msSince(start);
+    return true;
+}
+
+template <typename T>
+bool ItemArraySdk::getVector(const OctaneGRPC::ApiItemProxy& item,
+                             Octane::AttributeId id,
+                             ElementType type,
+                             std::vector<T>& out,
+                             std::string* error) {
+    std::string data;
+    if (!getPacked(item, id, type, data, error)) {
+        return false;
+    }
+    out.resize(data.size() / sizeof(T));
+    if (!out.empty()) {
+        std::memcpy(out.data(), data.data(), out.size() * sizeof(T));
+    }
+    return true;
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const bool* arr, size_t size, bool evaluate, std::string* error) {
+    static_assert(sizeof(bool) == 1, "bool arrays are packed as bytes");
+    return setPacked(item, id, ElementType::Bool, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const int32_t* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Int, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::int32_2* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Int2, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::int32_3* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Int3, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::int32_4* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Int4, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const int64_t* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Long, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::int64_2* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Long2, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const float* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Float, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::float_2* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Float2, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::float_3* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Float3, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::float_4* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Float4, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::MatrixF* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Matrix, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const uint8_t* arr, size_t size, bool evaluate, std::string* error) {
+    return setPacked(item, id, ElementType::Byte, arr, size, evaluate, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<bool>& out, std::string* error) {
+    // std::vector<bool> has no contiguous storage
+    std::string data;
+    if (!getPacked(item, id, ElementType::Bool, data, error)) {
+        return false;
+    }
+    out.assign(data.size(), false);
+    for (size_t i = 0; i < data.size(); ++i) {
+        out[i] = data[i] != 0;
+    }
+    return true;
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<int32_t>& out, std::string* error) {
+    return getVector(item, id, ElementType::Int, out, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::int32_2>& out, std::string* error) {
+    return getVector(item, id, ElementType::Int2, out, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::int32_3>& out, std::string* error) {
+    return getVector(item, id, ElementType::Int3, out, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::int32_4>& out, std::string* error) {
+    return getVector(item, id, ElementType::Int4, out, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<int64_t>& out, std::string* error) {
+    return getVector(item, id, ElementType::Long, out, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::int64_2>& out, std::string* error) {
+    return getVector(item, id, ElementType::Long2, out, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<float>& out, std::string* error) {
+    return getVector(item, id, ElementType::Float, out, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::float_2>& out, std::string* error) {
+    return getVector(item, id, ElementType::Float2, out, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::float_3>& out, std::string* error) {
+    return getVector(item, id, ElementType::Float3, out, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::float_4>& out, std::string* error) {
+    return getVector(item, id, ElementType::Float4, out, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::MatrixF>& out, std::string* error) {
+    return getVector(item, id, ElementType::Matrix, out, error);
+}
+
+bool ItemArraySdk::get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<uint8_t>& out, std::string* error) {
+    return getVector(item, id, ElementType::Byte, out, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, bool* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Bool, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, int32_t* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Int, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::int32_2* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Int2, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::int32_3* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Int3, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::int32_4* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Int4, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, int64_t* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Long, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::int64_2* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Long2, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, float* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Float, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::float_2* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Float2, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::float_3* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Float3, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::float_4* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Float4, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::MatrixF* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Matrix, out, capacity, count, error);
+}
+
+bool ItemArraySdk::read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, uint8_t* out, size_t capacity, size_t& count, std::string* error) {
+    return readPacked(item, id, ElementType::Byte, out, capacity, count, error);
+}
+
+ItemArraySdk::Stats ItemArraySdk::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void ItemArraySdk::printSummary(std::ostream& out) const {
+    const Stats s = stats();
+    out << "ItemArraySdk: " << s.sets << " arrays set (" << std::fixed << std::setprecision(1)
+        << s.bytesSent / (1024.0 * 1024.0) << " MB, " << s.streams << " streamed in " << s.chunks
+        << " chunks, " << s.transactions << " transactions, " << s.animations << " animations of "
+        << s.animSamples << " samples from " << s.animRawBytes / (1024.0 * 1024.0) << " MB), " << s.gets << " read ("
+        << s.bytesReceived / (1024.0 * 1024.0) << " MB), " << s.sizeQueries << " size queries, "
+        << s.errors << " failed";
+    if (s.setMs > 0.0) {
+        out << ", " << s.bytesSent / (s.setMs * 1000.0) << " MB/s set";
+    }
+    if (s.getMs > 0.0) {
+        out << ", " << s.bytesReceived / (s.getMs * 1000.0) << " MB/s read";
+    }
+    out << std::endl;
+}
+
+#endif
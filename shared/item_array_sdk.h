@@ -0,0 +1,297 @@
+#ifndef ITEM_ARRAY_SDK_H
+#define ITEM_ARRAY_SDK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "anim_sample_codec.h"
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/generic/generic_stub.h>
+#include "apiitemclient.h"
+
+/**
+ * @brief Packed set and get of item array attributes
+ *
+ * ApiItemProxy::set(id, const float_3* arr, size, evaluate) and getFloat3Array() encode every
+ * element as a protobuf sub message, millions of them for a big mesh. ItemArraySdk sends the
+ * array as one little endian bytes field instead, filled and read with a single memcpy, to
+ * octane_arrays (grpc-api-examples/item-arrays) on the Octane host, which converts it over the
+ * local connection.
+ *
+ * The element types match the ApiItemProxy overloads: bool, int32_t, int32_2/3/4, int64_t,
+ * int64_2, float, float_2/3/4, MatrixF and uint8_t. Strings stay with ApiItemProxy.
+ *
+ * setStream() uploads an array in chunks of settings.chunkBytes, from memory or from a callback
+ * that produces the data as it goes, so neither side needs a message of the whole array and the
+ * client never holds more than one chunk besides its own data.
+ *
+ * setMany() sets the arrays of an ArrayBatch, e.g. all arrays of a mesh, in one call as a
+ * transaction with a single evaluation of the item at the end.
+ *
+ * setAnimStream() uploads an animated array, e.g. the vertices of a deforming mesh, one time
+ * sample per message as a callback produces them, optionally as differences to the previous
+ * sample and as half floats or 16 bit steps (AnimOptions).
+ */
+class ItemArraySdk {
+public:
+    struct Settings {
+        std::string address = "127.0.0.1:50055";    // octane_arrays next to Octane
+        size_t chunkBytes = 1024 * 1024;            // data per setStream() message
+    };
+
+    /**
+     * @brief Element layout of a packed array, the values of octanearrays::PackedType
+     */
+    enum class ElementType {
+        Bool = 0,
+        Int,
+        Int2,
+        Int3,
+        Int4,
+        Long,
+        Long2,
+        Float,
+        Float2,
+        Float3,
+        Float4,
+        Matrix,
+        Byte,
+    };
+
+    struct UploadProgress {
+        uint64_t bytesSent = 0;
+        uint64_t totalBytes = 0;                    // 0 if the count wasn't known up front
+        uint64_t chunks = 0;
+    };
+
+    /**
+     * @brief Called after every chunk of setStream(), returning false cancels the upload and the
+     * attribute keeps its old value
+     */
+    using ProgressCallback = std::function<bool(const UploadProgress&)>;
+
+    /**
+     * @brief Produces the data of setStream(): fills at most capacity bytes of buffer and returns
+     * how many, 0 at the end. Elements may be split between calls.
+     */
+    using ChunkSource = std::function<size_t(void* buffer, size_t capacity)>;
+
+    /**
+     * @brief Encoding of the samples of setAnimStream(), see SharedUtils::SampleFormat. Half and
+     * Quantized are lossy and apply to float types only; delta needs 32 bit components.
+     */
+    struct AnimOptions {
+        SharedUtils::SampleEncoding encoding = SharedUtils::SampleEncoding::Exact;
+        bool delta = false;                         // samples after the first as differences
+        float rangeMin = 0.0f;                      // Quantized: range of all values
+        float rangeMax = 1.0f;
+    };
+
+    /**
+     * @brief Fills values with the elements of time sample index for setAnimStream(), returning
+     * false cancels the upload
+     */
+    using SampleSource = std::function<bool(size_t index, void* values)>;
+
+    /**
+     * @brief Arrays for setMany(). add() keeps a pointer to the data, which must stay valid
+     * until setMany() returned; strings are copied.
+     */
+    class ArrayBatch {
+    public:
+        void add(Octane::AttributeId id, const bool* arr, size_t size) { addPacked(id, ElementType::Bool, arr, size); }
+        void add(Octane::AttributeId id, const int32_t* arr, size_t size) { addPacked(id, ElementType::Int, arr, size); }
+        void add(Octane::AttributeId id, const OctaneVec::int32_2* arr, size_t size) { addPacked(id, ElementType::Int2, arr, size); }
+        void add(Octane::AttributeId id, const OctaneVec::int32_3* arr, size_t size) { addPacked(id, ElementType::Int3, arr, size); }
+        void add(Octane::AttributeId id, const OctaneVec::int32_4* arr, size_t size) { addPacked(id, ElementType::Int4, arr, size); }
+        void add(Octane::AttributeId id, const int64_t* arr, size_t size) { addPacked(id, ElementType::Long, arr, size); }
+        void add(Octane::AttributeId id, const OctaneVec::int64_2* arr, size_t size) { addPacked(id, ElementType::Long2, arr, size); }
+        void add(Octane::AttributeId id, const float* arr, size_t size) { addPacked(id, ElementType::Float, arr, size); }
+        void add(Octane::AttributeId id, const OctaneVec::float_2* arr, size_t size) { addPacked(id, ElementType::Float2, arr, size); }
+        void add(Octane::AttributeId id, const OctaneVec::float_3* arr, size_t size) { addPacked(id, ElementType::Float3, arr, size); }
+        void add(Octane::AttributeId id, const OctaneVec::float_4* arr, size_t size) { addPacked(id, ElementType::Float4, arr, size); }
+        void add(Octane::AttributeId id, const OctaneVec::MatrixF* arr, size_t size) { addPacked(id, ElementType::Matrix, arr, size); }
+        void add(Octane::AttributeId id, const uint8_t* arr, size_t size) { addPacked(id, ElementType::Byte, arr, size); }
+        void add(Octane::AttributeId id, const char* const* arr, size_t size);
+
+        size_t size() const { return m_entries.size(); }
+        void clear() { m_entries.clear(); }
+
+    private:
+        friend class ItemArraySdk;
+        friend class BlobCacheSdk;
+
+        struct Entry {
+            Octane::AttributeId id;
+            ElementType type;
+            const void* data;
+            size_t count;
+            bool isStrings;
+            std::vector<std::string> strings;
+        };
+
+        void addPacked(Octane::AttributeId id, ElementType type, const void* data, size_t count);
+
+        std::vector<Entry> m_entries;
+    };
+
+    struct Stats {
+        uint64_t sets = 0;                          // including streams and batched arrays
+        uint64_t transactions = 0;
+        uint64_t streams = 0;
+        uint64_t chunks = 0;
+        uint64_t animations = 0;
+        uint64_t animSamples = 0;
+        uint64_t animRawBytes = 0;                  // before the sample encoding
+        uint64_t gets = 0;                          // including reads
+        uint64_t sizeQueries = 0;
+        uint64_t errors = 0;
+        uint64_t bytesSent = 0;
+        uint64_t bytesReceived = 0;
+        double setMs = 0.0;
+        double getMs = 0.0;
+    };
+
+    ItemArraySdk() : ItemArraySdk(Settings()) {}
+    explicit ItemArraySdk(const Settings& settings);
+
+    /**
+     * @brief Use a channel of its own instead of one to settings.address. It must accept
+     * messages of a whole array.
+     */
+    ItemArraySdk(const Settings& settings, std::shared_ptr<grpc::Channel> channel);
+
+    const Settings& settings() const { return m_settings; }
+
+    /**
+     * @brief Set an array attribute of item, like ApiItemProxy::set(). Returns false and
+     * fills error if the service or Octane refused it.
+     */
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const bool* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const int32_t* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::int32_2* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::int32_3* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::int32_4* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const int64_t* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::int64_2* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const float* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::float_2* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::float_3* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::float_4* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const OctaneVec::MatrixF* arr, size_t size, bool evaluate, std::string* error = nullptr);
+    bool set(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, const uint8_t* arr, size_t size, bool evaluate, std::string* error = nullptr);
+
+    /**
+     * @brief Set an array attribute of count elements of type at data, sent in chunks. Like
+     * set(), but the client holds one chunk instead of a second copy of the array.
+     */
+    bool setStream(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, ElementType type, const void* data, size_t count,
+                   bool evaluate, const ProgressCallback& progress = nullptr, std::string* error = nullptr);
+
+    /**
+     * @brief Set an array attribute with the data source produces. count is the number of
+     * elements it will produce, or 0 if unknown, which costs the service some reallocations.
+     */
+    bool setStream(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, ElementType type, const ChunkSource& source,
+                   uint64_t count, bool evaluate, const ProgressCallback& progress = nullptr, std::string* error = nullptr);
+
+    /**
+     * @brief Set all arrays of batch in one call. They are applied in order with evaluate off;
+     * if Octane refuses one, the ones already set are restored and false is returned. With
+     * evaluate the item is evaluated once after the last array.
+     */
+    bool setMany(const OctaneGRPC::ApiItemProxy& item, const ArrayBatch& batch, bool evaluate, std::string* error = nullptr);
+
+    /**
+     * @brief Set an animated array attribute like ApiItemProxy::setAnim(id, times, numTimes, arr,
+     * arrSize, evaluate), with samples time samples of count elements each. source produces them
+     * one at a time and each goes out as its own message, so the client holds one sample and its
+     * encoding instead of all of them.
+     */
+    bool setAnimStream(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, ElementType type,
+                       const Octane::ApiTimeSampling& times, size_t count, size_t samples, const SampleSource& source,
+                       const AnimOptions& options, bool evaluate, std::string* error = nullptr);
+
+    /**
+     * @brief Get an array attribute of item, like ApiItemProxy::getFloat3Array() and friends.
+     * Returns false and fills error if the attribute doesn't hold an array of that type.
+     */
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<bool>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<int32_t>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::int32_2>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::int32_3>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::int32_4>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<int64_t>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::int64_2>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<float>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::float_2>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::float_3>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::float_4>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<OctaneVec::MatrixF>& out, std::string* error = nullptr);
+    bool get(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, std::vector<uint8_t>& out, std::string* error = nullptr);
+
+    /**
+     * @brief Number of elements of an array attribute, to size the buffer for read(). The
+     * service keeps the array it read for the size, so the read that follows costs no
+     * second call to Octane.
+     */
+    bool size(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, ElementType type, size_t& count, std::string* error = nullptr);
+
+    /**
+     * @brief Read an array attribute into out, which has room for capacity elements. count
+     * receives the number of elements; if it is above capacity nothing is written and false is
+     * returned. The elements are copied once, straight out of the received message, a read
+     * allocates nothing beyond the receive buffer of gRPC.
+     */
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, bool* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, int32_t* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::int32_2* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::int32_3* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::int32_4* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, int64_t* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::int64_2* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, float* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::float_2* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::float_3* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::float_4* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, OctaneVec::MatrixF* out, size_t capacity, size_t& count, std::string* error = nullptr);
+    bool read(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, uint8_t* out, size_t capacity, size_t& count, std::string* error = nullptr);
+
+    /**
+     * @brief Bytes of one element of type
+     */
+    static size_t elementSize(ElementType type);
+
+    Stats stats() const;
+    void printSummary(std::ostream& out) const;
+
+private:
+    bool setPacked(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, ElementType type,
+                   const void* data, size_t count, bool evaluate, std::string* error);
+    bool getPacked(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, ElementType type,
+                   std::string& data, std::string* error);
+    bool readPacked(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, ElementType type,
+                    void* out, size_t capacity, size_t& count, std::string* error);
+    template <typename T>
+    bool getVector(const OctaneGRPC::ApiItemProxy& item, Octane::AttributeId id, ElementType type,
+                   std::vector<T>& out, std::string* error);
+
+    const Settings m_settings;
+    std::shared_ptr<grpc::Channel> m_channel;
+    // getPackedArray with the raw response, for read()
+    grpc::GenericStub m_genericStub;
+
+    mutable std::mutex m_mutex;
+    Stats m_stats;
+};
+#endif
+
+#endif // ITEM_ARRAY_SDK_H
@@ -0,0 +1,105 @@
+#include "windows_headers.h"
+#include "mapped_file.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SharedUtils {
+
+    MappedFile::~MappedFile()
+    {
+        unmap();
+    }
+
+    bool MappedFile::map(const std::string& path, size_t size)
+    {
+        unmap();
+#ifdef _WIN32
+        // appends go through another handle while the file is mapped
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        mFile = file;
+        if (size == 0)
+        {
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            {
+                unmap();
+                return false;
+            }
+            size = (size_t)fileSize.QuadPart;
+        }
+        mMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, (DWORD)((uint64_t)size >> 32),
+                                      (DWORD)(size & 0xffffffffu), nullptr);
+        if (!mMapping)
+        {
+            unmap();
+            return false;
+        }
+        mData = MapViewOfFile((HANDLE)mMapping, FILE_MAP_READ, 0, 0, size);
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        if (size == 0)
+        {
+            struct stat status;
+            if (fstat(fd, &status) != 0 || status.st_size <= 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            size = (size_t)status.st_size;
+        }
+        void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        // the mapping keeps the file referenced
+        ::close(fd);
+        mData = data == MAP_FAILED ? nullptr : data;
+#endif
+        if (!mData)
+        {
+            unmap();
+            return false;
+        }
+        mSize = size;
+        return true;
+    }
+
+    void MappedFile::unmap()
+    {
+#ifdef _WIN32
+        if (mData)
+        {
+            UnmapViewOfFile(mData);
+        }
+        if (mMapping)
+        {
+            CloseHandle((HANDLE)mMapping);
+        }
+        if (mFile)
+        {
+            CloseHandle((HANDLE)mFile);
+        }
+#else
+        if (mData)
+        {
+            munmap(mData, mSize);
+        }
+#endif
+        mFile = nullptr;
+        mMapping = nullptr;
+        mData = nullptr;
+        mSize = 0;
+    }
+
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace SharedUtils {
+
+    /**
+     * Read only mapping of a file. The pages are read on first access, so a file that is
+     * hashed, decoded or sent is read once without a copy into a buffer of the process.
+     */
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * Maps the first size bytes of the file, the whole file with size 0. Other handles
+         * may keep writing to the file, e.g. to append to it. Returns false if the file can't
+         * be opened or is empty.
+         */
+        bool map(const std::string& path, size_t size = 0);
+
+        /**
+         * Unmaps the file, data() is null afterwards
+         */
+        void unmap();
+
+        const uint8_t* data() const { return static_cast<const uint8_t*>(mData); }
+        size_t size() const { return mSize; }
+
+    private:
+        // file and mapping HANDLE on Windows, so this header doesn't pull in windows.h
+        void* mFile = nullptr;
+        void* mMapping = nullptr;
+        void* mData = nullptr;
+        size_t mSize = 0;
+    };
+
+};
@@ -0,0 +1,473 @@
+#include "material_preview_sdk.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <unordered_map>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apiinfoclient.h"
+
+namespace {
+
+double msSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+template <typename T>
+void hashArray(SharedUtils::KeyHasher& hasher, const std::vector<T>& values) {
+    hasher.addValue((uint64_t)values.size());
+    if (!values.empty()) {
+        hasher.add(values.data(), values.size() * sizeof(T));
+    }
+}
+
+// files are hashed by size and modification time, Octane reloads them when those change
+void hashFile(SharedUtils::KeyHasher& hasher, const std::string& path) {
+    hasher.add(path);
+    std::error_code error;
+    const uint64_t size = path.empty() ? 0 : (uint64_t)std::filesystem::file_size(path, error);
+    hasher.addValue(error ? 0 : size);
+    const auto time = path.empty() ? std::filesystem::file_time_type() : std::filesystem::last_write_time(path, error);
+    hasher.addValue(error ? (int64_t)0 : (int64_t)time.time_since_epoch().count());
+}
+
+void hashAttribute(SharedUtils::KeyHasher& hasher, const OctaneGRPC::ApiNodeProxy& node, uint32_t index,
+                   const Octane::ApiAttributeInfo& info) {
+    hasher.addValue((int32_t)info.mId);
+    hasher.addValue((int32_t)info.mType);
+    hasher.addValue((uint8_t)info.mIsArray);
+    if (info.mIsArray) {
+        switch (info.mType) {
+        case Octane::AT_BOOL: {
+            const std::vector<bool> values = node.getBoolArrayIx(index);
+            hasher.addValue((uint64_t)values.size());
+            for (bool value : values) {
+                hasher.addValue((uint8_t)value);
+            }
+            break;
+        }
+        case Octane::AT_INT:    hashArray(hasher, node.getIntArrayIx(index)); break;
+        case Octane::AT_INT2:   hashArray(hasher, node.getInt2ArrayIx(index)); break;
+        case Octane::AT_INT3:   hashArray(hasher, node.getInt3ArrayIx(index)); break;
+        case Octane::AT_INT4:   hashArray(hasher, node.getInt4ArrayIx(index)); break;
+        case Octane::AT_LONG:   hashArray(hasher, node.getLongArrayIx(index)); break;
+        case Octane::AT_LONG2:  hashArray(hasher, node.getLong2ArrayIx(index)); break;
+        case Octane::AT_FLOAT:  hashArray(hasher, node.getFloatArrayIx(index)); break;
+        case Octane::AT_FLOAT2: hashArray(hasher, node.getFloat2ArrayIx(index)); break;
+        case Octane::AT_FLOAT3: hashArray(hasher, node.getFloat3ArrayIx(index)); break;
+        case Octane::AT_FLOAT4: hashArray(hasher, node.getFloat4ArrayIx(index)); break;
+        case Octane::AT_MATRIX: hashArray(hasher, node.getMatrixArrayIx(index)); break;
+        case Octane::AT_STRING:
+        case Octane::AT_FILENAME: {
+            const std::vector<std::string> values = node.getStringArrayIx(index);
+            hasher.addValue((uint64_t)values.size());
+            for (const std::string& value : values) {
+                if (info.mType == Octane::AT_FILENAME) {
+                    hashFile(hasher, value);
+                } else {
+                    hasher.add(value);
+                }
+            }
+            break;
+        }
+        default:
+            // byte arrays hold loaded image and package data, far too much to transfer
+            // for a key; the file name attributes next to them identify the content
+            break;
+        }
+        return;
+    }
+
+    switch (info.mType) {
+    case Octane::AT_BOOL:     hasher.addValue((uint8_t)node.getBoolIx(index)); break;
+    case Octane::AT_INT:      hasher.addValue(node.getIntIx(index)); break;
+    case Octane::AT_INT2:     hasher.addValue(node.getInt2Ix(index)); break;
+    case Octane::AT_INT3:     hasher.addValue(node.getInt3Ix(index)); break;
+    case Octane::AT_INT4:     hasher.addValue(node.getInt4Ix(index)); break;
+    case Octane::AT_LONG:     hasher.addValue(node.getLongIx(index)); break;
+    case Octane::AT_LONG2:    hasher.addValue(node.getLong2Ix(index)); break;
+    case Octane::AT_FLOAT:    hasher.addValue(node.getFloatIx(index)); break;
+    case Octane::AT_FLOAT2:   hasher.addValue(node.getFloat2Ix(index)); break;
+    case Octane::AT_FLOAT3:   hasher.addValue(node.getFloat3Ix(index)); break;
+    case Octane::AT_FLOAT4:   hasher.addValue(node.getFloat4Ix(index)); break;
+    case Octane::AT_MATRIX:   hasher.addValue(node.getMatrixIx(index)); break;
+    case Octane::AT_STRING:   hasher.add(node.getStringIx(index)); break;
+    case Octane::AT_FILENAME: hashFile(hasher, node.getStringIx(index)); break;
+    default:
+        break;
+    }
+}
+
+// depth first over the pins; nodes reached twice are hashed as a back reference, so shared
+// inputs and cycles through linkers are handled
+void hashNode(SharedUtils::KeyHasher& hasher, OctaneGRPC::ApiNodeProxy node,
+              std::unordered_map<int64_t, uint32_t>& visited) {
+    if (node.isNull()) {
+        hasher.addValue((uint8_t)0);
+        return;
+    }
+    const auto it = visited.find(node.getObjectHandle());
+    if (it != visited.end()) {
+        hasher.addValue((uint8_t)1);
+        hasher.addValue(it->second);
+        return;
+    }
+    visited.emplace(node.getObjectHandle(), (uint32_t)visited.size());
+
+    hasher.addValue((uint8_t)2);
+    hasher.addValue((int32_t)node.type());
+    const uint32_t attrCount = node.attrCount();
+    for (uint32_t i = 0; i < attrCount; ++i) {
+        hashAttribute(hasher, node, i, node.attrInfoIx(i));
+    }
+    const uint32_t pinCount = node.pinCount();
+    hasher.addValue(pinCount);
+    for (uint32_t i = 0; i < pinCount; ++i) {
+        hashNode(hasher, node.connectedNodeIx(i, true), visited);
+    }
+}
+
+}
+
+MaterialPreviewSdk::MaterialPreviewSdk(const Settings& settings)
+    : m_settings(settings)
+    , m_stop(false)
+    , m_nextOrder(0)
+    , m_nextSeq(0)
+    , m_running(0)
+    , m_generation(0)
+    , m_rendersRunning(0)
+    , m_octaneVersion(0)
+    , m_hasOctaneVersion(false)
+{
+    if (!m_settings.cacheFile.empty()) {
+        m_cache.open(m_settings.cacheFile);
+    }
+    m_stats.mappedPreviews = m_cache.stats().mappedEntries;
+    const unsigned workers = std::max(1u, m_settings.workers);
+    for (unsigned i = 0; i < workers; ++i) {
+        m_workers.emplace_back(&MaterialPreviewSdk::workerLoop, this);
+    }
+}
+
+MaterialPreviewSdk::~MaterialPreviewSdk() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void MaterialPreviewSdk::enqueue(Entry& entry, int64_t handle) {
+    entry.state = STATE_QUEUED;
+    entry.queueSeq = ++m_nextSeq;
+    m_queue.push(QueueItem{ entry.priority, entry.order, entry.queueSeq, handle });
+}
+
+void MaterialPreviewSdk::request(const Request& item) {
+    request(std::vector<Request>(1, item));
+}
+
+void MaterialPreviewSdk::request(const std::vector<Request>& requests) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const Request& request : requests) {
+            const int64_t handle = request.material.getObjectHandle();
+            if (handle == 0) {
+                continue;
+            }
+            auto inserted = m_entries.emplace(handle, Entry());
+            Entry& entry = inserted.first->second;
+            if (inserted.second) {
+                entry.material = request.material;
+                entry.order = m_nextOrder++;
+            }
+            // a new content key is an edit, like invalidate()
+            const bool changed = !inserted.second && entry.contentKey != request.contentKey;
+            if (changed) {
+                ++entry.revision;
+                entry.hasKey = false;
+            }
+            entry.contentKey = request.contentKey;
+            ++m_stats.requests;
+
+            const bool reprioritized = entry.priority != request.priority;
+            entry.priority = request.priority;
+            if (entry.state == STATE_NONE || entry.state == STATE_FAILED ||
+                (changed && entry.state != STATE_QUEUED) || (entry.state == STATE_QUEUED && reprioritized)) {
+                enqueue(entry, handle);
+            }
+        }
+    }
+    m_wake.notify_all();
+}
+
+void MaterialPreviewSdk::request(const std::vector<OctaneGRPC::ApiNodeProxy>& materials, int priority) {
+    std::vector<Request> requests(materials.size());
+    for (size_t i = 0; i < materials.size(); ++i) {
+        requests[i].material = materials[i];
+        requests[i].priority = priority;
+    }
+    request(requests);
+}
+
+void MaterialPreviewSdk::setPriority(const OctaneGRPC::ApiNodeProxy& material, int priority) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_entries.find(material.getObjectHandle());
+        if (it == m_entries.end() || it->second.priority == priority) {
+            return;
+        }
+        it->second.priority = priority;
+        // the queued item is left behind as stale
+        if (it->second.state == STATE_QUEUED) {
+            enqueue(it->second, it->first);
+        }
+    }
+    m_wake.notify_all();
+}
+
+void MaterialPreviewSdk::cancelPending() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue = std::priority_queue<QueueItem>();
+    for (auto& item : m_entries) {
+        if (item.second.state == STATE_QUEUED) {
+            item.second.state = STATE_NONE;
+        }
+    }
+    if (m_running == 0) {
+        m_idle.notify_all();
+    }
+}
+
+void MaterialPreviewSdk::invalidate(const OctaneGRPC::ApiNodeProxy& material) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_entries.find(material.getObjectHandle());
+    if (it == m_entries.end()) {
+        return;
+    }
+    Entry& entry = it->second;
+    ++entry.revision;
+    entry.hasKey = false;
+    // a running preview is dropped when it finishes, a queued one hashes the graph again
+    if (entry.state != STATE_QUEUED) {
+        entry.state = STATE_NONE;
+        entry.preview = SharedUtils::Thumbnail();
+    }
+}
+
+MaterialPreviewSdk::State MaterialPreviewSdk::state(const OctaneGRPC::ApiNodeProxy& material) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_entries.find(material.getObjectHandle());
+    return it == m_entries.end() ? STATE_NONE : it->second.state;
+}
+
+bool MaterialPreviewSdk::preview(const OctaneGRPC::ApiNodeProxy& material, SharedUtils::Thumbnail& preview) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_entries.find(material.getObjectHandle());
+    if (it == m_entries.end() || it->second.state != STATE_READY) {
+        return false;
+    }
+    preview = it->second.preview;
+    return true;
+}
+
+void MaterialPreviewSdk::setReadyCallback(const ReadyCallback& callback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_readyCallback = callback;
+}
+
+uint64_t MaterialPreviewSdk::generation() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generation;
+}
+
+bool MaterialPreviewSdk::waitIdle(unsigned timeoutMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_idle.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] {
+        return m_queue.empty() && m_running == 0;
+    });
+}
+
+void MaterialPreviewSdk::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_stop) {
+            return;
+        }
+        const QueueItem item = m_queue.top();
+        m_queue.pop();
+        const auto it = m_entries.find(item.handle);
+        if (it == m_entries.end() || it->second.state != STATE_QUEUED || it->second.queueSeq != item.seq) {
+            if (m_queue.empty() && m_running == 0) {
+                m_idle.notify_all();
+            }
+            continue;
+        }
+        Entry& entry = it->second;
+        entry.state = STATE_RUNNING;
+        ++m_running;
+        const OctaneGRPC::ApiNodeProxy material = entry.material;
+        const std::string contentKey = entry.contentKey;
+        const uint64_t revision = entry.revision;
+        const bool hadKey = entry.hasKey;
+        uint64_t key = entry.key;
+        lock.unlock();
+
+        bool ok = true;
+        bool cached = false;
+        double hashMs = 0.0;
+        double renderMs = 0.0;
+        SharedUtils::Thumbnail preview;
+        try {
+            if (!hadKey) {
+                const auto start = std::chrono::high_resolution_clock::now();
+                key = computeKey(material, contentKey);
+                hashMs = msSince(start);
+            }
+            cached = m_cache.find(key, preview);
+            if (!cached) {
+                const auto start = std::chrono::high_resolution_clock::now();
+                std::vector<uint8_t> pixels;
+                ok = render(material, pixels);
+                renderMs = msSince(start);
+                if (ok) {
+                    preview = m_cache.insert(key,
+                                             m_settings.hdr ? SharedUtils::PixelConvert::PIXEL_FORMAT_HDR_RGBA
+                                                            : SharedUtils::PixelConvert::PIXEL_FORMAT_LDR_RGBA,
+                                             m_settings.size, m_settings.size, pixels.data());
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cout << "MaterialPreviewSdk: preview failed: " << e.what() << std::endl;
+            ok = false;
+        }
+
+        lock.lock();
+        --m_running;
+        m_stats.keysHashed += hadKey ? 0 : 1;
+        m_stats.totalHashMs += hashMs;
+        m_stats.totalRenderMs += renderMs;
+        m_stats.cacheHits += ok && cached ? 1 : 0;
+        m_stats.renders += ok && !cached ? 1 : 0;
+        m_stats.failed += ok ? 0 : 1;
+
+        ReadyCallback callback;
+        const auto done = m_entries.find(item.handle);
+        // dropped if the material was invalidated meanwhile
+        if (done != m_entries.end() && done->second.revision == revision && done->second.state == STATE_RUNNING) {
+            Entry& finished = done->second;
+            finished.key = key;
+            finished.hasKey = true;
+            if (ok) {
+                finished.state = STATE_READY;
+                finished.preview = preview;
+                ++m_generation;
+                callback = m_readyCallback;
+            } else {
+                finished.state = STATE_FAILED;
+            }
+        }
+        if (m_queue.empty() && m_running == 0) {
+            m_idle.notify_all();
+        }
+        if (callback) {
+            lock.unlock();
+            callback(item.handle, preview);
+            lock.lock();
+        }
+    }
+}
+
+uint64_t MaterialPreviewSdk::computeKey(const OctaneGRPC::ApiNodeProxy& material, const std::string& contentKey) {
+    int octaneVersion = 0;
+    bool hasOctaneVersion = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        octaneVersion = m_octaneVersion;
+        hasOctaneVersion = m_hasOctaneVersion;
+    }
+    if (!hasOctaneVersion) {
+        octaneVersion = OctaneGRPC::ApiInfoProxy::octaneVersion();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_octaneVersion = octaneVersion;
+        m_hasOctaneVersion = true;
+    }
+
+    SharedUtils::KeyHasher hasher;
+    hasher.addValue(octaneVersion);
+    hasher.addValue(m_settings.size);
+    hasher.addValue(m_settings.maxSamples);
+    hasher.addValue(m_settings.objectSize);
+    hasher.addValue(m_settings.previewType);
+    hasher.addValue((uint8_t)m_settings.hdr);
+    if (!contentKey.empty()) {
+        hasher.addValue((uint8_t)1);
+        hasher.add(contentKey);
+    } else {
+        hasher.addValue((uint8_t)0);
+        std::unordered_map<int64_t, uint32_t> visited;
+        hashNode(hasher, material, visited);
+    }
+    return hasher.value();
+}
+
+bool MaterialPreviewSdk::render(const OctaneGRPC::ApiNodeProxy& material, std::vector<uint8_t>& pixels) {
+    {
+        std::unique_lock<std::mutex> lock(m_renderMutex);
+        m_renderSlotFree.wait(lock, [this] { return m_rendersRunning < std::max(1u, m_settings.concurrentRenders); });
+        ++m_rendersRunning;
+    }
+
+    pixels.resize((size_t)m_settings.size * m_settings.size * (m_settings.hdr ? 16 : 4));
+    bool ok = false;
+    try {
+        ok = OctaneGRPC::ApiRenderEngineProxy::previewMaterial(
+            &material,
+            OctaneVec::uint32_2{ m_settings.size, m_settings.size },
+            OctaneVec::float_4{ 0.0f, 0.0f, 1.0f, 1.0f },
+            m_settings.maxSamples,
+            m_settings.objectSize,
+            (Octane::PreviewType)m_settings.previewType,
+            m_settings.hdr ? Octane::TONEMAP_BUFFER_TYPE_HDR_FLOAT : Octane::TONEMAP_BUFFER_TYPE_LDR,
+            m_settings.hdr ? Octane::NAMED_COLOR_SPACE_LINEAR_SRGB : Octane::NAMED_COLOR_SPACE_SRGB,
+            pixels.data());
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_renderMutex);
+        --m_rendersRunning;
+        m_renderSlotFree.notify_one();
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_renderMutex);
+        --m_rendersRunning;
+    }
+    m_renderSlotFree.notify_one();
+    return ok;
+}
+
+MaterialPreviewSdk::Stats MaterialPreviewSdk::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void MaterialPreviewSdk::printSummary(std::ostream& out) const {
+    const Stats s = stats();
+    out << "Material previews: " << s.requests << " requests, " << s.cacheHits << " from cache ("
+        << s.mappedPreviews << " mapped), " << s.renders << " rendered, " << s.failed << " failed";
+    if (s.renders > 0) {
+        out << ", avg render " << std::fixed << std::setprecision(1) << s.totalRenderMs / s.renders << " ms";
+    }
+    if (s.keysHashed > 0) {
+        out << ", avg key " << std::fixed << std::setprecision(2) << s.totalHashMs / s.keysHashed << " ms";
+    }
+    out << std::endl;
+}
+#endif
@@ -0,0 +1,195 @@
+#ifndef MATERIAL_PREVIEW_SDK_H
+#define MATERIAL_PREVIEW_SDK_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "thumbnail_cache.h"
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apinodeclient.h"
+#include "apirenderengineclient.h"
+
+/**
+ * @brief Renders material previews for a browser from a priority queue, with a persistent cache
+ *
+ * previewMaterial() blocks for a full render per material, a browser calling it for every
+ * item waits seconds before the visible rows fill. Materials are queued with a priority
+ * instead, visible items first, and worker threads take the highest priority request.
+ * Scrolling only changes priorities, queued requests are never rendered twice.
+ *
+ * Every preview is stored in a SharedUtils::ThumbnailCache file under a key hashed from the
+ * Octane version, the preview settings and the material: all attribute values of the
+ * nodes in its graph, plus size and modification time of referenced files. The next run
+ * maps the file and a material that didn't change is served from it without a render.
+ * Hashing the graph costs a few RPCs per node; a browser that knows its materials (a
+ * library path and revision) can pass that as contentKey to skip the walk completely.
+ *
+ * Workers walk graphs and look up the cache in parallel, the number of previewMaterial()
+ * calls running at once is limited separately since the server renders them one by one.
+ */
+class MaterialPreviewSdk {
+public:
+    enum Priority {
+        PRIORITY_BACKGROUND = 0,
+        PRIORITY_VISIBLE = 100,
+    };
+
+    enum State {
+        STATE_NONE = 0,                         // never requested, or invalidated
+        STATE_QUEUED,
+        STATE_RUNNING,
+        STATE_READY,
+        STATE_FAILED,
+    };
+
+    struct Settings {
+        std::string cacheFile;                  // empty keeps previews in memory only
+        uint32_t size = 128;                    // width and height in pixels
+        uint32_t maxSamples = 128;
+        float objectSize = 1.0f;                // meters
+        int previewType = 2;                    // Octane::PREVIEW_SPHERE
+        bool hdr = false;                       // linear float RGBA instead of 8 bit sRGB
+        unsigned workers = 4;                   // graph walks and cache lookups
+        unsigned concurrentRenders = 1;         // previewMaterial() calls at once
+    };
+
+    struct Request {
+        OctaneGRPC::ApiNodeProxy material;
+        int priority = PRIORITY_BACKGROUND;
+        std::string contentKey;                 // identifies the material's content, empty hashes its graph
+    };
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t cacheHits = 0;
+        uint64_t renders = 0;
+        uint64_t failed = 0;
+        uint64_t keysHashed = 0;
+        double totalHashMs = 0.0;
+        double totalRenderMs = 0.0;
+        size_t mappedPreviews = 0;              // in the cache file when it was opened
+    };
+
+    typedef std::function<void(int64_t materialHandle, const SharedUtils::Thumbnail& preview)> ReadyCallback;
+
+    MaterialPreviewSdk() : MaterialPreviewSdk(Settings()) {}
+    explicit MaterialPreviewSdk(const Settings& settings);
+    ~MaterialPreviewSdk();
+
+    const Settings& settings() const { return m_settings; }
+
+    /**
+     * @brief Queue previews. A material that is queued already only gets the new priority,
+     * one that is ready stays ready.
+     */
+    void request(const Request& request);
+    void request(const std::vector<Request>& requests);
+    void request(const std::vector<OctaneGRPC::ApiNodeProxy>& materials, int priority = PRIORITY_BACKGROUND);
+
+    /**
+     * @brief Reprioritize a queued material, e.g. when it scrolls into view
+     */
+    void setPriority(const OctaneGRPC::ApiNodeProxy& material, int priority);
+
+    /**
+     * @brief Drop all queued requests, previews that are running still finish
+     */
+    void cancelPending();
+
+    /**
+     * @brief The material was edited, its key is hashed again on the next request
+     */
+    void invalidate(const OctaneGRPC::ApiNodeProxy& material);
+
+    State state(const OctaneGRPC::ApiNodeProxy& material) const;
+
+    /**
+     * @brief Preview of a material, false unless it is ready. The pixels stay valid as long
+     * as the service exists: size x size RGBA, 8 bit sRGB or linear float.
+     */
+    bool preview(const OctaneGRPC::ApiNodeProxy& material, SharedUtils::Thumbnail& preview) const;
+
+    /**
+     * @brief Called on a worker thread whenever a preview becomes ready
+     */
+    void setReadyCallback(const ReadyCallback& callback);
+
+    /**
+     * @brief Incremented whenever a preview becomes ready, for polling from a UI loop
+     */
+    uint64_t generation() const;
+
+    /**
+     * @brief Block until the queue is empty and no preview is running. Returns false on
+     * timeout.
+     */
+    bool waitIdle(unsigned timeoutMs);
+
+    Stats stats() const;
+    void printSummary(std::ostream& out) const;
+
+private:
+    struct Entry {
+        OctaneGRPC::ApiNodeProxy material;
+        State state = STATE_NONE;
+        int priority = PRIORITY_BACKGROUND;
+        uint64_t order = 0;                     // first request, keeps list order among equal priorities
+        uint64_t queueSeq = 0;                  // queue item that is current, older ones are stale
+        uint64_t revision = 0;                  // bumped by invalidate()
+        std::string contentKey;
+        uint64_t key = 0;
+        bool hasKey = false;
+        SharedUtils::Thumbnail preview;
+    };
+
+    struct QueueItem {
+        int priority;
+        uint64_t order;
+        uint64_t seq;
+        int64_t handle;
+
+        bool operator<(const QueueItem& other) const {
+            return priority != other.priority ? priority < other.priority : order > other.order;
+        }
+    };
+
+    void enqueue(Entry& entry, int64_t handle);
+    void workerLoop();
+    uint64_t computeKey(const OctaneGRPC::ApiNodeProxy& material, const std::string& contentKey);
+    bool render(const OctaneGRPC::ApiNodeProxy& material, std::vector<uint8_t>& pixels);
+
+    const Settings m_settings;
+    SharedUtils::ThumbnailCache m_cache;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::vector<std::thread> m_workers;
+    bool m_stop;
+    std::map<int64_t, Entry> m_entries;
+    std::priority_queue<QueueItem> m_queue;
+    uint64_t m_nextOrder;
+    uint64_t m_nextSeq;
+    size_t m_running;
+    uint64_t m_generation;
+    ReadyCallback m_readyCallback;
+    Stats m_stats;
+
+    std::mutex m_renderMutex;
+    std::condition_variable m_renderSlotFree;
+    unsigned m_rendersRunning;
+
+    int m_octaneVersion;                        // part of every key, fetched once
+    bool m_hasOctaneVersion;
+};
+#endif
+
+#endif // MATERIAL_PREVIEW_SDK_H
@@ -48,6 +48,11 @@ public:
      */
     void updateWindowTitle(GLFWwindow* window, const std::string& appName = "3D Model Viewer");
     
+    /**
+     * The title updateWindowTitle() sets, for callers that add to it
+     */
+    std::string windowTitle(const std::string& appName = "3D Model Viewer") const;
+    
     /**
      * Check if a custom model is currently loaded
      */
@@ -147,16 +152,17 @@ inline void ModelManager::resetToDefaultCube() {
 inline void ModelManager::updateWindowTitle(GLFWwindow* window, const std::string& appName) {
     if (!window) return;
     
-    std::string title;
+    const std::string title = windowTitle(appName);
+    glfwSetWindowTitle(window, title.c_str());
+}
+
+inline std::string ModelManager::windowTitle(const std::string& appName) const {
     if (m_hasCustomModel) {
-        title = "🎯 " + appName + " - " + m_currentModelName + " (" + 
-                std::to_string(m_currentModel.getVertexCount()) + " vertices, " +
-                std::to_string(m_currentModel.getTriangleCount()) + " triangles)";
-    } else {
-        title = "🚀 " + appName + " - " + m_currentModelName + " (Default Cube)";
+        return "🎯 " + appName + " - " + m_currentModelName + " (" + 
+               std::to_string(m_currentModel.getVertexCount()) + " vertices, " +
+               std::to_string(m_currentModel.getTriangleCount()) + " triangles)";
     }
-    
-    glfwSetWindowTitle(window, title.c_str());
+    return "🚀 " + appName + " - " + m_currentModelName + " (Default Cube)";
 }
 
 inline void ModelManager::printModelInfo(const ModelData& model) {
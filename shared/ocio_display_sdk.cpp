@@ -0,0 +1,252 @@
+#include "ocio_display_sdk.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apiocioconfigclient.h"
+#include "apiociocontextmanagerclient.h"
+#include "apirenderengineclient.h"
+#endif
+
+namespace {
+
+const char* const kBuiltinConfig = "builtin";
+
+std::string lowerCase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return text;
+}
+
+bool contains(const std::string& lowerText, const char* word) {
+    return lowerText.find(word) != std::string::npos;
+}
+
+// keeps letters, digits, '-' and '.', everything else becomes '_'
+std::string fileNamePart(const std::string& text) {
+    std::string out = text;
+    for (char& c : out) {
+        if (!std::isalnum((unsigned char)c) && c != '-' && c != '.') {
+            c = '_';
+        }
+    }
+    return out.empty() ? "_" : out;
+}
+
+std::string fileStem(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+}
+
+enum DisplayEncoding {
+    ENCODING_SRGB,
+    ENCODING_GAMMA_24,
+    ENCODING_GAMMA_22,
+};
+
+float encode(DisplayEncoding encoding, float v) {
+    v = v > 0.0f ? (v < 1.0f ? v : 1.0f) : 0.0f;
+    switch (encoding) {
+    case ENCODING_GAMMA_24:
+        return std::pow(v, 1.0f / 2.4f);
+    case ENCODING_GAMMA_22:
+        return std::pow(v, 1.0f / 2.2f);
+    default:
+        return v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+    }
+}
+
+}
+
+OcioDisplaySdk::OcioDisplaySdk(const std::string& lutDirectory, unsigned lutSize)
+    : m_lutDirectory(lutDirectory)
+    , m_lutSize(lutSize < 2 ? 2 : lutSize)
+    , m_hasConfig(false)
+    , m_configKey(kBuiltinConfig)
+{
+}
+
+bool OcioDisplaySdk::refresh() {
+#ifdef DO_GRPC_SDK_ENABLED
+    std::string key = kBuiltinConfig;
+    std::vector<DisplayView> displayViews;
+    std::vector<std::string> looks;
+    bool hasConfig = false;
+
+    try {
+        OctaneGRPC::ApiOcioContextManagerProxy manager = OctaneGRPC::ApiOcioContextManagerProxy::create();
+        OctaneGRPC::ApiOcioConfigProxy config = manager.createConfig();
+        if (!config.isNull()) {
+            hasConfig = true;
+            std::string filename = manager.getLastConfigLoadFilename();
+            key = filename.empty() ? manager.getDefaultConfigFilename() : filename;
+            if (key.empty()) {
+                key = "unnamed";
+            }
+
+            const size_t displayCount = config.getDisplayCount();
+            for (size_t d = 0; d < displayCount; ++d) {
+                const std::string display = config.getDisplayName(d);
+                const size_t viewCount = config.getDisplayViewCount(d);
+                for (size_t v = 0; v < viewCount; ++v) {
+                    displayViews.push_back({ display, config.getDisplayViewName(d, v) });
+                }
+            }
+            const size_t lookCount = config.getLookCount();
+            for (size_t l = 0; l < lookCount; ++l) {
+                looks.push_back(config.getLookName(l));
+            }
+            config.destroy();
+        }
+        manager.destroy();
+    } catch (const std::exception& e) {
+        std::cout << "OcioDisplaySdk: reading the OCIO config failed: " << e.what() << std::endl;
+        return false;
+    }
+
+    const size_t viewCount = displayViews.size();
+    std::string oldKey;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        oldKey = m_configKey;
+        m_hasConfig = hasConfig;
+        m_configKey = key;
+        m_displayViews.swap(displayViews);
+        m_looks.swap(looks);
+    }
+    if (oldKey != key) {
+        // a config reloaded from the same file keeps its LUTs, they come from the same baked files
+        m_cache.erasePrefix(oldKey + "|");
+    }
+    std::cout << "OcioDisplaySdk: config " << key << ", " << viewCount << " views" << std::endl;
+    return true;
+#else
+    std::cout << "OcioDisplaySdk: SDK not available" << std::endl;
+    return false;
+#endif
+}
+
+std::string OcioDisplaySdk::configKey() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_configKey;
+}
+
+std::vector<OcioDisplaySdk::DisplayView> OcioDisplaySdk::displayViews() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_displayViews;
+}
+
+std::vector<std::string> OcioDisplaySdk::looks() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_looks;
+}
+
+std::string OcioDisplaySdk::bakedLutPath(const std::string& display, const std::string& view, const std::string& look) const {
+    std::string path = m_lutDirectory + "/" + fileNamePart(fileStem(configKey())) + "/" +
+                       fileNamePart(display) + "__" + fileNamePart(view);
+    if (!look.empty()) {
+        path += "__" + fileNamePart(look);
+    }
+    return path + ".cube";
+}
+
+std::shared_ptr<const SharedUtils::DisplayLut3D> OcioDisplaySdk::lut(const std::string& display,
+                                                                     const std::string& view,
+                                                                     const std::string& look) {
+    const std::string key = configKey() + "|" + display + "|" + view + "|" + look;
+    return m_cache.getOrBake(key, [&]() { return bake(display, view, look); });
+}
+
+std::shared_ptr<SharedUtils::DisplayLut3D> OcioDisplaySdk::bake(const std::string& display,
+                                                                const std::string& view,
+                                                                const std::string& look) const {
+    using SharedUtils::DisplayLut3D;
+
+    const std::string path = bakedLutPath(display, view, look);
+    if (std::ifstream(path).good()) {
+        std::string error;
+        std::shared_ptr<DisplayLut3D> lut = DisplayLut3D::loadCube(path, &error);
+        if (lut) {
+            std::cout << "OcioDisplaySdk: loaded " << path << std::endl;
+            return lut;
+        }
+        std::cout << "OcioDisplaySdk: can't use " << path << ": " << error << std::endl;
+    }
+
+    const std::string displayName = lowerCase(display);
+    const std::string viewName = lowerCase(view);
+
+    DisplayEncoding encoding = ENCODING_SRGB;
+    if (contains(displayName, "1886") || contains(displayName, "709")) {
+        encoding = ENCODING_GAMMA_24;
+    } else if (contains(displayName, "2.2")) {
+        encoding = ENCODING_GAMMA_22;
+    }
+
+    std::shared_ptr<DisplayLut3D> lut;
+    std::string description;
+    if (contains(viewName, "raw") || contains(viewName, "linear") || contains(viewName, "data")) {
+        lut = DisplayLut3D::bake(m_lutSize, DisplayLut3D::SHAPER_LINEAR, 0.0f, 1.0f, [](const float* in, float* out, size_t count) {
+            std::copy(in, in + count * 3, out);
+        });
+        description = "pass through";
+    } else if (contains(viewName, "aces") || contains(viewName, "filmic")) {
+        // scene linear from 12 stops below to 10 stops above middle gray
+        lut = DisplayLut3D::bake(m_lutSize, DisplayLut3D::SHAPER_LOG2, -12.0f, 10.0f, [encoding](const float* in, float* out, size_t count) {
+            for (size_t i = 0; i < count * 3; ++i) {
+                out[i] = encode(encoding, SharedUtils::applyToneCurve(SharedUtils::TONE_CURVE_ACES_FILMIC, in[i]));
+            }
+        });
+        description = "ACES filmic approximation";
+    } else {
+        lut = DisplayLut3D::bake(m_lutSize, DisplayLut3D::SHAPER_LOG2, -14.0f, std::log2(1.0f / 0.18f), [encoding](const float* in, float* out, size_t count) {
+            for (size_t i = 0; i < count * 3; ++i) {
+                out[i] = encode(encoding, in[i]);
+            }
+        });
+        description = "display encoding";
+    }
+
+    if (lut) {
+        lut->setTitle(display + " / " + view);
+        std::cout << "OcioDisplaySdk: no baked LUT for " << display << " / " << view
+                  << (look.empty() ? "" : " / " + look) << ", using the built in " << description << std::endl;
+    }
+    return lut;
+}
+
+bool OcioDisplaySdk::requestHdrOutput() {
+#ifdef DO_GRPC_SDK_ENABLED
+    try {
+        OctaneGRPC::ApiRenderEngineProxy::setAsyncTonemapParams(
+            Octane::TONEMAP_BUFFER_TYPE_HDR_FLOAT,
+            true,
+            Octane::NAMED_COLOR_SPACE_LINEAR_SRGB,
+            Octane::PREMULTIPLIED_ALPHA_TYPE_NONE);
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "OcioDisplaySdk: setAsyncTonemapParams failed: " << e.what() << std::endl;
+    }
+#endif
+    return false;
+}
+
+bool OcioDisplaySdk::requestLdrOutput() {
+#ifdef DO_GRPC_SDK_ENABLED
+    try {
+        OctaneGRPC::ApiRenderEngineProxy::setAsyncTonemapParams(
+            Octane::TONEMAP_BUFFER_TYPE_LDR,
+            true,
+            Octane::NAMED_COLOR_SPACE_SRGB,
+            Octane::PREMULTIPLIED_ALPHA_TYPE_NONE);
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "OcioDisplaySdk: setAsyncTonemapParams failed: " << e.what() << std::endl;
+    }
+#endif
+    return false;
+}
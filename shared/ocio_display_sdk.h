@@ -0,0 +1,112 @@
+#ifndef OCIO_DISPLAY_SDK_H
+#define OCIO_DISPLAY_SDK_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "display_lut.h"
+
+/**
+ * @brief Display LUTs for the OCIO displays and views of the connected Octane
+ *
+ * Octane is asked once for linear HDR frames (requestHdrOutput()), and the client
+ * applies exposure, tone curve and the display LUT itself with
+ * SharedUtils::applyDisplayTransform() or SharedUtils::DisplayTransformGl. Changing the
+ * exposure or curve then needs no round trip and no restart of the render.
+ *
+ * refresh() reads the displays, views and looks of the current config through
+ * ApiOcioContextManagerProxy / ApiOcioConfigProxy. The API exposes the names but can't
+ * evaluate a transform on client data, so lut() looks for a LUT baked offline from the
+ * same config:
+ *
+ *     ociobakelut --iconfig config.ocio --inputspace <linear sRGB space>
+ *                 --displayview <display> <view> --format resolve_cube --cubesize 33
+ *                 <lutDirectory>/<config>/<display>__<view>.cube
+ *
+ * (bakedLutPath() gives the exact name). Such a LUT takes display linear input in its
+ * domain, so use it with a tone curve for HDR frames. Without a file, a built in
+ * approximation is picked from the view and display names: raw/linear views pass the
+ * values through, ACES/filmic views get the ACES filmic curve, everything else only
+ * gets the display encoding (sRGB, gamma 2.4 for Rec.1886/Rec.709, gamma 2.2).
+ *
+ * LUTs are cached per config, display, view and look; a second request for the same
+ * view costs nothing.
+ */
+class OcioDisplaySdk {
+public:
+    struct DisplayView {
+        std::string display;
+        std::string view;
+    };
+
+    /**
+     * @param lutDirectory directory with the baked .cube files
+     * @param lutSize      grid size of the built in approximations
+     */
+    explicit OcioDisplaySdk(const std::string& lutDirectory = "luts", unsigned lutSize = 33);
+
+    /**
+     * @brief Read the displays, views and looks of the current OCIO config
+     *
+     * If the config changed since the last refresh, its cached LUTs are dropped.
+     * @return false if the calls failed. Without a loaded config the list is empty and
+     *         lut() still returns the built in LUTs.
+     */
+    bool refresh();
+
+    bool hasConfig() const { return m_hasConfig; }
+
+    /**
+     * @brief Identifies the config in the cache keys, its file name or "builtin"
+     */
+    std::string configKey() const;
+
+    std::vector<DisplayView> displayViews() const;
+    std::vector<std::string> looks() const;
+
+    /**
+     * @brief The display LUT for a view, from the cache, a baked file or the built in
+     *        approximation. Never null.
+     */
+    std::shared_ptr<const SharedUtils::DisplayLut3D> lut(const std::string& display,
+                                                         const std::string& view,
+                                                         const std::string& look = std::string());
+
+    /**
+     * @brief Where lut() looks for a baked LUT of a view
+     */
+    std::string bakedLutPath(const std::string& display,
+                             const std::string& view,
+                             const std::string& look = std::string()) const;
+
+    /**
+     * @brief Ask Octane for linear sRGB float frames without premultiplied alpha, for
+     *        the client side display transform
+     */
+    static bool requestHdrOutput();
+
+    /**
+     * @brief Go back to Octane's own tone mapped 8-bit frames
+     */
+    static bool requestLdrOutput();
+
+    SharedUtils::DisplayLutCache& cache() { return m_cache; }
+
+private:
+    std::shared_ptr<SharedUtils::DisplayLut3D> bake(const std::string& display,
+                                                    const std::string& view,
+                                                    const std::string& look) const;
+
+    std::string m_lutDirectory;
+    unsigned m_lutSize;
+    SharedUtils::DisplayLutCache m_cache;
+
+    mutable std::mutex m_mutex;
+    bool m_hasConfig;
+    std::string m_configKey;
+    std::vector<DisplayView> m_displayViews;
+    std::vector<std::string> m_looks;
+};
+
+#endif // OCIO_DISPLAY_SDK_H
@@ -0,0 +1,220 @@
+#include "pick_batch_sdk.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apirender.grpc.pb.h"
+#include "grpcsettings.h"
+
+namespace {
+
+struct PendingPick {
+    std::unique_ptr<grpc::ClientContext> context;
+    std::unique_ptr<grpc::ClientAsyncResponseReader<octaneapi::ApiRenderEngine::pickResponse>> reader;
+    octaneapi::ApiRenderEngine::pickResponse response;
+    grpc::Status status;
+    size_t position = 0;
+};
+
+OctaneVec::float_3 toFloat3(const octaneapi::float_3& v) {
+    return OctaneVec::float_3{ v.x(), v.y(), v.z() };
+}
+
+// same conversion as ApiRenderEngineProxy::pick(), plus the node
+void convertIntersection(const octaneapi::ApiRenderEngine_ApiRenderEngine_PickIntersection& in,
+                         OctaneGRPC::GRPCPickIntersection& out) {
+    out.mNode.attachObjectHandle(in.node().handle());
+    out.mMaterialPinIx = in.materialpinix();
+    out.mDepth = in.depth();
+    out.mPosition = toFloat3(in.position());
+    out.mGeometricNormal = toFloat3(in.geometricnormal());
+    out.mSmoothedNormal = toFloat3(in.smoothednormal());
+    out.mPrimitiveType = static_cast<Octane::PrimitiveType>(in.primitivetype());
+    const int vertexCount = std::min(in.primitivevertices().data_size(), 3);
+    for (int k = 0; k < vertexCount; ++k) {
+        out.mPrimitiveVertices[k] = toFloat3(in.primitivevertices().data(k));
+    }
+    out.mPositionOnPrimitive = toFloat3(in.positiononprimitive());
+}
+
+}
+
+PickBatchSdk::PickBatchSdk(const Settings& settings)
+    : m_settings(settings)
+{
+}
+
+PickBatchSdk::PickBatchSdk(const Settings& settings, std::shared_ptr<grpc::Channel> channel)
+    : m_settings(settings)
+    , m_channel(std::move(channel))
+{
+}
+
+void PickBatchSdk::setSettings(const Settings& settings) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_settings = settings;
+}
+
+PickBatchSdk::Settings PickBatchSdk::settings() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+std::shared_ptr<grpc::Channel> PickBatchSdk::channel() const {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_channel) {
+            return m_channel;
+        }
+    }
+    return OctaneGRPC::GRPCSettings::getInstance().getChannel();
+}
+
+size_t PickBatchSdk::pick(const std::vector<Position>& positions,
+                          bool filterDuplicateMaterialPins,
+                          unsigned int intersectionsSize,
+                          Result& result) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    const Settings settings = this->settings();
+
+    result.positions = positions;
+    result.intersections.clear();
+    result.offsets.assign(positions.size() + 1, 0);
+    result.failedCalls = 0;
+    result.lastError.clear();
+    result.ms = 0.0;
+    if (positions.empty() || intersectionsSize == 0) {
+        return 0;
+    }
+
+    std::unique_ptr<octaneapi::ApiRenderEngineService::Stub> stub =
+        octaneapi::ApiRenderEngineService::NewStub(channel());
+    grpc::CompletionQueue queue;
+    const auto deadline = std::chrono::system_clock::now() + std::chrono::milliseconds(settings.timeoutMs);
+
+    // responses arrive in any order, the closest hit of every position is kept until packing
+    std::vector<octaneapi::ApiRenderEngine_ApiRenderEngine_PickIntersection> closest(positions.size());
+    std::vector<uint8_t> hit(positions.size(), 0);
+
+    std::vector<PendingPick> pending(std::max(1u, std::min<unsigned>(settings.maxInFlight, (unsigned)positions.size())));
+    size_t next = 0;
+    size_t inFlight = 0;
+    auto issue = [&](size_t slot) {
+        PendingPick& call = pending[slot];
+        call.position = next++;
+        call.context = std::make_unique<grpc::ClientContext>();
+        call.context->set_deadline(deadline);
+        call.status = grpc::Status::OK;
+
+        octaneapi::ApiRenderEngine::pickRequest request;
+        request.set_x(positions[call.position].x);
+        request.set_y(positions[call.position].y);
+        request.set_filterduplicatematerialpins(filterDuplicateMaterialPins);
+        request.set_intersectionssize(intersectionsSize);
+        call.reader = stub->PrepareAsyncpick(call.context.get(), request, &queue);
+        call.reader->StartCall();
+        call.reader->Finish(&call.response, &call.status, reinterpret_cast<void*>(slot));
+    };
+
+    for (size_t slot = 0; slot < pending.size(); ++slot) {
+        issue(slot);
+        ++inFlight;
+    }
+
+    while (inFlight > 0) {
+        void* tag = nullptr;
+        bool ok = false;
+        if (!queue.Next(&tag, &ok)) {
+            break;
+        }
+        const size_t slot = reinterpret_cast<size_t>(tag);
+        PendingPick& call = pending[slot];
+        if (ok && call.status.ok()) {
+            if (call.response.result() > 0) {
+                closest[call.position].Swap(call.response.mutable_intersections());
+                hit[call.position] = 1;
+            }
+        } else {
+            ++result.failedCalls;
+            result.lastError = call.status.error_message();
+        }
+        call.reader.reset();
+        call.response.Clear();
+
+        if (next < positions.size()) {
+            issue(slot);
+        } else {
+            --inFlight;
+        }
+    }
+    queue.Shutdown();
+    void* tag = nullptr;
+    bool ok = false;
+    while (queue.Next(&tag, &ok)) {
+    }
+
+    size_t hits = 0;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        result.offsets[i] = (uint32_t)result.intersections.size();
+        if (hit[i]) {
+            result.intersections.emplace_back();
+            convertIntersection(closest[i], result.intersections.back());
+            ++hits;
+        }
+    }
+    result.offsets[positions.size()] = (uint32_t)result.intersections.size();
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.batches;
+        m_stats.positions += positions.size();
+        m_stats.hits += hits;
+        m_stats.failedCalls += result.failedCalls;
+        m_stats.totalMs += result.ms;
+        m_stats.lastMs = result.ms;
+    }
+    if (result.failedCalls == positions.size()) {
+        std::cout << "PickBatchSdk: all " << positions.size() << " picks failed: " << result.lastError << std::endl;
+    }
+    return hits;
+}
+
+size_t PickBatchSdk::pickRect(uint32_t x,
+                              uint32_t y,
+                              uint32_t width,
+                              uint32_t height,
+                              uint32_t stride,
+                              bool filterDuplicateMaterialPins,
+                              unsigned int intersectionsSize,
+                              Result& result) {
+    stride = std::max(stride, 1u);
+    std::vector<Position> positions;
+    positions.reserve((size_t)((width + stride - 1) / stride) * ((height + stride - 1) / stride));
+    for (uint32_t row = 0; row < height; row += stride) {
+        for (uint32_t col = 0; col < width; col += stride) {
+            positions.push_back(Position{ x + col, y + row });
+        }
+    }
+    return pick(positions, filterDuplicateMaterialPins, intersectionsSize, result);
+}
+
+PickBatchSdk::Stats PickBatchSdk::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void PickBatchSdk::printSummary(std::ostream& out) const {
+    const Stats s = stats();
+    out << "Pick batches: " << s.batches << " batches, " << s.positions << " positions ("
+        << s.hits << " hit, " << s.failedCalls << " failed)";
+    if (s.batches > 0) {
+        out << ", avg " << std::fixed << std::setprecision(2) << s.totalMs / s.batches << " ms, last "
+            << s.lastMs << " ms";
+    }
+    out << std::endl;
+}
+#endif
@@ -0,0 +1,113 @@
+#ifndef PICK_BATCH_SDK_H
+#define PICK_BATCH_SDK_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include <grpcpp/grpcpp.h>
+#include "apirenderengineclient.h"
+
+/**
+ * @brief Picks many screen positions with ApiRenderEngine::pick in one batch
+ *
+ * ApiRenderEngineProxy::pick() blocks for a full round trip per position, a 64x64 probe
+ * grid for lasso selection or a hover preview costs 4096 of them back to back. The server
+ * has no batched pick, so the batch issues the pick calls asynchronously on one channel
+ * and keeps up to maxInFlight of them pending. They are multiplexed over the same HTTP/2
+ * connection, the whole grid costs about one round trip plus the server time.
+ *
+ * Results are packed into one array with an offset per position, in the order of the
+ * positions no matter in which order the responses arrive. The pick response holds one
+ * intersection (the closest), so a position gets at most one entry.
+ *
+ * A batch can be issued from any thread, batches from different threads run concurrently.
+ */
+class PickBatchSdk {
+public:
+    struct Settings {
+        unsigned maxInFlight = 256;         // pick calls pending at once
+        unsigned timeoutMs = 10000;         // deadline of every call, from the start of the batch
+    };
+
+    struct Position {
+        uint32_t x;
+        uint32_t y;
+    };
+
+    struct Result {
+        std::vector<Position> positions;
+        std::vector<OctaneGRPC::GRPCPickIntersection> intersections;
+        std::vector<uint32_t> offsets;      // per position into intersections, plus the end
+        size_t failedCalls = 0;
+        std::string lastError;
+        double ms = 0.0;
+
+        /**
+         * @brief Intersections of position i are [begin(i), begin(i) + count(i))
+         */
+        uint32_t begin(size_t i) const { return offsets[i]; }
+        uint32_t count(size_t i) const { return offsets[i + 1] - offsets[i]; }
+    };
+
+    struct Stats {
+        uint64_t batches = 0;
+        uint64_t positions = 0;
+        uint64_t hits = 0;
+        uint64_t failedCalls = 0;
+        double totalMs = 0.0;
+        double lastMs = 0.0;
+    };
+
+    PickBatchSdk() : PickBatchSdk(Settings()) {}
+    explicit PickBatchSdk(const Settings& settings);
+
+    /**
+     * @brief Use a channel of its own instead of the one of the proxies
+     */
+    PickBatchSdk(const Settings& settings, std::shared_ptr<grpc::Channel> channel);
+
+    void setSettings(const Settings& settings);
+    Settings settings() const;
+
+    /**
+     * @brief Pick all positions, arguments as for ApiRenderEngineProxy::pick(). Returns the
+     * number of positions with an intersection. Failed calls count as misses and are
+     * reported in the result.
+     */
+    size_t pick(const std::vector<Position>& positions,
+                bool filterDuplicateMaterialPins,
+                unsigned int intersectionsSize,
+                Result& result);
+
+    /**
+     * @brief Pick a grid of positions in the rectangle, every stride pixels starting at
+     * (x, y), row by row
+     */
+    size_t pickRect(uint32_t x,
+                    uint32_t y,
+                    uint32_t width,
+                    uint32_t height,
+                    uint32_t stride,
+                    bool filterDuplicateMaterialPins,
+                    unsigned int intersectionsSize,
+                    Result& result);
+
+    Stats stats() const;
+    void printSummary(std::ostream& out) const;
+
+private:
+    std::shared_ptr<grpc::Channel> channel() const;
+
+    mutable std::mutex m_mutex;
+    Settings m_settings;
+    std::shared_ptr<grpc::Channel> m_channel;   // null uses the proxies' channel
+    Stats m_stats;
+};
+#endif
+
+#endif // PICK_BATCH_SDK_H
@@ -0,0 +1,1090 @@
+#include "pixel_convert.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PIXEL_CONVERT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define PIXEL_CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+// AVX2 kernels are compiled next to the baseline ones and only called after the
+// CPU check, so they need a per-function target on GCC/Clang. MSVC allows the
+// intrinsics without any flag.
+#if defined(PIXEL_CONVERT_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PIXEL_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#else
+#define PIXEL_TARGET_AVX2
+#endif
+
+namespace SharedUtils {
+namespace PixelConvert {
+
+namespace {
+
+    struct Kernels
+    {
+        void (*floatToU8)(const float*, uint8_t*, size_t);
+        void (*halfToFloat)(const uint16_t*, float*, size_t);
+        void (*floatToHalf)(const float*, uint16_t*, size_t);
+        void (*monoToRgba8)(const uint8_t*, bool, uint8_t*, size_t);
+        void (*fillAlpha8)(uint8_t*, size_t, uint8_t);
+        void (*swizzle8)(const uint8_t*, uint8_t*, size_t, const uint8_t*);
+        void (*premultiply8)(uint8_t*, size_t);
+        void (*unpremultiply8)(uint8_t*, size_t);
+        void (*premultiplyFloat)(float*, size_t);
+        void (*unpremultiplyFloat)(float*, size_t);
+    };
+
+    //--- Scalar kernels, also used for the tails of the vector kernels ---
+
+    inline uint8_t floatToU8Scalar(float v)
+    {
+        v *= 255.f;
+        // written so that NaN ends up as 0
+        v = v > 0.f ? v : 0.f;
+        v = v < 255.f ? v : 255.f;
+        return (uint8_t)v;
+    }
+
+    inline float halfToFloatScalar(uint16_t h)
+    {
+        const uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+        const uint32_t exponent = (h >> 10) & 0x1fu;
+        const uint32_t mantissa = h & 0x3ffu;
+        uint32_t bits;
+        if (exponent == 0)
+        {
+            // zero or subnormal, value is mantissa * 2^-24
+            float f = (float)mantissa * (1.0f / 16777216.0f);
+            std::memcpy(&bits, &f, sizeof(bits));
+            bits |= sign;
+        }
+        else if (exponent == 31)
+        {
+            bits = sign | 0x7f800000u | (mantissa << 13);
+        }
+        else
+        {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        float result;
+        std::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    inline uint16_t floatToHalfScalar(float f)
+    {
+        uint32_t x;
+        std::memcpy(&x, &f, sizeof(x));
+        const uint32_t sign = (x >> 16) & 0x8000u;
+        const uint32_t absx = x & 0x7fffffffu;
+
+        if (absx >= 0x7f800000u)
+        {
+            // inf stays inf, NaN stays a quiet NaN
+            return (uint16_t)(sign | 0x7c00u | (absx > 0x7f800000u ? 0x200u | ((absx >> 13) & 0x3ffu) : 0u));
+        }
+        if (absx >= 0x477ff000u)
+        {
+            // 65520 and up rounds to inf
+            return (uint16_t)(sign | 0x7c00u);
+        }
+        if (absx < 0x38800000u)
+        {
+            // below the smallest normal half, 2^-25 and less rounds to zero
+            if (absx <= 0x33000000u)
+            {
+                return (uint16_t)sign;
+            }
+            const uint32_t exponent = absx >> 23;
+            const uint32_t mantissa = (absx & 0x7fffffu) | 0x800000u;
+            const uint32_t shift = 126 - exponent;
+            uint32_t result = mantissa >> shift;
+            const uint32_t rest = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+            if (rest > halfway || (rest == halfway && (result & 1u)))
+            {
+                ++result;
+            }
+            return (uint16_t)(sign | result);
+        }
+
+        // normal range, rebias the exponent and round to nearest even
+        uint32_t result = (absx - 0x38000000u) >> 13;
+        const uint32_t rest = absx & 0x1fffu;
+        if (rest > 0x1000u || (rest == 0x1000u && (result & 1u)))
+        {
+            ++result;
+        }
+        return (uint16_t)(sign | result);
+    }
+
+    // round(c * a / 255) without a division
+    inline uint8_t mulDiv255(uint32_t c, uint32_t a)
+    {
+        uint32_t t = c * a + 128;
+        return (uint8_t)((t + (t >> 8)) >> 8);
+    }
+
+    // 16.16 fixed point 255 / a, used to unpremultiply without dividing per channel
+    struct UnpremultiplyTable
+    {
+        uint32_t scale[256];
+
+        UnpremultiplyTable()
+        {
+            scale[0] = 0;
+            for (uint32_t a = 1; a < 256; ++a)
+            {
+                scale[a] = ((255u << 16) + a / 2) / a;
+            }
+        }
+    };
+
+    const UnpremultiplyTable& unpremultiplyTable()
+    {
+        static const UnpremultiplyTable table;
+        return table;
+    }
+
+    void floatToU8_scalar(const float* src, uint8_t* dst, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            dst[i] = floatToU8Scalar(src[i]);
+        }
+    }
+
+    void halfToFloat_scalar(const uint16_t* src, float* dst, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            dst[i] = halfToFloatScalar(src[i]);
+        }
+    }
+
+    void floatToHalf_scalar(const float* src, uint16_t* dst, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            dst[i] = floatToHalfScalar(src[i]);
+        }
+    }
+
+    void monoToRgba8_scalar(const uint8_t* src, bool srcHasAlpha, uint8_t* dst, size_t count)
+    {
+        const size_t srcStep = srcHasAlpha ? 2 : 1;
+        for (size_t i = 0; i < count; ++i, src += srcStep, dst += 4)
+        {
+            dst[0] = src[0];
+            dst[1] = src[0];
+            dst[2] = src[0];
+            dst[3] = srcHasAlpha ? src[1] : 0xff;
+        }
+    }
+
+    void fillAlpha8_scalar(uint8_t* rgba, size_t count, uint8_t alpha)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            rgba[i * 4 + 3] = alpha;
+        }
+    }
+
+    void swizzle8_scalar(const uint8_t* src, uint8_t* dst, size_t count, const uint8_t* order)
+    {
+        for (size_t i = 0; i < count; ++i, src += 4, dst += 4)
+        {
+            const uint8_t pixel[4] = { src[0], src[1], src[2], src[3] };
+            dst[0] = pixel[order[0]];
+            dst[1] = pixel[order[1]];
+            dst[2] = pixel[order[2]];
+            dst[3] = pixel[order[3]];
+        }
+    }
+
+    void premultiply8_scalar(uint8_t* rgba, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i, rgba += 4)
+        {
+            const uint32_t a = rgba[3];
+            rgba[0] = mulDiv255(rgba[0], a);
+            rgba[1] = mulDiv255(rgba[1], a);
+            rgba[2] = mulDiv255(rgba[2], a);
+        }
+    }
+
+    void unpremultiply8_scalar(uint8_t* rgba, size_t count)
+    {
+        const uint32_t* scale = unpremultiplyTable().scale;
+        for (size_t i = 0; i < count; ++i, rgba += 4)
+        {
+            const uint32_t s = scale[rgba[3]];
+            rgba[0] = (uint8_t)std::min<uint32_t>(255u, (rgba[0] * s + 0x8000u) >> 16);
+            rgba[1] = (uint8_t)std::min<uint32_t>(255u, (rgba[1] * s + 0x8000u) >> 16);
+            rgba[2] = (uint8_t)std::min<uint32_t>(255u, (rgba[2] * s + 0x8000u) >> 16);
+        }
+    }
+
+    void premultiplyFloat_scalar(float* rgba, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i, rgba += 4)
+        {
+            rgba[0] *= rgba[3];
+            rgba[1] *= rgba[3];
+            rgba[2] *= rgba[3];
+        }
+    }
+
+    void unpremultiplyFloat_scalar(float* rgba, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i, rgba += 4)
+        {
+            // fully transparent pixels keep their (emissive) color
+            if (rgba[3] > 0.f)
+            {
+                const float inv = 1.f / rgba[3];
+                rgba[0] *= inv;
+                rgba[1] *= inv;
+                rgba[2] *= inv;
+            }
+        }
+    }
+
+    const Kernels gScalarKernels =
+    {
+        floatToU8_scalar,
+        halfToFloat_scalar,
+        floatToHalf_scalar,
+        monoToRgba8_scalar,
+        fillAlpha8_scalar,
+        swizzle8_scalar,
+        premultiply8_scalar,
+        unpremultiply8_scalar,
+        premultiplyFloat_scalar,
+        unpremultiplyFloat_scalar,
+    };
+
+#if defined(PIXEL_CONVERT_X86)
+
+    //--- SSE2 kernels, baseline on x64 ---
+
+    inline __m128i floatToI32_sse2(__m128 v, __m128 scale, __m128 maxValue)
+    {
+        // max() with the constant second returns 0 for NaN
+        v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(v, scale), _mm_setzero_ps()), maxValue);
+        return _mm_cvttps_epi32(v);
+    }
+
+    void floatToU8_sse2(const float* src, uint8_t* dst, size_t count)
+    {
+        const __m128 scale = _mm_set1_ps(255.f);
+        const __m128 maxValue = _mm_set1_ps(255.f);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i a = floatToI32_sse2(_mm_loadu_ps(src + i), scale, maxValue);
+            __m128i b = floatToI32_sse2(_mm_loadu_ps(src + i + 4), scale, maxValue);
+            __m128i c = floatToI32_sse2(_mm_loadu_ps(src + i + 8), scale, maxValue);
+            __m128i d = floatToI32_sse2(_mm_loadu_ps(src + i + 12), scale, maxValue);
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+            _mm_storeu_si128((__m128i*)(dst + i), packed);
+        }
+        floatToU8_scalar(src + i, dst + i, count - i);
+    }
+
+    void halfToFloat_sse2(const uint16_t* src, float* dst, size_t count)
+    {
+        // magic number conversion: shift exponent/mantissa into place and let a
+        // float multiply rebias the exponent, which also handles subnormals
+        const __m128i maskNoSign = _mm_set1_epi32(0x7fff);
+        const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+        const __m128i wasInfNan = _mm_set1_epi32(0x7bff);
+        const __m128i expInfNan = _mm_set1_epi32(255 << 23);
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i h8 = _mm_loadu_si128((const __m128i*)(src + i));
+            __m128i halves[2] = { _mm_unpacklo_epi16(h8, zero), _mm_unpackhi_epi16(h8, zero) };
+            for (int k = 0; k < 2; ++k)
+            {
+                __m128i h = halves[k];
+                __m128i expMant = _mm_and_si128(maskNoSign, h);
+                __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMant, 13)), magic);
+                __m128i infNan = _mm_and_si128(_mm_cmpgt_epi32(expMant, wasInfNan), expInfNan);
+                __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expMant), 16);
+                __m128 result = _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infNan)));
+                _mm_storeu_ps(dst + i + k * 4, result);
+            }
+        }
+        halfToFloat_scalar(src + i, dst + i, count - i);
+    }
+
+    void monoToRgba8_sse2(const uint8_t* src, bool srcHasAlpha, uint8_t* dst, size_t count)
+    {
+        size_t i = 0;
+        if (srcHasAlpha)
+        {
+            const __m128i lowByte = _mm_set1_epi16(0x00ff);
+            for (; i + 8 <= count; i += 8)
+            {
+                // 8 YA pairs, as 16-bit words y | a << 8
+                __m128i ya = _mm_loadu_si128((const __m128i*)(src + i * 2));
+                __m128i y = _mm_and_si128(ya, lowByte);
+                __m128i yy = _mm_or_si128(y, _mm_slli_epi16(y, 8));
+                _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_unpacklo_epi16(yy, ya));
+                _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_unpackhi_epi16(yy, ya));
+            }
+        }
+        else
+        {
+            const __m128i opaque = _mm_set1_epi8((char)0xff);
+            for (; i + 16 <= count; i += 16)
+            {
+                __m128i y = _mm_loadu_si128((const __m128i*)(src + i));
+                __m128i yyLo = _mm_unpacklo_epi8(y, y);
+                __m128i yyHi = _mm_unpackhi_epi8(y, y);
+                __m128i yaLo = _mm_unpacklo_epi8(y, opaque);
+                __m128i yaHi = _mm_unpackhi_epi8(y, opaque);
+                _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_unpacklo_epi16(yyLo, yaLo));
+                _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_unpackhi_epi16(yyLo, yaLo));
+                _mm_storeu_si128((__m128i*)(dst + i * 4 + 32), _mm_unpacklo_epi16(yyHi, yaHi));
+                _mm_storeu_si128((__m128i*)(dst + i * 4 + 48), _mm_unpackhi_epi16(yyHi, yaHi));
+            }
+        }
+        monoToRgba8_scalar(src + i * (srcHasAlpha ? 2 : 1), srcHasAlpha, dst + i * 4, count - i);
+    }
+
+    void fillAlpha8_sse2(uint8_t* rgba, size_t count, uint8_t alpha)
+    {
+        const __m128i colorMask = _mm_set1_epi32(0x00ffffff);
+        const __m128i alphaBits = _mm_set1_epi32((int)((uint32_t)alpha << 24));
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+            _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_or_si128(_mm_and_si128(v, colorMask), alphaBits));
+        }
+        fillAlpha8_scalar(rgba + i * 4, count - i, alpha);
+    }
+
+    void swizzle8_sse2(const uint8_t* src, uint8_t* dst, size_t count, const uint8_t* order)
+    {
+        // SSE2 has no byte shuffle, only the common red/blue swap gets a vector path
+        size_t i = 0;
+        if (order[0] == 2 && order[1] == 1 && order[2] == 0 && order[3] == 3)
+        {
+            const __m128i keep = _mm_set1_epi32((int)0xff00ff00u);
+            const __m128i low = _mm_set1_epi32(0x000000ff);
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+                __m128i r = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+                __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+                _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_and_si128(v, keep), _mm_or_si128(r, b)));
+            }
+        }
+        swizzle8_scalar(src + i * 4, dst + i * 4, count - i, order);
+    }
+
+    inline __m128i premultiplyWords_sse2(__m128i x)
+    {
+        // x holds two RGBA pixels as 16-bit words, broadcast alpha to all channels
+        __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xff), 0xff);
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    void premultiply8_sse2(uint8_t* rgba, size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i alphaMask = _mm_set1_epi32((int)0xff000000u);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+            __m128i lo = premultiplyWords_sse2(_mm_unpacklo_epi8(v, zero));
+            __m128i hi = premultiplyWords_sse2(_mm_unpackhi_epi8(v, zero));
+            __m128i result = _mm_packus_epi16(lo, hi);
+            result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, v));
+            _mm_storeu_si128((__m128i*)(rgba + i * 4), result);
+        }
+        premultiply8_scalar(rgba + i * 4, count - i);
+    }
+
+    void premultiplyFloat_sse2(float* rgba, size_t count)
+    {
+        const __m128 alphaMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+        for (size_t i = 0; i < count; ++i)
+        {
+            __m128 v = _mm_loadu_ps(rgba + i * 4);
+            __m128 a = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+            __m128 result = _mm_or_ps(_mm_andnot_ps(alphaMask, _mm_mul_ps(v, a)), _mm_and_ps(alphaMask, v));
+            _mm_storeu_ps(rgba + i * 4, result);
+        }
+    }
+
+    void unpremultiplyFloat_sse2(float* rgba, size_t count)
+    {
+        const __m128 alphaMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+        const __m128 one = _mm_set1_ps(1.f);
+        for (size_t i = 0; i < count; ++i)
+        {
+            __m128 v = _mm_loadu_ps(rgba + i * 4);
+            __m128 a = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+            __m128 valid = _mm_cmpgt_ps(a, _mm_setzero_ps());
+            __m128 factor = _mm_or_ps(_mm_and_ps(valid, _mm_div_ps(one, a)), _mm_andnot_ps(valid, one));
+            __m128 result = _mm_or_ps(_mm_andnot_ps(alphaMask, _mm_mul_ps(v, factor)), _mm_and_ps(alphaMask, v));
+            _mm_storeu_ps(rgba + i * 4, result);
+        }
+    }
+
+    const Kernels gSse2Kernels =
+    {
+        floatToU8_sse2,
+        halfToFloat_sse2,
+        floatToHalf_scalar,
+        monoToRgba8_sse2,
+        fillAlpha8_sse2,
+        swizzle8_sse2,
+        premultiply8_sse2,
+        unpremultiply8_scalar,
+        premultiplyFloat_sse2,
+        unpremultiplyFloat_sse2,
+    };
+
+    //--- AVX2 + F16C kernels ---
+    // Each kernel clears the upper YMM state before falling back to the SSE2/scalar
+    // code for the tail, GCC does not do that for a per-function target and mixing
+    // them is very slow on Intel CPUs.
+
+    PIXEL_TARGET_AVX2 inline __m256i floatToI32_avx2(__m256 v, __m256 scale, __m256 maxValue)
+    {
+        v = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(v, scale), _mm256_setzero_ps()), maxValue);
+        return _mm256_cvttps_epi32(v);
+    }
+
+    PIXEL_TARGET_AVX2 void floatToU8_avx2(const float* src, uint8_t* dst, size_t count)
+    {
+        const __m256 scale = _mm256_set1_ps(255.f);
+        const __m256 maxValue = _mm256_set1_ps(255.f);
+        // the packs work per 128-bit lane, this puts the 4-byte groups back in order
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256i a = floatToI32_avx2(_mm256_loadu_ps(src + i), scale, maxValue);
+            __m256i b = floatToI32_avx2(_mm256_loadu_ps(src + i + 8), scale, maxValue);
+            __m256i c = floatToI32_avx2(_mm256_loadu_ps(src + i + 16), scale, maxValue);
+            __m256i d = floatToI32_avx2(_mm256_loadu_ps(src + i + 24), scale, maxValue);
+            __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permutevar8x32_epi32(packed, order));
+        }
+        _mm256_zeroupper();
+        floatToU8_sse2(src + i, dst + i, count - i);
+    }
+
+    PIXEL_TARGET_AVX2 void halfToFloat_avx2(const uint16_t* src, float* dst, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i h = _mm_loadu_si128((const __m128i*)(src + i));
+            _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+        }
+        _mm256_zeroupper();
+        halfToFloat_scalar(src + i, dst + i, count - i);
+    }
+
+    PIXEL_TARGET_AVX2 void floatToHalf_avx2(const float* src, uint16_t* dst, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128((__m128i*)(dst + i), h);
+        }
+        _mm256_zeroupper();
+        floatToHalf_scalar(src + i, dst + i, count - i);
+    }
+
+    PIXEL_TARGET_AVX2 void fillAlpha8_avx2(uint8_t* rgba, size_t count, uint8_t alpha)
+    {
+        const __m256i colorMask = _mm256_set1_epi32(0x00ffffff);
+        const __m256i alphaBits = _mm256_set1_epi32((int)((uint32_t)alpha << 24));
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(rgba + i * 4));
+            _mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_or_si256(_mm256_and_si256(v, colorMask), alphaBits));
+        }
+        _mm256_zeroupper();
+        fillAlpha8_scalar(rgba + i * 4, count - i, alpha);
+    }
+
+    PIXEL_TARGET_AVX2 void swizzle8_avx2(const uint8_t* src, uint8_t* dst, size_t count, const uint8_t* order)
+    {
+        alignas(32) int8_t shuffle[32];
+        for (int p = 0; p < 8; ++p)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                // byte indices are relative to the 128-bit lane
+                shuffle[p * 4 + c] = (int8_t)(((p & 3) * 4) + (order[c] & 3));
+            }
+        }
+        const __m256i mask = _mm256_load_si256((const __m256i*)shuffle);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+            _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(v, mask));
+        }
+        _mm256_zeroupper();
+        swizzle8_scalar(src + i * 4, dst + i * 4, count - i, order);
+    }
+
+    PIXEL_TARGET_AVX2 inline __m256i premultiplyWords_avx2(__m256i x)
+    {
+        __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0xff), 0xff);
+        __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, a), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+
+    PIXEL_TARGET_AVX2 void premultiply8_avx2(uint8_t* rgba, size_t count)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i alphaMask = _mm256_set1_epi32((int)0xff000000u);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            // unpack and pack both work per lane, so the pixel order is preserved
+            __m256i v = _mm256_loadu_si256((const __m256i*)(rgba + i * 4));
+            __m256i lo = premultiplyWords_avx2(_mm256_unpacklo_epi8(v, zero));
+            __m256i hi = premultiplyWords_avx2(_mm256_unpackhi_epi8(v, zero));
+            __m256i result = _mm256_packus_epi16(lo, hi);
+            result = _mm256_blendv_epi8(result, v, alphaMask);
+            _mm256_storeu_si256((__m256i*)(rgba + i * 4), result);
+        }
+        _mm256_zeroupper();
+        premultiply8_sse2(rgba + i * 4, count - i);
+    }
+
+    PIXEL_TARGET_AVX2 void premultiplyFloat_avx2(float* rgba, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m256 v = _mm256_loadu_ps(rgba + i * 4);
+            __m256 a = _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3));
+            _mm256_storeu_ps(rgba + i * 4, _mm256_blend_ps(_mm256_mul_ps(v, a), v, 0x88));
+        }
+        _mm256_zeroupper();
+        premultiplyFloat_sse2(rgba + i * 4, count - i);
+    }
+
+    PIXEL_TARGET_AVX2 void unpremultiplyFloat_avx2(float* rgba, size_t count)
+    {
+        const __m256 one = _mm256_set1_ps(1.f);
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m256 v = _mm256_loadu_ps(rgba + i * 4);
+            __m256 a = _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3));
+            __m256 valid = _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GT_OQ);
+            __m256 factor = _mm256_blendv_ps(one, _mm256_div_ps(one, a), valid);
+            _mm256_storeu_ps(rgba + i * 4, _mm256_blend_ps(_mm256_mul_ps(v, factor), v, 0x88));
+        }
+        _mm256_zeroupper();
+        unpremultiplyFloat_sse2(rgba + i * 4, count - i);
+    }
+
+    const Kernels gAvx2Kernels =
+    {
+        floatToU8_avx2,
+        halfToFloat_avx2,
+        floatToHalf_avx2,
+        monoToRgba8_sse2,       // bound by memory bandwidth, the SSE2 version keeps up
+        fillAlpha8_avx2,
+        swizzle8_avx2,
+        premultiply8_avx2,
+        unpremultiply8_scalar,
+        premultiplyFloat_avx2,
+        unpremultiplyFloat_avx2,
+    };
+
+    bool cpuSupportsAvx2()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        const bool f16c = (info[2] & (1 << 29)) != 0;
+        if (!osxsave || !avx || !f16c || maxLeaf < 7)
+        {
+            return false;
+        }
+        // the OS has to save the YMM registers
+        if ((_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+#endif
+    }
+
+#endif // PIXEL_CONVERT_X86
+
+#if defined(PIXEL_CONVERT_NEON)
+
+    //--- NEON kernels, baseline on arm64 ---
+
+    inline uint16x4_t floatToU16_neon(float32x4_t v, float32x4_t scale, float32x4_t maxValue)
+    {
+        // the conversion saturates negative values and NaN to 0
+        return vmovn_u32(vcvtq_u32_f32(vminq_f32(vmulq_f32(v, scale), maxValue)));
+    }
+
+    void floatToU8_neon(const float* src, uint8_t* dst, size_t count)
+    {
+        const float32x4_t scale = vdupq_n_f32(255.f);
+        const float32x4_t maxValue = vdupq_n_f32(255.f);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            uint16x8_t lo = vcombine_u16(floatToU16_neon(vld1q_f32(src + i), scale, maxValue),
+                                         floatToU16_neon(vld1q_f32(src + i + 4), scale, maxValue));
+            uint16x8_t hi = vcombine_u16(floatToU16_neon(vld1q_f32(src + i + 8), scale, maxValue),
+                                         floatToU16_neon(vld1q_f32(src + i + 12), scale, maxValue));
+            vst1q_u8(dst + i, vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+        }
+        floatToU8_scalar(src + i, dst + i, count - i);
+    }
+
+    void halfToFloat_neon(const uint16_t* src, float* dst, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+        }
+        halfToFloat_scalar(src + i, dst + i, count - i);
+    }
+
+    void floatToHalf_neon(const float* src, uint16_t* dst, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+        }
+        floatToHalf_scalar(src + i, dst + i, count - i);
+    }
+
+    void monoToRgba8_neon(const uint8_t* src, bool srcHasAlpha, uint8_t* dst, size_t count)
+    {
+        size_t i = 0;
+        if (srcHasAlpha)
+        {
+            for (; i + 16 <= count; i += 16)
+            {
+                uint8x16x2_t ya = vld2q_u8(src + i * 2);
+                uint8x16x4_t rgba = { { ya.val[0], ya.val[0], ya.val[0], ya.val[1] } };
+                vst4q_u8(dst + i * 4, rgba);
+            }
+        }
+        else
+        {
+            const uint8x16_t opaque = vdupq_n_u8(0xff);
+            for (; i + 16 <= count; i += 16)
+            {
+                uint8x16_t y = vld1q_u8(src + i);
+                uint8x16x4_t rgba = { { y, y, y, opaque } };
+                vst4q_u8(dst + i * 4, rgba);
+            }
+        }
+        monoToRgba8_scalar(src + i * (srcHasAlpha ? 2 : 1), srcHasAlpha, dst + i * 4, count - i);
+    }
+
+    void fillAlpha8_neon(uint8_t* rgba, size_t count, uint8_t alpha)
+    {
+        const uint32x4_t colorMask = vdupq_n_u32(0x00ffffffu);
+        const uint32x4_t alphaBits = vdupq_n_u32((uint32_t)alpha << 24);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            uint32x4_t v = vreinterpretq_u32_u8(vld1q_u8(rgba + i * 4));
+            v = vorrq_u32(vandq_u32(v, colorMask), alphaBits);
+            vst1q_u8(rgba + i * 4, vreinterpretq_u8_u32(v));
+        }
+        fillAlpha8_scalar(rgba + i * 4, count - i, alpha);
+    }
+
+    void swizzle8_neon(const uint8_t* src, uint8_t* dst, size_t count, const uint8_t* order)
+    {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            uint8x16x4_t in = vld4q_u8(src + i * 4);
+            uint8x16x4_t out = { { in.val[order[0] & 3], in.val[order[1] & 3], in.val[order[2] & 3], in.val[order[3] & 3] } };
+            vst4q_u8(dst + i * 4, out);
+        }
+        swizzle8_scalar(src + i * 4, dst + i * 4, count - i, order);
+    }
+
+    inline uint8x8_t mulDiv255_neon(uint8x8_t c, uint8x8_t a)
+    {
+        uint16x8_t t = vaddq_u16(vmull_u8(c, a), vdupq_n_u16(128));
+        return vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+    }
+
+    void premultiply8_neon(uint8_t* rgba, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            uint8x16x4_t v = vld4q_u8(rgba + i * 4);
+            const uint8x8_t aLo = vget_low_u8(v.val[3]);
+            const uint8x8_t aHi = vget_high_u8(v.val[3]);
+            for (int c = 0; c < 3; ++c)
+            {
+                v.val[c] = vcombine_u8(mulDiv255_neon(vget_low_u8(v.val[c]), aLo),
+                                       mulDiv255_neon(vget_high_u8(v.val[c]), aHi));
+            }
+            vst4q_u8(rgba + i * 4, v);
+        }
+        premultiply8_scalar(rgba + i * 4, count - i);
+    }
+
+    void premultiplyFloat_neon(float* rgba, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            float32x4_t v = vld1q_f32(rgba + i * 4);
+            const float a = vgetq_lane_f32(v, 3);
+            vst1q_f32(rgba + i * 4, vsetq_lane_f32(a, vmulq_n_f32(v, a), 3));
+        }
+    }
+
+    const Kernels gNeonKernels =
+    {
+        floatToU8_neon,
+        halfToFloat_neon,
+        floatToHalf_neon,
+        monoToRgba8_neon,
+        fillAlpha8_neon,
+        swizzle8_neon,
+        premultiply8_neon,
+        unpremultiply8_scalar,
+        premultiplyFloat_neon,
+        unpremultiplyFloat_scalar,
+    };
+
+#endif // PIXEL_CONVERT_NEON
+
+    SimdLevel detectSimdLevel()
+    {
+#if defined(PIXEL_CONVERT_X86)
+        return cpuSupportsAvx2() ? SIMD_AVX2 : SIMD_SSE2;
+#elif defined(PIXEL_CONVERT_NEON)
+        return SIMD_NEON;
+#else
+        return SIMD_SCALAR;
+#endif
+    }
+
+    SimdLevel bestSimdLevel()
+    {
+        static const SimdLevel level = detectSimdLevel();
+        return level;
+    }
+
+    const Kernels* kernelsFor(SimdLevel level)
+    {
+        switch (level)
+        {
+#if defined(PIXEL_CONVERT_X86)
+        case SIMD_AVX2:
+            return &gAvx2Kernels;
+        case SIMD_SSE2:
+            return &gSse2Kernels;
+#endif
+#if defined(PIXEL_CONVERT_NEON)
+        case SIMD_NEON:
+            return &gNeonKernels;
+#endif
+        default:
+            return &gScalarKernels;
+        }
+    }
+
+    std::atomic<int> gSimdLevel{ -1 };
+    std::atomic<size_t> gParallelThreshold{ 1024 * 1024 };
+
+    const Kernels& kernels()
+    {
+        int level = gSimdLevel.load(std::memory_order_relaxed);
+        if (level < 0)
+        {
+            level = bestSimdLevel();
+            gSimdLevel.store(level, std::memory_order_relaxed);
+        }
+        return *kernelsFor((SimdLevel)level);
+    }
+
+    ThreadPool& rowPool()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    // Pixels per batch when a conversion goes through a temporary buffer
+    const size_t TEMP_PIXELS = 256;
+
+} // namespace
+
+size_t bytesPerPixel(PixelFormat format)
+{
+    switch (format)
+    {
+    case PIXEL_FORMAT_LDR_RGBA:        return 4;
+    case PIXEL_FORMAT_LDR_MONO:        return 1;
+    case PIXEL_FORMAT_HDR_RGBA:        return 16;
+    case PIXEL_FORMAT_HDR_MONO:        return 4;
+    case PIXEL_FORMAT_LDR_MONO_ALPHA:  return 2;
+    case PIXEL_FORMAT_HDR_MONO_ALPHA:  return 8;
+    case PIXEL_FORMAT_HALF_RGBA:       return 8;
+    case PIXEL_FORMAT_HALF_MONO:       return 2;
+    case PIXEL_FORMAT_HALF_MONO_ALPHA: return 4;
+    default:                           return 0;
+    }
+}
+
+unsigned channelCount(PixelFormat format)
+{
+    switch (format)
+    {
+    case PIXEL_FORMAT_LDR_RGBA:
+    case PIXEL_FORMAT_HDR_RGBA:
+    case PIXEL_FORMAT_HALF_RGBA:
+        return 4;
+    case PIXEL_FORMAT_LDR_MONO_ALPHA:
+    case PIXEL_FORMAT_HDR_MONO_ALPHA:
+    case PIXEL_FORMAT_HALF_MONO_ALPHA:
+        return 2;
+    case PIXEL_FORMAT_LDR_MONO:
+    case PIXEL_FORMAT_HDR_MONO:
+    case PIXEL_FORMAT_HALF_MONO:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+SimdLevel activeSimdLevel()
+{
+    kernels();
+    return (SimdLevel)gSimdLevel.load(std::memory_order_relaxed);
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_SSE2: return "SSE2";
+    case SIMD_AVX2: return "AVX2";
+    case SIMD_NEON: return "NEON";
+    default:        return "scalar";
+    }
+}
+
+SimdLevel setSimdLevel(SimdLevel level)
+{
+    const SimdLevel best = bestSimdLevel();
+    bool supported = level == SIMD_SCALAR || level == best;
+#if defined(PIXEL_CONVERT_X86)
+    supported = supported || level == SIMD_SSE2;
+#endif
+    const SimdLevel chosen = supported ? level : best;
+    gSimdLevel.store(chosen, std::memory_order_relaxed);
+    return chosen;
+}
+
+void setParallelThreshold(size_t pixels)
+{
+    gParallelThreshold.store(pixels, std::memory_order_relaxed);
+}
+
+void floatToU8(const float* src, uint8_t* dst, size_t count)
+{
+    kernels().floatToU8(src, dst, count);
+}
+
+void halfToFloat(const uint16_t* src, float* dst, size_t count)
+{
+    kernels().halfToFloat(src, dst, count);
+}
+
+void floatToHalf(const float* src, uint16_t* dst, size_t count)
+{
+    kernels().floatToHalf(src, dst, count);
+}
+
+void monoToRgba8(const uint8_t* src, bool srcHasAlpha, uint8_t* dst, size_t count)
+{
+    kernels().monoToRgba8(src, srcHasAlpha, dst, count);
+}
+
+void monoFloatToRgba8(const float* src, bool srcHasAlpha, uint8_t* dst, size_t count)
+{
+    // clamp into a small cache resident buffer, then expand
+    const Kernels& k = kernels();
+    const size_t channels = srcHasAlpha ? 2 : 1;
+    uint8_t temp[TEMP_PIXELS * 2];
+    for (size_t i = 0; i < count; i += TEMP_PIXELS)
+    {
+        const size_t n = std::min(TEMP_PIXELS, count - i);
+        k.floatToU8(src + i * channels, temp, n * channels);
+        k.monoToRgba8(temp, srcHasAlpha, dst + i * 4, n);
+    }
+}
+
+void fillAlpha8(uint8_t* rgba, size_t count, uint8_t alpha)
+{
+    kernels().fillAlpha8(rgba, count, alpha);
+}
+
+void swizzle8(const uint8_t* src, uint8_t* dst, size_t count, const uint8_t order[4])
+{
+    kernels().swizzle8(src, dst, count, order);
+}
+
+void premultiply8(uint8_t* rgba, size_t count)
+{
+    kernels().premultiply8(rgba, count);
+}
+
+void unpremultiply8(uint8_t* rgba, size_t count)
+{
+    kernels().unpremultiply8(rgba, count);
+}
+
+void premultiplyFloat(float* rgba, size_t count)
+{
+    kernels().premultiplyFloat(rgba, count);
+}
+
+void unpremultiplyFloat(float* rgba, size_t count)
+{
+    kernels().unpremultiplyFloat(rgba, count);
+}
+
+void forEachRowRange(uint32_t width, uint32_t height, const std::function<void(uint32_t, uint32_t)>& fn)
+{
+    const size_t threshold = gParallelThreshold.load(std::memory_order_relaxed);
+    const size_t pixels = (size_t)width * height;
+    if (threshold == 0 || pixels < threshold || height < 2)
+    {
+        fn(0, height);
+        return;
+    }
+    // keep at least 64K pixels per task so the scheduling cost stays small
+    const size_t minRows = std::max<size_t>(1, (64 * 1024) / std::max<uint32_t>(width, 1));
+    rowPool().parallelFor(height, minRows, [&fn](size_t begin, size_t end) {
+        fn((uint32_t)begin, (uint32_t)end);
+    });
+}
+
+bool convertToRgba8(PixelFormat format,
+                    const void* src,
+                    size_t srcPitch,
+                    uint32_t width,
+                    uint32_t height,
+                    uint8_t* dst,
+                    size_t dstPitch,
+                    bool opaqueAlpha)
+{
+    if (!src || !dst || bytesPerPixel(format) == 0)
+    {
+        return false;
+    }
+
+    const Kernels& k = kernels();
+    const unsigned channels = channelCount(format);
+    const bool fillAlpha = opaqueAlpha && channels != 1;
+
+    forEachRowRange(width, height, [&](uint32_t firstRow, uint32_t endRow) {
+        std::vector<float> halfRow;
+        for (uint32_t y = firstRow; y < endRow; ++y)
+        {
+            const uint8_t* srcRow = (const uint8_t*)src + y * srcPitch;
+            uint8_t* dstRow = dst + y * dstPitch;
+
+            switch (format)
+            {
+            case PIXEL_FORMAT_LDR_RGBA:
+                if (srcRow != dstRow)
+                {
+                    std::memcpy(dstRow, srcRow, (size_t)width * 4);
+                }
+                break;
+            case PIXEL_FORMAT_LDR_MONO:
+            case PIXEL_FORMAT_LDR_MONO_ALPHA:
+                k.monoToRgba8(srcRow, channels == 2, dstRow, width);
+                break;
+            case PIXEL_FORMAT_HDR_RGBA:
+                k.floatToU8((const float*)srcRow, dstRow, (size_t)width * 4);
+                break;
+            case PIXEL_FORMAT_HDR_MONO:
+            case PIXEL_FORMAT_HDR_MONO_ALPHA:
+                monoFloatToRgba8((const float*)srcRow, channels == 2, dstRow, width);
+                break;
+            case PIXEL_FORMAT_HALF_RGBA:
+            case PIXEL_FORMAT_HALF_MONO:
+            case PIXEL_FORMAT_HALF_MONO_ALPHA:
+            {
+                halfRow.resize((size_t)width * channels);
+                k.halfToFloat((const uint16_t*)srcRow, halfRow.data(), halfRow.size());
+                if (channels == 4)
+                {
+                    k.floatToU8(halfRow.data(), dstRow, halfRow.size());
+                }
+                else
+                {
+                    monoFloatToRgba8(halfRow.data(), channels == 2, dstRow, width);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+
+            if (fillAlpha)
+            {
+                k.fillAlpha8(dstRow, width, 0xff);
+            }
+        }
+    });
+    return true;
+}
+
+} // namespace PixelConvert
+} // namespace SharedUtils
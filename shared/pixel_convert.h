@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace SharedUtils {
+namespace PixelConvert {
+
+    /**
+     * Pixel layouts of Octane render images. The values match Octane::ImageType,
+     * so an image type can be cast to PixelFormat directly.
+     */
+    enum PixelFormat
+    {
+        PIXEL_FORMAT_LDR_RGBA        = 0,   // 4 x uint8
+        PIXEL_FORMAT_LDR_MONO        = 1,   // 1 x uint8
+        PIXEL_FORMAT_HDR_RGBA        = 2,   // 4 x float
+        PIXEL_FORMAT_HDR_MONO        = 3,   // 1 x float
+        PIXEL_FORMAT_LDR_MONO_ALPHA  = 4,   // 2 x uint8
+        PIXEL_FORMAT_HDR_MONO_ALPHA  = 5,   // 2 x float
+        PIXEL_FORMAT_HALF_RGBA       = 6,   // 4 x half
+        PIXEL_FORMAT_HALF_MONO       = 7,   // 1 x half
+        PIXEL_FORMAT_HALF_MONO_ALPHA = 8,   // 2 x half
+    };
+
+    /**
+     * Instruction set used by the row kernels
+     */
+    enum SimdLevel
+    {
+        SIMD_SCALAR = 0,
+        SIMD_SSE2,
+        SIMD_AVX2,
+        SIMD_NEON,
+    };
+
+    /**
+     * Size of one pixel in bytes, or 0 if the format is not supported
+     */
+    size_t bytesPerPixel(PixelFormat format);
+
+    /**
+     * Number of channels of one pixel (1, 2 or 4), or 0 if the format is not supported
+     */
+    unsigned channelCount(PixelFormat format);
+
+    /**
+     * Kernel set picked at startup from the CPU features
+     */
+    SimdLevel activeSimdLevel();
+    const char* simdLevelName(SimdLevel level);
+
+    /**
+     * Override the kernel set, e.g. to compare paths in a benchmark. A level the CPU
+     * can't run falls back to the best supported one. Returns the level now in use.
+     */
+    SimdLevel setSimdLevel(SimdLevel level);
+
+    /**
+     * Frames with at least this many pixels are converted on multiple threads.
+     * 0 disables threading.
+     */
+    void setParallelThreshold(size_t pixels);
+
+    //--- Row kernels, count is the number of pixels unless stated otherwise ---
+
+    /**
+     * dst[i] = clamp(src[i] * 255, 0, 255), count is the number of values
+     */
+    void floatToU8(const float* src, uint8_t* dst, size_t count);
+
+    /**
+     * IEEE half to float conversion, count is the number of values
+     */
+    void halfToFloat(const uint16_t* src, float* dst, size_t count);
+
+    /**
+     * Float to IEEE half conversion with round to nearest even, count is the number of values
+     */
+    void floatToHalf(const float* src, uint16_t* dst, size_t count);
+
+    /**
+     * Expand 8-bit Y or YA pixels to RGBA. Without source alpha, alpha is set to 255.
+     */
+    void monoToRgba8(const uint8_t* src, bool srcHasAlpha, uint8_t* dst, size_t count);
+
+    /**
+     * Expand float Y or YA pixels to 8-bit RGBA, clamping like floatToU8
+     */
+    void monoFloatToRgba8(const float* src, bool srcHasAlpha, uint8_t* dst, size_t count);
+
+    /**
+     * Set the alpha channel of RGBA pixels to a constant
+     */
+    void fillAlpha8(uint8_t* rgba, size_t count, uint8_t alpha = 0xff);
+
+    /**
+     * Reorder the channels of RGBA pixels: dst[c] = src[order[c]]. src and dst may be the same buffer.
+     */
+    void swizzle8(const uint8_t* src, uint8_t* dst, size_t count, const uint8_t order[4]);
+
+    /**
+     * Multiply, or divide, the color channels by alpha in place
+     */
+    void premultiply8(uint8_t* rgba, size_t count);
+    void unpremultiply8(uint8_t* rgba, size_t count);
+    void premultiplyFloat(float* rgba, size_t count);
+    void unpremultiplyFloat(float* rgba, size_t count);
+
+    //--- Frame conversion ---
+
+    /**
+     * Run fn(firstRow, endRow) over all rows of a width x height frame, split across
+     * threads when the frame is larger than the parallel threshold
+     */
+    void forEachRowRange(uint32_t width, uint32_t height, const std::function<void(uint32_t, uint32_t)>& fn);
+
+    /**
+     * Convert a render image to 8-bit RGBA. Pitches are in bytes. When opaqueAlpha is
+     * set, the alpha channel of the result is 255, otherwise the source alpha is kept.
+     * Returns false if the source format is not supported.
+     */
+    bool convertToRgba8(PixelFormat format,
+                        const void* src,
+                        size_t srcPitch,
+                        uint32_t width,
+                        uint32_t height,
+                        uint8_t* dst,
+                        size_t dstPitch,
+                        bool opaqueAlpha = true);
+
+} // namespace PixelConvert
+} // namespace SharedUtils
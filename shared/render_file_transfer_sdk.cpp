@@ -0,0 +1,363 @@
+#include "render_file_transfer_sdk.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "protos/render_file_transfer.grpc.pb.h"
+#include "protos/render_file_transfer.pb.h"
+#include "async_file_writer.h"
+
+using octanefiletransfer::FileChunk;
+using octanefiletransfer::RenderFileTransfer;
+
+typedef std::function<std::unique_ptr<grpc::ClientReader<FileChunk>>(RenderFileTransfer::Stub& stub,
+                                                                     grpc::ClientContext& context)> StartDownload;
+
+struct RenderFileTransferSdk::Download {
+    const char* name;
+    StartDownload start;
+};
+
+struct RenderFileTransferSdk::Upload {
+    std::string fileName;
+    // fills the buffer with the next part of the file, returns the number of bytes or 0 at the end
+    std::function<size_t(char* buffer, size_t size)> read;
+    uint64_t size = 0;
+};
+
+namespace {
+
+double msSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// the requests are small, they are copied into the calls
+StartDownload startDeepExr(const std::vector<Octane::RenderPassExport>& passesToExport,
+                           Octane::NamedColorSpace colorSpace,
+                           Octane::ExrCompressionType compressionType,
+                           const std::vector<std::string>& metadata,
+                           uint32_t chunkSize) {
+    octanefiletransfer::SaveRenderPassesDeepExrRequest request;
+    for (const Octane::RenderPassExport& pass : passesToExport) {
+        octanefiletransfer::RenderPassExport* out = request.add_passestoexport();
+        out->set_renderpassid(static_cast<int32_t>(pass.mRenderPassId));
+        out->set_exportname(pass.mExportName ? pass.mExportName : "");
+    }
+    request.set_colorspace(static_cast<int32_t>(colorSpace));
+    request.set_compressiontype(static_cast<int32_t>(compressionType));
+    for (const std::string& value : metadata) {
+        request.add_metadata(value);
+    }
+    request.set_chunksize(chunkSize);
+    return [request](RenderFileTransfer::Stub& stub, grpc::ClientContext& context) {
+        return stub.saveRenderPassesDeepExr(&context, request);
+    };
+}
+
+StartDownload startDeepImage(Octane::NamedColorSpace colorSpace, uint32_t chunkSize) {
+    octanefiletransfer::SaveDeepImageRequest request;
+    request.set_colorspace(static_cast<int32_t>(colorSpace));
+    request.set_chunksize(chunkSize);
+    return [request](RenderFileTransfer::Stub& stub, grpc::ClientContext& context) {
+        return stub.saveDeepImage(&context, request);
+    };
+}
+
+StartDownload startRenderState(const std::string& customProjectFileName,
+                               float customProjectTime,
+                               uint32_t customVersion,
+                               uint32_t chunkSize) {
+    octanefiletransfer::SaveRenderStateRequest request;
+    request.set_customprojectfilename(customProjectFileName);
+    request.set_customprojecttime(customProjectTime);
+    request.set_customversion(customVersion);
+    request.set_chunksize(chunkSize);
+    return [request](RenderFileTransfer::Stub& stub, grpc::ClientContext& context) {
+        return stub.saveRenderState(&context, request);
+    };
+}
+
+}
+
+RenderFileTransferSdk::RenderFileTransferSdk(const Settings& settings)
+    : RenderFileTransferSdk(settings, grpc::CreateChannel(settings.address, grpc::InsecureChannelCredentials()))
+{
+}
+
+RenderFileTransferSdk::RenderFileTransferSdk(const Settings& settings, std::shared_ptr<grpc::Channel> channel)
+    : m_settings(settings)
+    , m_channel(std::move(channel))
+{
+}
+
+void RenderFileTransferSdk::setDeadline(grpc::ClientContext& context) const {
+    if (m_settings.timeoutMs > 0) {
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(m_settings.timeoutMs));
+    }
+}
+
+void RenderFileTransferSdk::record(const Result& result, bool isUpload) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (isUpload) {
+        ++m_stats.uploads;
+        m_stats.bytesUp += result.bytes;
+    } else {
+        ++m_stats.downloads;
+        m_stats.bytesDown += result.bytes;
+    }
+    if (!result.ok) {
+        ++m_stats.failed;
+        std::cerr << "RenderFileTransferSdk: " << result.error << std::endl;
+    }
+    m_stats.totalMs += result.ms;
+}
+
+RenderFileTransferSdk::Result RenderFileTransferSdk::download(Download& download, const std::string& localPath,
+                                                              const ChunkCallback& callback) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    Result result;
+
+    // either into a file, written behind the stream, or to the callback
+    const bool toFile = !localPath.empty();
+    SharedUtils::AsyncFileWriter writer(m_settings.writeQueueBytes);
+    if (toFile && !writer.open(localPath)) {
+        result.error = std::string(download.name) + ": " + writer.error();
+        result.ms = msSince(start);
+        record(result, false);
+        return result;
+    }
+
+    std::unique_ptr<RenderFileTransfer::Stub> stub = RenderFileTransfer::NewStub(m_channel);
+    grpc::ClientContext context;
+    setDeadline(context);
+    std::unique_ptr<grpc::ClientReader<FileChunk>> reader = download.start(*stub, context);
+
+    FileChunk chunk;
+    uint64_t totalSize = 0;
+    bool cancelled = false;
+    while (reader->Read(&chunk)) {
+        if (result.bytes == 0) {
+            totalSize = chunk.totalsize();
+        }
+        const size_t size = chunk.data().size();
+        const bool accepted = toFile ? writer.write(std::move(*chunk.mutable_data()))
+                                     : !callback || callback(chunk.data().data(), size, totalSize);
+        result.bytes += size;
+        if (!accepted) {
+            // stops the server, the remaining chunks are discarded
+            context.TryCancel();
+            cancelled = true;
+            break;
+        }
+    }
+    const grpc::Status status = reader->Finish();
+
+    if (cancelled) {
+        result.error = std::string(download.name) + ": " + (toFile ? writer.error() : "cancelled");
+    } else if (!status.ok()) {
+        result.error = std::string(download.name) + " failed: " + status.error_message();
+    } else if (result.bytes != totalSize) {
+        result.error = std::string(download.name) + ": received " + std::to_string(result.bytes) + " of " +
+                       std::to_string(totalSize) + " bytes";
+    } else if (toFile && !writer.finish()) {
+        result.error = std::string(download.name) + ": " + writer.error();
+    } else {
+        result.ok = true;
+    }
+    if (!result.ok) {
+        writer.abort();
+    }
+    result.ms = msSince(start);
+    record(result, false);
+    return result;
+}
+
+RenderFileTransferSdk::Result RenderFileTransferSdk::saveRenderPassesDeepExr(
+    const std::string& localPath,
+    const std::vector<Octane::RenderPassExport>& passesToExport,
+    Octane::NamedColorSpace colorSpace,
+    Octane::ExrCompressionType compressionType,
+    const std::vector<std::string>& metadata) {
+    Download download{ "saveRenderPassesDeepExr",
+                       startDeepExr(passesToExport, colorSpace, compressionType, metadata, m_settings.chunkSize) };
+    return this->download(download, localPath, ChunkCallback());
+}
+
+RenderFileTransferSdk::Result RenderFileTransferSdk::saveRenderPassesDeepExr(
+    const ChunkCallback& callback,
+    const std::vector<Octane::RenderPassExport>& passesToExport,
+    Octane::NamedColorSpace colorSpace,
+    Octane::ExrCompressionType compressionType,
+    const std::vector<std::string>& metadata) {
+    Download download{ "saveRenderPassesDeepExr",
+                       startDeepExr(passesToExport, colorSpace, compressionType, metadata, m_settings.chunkSize) };
+    return this->download(download, std::string(), callback);
+}
+
+RenderFileTransferSdk::Result RenderFileTransferSdk::saveDeepImage(const std::string& localPath,
+                                                                   Octane::NamedColorSpace colorSpace) {
+    Download download{ "saveDeepImage", startDeepImage(colorSpace, m_settings.chunkSize) };
+    return this->download(download, localPath, ChunkCallback());
+}
+
+RenderFileTransferSdk::Result RenderFileTransferSdk::saveDeepImage(const ChunkCallback& callback,
+                                                                   Octane::NamedColorSpace colorSpace) {
+    Download download{ "saveDeepImage", startDeepImage(colorSpace, m_settings.chunkSize) };
+    return this->download(download, std::string(), callback);
+}
+
+RenderFileTransferSdk::Result RenderFileTransferSdk::saveRenderState(const std::string& localPath,
+                                                                     const std::string& customProjectFileName,
+                                                                     float customProjectTime,
+                                                                     uint32_t customVersion) {
+    Download download{ "saveRenderState",
+                       startRenderState(customProjectFileName, customProjectTime, customVersion,
+                                        m_settings.chunkSize) };
+    return this->download(download, localPath, ChunkCallback());
+}
+
+RenderFileTransferSdk::Result RenderFileTransferSdk::saveRenderState(const ChunkCallback& callback,
+                                                                     const std::string& customProjectFileName,
+                                                                     float customProjectTime,
+                                                                     uint32_t customVersion) {
+    Download download{ "saveRenderState",
+                       startRenderState(customProjectFileName, customProjectTime, customVersion,
+                                        m_settings.chunkSize) };
+    return this->download(download, std::string(), callback);
+}
+
+RenderFileTransferSdk::Result RenderFileTransferSdk::upload(Upload& upload,
+                                                            OctaneGRPC::GRPCLoadRenderStateProjectT loadProjectCallback,
+                                                            void* privateCallbackData) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    Result result;
+
+    std::unique_ptr<RenderFileTransfer::Stub> stub = RenderFileTransfer::NewStub(m_channel);
+    octanefiletransfer::UploadedFile uploaded;
+    {
+        grpc::ClientContext context;
+        setDeadline(context);
+        std::unique_ptr<grpc::ClientWriter<FileChunk>> writer = stub->loadRenderState(&context, &uploaded);
+
+        FileChunk chunk;
+        chunk.set_totalsize(upload.size);
+        chunk.set_filename(upload.fileName);
+        // below the 4 MB message limit of the server
+        const size_t chunkSize = std::min<size_t>(std::max<uint32_t>(m_settings.chunkSize, 4096), 2 * 1024 * 1024);
+        bool first = true;
+        for (;;) {
+            std::string* data = chunk.mutable_data();
+            data->resize(chunkSize);
+            const size_t size = upload.read(&(*data)[0], chunkSize);
+            data->resize(size);
+            // an empty file still sends its header
+            if (size == 0 && !first) {
+                break;
+            }
+            if (!writer->Write(chunk)) {
+                // the server ended the call, Finish() has the reason
+                break;
+            }
+            result.bytes += size;
+            if (size < chunkSize) {
+                break;
+            }
+            if (first) {
+                chunk.clear_totalsize();
+                chunk.clear_filename();
+                first = false;
+            }
+        }
+        writer->WritesDone();
+        const grpc::Status status = writer->Finish();
+        if (!status.ok()) {
+            result.error = "loadRenderState upload failed: " + status.error_message();
+        } else if (result.bytes != upload.size || uploaded.size() != upload.size) {
+            result.error = "loadRenderState: uploaded " + std::to_string(uploaded.size()) + " of " +
+                           std::to_string(upload.size) + " bytes";
+        }
+    }
+
+    if (result.error.empty()) {
+        try {
+            result.ok = OctaneGRPC::ApiRenderEngineProxy::loadRenderState(uploaded.path().c_str(),
+                                                                          loadProjectCallback,
+                                                                          privateCallbackData);
+            if (!result.ok) {
+                result.error = "loadRenderState failed for " + uploaded.path() + ", see the Octane log";
+            }
+        }
+        catch (const std::exception& e) {
+            result.error = std::string("loadRenderState failed: ") + e.what();
+        }
+    }
+    if (!uploaded.path().empty()) {
+        grpc::ClientContext context;
+        setDeadline(context);
+        google::protobuf::Empty empty;
+        stub->releaseUpload(&context, uploaded, &empty);
+    }
+    result.ms = msSince(start);
+    record(result, true);
+    return result;
+}
+
+RenderFileTransferSdk::Result RenderFileTransferSdk::loadRenderState(const std::string& localPath,
+                                                                     OctaneGRPC::GRPCLoadRenderStateProjectT loadProjectCallback,
+                                                                     void* privateCallbackData) {
+    std::ifstream file(localPath, std::ios::binary);
+    std::error_code error;
+    const uint64_t size = file ? std::filesystem::file_size(localPath, error) : 0;
+    if (!file || error) {
+        Result result;
+        result.error = "loadRenderState: can't read " + localPath;
+        record(result, true);
+        return result;
+    }
+    Upload upload;
+    upload.fileName = std::filesystem::path(localPath).filename().string();
+    upload.size = size;
+    upload.read = [&file](char* buffer, size_t size) {
+        file.read(buffer, (std::streamsize)size);
+        return (size_t)file.gcount();
+    };
+    return this->upload(upload, loadProjectCallback, privateCallbackData);
+}
+
+RenderFileTransferSdk::Result RenderFileTransferSdk::loadRenderState(const void* data, size_t size,
+                                                                     OctaneGRPC::GRPCLoadRenderStateProjectT loadProjectCallback,
+                                                                     void* privateCallbackData) {
+    const char* bytes = static_cast<const char*>(data);
+    size_t offset = 0;
+    Upload upload;
+    upload.size = size;
+    upload.read = [bytes, size, &offset](char* buffer, size_t count) {
+        count = std::min(count, size - offset);
+        std::memcpy(buffer, bytes + offset, count);
+        offset += count;
+        return count;
+    };
+    return this->upload(upload, loadProjectCallback, privateCallbackData);
+}
+
+RenderFileTransferSdk::Stats RenderFileTransferSdk::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void RenderFileTransferSdk::printSummary(std::ostream& out) const {
+    const Stats s = stats();
+    const double mb = (s.bytesDown + s.bytesUp) / (1024.0 * 1024.0);
+    out << "RenderFileTransferSdk: " << s.downloads << " downloads ("
+        << std::fixed << std::setprecision(1) << s.bytesDown / (1024.0 * 1024.0) << " MB), "
+        << s.uploads << " uploads (" << s.bytesUp / (1024.0 * 1024.0) << " MB), "
+        << s.failed << " failed, " << mb / std::max(s.totalMs / 1000.0, 1e-6) << " MB/s" << std::endl;
+}
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef RENDER_FILE_TRANSFER_SDK_H
+#define RENDER_FILE_TRANSFER_SDK_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include <grpcpp/grpcpp.h>
+#include "apirenderengineclient.h"
+#include "octanerenderpasses.h"
+
+/**
+ * @brief Deep images and render states of a remote Octane, transferred over gRPC
+ *
+ * saveRenderPassesDeepExr(), saveDeepImage() and saveRenderState() of ApiRenderEngineProxy
+ * write to a path on the Octane host and loadRenderState() reads from one, a client on
+ * another machine needs a network share and copies the file a second time. These go
+ * through octane_filetransfer (grpc-api-examples/file-transfer) on the Octane host instead,
+ * which saves to a temporary file there and streams the contents back in chunks.
+ *
+ * Downloads are written by a SharedUtils::AsyncFileWriter, so the disk and the network
+ * overlap, or handed chunk by chunk to a callback. loadRenderState() uploads the file and
+ * calls ApiRenderEngineProxy::loadRenderState() with the path on the host, the project
+ * callback runs in this process as before.
+ *
+ * Transfers can run from any thread.
+ */
+class RenderFileTransferSdk {
+public:
+    struct Settings {
+        std::string address = "127.0.0.1:50053";    // octane_filetransfer next to Octane
+        uint32_t chunkSize = 1024 * 1024;           // bytes per message, both directions, at most 2 MB
+        size_t writeQueueBytes = 16 * 1024 * 1024;  // received but not written yet
+        unsigned timeoutMs = 0;                     // deadline of a transfer, 0 for none
+    };
+
+    struct Result {
+        bool ok = false;
+        uint64_t bytes = 0;
+        double ms = 0.0;
+        std::string error;
+    };
+
+    struct Stats {
+        uint64_t downloads = 0;
+        uint64_t uploads = 0;
+        uint64_t failed = 0;
+        uint64_t bytesDown = 0;
+        uint64_t bytesUp = 0;
+        double totalMs = 0.0;
+    };
+
+    /**
+     * @brief Receives the file in order. totalSize is the size of the whole file. Return false
+     * to cancel the transfer.
+     */
+    typedef std::function<bool(const void* data, size_t size, uint64_t totalSize)> ChunkCallback;
+
+    RenderFileTransferSdk() : RenderFileTransferSdk(Settings()) {}
+    explicit RenderFileTransferSdk(const Settings& settings);
+
+    /**
+     * @brief Use a channel of its own instead of one to settings.address
+     */
+    RenderFileTransferSdk(const Settings& settings, std::shared_ptr<grpc::Channel> channel);
+
+    const Settings& settings() const { return m_settings; }
+
+    /**
+     * @brief Arguments as for ApiRenderEngineProxy::saveRenderPassesDeepExr(), the file ends
+     * up at localPath on this machine. The save is never asynchronous, the result is
+     * complete when the call returns. Octane takes at most one pass to export, the service
+     * refuses more.
+     */
+    Result saveRenderPassesDeepExr(const std::string& localPath,
+                                   const std::vector<Octane::RenderPassExport>& passesToExport,
+                                   Octane::NamedColorSpace colorSpace,
+                                   Octane::ExrCompressionType compressionType,
+                                   const std::vector<std::string>& metadata = std::vector<std::string>());
+    Result saveRenderPassesDeepExr(const ChunkCallback& callback,
+                                   const std::vector<Octane::RenderPassExport>& passesToExport,
+                                   Octane::NamedColorSpace colorSpace,
+                                   Octane::ExrCompressionType compressionType,
+                                   const std::vector<std::string>& metadata = std::vector<std::string>());
+
+    Result saveDeepImage(const std::string& localPath, Octane::NamedColorSpace colorSpace);
+    Result saveDeepImage(const ChunkCallback& callback, Octane::NamedColorSpace colorSpace);
+
+    /**
+     * @brief As ApiRenderEngineProxy::saveRenderState() without custom data, which the gRPC
+     * API can't transfer (it only sends the pointer).
+     */
+    Result saveRenderState(const std::string& localPath,
+                           const std::string& customProjectFileName,
+                           float customProjectTime,
+                           uint32_t customVersion);
+    Result saveRenderState(const ChunkCallback& callback,
+                           const std::string& customProjectFileName,
+                           float customProjectTime,
+                           uint32_t customVersion);
+
+    /**
+     * @brief Upload a render state file and load it, arguments as for
+     * ApiRenderEngineProxy::loadRenderState(). The uploaded copy is deleted afterwards.
+     */
+    Result loadRenderState(const std::string& localPath,
+                           OctaneGRPC::GRPCLoadRenderStateProjectT loadProjectCallback,
+                           void* privateCallbackData);
+    Result loadRenderState(const void* data, size_t size,
+                           OctaneGRPC::GRPCLoadRenderStateProjectT loadProjectCallback,
+                           void* privateCallbackData);
+
+    Stats stats() const;
+    void printSummary(std::ostream& out) const;
+
+private:
+    struct Download;
+    struct Upload;
+
+    Result download(Download& download, const std::string& localPath, const ChunkCallback& callback);
+    Result upload(Upload& upload, OctaneGRPC::GRPCLoadRenderStateProjectT loadProjectCallback,
+                  void* privateCallbackData);
+    void setDeadline(grpc::ClientContext& context) const;
+    void record(const Result& result, bool isUpload);
+
+    const Settings m_settings;
+    std::shared_ptr<grpc::Channel> m_channel;
+
+    mutable std::mutex m_mutex;
+    Stats m_stats;
+};
+#endif
+
+#endif // RENDER_FILE_TRANSFER_SDK_H
@@ -0,0 +1,356 @@
+#include "render_stats_recorder_sdk.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apirenderengineclient.h"
+#include "octanerenderpasses.h"
+#endif
+
+namespace {
+
+typedef RenderStatsRecorderSdk::Sample Sample;
+
+// index of the first sample of the render the last sample belongs to
+size_t currentRenderStart(const std::vector<Sample>& samples) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t first = samples.size() - 1;
+    while (first > 0) {
+        const Sample& previous = samples[first - 1];
+        const Sample& next = samples[first];
+        if (next.samplesPerPixel < previous.samplesPerPixel || next.changeLevel != previous.changeLevel) {
+            break;
+        }
+        --first;
+    }
+    return first;
+}
+
+// first sample of the current render that is inside the window
+size_t windowStart(const std::vector<Sample>& samples, double windowSeconds) {
+    const size_t first = currentRenderStart(samples);
+    const double from = samples.back().time - windowSeconds;
+    size_t start = samples.size() - 1;
+    while (start > first && samples[start - 1].time >= from) {
+        --start;
+    }
+    return start;
+}
+
+double fieldValue(const Sample& sample, RenderStatsRecorderSdk::Field field) {
+    switch (field) {
+    case RenderStatsRecorderSdk::FIELD_SAMPLES_PER_PIXEL:     return sample.samplesPerPixel;
+    case RenderStatsRecorderSdk::FIELD_RENDER_TIME:           return sample.renderTime;
+    case RenderStatsRecorderSdk::FIELD_ESTIMATED_RENDER_TIME: return sample.estimatedRenderTime;
+    case RenderStatsRecorderSdk::FIELD_SAMPLES_PER_SECOND:
+    default:                                                  return sample.samplesPerSecond;
+    }
+}
+
+double samplingRate(const std::vector<Sample>& samples, double windowSeconds) {
+    if (samples.size() < 2) {
+        return 0.0;
+    }
+    const size_t start = windowStart(samples, windowSeconds);
+    const Sample& first = samples[start];
+    const Sample& last = samples.back();
+    // prefer Octane's render time, it doesn't count the time the render was paused
+    double seconds = last.renderTime - first.renderTime;
+    if (seconds <= 0.0) {
+        seconds = last.time - first.time;
+    }
+    if (seconds <= 0.0) {
+        return 0.0;
+    }
+    return (static_cast<double>(last.samplesPerPixel) - first.samplesPerPixel) / seconds;
+}
+
+}
+
+RenderStatsRecorderSdk::RenderStatsRecorderSdk(size_t capacity, std::chrono::milliseconds pollInterval)
+    : m_ring(capacity)
+    , m_pollInterval(pollInterval)
+    , m_startTime(std::chrono::steady_clock::now())
+    , m_pending(false)
+    , m_stopping(false)
+    , m_running(false)
+    , m_failedFetches(0)
+{
+}
+
+RenderStatsRecorderSdk::~RenderStatsRecorderSdk() {
+    stop();
+}
+
+bool RenderStatsRecorderSdk::start() {
+    if (m_running) {
+        return true;
+    }
+#ifdef DO_GRPC_SDK_ENABLED
+    m_startTime = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = false;
+        // first sample right away
+        m_pending = true;
+    }
+    m_sampler = std::thread(&RenderStatsRecorderSdk::samplerLoop, this);
+
+    try {
+        OctaneGRPC::ApiRenderEngineProxy::setOnNewStatisticsCallback(&RenderStatsRecorderSdk::onNewStatistics, this);
+    } catch (const std::exception& e) {
+        std::cout << "RenderStatsRecorderSdk: failed to register the statistics callback: " << e.what() << std::endl;
+        if (m_pollInterval.count() == 0) {
+            stop();
+            return false;
+        }
+        std::cout << "RenderStatsRecorderSdk: polling every " << m_pollInterval.count() << " ms instead" << std::endl;
+    }
+    m_running = true;
+    return true;
+#else
+    std::cout << "RenderStatsRecorderSdk: SDK not available" << std::endl;
+    return false;
+#endif
+}
+
+void RenderStatsRecorderSdk::stop() {
+#ifdef DO_GRPC_SDK_ENABLED
+    if (m_running) {
+        try {
+            OctaneGRPC::ApiRenderEngineProxy::setOnNewStatisticsCallback(nullptr, nullptr);
+        } catch (const std::exception& e) {
+            std::cout << "RenderStatsRecorderSdk: failed to unregister the statistics callback: " << e.what() << std::endl;
+        }
+    }
+#endif
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    if (m_sampler.joinable()) {
+        m_sampler.join();
+    }
+    m_running = false;
+}
+
+void RenderStatsRecorderSdk::onNewStatistics(void* userData) {
+    // runs on the callback thread, leave the round trip to the sampler
+    static_cast<RenderStatsRecorderSdk*>(userData)->requestSample();
+}
+
+void RenderStatsRecorderSdk::requestSample() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = true;
+    }
+    m_wake.notify_one();
+}
+
+void RenderStatsRecorderSdk::samplerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        if (m_pollInterval.count() > 0) {
+            m_wake.wait_for(lock, m_pollInterval, [this] { return m_pending || m_stopping; });
+        } else {
+            m_wake.wait(lock, [this] { return m_pending || m_stopping; });
+        }
+        if (m_stopping) {
+            break;
+        }
+        // callbacks that arrive during the fetch are folded into the next sample
+        m_pending = false;
+        lock.unlock();
+
+        Sample sample;
+        if (fetchSample(sample)) {
+            m_ring.push(sample);
+        } else {
+            ++m_failedFetches;
+        }
+
+        lock.lock();
+    }
+}
+
+bool RenderStatsRecorderSdk::fetchSample(Sample& sample) {
+#ifdef DO_GRPC_SDK_ENABLED
+    Octane::RenderResultStatistics statistics = {};
+    try {
+        OctaneGRPC::ApiRenderEngineProxy::getRenderStatistics(statistics);
+    } catch (const std::exception& e) {
+        // only report the first failure, the server may just be gone
+        if (m_failedFetches == 0) {
+            std::cout << "RenderStatsRecorderSdk: getRenderStatistics failed: " << e.what() << std::endl;
+        }
+        return false;
+    }
+    sample.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+    sample.renderTime = statistics.mRenderTime;
+    sample.estimatedRenderTime = statistics.mEstimatedRenderTime;
+    sample.samplesPerSecond = statistics.mBeautySamplesPerSecond;
+    sample.samplesPerPixel = statistics.mBeautySamplesPerPixel;
+    sample.maxSamplesPerPixel = statistics.mBeautyMaxSamplesPerPixel;
+    sample.denoisedSamplesPerPixel = statistics.mDenoisedSamplesPerPixel;
+    sample.width = statistics.mUsedSize.x;
+    sample.height = statistics.mUsedSize.y;
+    sample.state = static_cast<int32_t>(statistics.mState);
+    sample.changeLevel = static_cast<uint64_t>(statistics.mChangeLevel);
+    return true;
+#else
+    (void)sample;
+    return false;
+#endif
+}
+
+std::vector<RenderStatsRecorderSdk::Sample> RenderStatsRecorderSdk::samples() const {
+    std::vector<Sample> result;
+    m_ring.snapshot(result);
+    return result;
+}
+
+bool RenderStatsRecorderSdk::latest(Sample& sample) const {
+    return m_ring.latest(sample);
+}
+
+double RenderStatsRecorderSdk::samplingRate(double windowSeconds) const {
+    return ::samplingRate(samples(), windowSeconds);
+}
+
+double RenderStatsRecorderSdk::movingAverage(Field field, double windowSeconds) const {
+    const std::vector<Sample> all = samples();
+    if (all.empty()) {
+        return 0.0;
+    }
+    const size_t start = windowStart(all, windowSeconds);
+    if (start + 1 >= all.size()) {
+        return fieldValue(all.back(), field);
+    }
+    // the updates don't come at a fixed rate, weight each value by how long it held
+    double weighted = 0.0;
+    double duration = 0.0;
+    for (size_t i = start; i + 1 < all.size(); ++i) {
+        const double dt = all[i + 1].time - all[i].time;
+        weighted += fieldValue(all[i], field) * dt;
+        duration += dt;
+    }
+    if (duration <= 0.0) {
+        return fieldValue(all.back(), field);
+    }
+    return weighted / duration;
+}
+
+double RenderStatsRecorderSdk::timeToSpp(uint32_t targetSpp, bool* reached) const {
+    if (reached) {
+        *reached = false;
+    }
+    const std::vector<Sample> all = samples();
+    if (all.empty()) {
+        return -1.0;
+    }
+    const size_t first = currentRenderStart(all);
+    for (size_t i = first; i < all.size(); ++i) {
+        if (all[i].samplesPerPixel < targetSpp) {
+            continue;
+        }
+        if (reached) {
+            *reached = true;
+        }
+        if (i == first) {
+            return all[i].renderTime;
+        }
+        const Sample& before = all[i - 1];
+        const Sample& after = all[i];
+        const double span = static_cast<double>(after.samplesPerPixel) - before.samplesPerPixel;
+        const double t = span > 0.0 ? (targetSpp - static_cast<double>(before.samplesPerPixel)) / span : 1.0;
+        return before.renderTime + t * (after.renderTime - before.renderTime);
+    }
+
+    const double rate = ::samplingRate(all, 2.0);
+    if (rate <= 0.0) {
+        return -1.0;
+    }
+    const Sample& last = all.back();
+    return last.renderTime + (targetSpp - static_cast<double>(last.samplesPerPixel)) / rate;
+}
+
+void RenderStatsRecorderSdk::exportCsv(std::ostream& out) const {
+    const std::vector<Sample> all = samples();
+    out << "time,render_time,estimated_render_time,samples_per_second,spp,max_spp,denoised_spp,width,height,state,change_level\n";
+    out << std::setprecision(9);
+    for (const Sample& s : all) {
+        out << s.time << ',' << s.renderTime << ',' << s.estimatedRenderTime << ',' << s.samplesPerSecond << ','
+            << s.samplesPerPixel << ',' << s.maxSamplesPerPixel << ',' << s.denoisedSamplesPerPixel << ','
+            << s.width << ',' << s.height << ',' << s.state << ',' << s.changeLevel << '\n';
+    }
+    out << std::setprecision(6);
+}
+
+void RenderStatsRecorderSdk::exportJson(std::ostream& out) const {
+    const std::vector<Sample> all = samples();
+    out << "[";
+    out << std::setprecision(9);
+    for (size_t i = 0; i < all.size(); ++i) {
+        const Sample& s = all[i];
+        out << (i ? ",\n " : "\n ")
+            << "{\"time\":" << s.time
+            << ",\"renderTime\":" << s.renderTime
+            << ",\"estimatedRenderTime\":" << s.estimatedRenderTime
+            << ",\"samplesPerSecond\":" << s.samplesPerSecond
+            << ",\"spp\":" << s.samplesPerPixel
+            << ",\"maxSpp\":" << s.maxSamplesPerPixel
+            << ",\"denoisedSpp\":" << s.denoisedSamplesPerPixel
+            << ",\"width\":" << s.width
+            << ",\"height\":" << s.height
+            << ",\"state\":" << s.state
+            << ",\"changeLevel\":" << s.changeLevel << "}";
+    }
+    out << "\n]\n";
+    out << std::setprecision(6);
+}
+
+bool RenderStatsRecorderSdk::exportToFile(const std::string& path) const {
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file) {
+        std::cout << "RenderStatsRecorderSdk: can't open " << path << std::endl;
+        return false;
+    }
+    const bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (json) {
+        exportJson(file);
+    } else {
+        exportCsv(file);
+    }
+    return static_cast<bool>(file);
+}
+
+void RenderStatsRecorderSdk::printSummary(std::ostream& out) const {
+    Sample last;
+    out << "Render statistics: " << recordedCount() << " samples recorded";
+    if (failedFetches()) {
+        out << ", " << failedFetches() << " fetches failed";
+    }
+    out << std::endl;
+    if (!latest(last)) {
+        return;
+    }
+    out << std::fixed << std::setprecision(2);
+    out << "  last: " << last.samplesPerPixel << "/" << last.maxSamplesPerPixel << " spp after "
+        << last.renderTime << " s, " << last.width << "x" << last.height << std::endl;
+    out << "  rate: " << samplingRate() << " spp/s, average " << movingAverage(FIELD_SAMPLES_PER_SECOND) / 1e6
+        << " Ms/s over the last 2 s" << std::endl;
+    if (last.maxSamplesPerPixel > 0) {
+        bool reached = false;
+        const double t = timeToSpp(last.maxSamplesPerPixel, &reached);
+        if (t >= 0.0) {
+            out << "  " << (reached ? "reached " : "estimated to reach ") << last.maxSamplesPerPixel
+                << " spp at " << t << " s" << std::endl;
+        }
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,157 @@
+#ifndef RENDER_STATS_RECORDER_SDK_H
+#define RENDER_STATS_RECORDER_SDK_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sample_ring.h"
+
+/**
+ * @brief Records the render statistics of Octane as a time series
+ *
+ * The recorder subscribes to setOnNewStatisticsCallback(). The callback only wakes a
+ * background sampler thread, which fetches the statistics and pushes a timestamped
+ * sample into a fixed-size lock-free ring, so the callback thread never waits on a
+ * round trip. The query functions and exports read a snapshot of the ring and can be
+ * called from any thread while recording continues.
+ */
+class RenderStatsRecorderSdk {
+public:
+    /**
+     * @brief One recorded statistics update
+     */
+    struct Sample {
+        double time = 0.0;                  // seconds since start()
+        double renderTime = 0.0;            // seconds Octane reports for the current render
+        double estimatedRenderTime = 0.0;
+        double samplesPerSecond = 0.0;      // beauty samples per second as reported by Octane
+        uint32_t samplesPerPixel = 0;
+        uint32_t maxSamplesPerPixel = 0;
+        uint32_t denoisedSamplesPerPixel = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        int32_t state = 0;                  // Octane::RenderState
+        uint64_t changeLevel = 0;
+    };
+
+    /**
+     * @brief Value averaged by movingAverage()
+     */
+    enum Field {
+        FIELD_SAMPLES_PER_SECOND = 0,
+        FIELD_SAMPLES_PER_PIXEL,
+        FIELD_RENDER_TIME,
+        FIELD_ESTIMATED_RENDER_TIME,
+    };
+
+    /**
+     * @param capacity     number of samples kept, older samples are overwritten
+     * @param pollInterval the sampler also polls at this interval (0 = only on callbacks),
+     *                     for servers that don't send statistics callbacks
+     */
+    explicit RenderStatsRecorderSdk(size_t capacity = 4096,
+                                    std::chrono::milliseconds pollInterval = std::chrono::milliseconds(0));
+    ~RenderStatsRecorderSdk();
+
+    RenderStatsRecorderSdk(const RenderStatsRecorderSdk&) = delete;
+    RenderStatsRecorderSdk& operator=(const RenderStatsRecorderSdk&) = delete;
+
+    /**
+     * @brief Register the statistics callback and start the sampler thread
+     * @return false if the callback could not be registered
+     */
+    bool start();
+
+    /**
+     * @brief Unregister the callback and stop the sampler. The samples are kept.
+     */
+    void stop();
+
+    bool isRunning() const { return m_running; }
+
+    /**
+     * @brief Fetch and record the current statistics right away, on the sampler thread
+     */
+    void requestSample();
+
+    /**
+     * @brief Copy of the recorded samples, oldest first
+     */
+    std::vector<Sample> samples() const;
+
+    /**
+     * @brief The most recent sample, false if nothing was recorded yet
+     */
+    bool latest(Sample& sample) const;
+
+    /**
+     * @brief Samples per pixel gained per second over the last windowSeconds
+     *
+     * Only samples of the current render count: a restart (samples per pixel going
+     * down or a new change level) starts a new window. Returns 0 without enough samples.
+     */
+    double samplingRate(double windowSeconds = 2.0) const;
+
+    /**
+     * @brief Time weighted average of a field over the last windowSeconds of the current render
+     */
+    double movingAverage(Field field, double windowSeconds = 2.0) const;
+
+    /**
+     * @brief Render time at which the current render reached targetSpp
+     *
+     * If the target is reached, the render time is interpolated between the samples
+     * around it. Otherwise it is extrapolated from samplingRate(); -1 if the rate is unknown.
+     *
+     * @param reached set to whether targetSpp was reached, may be nullptr
+     */
+    double timeToSpp(uint32_t targetSpp, bool* reached = nullptr) const;
+
+    uint64_t recordedCount() const { return m_ring.pushedCount(); }
+    uint64_t failedFetches() const { return m_failedFetches; }
+
+    /**
+     * @brief Write all samples as CSV with a header line
+     */
+    void exportCsv(std::ostream& out) const;
+
+    /**
+     * @brief Write all samples as a JSON array of objects
+     */
+    void exportJson(std::ostream& out) const;
+
+    /**
+     * @brief Export to a file, the format follows the extension (.json, anything else is CSV)
+     */
+    bool exportToFile(const std::string& path) const;
+
+    /**
+     * @brief Print the current rate, averages and sample counts
+     */
+    void printSummary(std::ostream& out) const;
+
+private:
+    static void onNewStatistics(void* userData);
+    void samplerLoop();
+    bool fetchSample(Sample& sample);
+
+    SharedUtils::SampleRing<Sample> m_ring;
+    std::chrono::milliseconds m_pollInterval;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    std::thread m_sampler;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_pending;
+    bool m_stopping;
+    std::atomic<bool> m_running;
+    std::atomic<uint64_t> m_failedFetches;
+};
+
+#endif // RENDER_STATS_RECORDER_SDK_H
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace SharedUtils {
+
+    /**
+     * Fixed-size lock-free ring of samples with one writer and any number of readers.
+     *
+     * The writer calls push() and never waits; once the ring is full the oldest sample
+     * is overwritten. Readers call snapshot() at any time and get the samples that are
+     * still in the ring, oldest first. Every slot carries a sequence number that is odd
+     * while the writer is in it (a seqlock), so a reader skips a slot that is being
+     * overwritten instead of returning a torn sample.
+     *
+     * T must be trivially copyable. Its bytes are stored in relaxed atomic words, which
+     * keeps the concurrent read of a slot that is being written well defined.
+     */
+    template<typename T>
+    class SampleRing {
+        static_assert(std::is_trivially_copyable<T>::value, "SampleRing needs a trivially copyable type");
+
+    public:
+        explicit SampleRing(size_t capacity)
+            : mSlots(capacity ? capacity : 1)
+        {
+        }
+
+        SampleRing(const SampleRing&) = delete;
+        SampleRing& operator=(const SampleRing&) = delete;
+
+        size_t capacity() const { return mSlots.size(); }
+
+        /**
+         * Number of samples pushed since construction or the last clear(), including overwritten ones
+         */
+        uint64_t pushedCount() const { return mPushed.load(std::memory_order_acquire); }
+
+        /**
+         * Append a sample. Only call from the writer thread.
+         */
+        void push(const T& sample)
+        {
+            const uint64_t index = mPushed.load(std::memory_order_relaxed);
+            Slot& slot = mSlots[index % mSlots.size()];
+
+            uint64_t words[WORD_COUNT] = {};
+            std::memcpy(words, &sample, sizeof(T));
+
+            // odd while writing, the readers retry or skip the slot
+            slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORD_COUNT; ++i)
+            {
+                slot.words[i].store(words[i], std::memory_order_relaxed);
+            }
+            slot.sequence.store(index * 2 + 2, std::memory_order_release);
+            mPushed.store(index + 1, std::memory_order_release);
+        }
+
+        /**
+         * Copy the samples that are in the ring, oldest first. Samples overwritten
+         * while copying are left out.
+         */
+        void snapshot(std::vector<T>& samples) const
+        {
+            samples.clear();
+            const uint64_t end = mPushed.load(std::memory_order_acquire);
+            const uint64_t begin = end > mSlots.size() ? end - mSlots.size() : 0;
+            samples.reserve(static_cast<size_t>(end - begin));
+            for (uint64_t index = begin; index < end; ++index)
+            {
+                T sample;
+                if (read(index, sample))
+                {
+                    samples.push_back(sample);
+                }
+            }
+        }
+
+        /**
+         * The most recent sample, false if the ring is empty
+         */
+        bool latest(T& sample) const
+        {
+            // retry when the writer laps us between loading the count and reading the slot
+            for (int attempt = 0; attempt < 4; ++attempt)
+            {
+                const uint64_t end = mPushed.load(std::memory_order_acquire);
+                if (end == 0)
+                {
+                    return false;
+                }
+                if (read(end - 1, sample))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Forget all samples. Only call from the writer thread.
+         */
+        void clear()
+        {
+            mPushed.store(0, std::memory_order_release);
+        }
+
+    private:
+        static constexpr size_t WORD_COUNT = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        struct Slot
+        {
+            std::atomic<uint64_t> sequence{ 0 };
+            std::atomic<uint64_t> words[WORD_COUNT];
+        };
+
+        bool read(uint64_t index, T& sample) const
+        {
+            const Slot& slot = mSlots[index % mSlots.size()];
+            const uint64_t expected = index * 2 + 2;
+            if (slot.sequence.load(std::memory_order_acquire) != expected)
+            {
+                return false;
+            }
+            uint64_t words[WORD_COUNT];
+            for (size_t i = 0; i < WORD_COUNT; ++i)
+            {
+                words[i] = slot.words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != expected)
+            {
+                return false;
+            }
+            std::memcpy(&sample, words, sizeof(T));
+            return true;
+        }
+
+        std::vector<Slot> mSlots;
+        alignas(64) std::atomic<uint64_t> mPushed{ 0 };
+    };
+
+};
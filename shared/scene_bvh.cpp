@@ -0,0 +1,930 @@
+#include "scene_bvh.h"
+#include "pixel_convert.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SCENE_BVH_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace SharedUtils {
+
+using OctaneVec::AABBF;
+using OctaneVec::MatrixF;
+using OctaneVec::float_3;
+
+struct SceneBvh::TriangleBlock
+{
+    // 4 triangles in SoA layout, unused lanes have zero edges and never hit
+    float v0[3][4];
+    float e1[3][4];
+    float e2[3][4];
+    uint32_t triangle[4];
+};
+
+struct SceneBvh::Mesh
+{
+    std::vector<float_3> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<float_3> normals;
+    std::vector<uint32_t> materials;
+    std::vector<Node> nodes;
+    std::vector<TriangleBlock> blocks;
+    AABBF bounds = AABBF::empty();
+    bool built = false;
+};
+
+namespace {
+
+    const uint32_t SAH_BINS = 16;
+    // below this depth the SAH split is used, deeper ranges are split at the median, which
+    // keeps any tree within the traversal stack
+    const uint32_t MAX_SAH_DEPTH = 32;
+    const uint32_t STACK_SIZE = 96;
+    // ranges of at least this many primitives are built as separate subtrees in parallel
+    const uint32_t PARALLEL_MIN_PRIMITIVES = 8192;
+    // refit top levels this much worse than when built are rebuilt
+    const float MAX_REFIT_COST_RATIO = 2.0f;
+
+    float halfArea(const AABBF& bounds)
+    {
+        if (bounds.pmin.x > bounds.pmax.x || bounds.pmin.y > bounds.pmax.y || bounds.pmin.z > bounds.pmax.z)
+        {
+            return 0.0f;
+        }
+        const float_3 e = bounds.pmax - bounds.pmin;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    void setNodeBounds(SceneBvh::Node& node, const AABBF& bounds)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            node.bmin[a] = bounds.pmin[a];
+            node.bmax[a] = bounds.pmax[a];
+        }
+    }
+
+    AABBF nodeBounds(const SceneBvh::Node& node)
+    {
+        AABBF bounds;
+        bounds.pmin = float_3{ node.bmin[0], node.bmin[1], node.bmin[2] };
+        bounds.pmax = float_3{ node.bmax[0], node.bmax[1], node.bmax[2] };
+        return bounds;
+    }
+
+    /**
+     * Binned SAH builder over primitive bounds. Reorders refs so the primitives of every
+     * leaf are a contiguous range, leaves store that range.
+     */
+    class BvhBuilder
+    {
+    public:
+        BvhBuilder(const AABBF* bounds, const float_3* centroids, uint32_t* refs, uint32_t maxLeaf)
+            : mBounds(bounds), mCentroids(centroids), mRefs(refs), mMaxLeaf(maxLeaf)
+        {
+        }
+
+        void build(std::vector<SceneBvh::Node>& nodes, uint32_t count, ThreadPool* pool)
+        {
+            nodes.clear();
+            if (count == 0)
+            {
+                return;
+            }
+            nodes.reserve(2 * (count / mMaxLeaf) + 1);
+            nodes.resize(1);
+            if (!pool || count < 2 * PARALLEL_MIN_PRIMITIVES)
+            {
+                buildRange(nodes, 0, 0, count, 0, nullptr, 0);
+                return;
+            }
+
+            // split the top of the tree until the ranges are small enough, then build the
+            // subtrees on the workers and append them
+            const uint32_t deferBelow = std::max(PARALLEL_MIN_PRIMITIVES, count / (4 * (pool->threadCount() + 1)));
+            std::vector<Subtree> subtrees;
+            buildRange(nodes, 0, 0, count, 0, &subtrees, deferBelow);
+
+            std::vector<std::vector<SceneBvh::Node>> built(subtrees.size());
+            pool->parallelFor(subtrees.size(), 1, [&](size_t first, size_t last) {
+                for (size_t s = first; s < last; ++s)
+                {
+                    built[s].resize(1);
+                    buildRange(built[s], 0, subtrees[s].begin, subtrees[s].end, subtrees[s].depth, nullptr, 0);
+                }
+            });
+
+            for (size_t s = 0; s < subtrees.size(); ++s)
+            {
+                // the subtree root replaces the placeholder, the rest is appended
+                const uint32_t base = static_cast<uint32_t>(nodes.size()) - 1;
+                for (size_t k = 0; k < built[s].size(); ++k)
+                {
+                    SceneBvh::Node node = built[s][k];
+                    if (node.count == 0)
+                    {
+                        node.leftOrFirst += base;
+                    }
+                    if (k == 0)
+                    {
+                        nodes[subtrees[s].node] = node;
+                    }
+                    else
+                    {
+                        nodes.push_back(node);
+                    }
+                }
+            }
+        }
+
+    private:
+        struct Subtree
+        {
+            uint32_t node;
+            uint32_t begin;
+            uint32_t end;
+            uint32_t depth;
+        };
+
+        void buildRange(std::vector<SceneBvh::Node>& nodes, uint32_t nodeIndex, uint32_t begin, uint32_t end,
+                        uint32_t depth, std::vector<Subtree>* deferred, uint32_t deferBelow)
+        {
+            AABBF bounds = AABBF::empty();
+            AABBF centroidBounds = AABBF::empty();
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                bounds.extend(mBounds[mRefs[i]]);
+                centroidBounds.extend(mCentroids[mRefs[i]]);
+            }
+            setNodeBounds(nodes[nodeIndex], bounds);
+
+            const uint32_t count = end - begin;
+            if (count <= mMaxLeaf)
+            {
+                nodes[nodeIndex].leftOrFirst = begin;
+                nodes[nodeIndex].count = count;
+                return;
+            }
+            if (deferred && count < deferBelow)
+            {
+                deferred->push_back(Subtree{ nodeIndex, begin, end, depth });
+                return;
+            }
+
+            const uint32_t mid = split(begin, end, centroidBounds, depth);
+            const uint32_t left = static_cast<uint32_t>(nodes.size());
+            nodes.resize(nodes.size() + 2);
+            nodes[nodeIndex].leftOrFirst = left;
+            nodes[nodeIndex].count = 0;
+            buildRange(nodes, left, begin, mid, depth + 1, deferred, deferBelow);
+            buildRange(nodes, left + 1, mid, end, depth + 1, deferred, deferBelow);
+        }
+
+        uint32_t split(uint32_t begin, uint32_t end, const AABBF& centroidBounds, uint32_t depth)
+        {
+            int bestAxis = -1;
+            uint32_t bestBin = 0;
+            float bestCost = FLT_MAX;
+            float bestScale = 0.0f;
+
+            for (int axis = 0; axis < 3 && depth < MAX_SAH_DEPTH; ++axis)
+            {
+                const float low = centroidBounds.pmin[axis];
+                const float extent = centroidBounds.pmax[axis] - low;
+                if (!(extent > 0.0f))
+                {
+                    continue;
+                }
+                const float scale = SAH_BINS / extent;
+
+                uint32_t counts[SAH_BINS] = {};
+                AABBF binBounds[SAH_BINS];
+                for (uint32_t b = 0; b < SAH_BINS; ++b)
+                {
+                    binBounds[b] = AABBF::empty();
+                }
+                for (uint32_t i = begin; i < end; ++i)
+                {
+                    const uint32_t ref = mRefs[i];
+                    const uint32_t b = std::min(SAH_BINS - 1, static_cast<uint32_t>((mCentroids[ref][axis] - low) * scale));
+                    ++counts[b];
+                    binBounds[b].extend(mBounds[ref]);
+                }
+
+                // cost of splitting after bin b, from both sides
+                float rightArea[SAH_BINS];
+                uint32_t rightCount[SAH_BINS];
+                AABBF accumulated = AABBF::empty();
+                uint32_t accumulatedCount = 0;
+                for (uint32_t b = SAH_BINS - 1; b > 0; --b)
+                {
+                    accumulated.extend(binBounds[b]);
+                    accumulatedCount += counts[b];
+                    rightArea[b] = halfArea(accumulated);
+                    rightCount[b] = accumulatedCount;
+                }
+                accumulated = AABBF::empty();
+                accumulatedCount = 0;
+                for (uint32_t b = 0; b + 1 < SAH_BINS; ++b)
+                {
+                    accumulated.extend(binBounds[b]);
+                    accumulatedCount += counts[b];
+                    if (accumulatedCount == 0 || rightCount[b + 1] == 0)
+                    {
+                        continue;
+                    }
+                    const float cost = halfArea(accumulated) * accumulatedCount + rightArea[b + 1] * rightCount[b + 1];
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = b;
+                        bestScale = scale;
+                    }
+                }
+            }
+
+            if (bestAxis >= 0)
+            {
+                const float low = centroidBounds.pmin[bestAxis];
+                uint32_t* mid = std::partition(mRefs + begin, mRefs + end, [&](uint32_t ref) {
+                    return std::min(SAH_BINS - 1, static_cast<uint32_t>((mCentroids[ref][bestAxis] - low) * bestScale)) <= bestBin;
+                });
+                const uint32_t split = static_cast<uint32_t>(mid - mRefs);
+                if (split > begin && split < end)
+                {
+                    return split;
+                }
+            }
+
+            // all centroids in one bin or too deep: median of the longest axis
+            const float_3 extent = centroidBounds.pmax - centroidBounds.pmin;
+            const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+            const uint32_t mid = begin + (end - begin) / 2;
+            std::nth_element(mRefs + begin, mRefs + mid, mRefs + end, [&](uint32_t a, uint32_t b) {
+                return mCentroids[a][axis] < mCentroids[b][axis];
+            });
+            return mid;
+        }
+
+        const AABBF* mBounds;
+        const float_3* mCentroids;
+        uint32_t* mRefs;
+        uint32_t mMaxLeaf;
+    };
+
+    /**
+     * Ray prepared for the slab test, the fourth lanes are padding
+     */
+    struct TraversalRay
+    {
+        float origin[4];
+        float invDir[4];
+        float dir[3];
+        float tMin;
+    };
+
+    TraversalRay prepareRay(const float_3& origin, const float_3& direction, float tMin)
+    {
+        TraversalRay ray;
+        for (int a = 0; a < 3; ++a)
+        {
+            const float d = direction[a];
+            // no infinities for axis parallel rays, 0 * inf would be NaN in the slab test
+            ray.invDir[a] = 1.0f / (std::fabs(d) > 1e-30f ? d : std::copysign(1e-30f, d));
+            ray.origin[a] = origin[a];
+            ray.dir[a] = d;
+        }
+        ray.origin[3] = 0.0f;
+        ray.invDir[3] = 0.0f;
+        ray.tMin = tMin;
+        return ray;
+    }
+
+    typedef bool (*BoxTest)(const SceneBvh::Node&, const TraversalRay&, float, float&);
+    typedef int (*BlockTest)(const float (*v0)[4], const float (*e1)[4], const float (*e2)[4], const TraversalRay&, float,
+                             float*, float*, float*);
+
+    bool boxTestScalar(const SceneBvh::Node& node, const TraversalRay& ray, float tMax, float& tNear)
+    {
+        float tn = ray.tMin;
+        float tf = tMax;
+        for (int a = 0; a < 3; ++a)
+        {
+            const float t0 = (node.bmin[a] - ray.origin[a]) * ray.invDir[a];
+            const float t1 = (node.bmax[a] - ray.origin[a]) * ray.invDir[a];
+            tn = std::max(tn, std::min(t0, t1));
+            tf = std::min(tf, std::max(t0, t1));
+        }
+        tNear = tn;
+        return tn <= tf;
+    }
+
+    int blockTestScalar(const float (*v0)[4], const float (*e1)[4], const float (*e2)[4], const TraversalRay& ray, float tMax,
+                        float* t, float* u, float* v)
+    {
+        const float* d = ray.dir;
+        int mask = 0;
+        for (int l = 0; l < 4; ++l)
+        {
+            const float px = d[1] * e2[2][l] - d[2] * e2[1][l];
+            const float py = d[2] * e2[0][l] - d[0] * e2[2][l];
+            const float pz = d[0] * e2[1][l] - d[1] * e2[0][l];
+            const float det = e1[0][l] * px + e1[1][l] * py + e1[2][l] * pz;
+            if (det == 0.0f)
+            {
+                continue;
+            }
+            const float inv = 1.0f / det;
+            const float sx = ray.origin[0] - v0[0][l];
+            const float sy = ray.origin[1] - v0[1][l];
+            const float sz = ray.origin[2] - v0[2][l];
+            u[l] = (sx * px + sy * py + sz * pz) * inv;
+            const float qx = sy * e1[2][l] - sz * e1[1][l];
+            const float qy = sz * e1[0][l] - sx * e1[2][l];
+            const float qz = sx * e1[1][l] - sy * e1[0][l];
+            v[l] = (d[0] * qx + d[1] * qy + d[2] * qz) * inv;
+            t[l] = (e2[0][l] * qx + e2[1][l] * qy + e2[2][l] * qz) * inv;
+            if (u[l] >= 0.0f && v[l] >= 0.0f && u[l] + v[l] <= 1.0f && t[l] > ray.tMin && t[l] < tMax)
+            {
+                mask |= 1 << l;
+            }
+        }
+        return mask;
+    }
+
+#if defined(SCENE_BVH_X86)
+
+    bool boxTestSse(const SceneBvh::Node& node, const TraversalRay& ray, float tMax, float& tNear)
+    {
+        // the fourth lanes hold leftOrFirst and count, they are replaced before the reduction
+        const __m128 lanes = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+        const __m128 origin = _mm_loadu_ps(ray.origin);
+        const __m128 invDir = _mm_loadu_ps(ray.invDir);
+        const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bmin), origin), invDir);
+        const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bmax), origin), invDir);
+        __m128 tn = _mm_or_ps(_mm_and_ps(lanes, _mm_min_ps(t0, t1)), _mm_andnot_ps(lanes, _mm_set1_ps(ray.tMin)));
+        __m128 tf = _mm_or_ps(_mm_and_ps(lanes, _mm_max_ps(t0, t1)), _mm_andnot_ps(lanes, _mm_set1_ps(tMax)));
+        tn = _mm_max_ps(tn, _mm_shuffle_ps(tn, tn, _MM_SHUFFLE(1, 0, 3, 2)));
+        tn = _mm_max_ps(tn, _mm_shuffle_ps(tn, tn, _MM_SHUFFLE(2, 3, 0, 1)));
+        tf = _mm_min_ps(tf, _mm_shuffle_ps(tf, tf, _MM_SHUFFLE(1, 0, 3, 2)));
+        tf = _mm_min_ps(tf, _mm_shuffle_ps(tf, tf, _MM_SHUFFLE(2, 3, 0, 1)));
+        tNear = _mm_cvtss_f32(tn);
+        return tNear <= _mm_cvtss_f32(tf);
+    }
+
+    /**
+     * Moeller-Trumbore for the 4 triangles of a block at once
+     */
+    int blockTestSse(const float (*v0)[4], const float (*e1)[4], const float (*e2)[4], const TraversalRay& ray, float tMax,
+                     float* t, float* u, float* v)
+    {
+        const __m128 dx = _mm_set1_ps(ray.dir[0]);
+        const __m128 dy = _mm_set1_ps(ray.dir[1]);
+        const __m128 dz = _mm_set1_ps(ray.dir[2]);
+        const __m128 e1x = _mm_loadu_ps(e1[0]), e1y = _mm_loadu_ps(e1[1]), e1z = _mm_loadu_ps(e1[2]);
+        const __m128 e2x = _mm_loadu_ps(e2[0]), e2y = _mm_loadu_ps(e2[1]), e2z = _mm_loadu_ps(e2[2]);
+
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        const __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+        const __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin[0]), _mm_loadu_ps(v0[0]));
+        const __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin[1]), _mm_loadu_ps(v0[1]));
+        const __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin[2]), _mm_loadu_ps(v0[2]));
+        const __m128 uu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inv);
+
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        const __m128 vv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inv);
+        const __m128 tt = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv);
+
+        const __m128 zero = _mm_setzero_ps();
+        // comparisons with NaN (degenerate lanes) are false
+        __m128 hit = _mm_cmpneq_ps(det, zero);
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(uu, zero));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(vv, zero));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(uu, vv), _mm_set1_ps(1.0f)));
+        hit = _mm_and_ps(hit, _mm_cmpgt_ps(tt, _mm_set1_ps(ray.tMin)));
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(tt, _mm_set1_ps(tMax)));
+        _mm_storeu_ps(t, tt);
+        _mm_storeu_ps(u, uu);
+        _mm_storeu_ps(v, vv);
+        return _mm_movemask_ps(hit);
+    }
+
+#endif
+
+    struct Kernels
+    {
+        BoxTest box;
+        BlockTest block;
+    };
+
+    Kernels activeKernels()
+    {
+#if defined(SCENE_BVH_X86)
+        if (PixelConvert::activeSimdLevel() != PixelConvert::SIMD_SCALAR)
+        {
+            return Kernels{ boxTestSse, blockTestSse };
+        }
+#endif
+        return Kernels{ boxTestScalar, blockTestScalar };
+    }
+
+    /**
+     * Front to back traversal, leaf(node) may lower tMax to prune the rest
+     */
+    template <typename LeafFn>
+    void traverse(const std::vector<SceneBvh::Node>& nodes, const TraversalRay& ray, float& tMax, BoxTest box, LeafFn leaf)
+    {
+        float tNear;
+        if (nodes.empty() || !box(nodes[0], ray, tMax, tNear))
+        {
+            return;
+        }
+        uint32_t stack[STACK_SIZE];
+        float stackNear[STACK_SIZE];
+        uint32_t depth = 0;
+        uint32_t current = 0;
+        for (;;)
+        {
+            const SceneBvh::Node& node = nodes[current];
+            if (node.count > 0)
+            {
+                leaf(node);
+            }
+            else
+            {
+                float nearA, nearB;
+                uint32_t first = node.leftOrFirst;
+                uint32_t second = first + 1;
+                const bool hitA = box(nodes[first], ray, tMax, nearA);
+                const bool hitB = box(nodes[second], ray, tMax, nearB);
+                if (hitA && hitB)
+                {
+                    if (nearB < nearA)
+                    {
+                        std::swap(first, second);
+                        std::swap(nearA, nearB);
+                    }
+                    stack[depth] = second;
+                    stackNear[depth] = nearB;
+                    ++depth;
+                    current = first;
+                    continue;
+                }
+                if (hitA || hitB)
+                {
+                    current = hitA ? first : second;
+                    continue;
+                }
+            }
+            // nodes behind the closest hit so far are skipped
+            do
+            {
+                if (depth == 0)
+                {
+                    return;
+                }
+                --depth;
+            } while (stackNear[depth] > tMax);
+            current = stack[depth];
+        }
+    }
+
+    float_3 transformNormal(const MatrixF& inverse, const float_3& n)
+    {
+        // inverse transpose
+        float_3 result;
+        for (int a = 0; a < 3; ++a)
+        {
+            result[a] = inverse.m[0][a] * n.x + inverse.m[1][a] * n.y + inverse.m[2][a] * n.z;
+        }
+        const float length = std::sqrt(OctaneVec::dot(result, result));
+        return length > 0.0f ? result * (1.0f / length) : result;
+    }
+
+} // namespace
+
+SceneBvh::SceneBvh(unsigned threadCount)
+    : mPool(new ThreadPool(threadCount))
+{
+}
+
+SceneBvh::~SceneBvh() = default;
+
+uint32_t SceneBvh::addMesh(std::vector<float_3> vertices,
+                           std::vector<uint32_t> triangleIndices,
+                           std::vector<float_3> normals,
+                           std::vector<uint32_t> materialIndices)
+{
+    std::unique_ptr<Mesh> mesh(new Mesh());
+    const size_t triangles = triangleIndices.size() / 3;
+    if (materialIndices.size() != triangles)
+    {
+        materialIndices.clear();
+    }
+    if (normals.size() != vertices.size())
+    {
+        normals.clear();
+    }
+
+    // triangles with indices outside the vertices are dropped
+    size_t kept = 0;
+    for (size_t t = 0; t < triangles; ++t)
+    {
+        const uint32_t* index = &triangleIndices[t * 3];
+        if (index[0] >= vertices.size() || index[1] >= vertices.size() || index[2] >= vertices.size())
+        {
+            continue;
+        }
+        std::copy(index, index + 3, &triangleIndices[kept * 3]);
+        if (!materialIndices.empty())
+        {
+            materialIndices[kept] = materialIndices[t];
+        }
+        ++kept;
+    }
+    triangleIndices.resize(kept * 3);
+    if (!materialIndices.empty())
+    {
+        materialIndices.resize(kept);
+    }
+
+    mesh->vertices = std::move(vertices);
+    mesh->indices = std::move(triangleIndices);
+    mesh->normals = std::move(normals);
+    mesh->materials = std::move(materialIndices);
+    mMeshes.push_back(std::move(mesh));
+    return static_cast<uint32_t>(mMeshes.size() - 1);
+}
+
+uint32_t SceneBvh::addInstance(uint32_t mesh, const MatrixF& transform)
+{
+    Instance instance;
+    instance.mesh = mesh < mMeshes.size() ? mesh : 0;
+    instance.transform = transform;
+    instance.inverse = transform.inverse();
+    instance.bounds = AABBF::empty();
+    mInstances.push_back(instance);
+    mTopDirty = true;
+    return static_cast<uint32_t>(mInstances.size() - 1);
+}
+
+void SceneBvh::setTransform(uint32_t instance, const MatrixF& transform)
+{
+    if (instance >= mInstances.size())
+    {
+        return;
+    }
+    mInstances[instance].transform = transform;
+    mInstances[instance].inverse = transform.inverse();
+    mTransformsDirty = true;
+}
+
+const MatrixF& SceneBvh::transform(uint32_t instance) const
+{
+    return mInstances[instance].transform;
+}
+
+void SceneBvh::clear()
+{
+    mMeshes.clear();
+    mInstances.clear();
+    mTopNodes.clear();
+    mInstanceRefs.clear();
+    mTopDirty = false;
+    mTransformsDirty = false;
+    mStats = Stats();
+}
+
+void SceneBvh::buildMesh(Mesh& mesh, ThreadPool* pool)
+{
+    const uint32_t triangles = static_cast<uint32_t>(mesh.indices.size() / 3);
+    std::vector<AABBF> bounds(triangles);
+    std::vector<float_3> centroids(triangles);
+    std::vector<uint32_t> refs(triangles);
+    auto prepare = [&](size_t first, size_t last) {
+        for (size_t t = first; t < last; ++t)
+        {
+            AABBF box = AABBF::empty();
+            for (int k = 0; k < 3; ++k)
+            {
+                box.extend(mesh.vertices[mesh.indices[t * 3 + k]]);
+            }
+            bounds[t] = box;
+            centroids[t] = (box.pmin + box.pmax) * 0.5f;
+            refs[t] = static_cast<uint32_t>(t);
+        }
+    };
+    if (pool && triangles >= 2 * PARALLEL_MIN_PRIMITIVES)
+    {
+        pool->parallelFor(triangles, PARALLEL_MIN_PRIMITIVES, prepare);
+    }
+    else
+    {
+        prepare(0, triangles);
+    }
+
+    BvhBuilder(bounds.data(), centroids.data(), refs.data(), LEAF_TRIANGLES).build(mesh.nodes, triangles, pool);
+
+    // one block per leaf, precomputed edges
+    mesh.blocks.clear();
+    for (Node& node : mesh.nodes)
+    {
+        if (node.count == 0)
+        {
+            continue;
+        }
+        TriangleBlock block = {};
+        for (uint32_t l = 0; l < 4; ++l)
+        {
+            block.triangle[l] = BvhHit::INVALID;
+            if (l >= node.count)
+            {
+                continue;
+            }
+            const uint32_t t = refs[node.leftOrFirst + l];
+            const float_3 a = mesh.vertices[mesh.indices[t * 3]];
+            const float_3 b = mesh.vertices[mesh.indices[t * 3 + 1]];
+            const float_3 c = mesh.vertices[mesh.indices[t * 3 + 2]];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                block.v0[axis][l] = a[axis];
+                block.e1[axis][l] = b[axis] - a[axis];
+                block.e2[axis][l] = c[axis] - a[axis];
+            }
+            block.triangle[l] = t;
+        }
+        node.leftOrFirst = static_cast<uint32_t>(mesh.blocks.size());
+        mesh.blocks.push_back(block);
+    }
+    mesh.bounds = mesh.nodes.empty() ? AABBF::empty() : nodeBounds(mesh.nodes[0]);
+    mesh.built = true;
+}
+
+void SceneBvh::buildTopLevel()
+{
+    const uint32_t count = static_cast<uint32_t>(mInstances.size());
+    std::vector<AABBF> bounds(count);
+    std::vector<float_3> centroids(count);
+    mInstanceRefs.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        bounds[i] = mInstances[i].bounds;
+        centroids[i] = halfArea(bounds[i]) > 0.0f ? (bounds[i].pmin + bounds[i].pmax) * 0.5f : float_3{ 0.0f, 0.0f, 0.0f };
+        mInstanceRefs[i] = i;
+    }
+    BvhBuilder(bounds.data(), centroids.data(), mInstanceRefs.data(), 2).build(mTopNodes, count, mPool.get());
+    mBuiltCost = topLevelCost();
+}
+
+bool SceneBvh::refitTopLevel()
+{
+    // children always come after their parent, so a reverse pass sees them first
+    for (size_t n = mTopNodes.size(); n-- > 0;)
+    {
+        Node& node = mTopNodes[n];
+        AABBF bounds = AABBF::empty();
+        if (node.count > 0)
+        {
+            for (uint32_t k = 0; k < node.count; ++k)
+            {
+                bounds.extend(mInstances[mInstanceRefs[node.leftOrFirst + k]].bounds);
+            }
+        }
+        else
+        {
+            bounds = nodeBounds(mTopNodes[node.leftOrFirst]);
+            bounds.extend(nodeBounds(mTopNodes[node.leftOrFirst + 1]));
+        }
+        setNodeBounds(node, bounds);
+    }
+    return topLevelCost() <= mBuiltCost * MAX_REFIT_COST_RATIO;
+}
+
+float SceneBvh::topLevelCost() const
+{
+    if (mTopNodes.empty())
+    {
+        return 0.0f;
+    }
+    const float rootArea = halfArea(nodeBounds(mTopNodes[0]));
+    if (rootArea <= 0.0f)
+    {
+        return 0.0f;
+    }
+    float cost = 0.0f;
+    for (const Node& node : mTopNodes)
+    {
+        cost += halfArea(nodeBounds(node)) * (node.count > 0 ? node.count : 1);
+    }
+    return cost / rootArea;
+}
+
+void SceneBvh::commit()
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    // big meshes use all threads each, small ones are built side by side
+    std::vector<Mesh*> small;
+    size_t built = 0;
+    for (const std::unique_ptr<Mesh>& mesh : mMeshes)
+    {
+        if (mesh->built)
+        {
+            continue;
+        }
+        ++built;
+        if (mesh->indices.size() / 3 >= 2 * PARALLEL_MIN_PRIMITIVES)
+        {
+            buildMesh(*mesh, mPool.get());
+        }
+        else
+        {
+            small.push_back(mesh.get());
+        }
+    }
+    mPool->parallelFor(small.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+        {
+            buildMesh(*small[i], nullptr);
+        }
+    });
+
+    if (built > 0 || mTopDirty || mTransformsDirty)
+    {
+        for (Instance& instance : mInstances)
+        {
+            const Mesh& mesh = *mMeshes[instance.mesh];
+            instance.bounds = mesh.nodes.empty() ? AABBF::empty() : mesh.bounds.transformed(instance.transform);
+        }
+    }
+
+    mStats.refit = false;
+    if (built > 0 || mTopDirty)
+    {
+        buildTopLevel();
+    }
+    else if (mTransformsDirty)
+    {
+        mStats.refit = refitTopLevel();
+        if (!mStats.refit)
+        {
+            buildTopLevel();
+        }
+    }
+    mTopDirty = false;
+    mTransformsDirty = false;
+
+    mStats.meshes = mMeshes.size();
+    mStats.instances = mInstances.size();
+    mStats.triangles = 0;
+    mStats.nodes = mTopNodes.size();
+    for (const std::unique_ptr<Mesh>& mesh : mMeshes)
+    {
+        mStats.triangles += mesh->indices.size() / 3;
+        mStats.nodes += mesh->nodes.size();
+    }
+    mStats.builtMeshes = built;
+    mStats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+bool SceneBvh::intersect(const BvhRay& ray, BvhHit& hit) const
+{
+    const Kernels kernels = activeKernels();
+    hit = BvhHit();
+    float tMax = ray.tMax;
+    const TraversalRay top = prepareRay(ray.origin, ray.direction, ray.tMin);
+    traverse(mTopNodes, top, tMax, kernels.box, [&](const Node& leaf) {
+        for (uint32_t k = 0; k < leaf.count; ++k)
+        {
+            const uint32_t instanceIndex = mInstanceRefs[leaf.leftOrFirst + k];
+            const Instance& instance = mInstances[instanceIndex];
+            const Mesh& mesh = *mMeshes[instance.mesh];
+            // the direction is not normalized, so t is the same in both spaces
+            const TraversalRay local = prepareRay(OctaneVec::multiplyP(instance.inverse, ray.origin),
+                                                  OctaneVec::multiplyV(instance.inverse, ray.direction), ray.tMin);
+            traverse(mesh.nodes, local, tMax, kernels.box, [&](const Node& meshLeaf) {
+                const TriangleBlock& block = mesh.blocks[meshLeaf.leftOrFirst];
+                float t[4], u[4], v[4];
+                int mask = kernels.block(block.v0, block.e1, block.e2, local, tMax, t, u, v);
+                for (int l = 0; mask != 0; ++l, mask >>= 1)
+                {
+                    if ((mask & 1) && t[l] < tMax)
+                    {
+                        tMax = t[l];
+                        hit.instance = instanceIndex;
+                        hit.mesh = instance.mesh;
+                        hit.triangle = block.triangle[l];
+                        hit.depth = t[l];
+                        hit.u = u[l];
+                        hit.v = v[l];
+                    }
+                }
+            });
+        }
+    });
+    return hit.instance != BvhHit::INVALID;
+}
+
+size_t SceneBvh::intersectAll(const BvhRay& ray, BvhHit* hits, size_t maxHits) const
+{
+    const Kernels kernels = activeKernels();
+    std::vector<BvhHit> found;
+    float tMax = ray.tMax;
+    const TraversalRay top = prepareRay(ray.origin, ray.direction, ray.tMin);
+    traverse(mTopNodes, top, tMax, kernels.box, [&](const Node& leaf) {
+        for (uint32_t k = 0; k < leaf.count; ++k)
+        {
+            const uint32_t instanceIndex = mInstanceRefs[leaf.leftOrFirst + k];
+            const Instance& instance = mInstances[instanceIndex];
+            const Mesh& mesh = *mMeshes[instance.mesh];
+            const TraversalRay local = prepareRay(OctaneVec::multiplyP(instance.inverse, ray.origin),
+                                                  OctaneVec::multiplyV(instance.inverse, ray.direction), ray.tMin);
+            traverse(mesh.nodes, local, tMax, kernels.box, [&](const Node& meshLeaf) {
+                const TriangleBlock& block = mesh.blocks[meshLeaf.leftOrFirst];
+                float t[4], u[4], v[4];
+                int mask = kernels.block(block.v0, block.e1, block.e2, local, tMax, t, u, v);
+                for (int l = 0; mask != 0; ++l, mask >>= 1)
+                {
+                    if (mask & 1)
+                    {
+                        BvhHit hit;
+                        hit.instance = instanceIndex;
+                        hit.mesh = instance.mesh;
+                        hit.triangle = block.triangle[l];
+                        hit.depth = t[l];
+                        hit.u = u[l];
+                        hit.v = v[l];
+                        found.push_back(hit);
+                    }
+                }
+            });
+        }
+    });
+
+    const size_t count = std::min(found.size(), maxHits);
+    std::partial_sort(found.begin(), found.begin() + count, found.end(),
+                      [](const BvhHit& a, const BvhHit& b) { return a.depth < b.depth; });
+    std::copy(found.begin(), found.begin() + count, hits);
+    return count;
+}
+
+void SceneBvh::intersectMany(const BvhRay* rays, size_t count, BvhHit* hits) const
+{
+    mPool->parallelFor(count, 64, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+        {
+            intersect(rays[i], hits[i]);
+        }
+    });
+}
+
+void SceneBvh::hitInfo(const BvhRay& ray, const BvhHit& hit, BvhHitInfo& info) const
+{
+    info = BvhHitInfo();
+    if (hit.instance >= mInstances.size() || hit.mesh >= mMeshes.size())
+    {
+        return;
+    }
+    const Instance& instance = mInstances[hit.instance];
+    const Mesh& mesh = *mMeshes[hit.mesh];
+    const uint32_t* index = &mesh.indices[hit.triangle * 3];
+    const float w = 1.0f - hit.u - hit.v;
+
+    info.position = ray.origin + ray.direction * hit.depth;
+    for (int k = 0; k < 3; ++k)
+    {
+        info.vertices[k] = mesh.vertices[index[k]];
+    }
+    info.barycentric = float_3{ w, hit.u, hit.v };
+    info.geometricNormal = transformNormal(instance.inverse,
+        OctaneVec::cross(info.vertices[1] - info.vertices[0], info.vertices[2] - info.vertices[0]));
+    if (!mesh.normals.empty())
+    {
+        const float_3 n = mesh.normals[index[0]] * w + mesh.normals[index[1]] * hit.u + mesh.normals[index[2]] * hit.v;
+        info.smoothedNormal = transformNormal(instance.inverse, n);
+    }
+    else
+    {
+        info.smoothedNormal = info.geometricNormal;
+    }
+    info.materialIndex = mesh.materials.empty() ? 0 : mesh.materials[hit.triangle];
+}
+
+AABBF SceneBvh::bounds() const
+{
+    return mTopNodes.empty() ? AABBF::empty() : nodeBounds(mTopNodes[0]);
+}
+
+} // namespace SharedUtils
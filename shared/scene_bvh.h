@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "octaneaabb.h"
+#include "octanematrix.h"
+#include "octanevectypes.h"
+
+namespace SharedUtils {
+
+    class ThreadPool;
+
+    /**
+     * Ray in world space. The direction doesn't need to be normalized, depths are
+     * in units of its length.
+     */
+    struct BvhRay
+    {
+        OctaneVec::float_3 origin;
+        OctaneVec::float_3 direction;
+        float tMin = 0.0f;
+        float tMax = FLT_MAX;
+    };
+
+    /**
+     * One intersection along a ray
+     */
+    struct BvhHit
+    {
+        static const uint32_t INVALID = 0xffffffffu;
+
+        uint32_t instance = INVALID;
+        uint32_t mesh = INVALID;
+        uint32_t triangle = INVALID;       // index into the triangles of the mesh
+        float depth = FLT_MAX;
+        float u = 0.0f;                    // barycentric weights of the second and third vertex
+        float v = 0.0f;
+    };
+
+    /**
+     * Everything Octane's pick returns for a triangle, computed for a hit
+     */
+    struct BvhHitInfo
+    {
+        OctaneVec::float_3 position;               // world space
+        OctaneVec::float_3 geometricNormal;        // world space, normalized
+        OctaneVec::float_3 smoothedNormal;         // geometric normal if the mesh has no normals
+        OctaneVec::float_3 vertices[3];            // local space
+        OctaneVec::float_3 barycentric;            // weights of vertices[0..2]
+        uint32_t materialIndex = 0;
+    };
+
+    /**
+     * Two level bounding volume hierarchy over triangle meshes for picking on the client.
+     *
+     * Every mesh gets its own BVH in local space, built once. Instances place meshes with
+     * an affine transform, the top level BVH over the instances is refit when transforms
+     * change and only rebuilt when instances are added or the refit tree got too loose.
+     *
+     * Both levels are built with binned SAH. Large meshes are split into subtrees that are
+     * built in parallel, small meshes are built in parallel with each other. Leaves hold up
+     * to 4 triangles in SoA layout, tested against a ray at once with SSE; box tests use
+     * SSE as well unless PixelConvert::activeSimdLevel() is SIMD_SCALAR.
+     *
+     * Queries are const and can run on any number of threads, but not at the same time as
+     * addMesh(), addInstance(), setTransform() or commit().
+     */
+    class SceneBvh
+    {
+    public:
+        /**
+         * Leaf size and stack depth are fixed by the layout
+         */
+        static const uint32_t LEAF_TRIANGLES = 4;
+
+        struct Stats
+        {
+            size_t meshes = 0;
+            size_t instances = 0;
+            size_t triangles = 0;          // over all meshes, not instanced
+            size_t nodes = 0;              // all levels
+            size_t builtMeshes = 0;        // by the last commit()
+            double buildMs = 0.0;          // of the last commit()
+            bool refit = false;            // last commit() only refit the top level
+        };
+
+        /**
+         * Thread count 0 uses all hardware threads for builds and pickMany()
+         */
+        explicit SceneBvh(unsigned threadCount = 0);
+        ~SceneBvh();
+
+        SceneBvh(const SceneBvh&) = delete;
+        SceneBvh& operator=(const SceneBvh&) = delete;
+
+        /**
+         * Add a triangle mesh. Normals are optional, one per vertex; material indices are
+         * optional, one per triangle. The BVH is built by the next commit().
+         */
+        uint32_t addMesh(std::vector<OctaneVec::float_3> vertices,
+                         std::vector<uint32_t> triangleIndices,
+                         std::vector<OctaneVec::float_3> normals = std::vector<OctaneVec::float_3>(),
+                         std::vector<uint32_t> materialIndices = std::vector<uint32_t>());
+
+        /**
+         * Place a mesh, returns the instance index
+         */
+        uint32_t addInstance(uint32_t mesh, const OctaneVec::MatrixF& transform);
+
+        /**
+         * Move an instance, the top level is refit by the next commit()
+         */
+        void setTransform(uint32_t instance, const OctaneVec::MatrixF& transform);
+        const OctaneVec::MatrixF& transform(uint32_t instance) const;
+
+        /**
+         * Remove all meshes and instances
+         */
+        void clear();
+
+        /**
+         * Build new meshes and rebuild or refit the top level
+         */
+        void commit();
+
+        /**
+         * Closest hit, false if the ray misses everything
+         */
+        bool intersect(const BvhRay& ray, BvhHit& hit) const;
+
+        /**
+         * All hits along the ray sorted by depth, up to maxHits. Returns the number stored.
+         */
+        size_t intersectAll(const BvhRay& ray, BvhHit* hits, size_t maxHits) const;
+
+        /**
+         * Closest hits of many rays, spread over the worker threads. Misses get an
+         * instance of BvhHit::INVALID.
+         */
+        void intersectMany(const BvhRay* rays, size_t count, BvhHit* hits) const;
+
+        /**
+         * Position, normals and vertices of a hit
+         */
+        void hitInfo(const BvhRay& ray, const BvhHit& hit, BvhHitInfo& info) const;
+
+        OctaneVec::AABBF bounds() const;
+        Stats stats() const { return mStats; }
+
+        /**
+         * Node layout shared by both levels: a leaf has count > 0 and leftOrFirst is its
+         * first triangle block (bottom level) or instance reference (top level). An inner
+         * node has count 0 and its children at leftOrFirst and leftOrFirst + 1.
+         */
+        struct Node
+        {
+            float bmin[3];
+            uint32_t leftOrFirst;
+            float bmax[3];
+            uint32_t count;
+        };
+
+    private:
+        struct TriangleBlock;
+        struct Mesh;
+        struct Instance
+        {
+            uint32_t mesh;
+            OctaneVec::MatrixF transform;
+            OctaneVec::MatrixF inverse;
+            OctaneVec::AABBF bounds;       // world space
+        };
+
+        void buildMesh(Mesh& mesh, ThreadPool* pool);
+        void buildTopLevel();
+        bool refitTopLevel();
+        float topLevelCost() const;
+
+        std::unique_ptr<ThreadPool> mPool;
+        std::vector<std::unique_ptr<Mesh>> mMeshes;
+        std::vector<Instance> mInstances;
+        std::vector<Node> mTopNodes;
+        std::vector<uint32_t> mInstanceRefs;
+        float mBuiltCost = 0.0f;           // SAH cost of the top level when it was built
+        bool mTopDirty = false;            // instances added, rebuild
+        bool mTransformsDirty = false;     // refit
+        Stats mStats;
+    };
+
+} // namespace SharedUtils
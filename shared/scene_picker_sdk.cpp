@@ -0,0 +1,284 @@
+#include "scene_picker_sdk.h"
+#ifdef DO_GRPC_SDK_ENABLED
+#include "item_array_sdk.h"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <utility>
+
+using OctaneVec::float_3;
+using OctaneVec::MatrixF;
+
+namespace {
+
+float_3 normalizedOr(const float_3& v, const float_3& fallback) {
+    const float length = std::sqrt(OctaneVec::dot(v, v));
+    return length > 0.0f ? v * (1.0f / length) : fallback;
+}
+
+// fan triangulation, polygons with fewer than 3 vertices are skipped
+void triangulate(const std::vector<uint32_t>& verticesPerPoly,
+                 const std::vector<uint32_t>& polyVertexIndices,
+                 const std::vector<uint32_t>& polyMaterialIndices,
+                 bool flipWinding,
+                 std::vector<uint32_t>& triangles,
+                 std::vector<uint32_t>& materials) {
+    size_t offset = 0;
+    for (size_t p = 0; p < verticesPerPoly.size(); ++p) {
+        const uint32_t count = verticesPerPoly[p];
+        if (offset + count > polyVertexIndices.size()) {
+            break;
+        }
+        for (uint32_t k = 1; count >= 3 && k + 1 < count; ++k) {
+            triangles.push_back(polyVertexIndices[offset]);
+            triangles.push_back(polyVertexIndices[offset + (flipWinding ? k + 1 : k)]);
+            triangles.push_back(polyVertexIndices[offset + (flipWinding ? k : k + 1)]);
+            if (!polyMaterialIndices.empty()) {
+                materials.push_back(p < polyMaterialIndices.size() ? polyMaterialIndices[p] : 0);
+            }
+        }
+        offset += count;
+    }
+}
+
+}
+
+ScenePickerSdk::ScenePickerSdk(unsigned threadCount)
+    : m_bvh(threadCount)
+    , m_cameraPosition{ 0.0f, 0.0f, 0.0f }
+    , m_cameraForward{ 0.0f, 0.0f, -1.0f }
+    , m_cameraRight{ 1.0f, 0.0f, 0.0f }
+    , m_cameraUp{ 0.0f, 1.0f, 0.0f }
+    , m_tanHalfWidth(1.0f)
+    , m_tanHalfHeight(1.0f)
+    , m_width(1)
+    , m_height(1)
+{
+#ifdef DO_GRPC_SDK_ENABLED
+    m_itemArrays = nullptr;
+#endif
+}
+
+void ScenePickerSdk::setCamera(const float_3& position, const float_3& target, const float_3& up, float fovDegrees,
+                               uint32_t width, uint32_t height, bool horizontalFov) {
+    m_cameraPosition = position;
+    m_cameraForward = normalizedOr(target - position, float_3{ 0.0f, 0.0f, -1.0f });
+    m_cameraRight = normalizedOr(OctaneVec::cross(m_cameraForward, up), float_3{ 1.0f, 0.0f, 0.0f });
+    m_cameraUp = OctaneVec::cross(m_cameraRight, m_cameraForward);
+    m_width = std::max(width, 1u);
+    m_height = std::max(height, 1u);
+    const float tanHalf = std::tan(fovDegrees * 0.5f * 3.14159265f / 180.0f);
+    const float aspect = (float)m_width / (float)m_height;
+    m_tanHalfWidth = horizontalFov ? tanHalf : tanHalf * aspect;
+    m_tanHalfHeight = horizontalFov ? tanHalf / aspect : tanHalf;
+}
+
+uint32_t ScenePickerSdk::addPolygonMesh(const std::vector<float_3>& vertices,
+                                        const std::vector<uint32_t>& verticesPerPoly,
+                                        const std::vector<uint32_t>& polyVertexIndices,
+                                        const MatrixF& transform,
+                                        const std::vector<uint32_t>& polyMaterialIndices) {
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> materials;
+    triangulate(verticesPerPoly, polyVertexIndices, polyMaterialIndices, false, triangles, materials);
+    const uint32_t mesh = m_bvh.addMesh(vertices, std::move(triangles), std::vector<float_3>(), std::move(materials));
+#ifdef DO_GRPC_SDK_ENABLED
+    m_meshNodes.resize(mesh + 1);
+#endif
+    return m_bvh.addInstance(mesh, transform);
+}
+
+uint32_t ScenePickerSdk::addLiveLinkMesh(const CameraSyncLiveLink::MeshData& meshData) {
+    std::vector<float_3> vertices(meshData.positions.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        vertices[i] = float_3{ meshData.positions[i].x, meshData.positions[i].y, meshData.positions[i].z };
+    }
+    // per vertex normals only if they are indexed like the positions
+    std::vector<float_3> normals;
+    if (meshData.normals.size() == meshData.positions.size() &&
+        (meshData.polyNormalIndices.empty() || meshData.polyNormalIndices == meshData.polyVertIndices)) {
+        normals.resize(meshData.normals.size());
+        for (size_t i = 0; i < normals.size(); ++i) {
+            normals[i] = float_3{ meshData.normals[i].x, meshData.normals[i].y, meshData.normals[i].z };
+        }
+    }
+
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> materials;
+    // 1 = clockwise, the geometric normals should face the same way as Octane's
+    triangulate(meshData.vertsPerPoly, meshData.polyVertIndices, std::vector<uint32_t>(), meshData.windingOrder == 1,
+                triangles, materials);
+
+    // glm is column major
+    MatrixF transform;
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 4; ++col) {
+            transform.m[row][col] = meshData.worldMatrix[col][row];
+        }
+    }
+    const uint32_t mesh = m_bvh.addMesh(std::move(vertices), std::move(triangles), std::move(normals));
+#ifdef DO_GRPC_SDK_ENABLED
+    m_meshNodes.resize(mesh + 1);
+#endif
+    return m_bvh.addInstance(mesh, transform);
+}
+
+#ifdef DO_GRPC_SDK_ENABLED
+uint32_t ScenePickerSdk::addMeshNode(const OctaneGRPC::ApiNodeProxy& meshNode, const MatrixF& transform) {
+    std::vector<float_3> vertices;
+    if (m_itemArrays) {
+        if (!readMeshArrays(meshNode, vertices)) {
+            return SharedUtils::BvhHit::INVALID;
+        }
+    } else {
+        try {
+            vertices = meshNode.getFloat3Array(Octane::A_VERTICES);
+            const std::vector<int> verticesPerPoly = meshNode.getIntArray(Octane::A_VERTICES_PER_POLY);
+            const std::vector<int> polyVertexIndices = meshNode.getIntArray(Octane::A_POLY_VERTEX_INDICES);
+            const std::vector<int> polyMaterialIndices = meshNode.getIntArray(Octane::A_POLY_MATERIAL_INDICES);
+            m_verticesPerPoly.assign(verticesPerPoly.begin(), verticesPerPoly.end());
+            m_polyVertexIndices.assign(polyVertexIndices.begin(), polyVertexIndices.end());
+            m_polyMaterialIndices.assign(polyMaterialIndices.begin(), polyMaterialIndices.end());
+        } catch (const std::exception& e) {
+            std::cout << "ScenePickerSdk: reading mesh attributes failed: " << e.what() << std::endl;
+            return SharedUtils::BvhHit::INVALID;
+        }
+    }
+
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> materials;
+    triangulate(m_verticesPerPoly, m_polyVertexIndices, m_polyMaterialIndices, false, triangles, materials);
+    const uint32_t mesh = m_bvh.addMesh(std::move(vertices), std::move(triangles), std::vector<float_3>(), std::move(materials));
+    m_meshNodes.resize(mesh + 1);
+    m_meshNodes[mesh] = meshNode;
+    return m_bvh.addInstance(mesh, transform);
+}
+
+bool ScenePickerSdk::readMeshArrays(const OctaneGRPC::ApiNodeProxy& meshNode, std::vector<float_3>& vertices) {
+    // the int arrays are read into the uint32_t buffers as they are, which is what the
+    // conversion of the getters does too
+    struct IntArray {
+        Octane::AttributeId id;
+        std::vector<uint32_t>* buffer;
+    };
+    const IntArray intArrays[] = {
+        { Octane::A_VERTICES_PER_POLY, &m_verticesPerPoly },
+        { Octane::A_POLY_VERTEX_INDICES, &m_polyVertexIndices },
+        { Octane::A_POLY_MATERIAL_INDICES, &m_polyMaterialIndices },
+    };
+
+    std::string error;
+    size_t count = 0;
+    bool ok = m_itemArrays->size(meshNode, Octane::A_VERTICES, ItemArraySdk::ElementType::Float3, count, &error);
+    if (ok) {
+        vertices.resize(count);
+        ok = m_itemArrays->read(meshNode, Octane::A_VERTICES, vertices.data(), vertices.size(), count, &error);
+    }
+    for (const IntArray& array : intArrays) {
+        if (!ok) {
+            break;
+        }
+        ok = m_itemArrays->size(meshNode, array.id, ItemArraySdk::ElementType::Int, count, &error);
+        if (ok) {
+            array.buffer->resize(count);
+            ok = m_itemArrays->read(meshNode, array.id, reinterpret_cast<int32_t*>(array.buffer->data()),
+                                    array.buffer->size(), count, &error);
+        }
+    }
+    if (!ok) {
+        std::cout << "ScenePickerSdk: reading mesh attributes failed: " << error << std::endl;
+    }
+    return ok;
+}
+
+unsigned int ScenePickerSdk::pick(unsigned int x,
+                                  unsigned int y,
+                                  bool filterDuplicateMaterialPins,
+                                  OctaneGRPC::GRPCPickIntersection& intersections,
+                                  unsigned int intersectionsSize) {
+    if (intersectionsSize == 0) {
+        return 0;
+    }
+    const SharedUtils::BvhRay ray = cameraRay((float)x, (float)y);
+    // the duplicates are filtered after the search, ask for more hits than needed then
+    std::vector<SharedUtils::BvhHit> hits(filterDuplicateMaterialPins ? intersectionsSize * 4 : intersectionsSize);
+    const size_t found = pickHits(x, y, hits.data(), hits.size());
+
+    OctaneGRPC::GRPCPickIntersection* out = &intersections;
+    std::set<std::pair<uint32_t, uint32_t>> seenPins;
+    unsigned int count = 0;
+    for (size_t i = 0; i < found && count < intersectionsSize; ++i) {
+        SharedUtils::BvhHitInfo info;
+        m_bvh.hitInfo(ray, hits[i], info);
+        if (filterDuplicateMaterialPins && !seenPins.insert(std::make_pair(hits[i].mesh, info.materialIndex)).second) {
+            continue;
+        }
+        OctaneGRPC::GRPCPickIntersection& result = out[count++];
+        result.mNode = hits[i].mesh < m_meshNodes.size() ? m_meshNodes[hits[i].mesh] : OctaneGRPC::ApiNodeProxy();
+        result.mMaterialPinIx = info.materialIndex;
+        result.mDepth = hits[i].depth;
+        result.mPosition = info.position;
+        result.mGeometricNormal = info.geometricNormal;
+        result.mSmoothedNormal = info.smoothedNormal;
+        result.mPrimitiveType = Octane::PRIMITIVE_TRIANGLE;
+        for (int k = 0; k < 3; ++k) {
+            result.mPrimitiveVertices[k] = info.vertices[k];
+        }
+        result.mPositionOnPrimitive = info.barycentric;
+    }
+    return count;
+}
+#endif
+
+void ScenePickerSdk::setTransform(uint32_t instance, const MatrixF& transform) {
+    m_bvh.setTransform(instance, transform);
+}
+
+void ScenePickerSdk::commit() {
+    m_bvh.commit();
+}
+
+void ScenePickerSdk::clear() {
+    m_bvh.clear();
+#ifdef DO_GRPC_SDK_ENABLED
+    m_meshNodes.clear();
+#endif
+}
+
+SharedUtils::BvhRay ScenePickerSdk::cameraRay(float x, float y) const {
+    const float ndcX = ((x + 0.5f) / (float)m_width) * 2.0f - 1.0f;
+    const float ndcY = 1.0f - ((y + 0.5f) / (float)m_height) * 2.0f;
+    SharedUtils::BvhRay ray;
+    ray.origin = m_cameraPosition;
+    // normalized, so depths are distances
+    ray.direction = normalizedOr(m_cameraForward + m_cameraRight * (ndcX * m_tanHalfWidth) + m_cameraUp * (ndcY * m_tanHalfHeight),
+                                 m_cameraForward);
+    return ray;
+}
+
+size_t ScenePickerSdk::pickHits(unsigned int x, unsigned int y, SharedUtils::BvhHit* hits, size_t maxHits) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    const size_t found = m_bvh.intersectAll(cameraRay((float)x, (float)y), hits, maxHits);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    ++m_stats.picks;
+    m_stats.hits += found > 0 ? 1 : 0;
+    m_stats.totalPickMs += ms;
+    m_stats.maxPickMs = std::max(m_stats.maxPickMs, ms);
+    return found;
+}
+
+void ScenePickerSdk::printSummary(std::ostream& out) const {
+    const SharedUtils::SceneBvh::Stats bvhStats = m_bvh.stats();
+    out << "Scene picker: " << bvhStats.meshes << " meshes, " << bvhStats.instances << " instances, "
+        << bvhStats.triangles << " triangles, " << bvhStats.nodes << " nodes, last commit "
+        << std::fixed << std::setprecision(2) << bvhStats.buildMs << " ms" << (bvhStats.refit ? " (refit)" : "");
+    if (m_stats.picks > 0) {
+        out << ", " << m_stats.picks << " picks (" << m_stats.hits << " hit), avg "
+            << std::setprecision(4) << m_stats.totalPickMs / m_stats.picks << " ms, max " << m_stats.maxPickMs << " ms";
+    }
+    out << std::endl;
+}
@@ -0,0 +1,152 @@
+#ifndef SCENE_PICKER_SDK_H
+#define SCENE_PICKER_SDK_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "scene_bvh.h"
+#include "camera_sync_livelink.h"
+
+#ifdef DO_GRPC_SDK_ENABLED
+#include "apirenderengineclient.h"
+#include "apinodeclient.h"
+
+class ItemArraySdk;
+#endif
+
+/**
+ * @brief Answers ApiRenderEngineProxy::pick() on the client from mirrored geometry
+ *
+ * pick() is one synchronous RPC per query, far too slow for hover, snapping or placing
+ * objects under the cursor. The picker keeps the scene meshes in a SharedUtils::SceneBvh,
+ * built from the mesh attributes of Octane mesh nodes or from LiveLink GetMesh data, and
+ * casts the camera ray of a pixel locally. pick() has the signature and result structure
+ * of the RPC, so callers can switch between the two.
+ *
+ * Geometry is read once per mesh. Moving an object only needs setTransform() and
+ * commit(), which refits the top level of the BVH.
+ *
+ * Only triangles and polygons (fan triangulated) are picked. Displacement, hair, volumes
+ * and other primitives Octane renders are not mirrored.
+ */
+class ScenePickerSdk {
+public:
+    struct Stats {
+        uint64_t picks = 0;
+        uint64_t hits = 0;
+        double totalPickMs = 0.0;
+        double maxPickMs = 0.0;
+    };
+
+    /**
+     * @param threadCount   threads for BVH builds, 0 uses all hardware threads
+     */
+    explicit ScenePickerSdk(unsigned threadCount = 0);
+
+    /**
+     * @brief Camera the pixel coordinates of pick() refer to. fovDegrees is horizontal by
+     * default, like the field of view pin of Octane's thin lens camera.
+     */
+    void setCamera(const OctaneVec::float_3& position,
+                   const OctaneVec::float_3& target,
+                   const OctaneVec::float_3& up,
+                   float fovDegrees,
+                   uint32_t width,
+                   uint32_t height,
+                   bool horizontalFov = true);
+
+    /**
+     * @brief Add a polygon mesh, returns its instance. polyMaterialIndices is optional,
+     * one per polygon.
+     */
+    uint32_t addPolygonMesh(const std::vector<OctaneVec::float_3>& vertices,
+                            const std::vector<uint32_t>& verticesPerPoly,
+                            const std::vector<uint32_t>& polyVertexIndices,
+                            const OctaneVec::MatrixF& transform,
+                            const std::vector<uint32_t>& polyMaterialIndices = std::vector<uint32_t>());
+
+    /**
+     * @brief Add a mesh fetched with CameraSyncLiveLink::getMeshData()
+     */
+    uint32_t addLiveLinkMesh(const CameraSyncLiveLink::MeshData& meshData);
+
+#ifdef DO_GRPC_SDK_ENABLED
+    /**
+     * @brief Read vertices, polygons and material indices of a mesh node (one RPC per
+     * attribute) and add it at a transform. Returns BvhHit::INVALID on failure.
+     */
+    uint32_t addMeshNode(const OctaneGRPC::ApiNodeProxy& meshNode, const OctaneVec::MatrixF& transform);
+
+    /**
+     * @brief Read mesh attributes packed through octane_arrays instead of the per element
+     * ApiItem getters, the polygon arrays go straight into buffers reused across meshes.
+     * Null goes back to the getters. arrays must outlive the picker.
+     */
+    void setItemArrays(ItemArraySdk* arrays) { m_itemArrays = arrays; }
+
+    /**
+     * @brief Local version of ApiRenderEngineProxy::pick(). intersections is the first
+     * of intersectionsSize entries, filled front to back. Returns the number of
+     * intersections found.
+     */
+    unsigned int pick(unsigned int x,
+                      unsigned int y,
+                      bool filterDuplicateMaterialPins,
+                      OctaneGRPC::GRPCPickIntersection& intersections,
+                      unsigned int intersectionsSize);
+#endif
+
+    /**
+     * @brief Move an instance, takes effect with the next commit()
+     */
+    void setTransform(uint32_t instance, const OctaneVec::MatrixF& transform);
+
+    /**
+     * @brief Build added meshes and refit moved instances
+     */
+    void commit();
+    void clear();
+
+    /**
+     * @brief Camera ray through a pixel center, y down from the top row
+     */
+    SharedUtils::BvhRay cameraRay(float x, float y) const;
+
+    /**
+     * @brief Hits along the camera ray of a pixel, sorted by depth
+     */
+    size_t pickHits(unsigned int x, unsigned int y, SharedUtils::BvhHit* hits, size_t maxHits);
+
+    SharedUtils::SceneBvh& bvh() { return m_bvh; }
+    const SharedUtils::SceneBvh& bvh() const { return m_bvh; }
+
+    Stats stats() const { return m_stats; }
+    void printSummary(std::ostream& out) const;
+
+private:
+#ifdef DO_GRPC_SDK_ENABLED
+    bool readMeshArrays(const OctaneGRPC::ApiNodeProxy& meshNode, std::vector<OctaneVec::float_3>& vertices);
+#endif
+
+    SharedUtils::SceneBvh m_bvh;
+#ifdef DO_GRPC_SDK_ENABLED
+    std::vector<OctaneGRPC::ApiNodeProxy> m_meshNodes;  // per mesh, null for LiveLink meshes
+    ItemArraySdk* m_itemArrays;
+    std::vector<uint32_t> m_verticesPerPoly;            // of the mesh node being read
+    std::vector<uint32_t> m_polyVertexIndices;
+    std::vector<uint32_t> m_polyMaterialIndices;
+#endif
+
+    OctaneVec::float_3 m_cameraPosition;
+    OctaneVec::float_3 m_cameraForward;
+    OctaneVec::float_3 m_cameraRight;
+    OctaneVec::float_3 m_cameraUp;
+    float m_tanHalfWidth;                   // of the image plane at distance 1
+    float m_tanHalfHeight;
+    uint32_t m_width;
+    uint32_t m_height;
+
+    Stats m_stats;
+};
+
+#endif // SCENE_PICKER_SDK_H
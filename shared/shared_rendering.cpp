@@ -1,5 +1,8 @@
 #include "shared_rendering.h"
 
+#include <chrono>
+#include <cstring>
+
 using namespace SharedUtils;
 
 const char* vertexShaderSourceCube = R"(
@@ -420,3 +423,497 @@ bool  RendererGl::GLCheckErrors(const char* file, int line)
     }
     return ret;
 }
+
+//--------------------------------------------------------------------------------
+
+StreamingTextureUploader::StreamingTextureUploader(unsigned ringSize)
+    : mSlots(ringSize < 2 ? 2 : ringSize)
+{
+}
+
+/**
+    * Create the buffers, needs a current GL context
+    */
+bool StreamingTextureUploader::initialize()
+{
+    if (mInitialized)
+    {
+        return true;
+    }
+    mPersistent = GLEW_ARB_buffer_storage != 0;
+    for (Slot& slot : mSlots)
+    {
+        glGenBuffers(1, &slot.pbo);
+        glGenQueries(1, &slot.timerQuery);
+    }
+    mInitialized = !GL_CHECK_ERROR(__FILE__, __LINE__);
+    std::cout << "StreamingTextureUploader: " << mSlots.size() << " buffers, "
+              << (mPersistent ? "persistent mapping" : "buffer orphaning") << std::endl;
+    return mInitialized;
+}
+
+bool StreamingTextureUploader::glFormatFor(PixelConvert::PixelFormat format, GLenum& internalFormat, GLenum& pixelFormat, GLenum& type)
+{
+    switch (format)
+    {
+    case PixelConvert::PIXEL_FORMAT_LDR_RGBA:        internalFormat = GL_RGBA8;   pixelFormat = GL_RGBA; type = GL_UNSIGNED_BYTE; return true;
+    case PixelConvert::PIXEL_FORMAT_LDR_MONO:        internalFormat = GL_R8;      pixelFormat = GL_RED;  type = GL_UNSIGNED_BYTE; return true;
+    case PixelConvert::PIXEL_FORMAT_LDR_MONO_ALPHA:  internalFormat = GL_RG8;     pixelFormat = GL_RG;   type = GL_UNSIGNED_BYTE; return true;
+    case PixelConvert::PIXEL_FORMAT_HDR_RGBA:        internalFormat = GL_RGBA32F; pixelFormat = GL_RGBA; type = GL_FLOAT;         return true;
+    case PixelConvert::PIXEL_FORMAT_HDR_MONO:        internalFormat = GL_R32F;    pixelFormat = GL_RED;  type = GL_FLOAT;         return true;
+    case PixelConvert::PIXEL_FORMAT_HDR_MONO_ALPHA:  internalFormat = GL_RG32F;   pixelFormat = GL_RG;   type = GL_FLOAT;         return true;
+    case PixelConvert::PIXEL_FORMAT_HALF_RGBA:       internalFormat = GL_RGBA16F; pixelFormat = GL_RGBA; type = GL_HALF_FLOAT;    return true;
+    case PixelConvert::PIXEL_FORMAT_HALF_MONO:       internalFormat = GL_R16F;    pixelFormat = GL_RED;  type = GL_HALF_FLOAT;    return true;
+    case PixelConvert::PIXEL_FORMAT_HALF_MONO_ALPHA: internalFormat = GL_RG16F;   pixelFormat = GL_RG;   type = GL_HALF_FLOAT;    return true;
+    default:
+        return false;
+    }
+}
+
+void StreamingTextureUploader::ensureTexture(PixelConvert::PixelFormat format, uint32_t width, uint32_t height)
+{
+    mStats.reallocated = false;
+    if (mTexture != 0 && width == mWidth && height == mHeight && format == mFormat)
+    {
+        return;
+    }
+
+    GLenum internalFormat, pixelFormat, type;
+    glFormatFor(format, internalFormat, pixelFormat, type);
+
+    // A new texture instead of respecifying the old one, so the driver doesn't have
+    // to wait for draws that still sample the previous frame. Deletion is deferred
+    // by GL until those are done.
+    if (mTexture != 0)
+    {
+        glDeleteTextures(1, &mTexture);
+    }
+    glGenTextures(1, &mTexture);
+    glBindTexture(GL_TEXTURE_2D, mTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, pixelFormat, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // show mono images as gray instead of red, and use the second channel as alpha
+    const unsigned channels = PixelConvert::channelCount(format);
+    GLint swizzle[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+    if (channels == 1)
+    {
+        swizzle[0] = swizzle[1] = swizzle[2] = GL_RED;
+        swizzle[3] = GL_ONE;
+    }
+    else if (channels == 2)
+    {
+        swizzle[0] = swizzle[1] = swizzle[2] = GL_RED;
+        swizzle[3] = GL_GREEN;
+    }
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    GL_CHECK_ERROR(__FILE__, __LINE__);
+
+    std::cout << "StreamingTextureUploader: texture " << width << "x" << height << ", format " << format << std::endl;
+    mWidth = width;
+    mHeight = height;
+    mFormat = format;
+    mStats.reallocated = true;
+}
+
+void StreamingTextureUploader::waitForSlot(Slot& slot)
+{
+    if (!slot.fence)
+    {
+        return;
+    }
+    // with a ring of 3 the transfer from two frames ago is normally long done
+    GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (result == GL_TIMEOUT_EXPIRED)
+    {
+        result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+}
+
+void* StreamingTextureUploader::mapSlot(Slot& slot, size_t bytes)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+
+    if (!mPersistent)
+    {
+        // orphan the old storage, the driver hands out a fresh block if the GPU still reads it
+        if (bytes > slot.capacity)
+        {
+            slot.capacity = bytes;
+        }
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, slot.capacity, nullptr, GL_STREAM_DRAW);
+        return glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    }
+
+    waitForSlot(slot);
+    if (bytes > slot.capacity)
+    {
+        // buffer storage is immutable, grow by recreating the buffer
+        if (slot.mapped)
+        {
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            slot.mapped = nullptr;
+        }
+        glDeleteBuffers(1, &slot.pbo);
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, flags);
+        slot.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, flags);
+        slot.capacity = slot.mapped ? bytes : 0;
+    }
+    return slot.mapped;
+}
+
+void StreamingTextureUploader::collectGpuTime(Slot& slot)
+{
+    if (!slot.queryPending)
+    {
+        return;
+    }
+    GLint available = 0;
+    glGetQueryObjectiv(slot.timerQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available)
+    {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(slot.timerQuery, GL_QUERY_RESULT, &elapsed);
+        mStats.gpuMs = elapsed / 1.0e6;
+    }
+    slot.queryPending = false;
+}
+
+/**
+    * Upload a frame through the next buffer of the ring
+    */
+bool StreamingTextureUploader::upload(PixelConvert::PixelFormat format, const void* pixels, uint32_t width, uint32_t height, size_t srcPitch)
+{
+    GLenum internalFormat, pixelFormat, type;
+    if (!mInitialized || !pixels || width == 0 || height == 0 ||
+        !glFormatFor(format, internalFormat, pixelFormat, type))
+    {
+        return false;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const size_t rowBytes = (size_t)width * PixelConvert::bytesPerPixel(format);
+    const size_t bytes = rowBytes * height;
+    ensureTexture(format, width, height);
+
+    Slot& slot = mSlots[mNextSlot];
+    mNextSlot = (mNextSlot + 1) % mSlots.size();
+    collectGpuTime(slot);
+
+    uint8_t* dst = (uint8_t*)mapSlot(slot, bytes);
+    if (!dst)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        GL_CHECK_ERROR(__FILE__, __LINE__);
+        return false;
+    }
+
+    // pack the rows tightly while copying
+    const uint8_t* src = (const uint8_t*)pixels;
+    if (srcPitch == rowBytes)
+    {
+        std::memcpy(dst, src, bytes);
+    }
+    else
+    {
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            std::memcpy(dst + y * rowBytes, src + y * srcPitch, rowBytes);
+        }
+    }
+
+    if (!mPersistent)
+    {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    // sources from the bound buffer, returns before the transfer is done
+    glBindTexture(GL_TEXTURE_2D, mTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBeginQuery(GL_TIME_ELAPSED, slot.timerQuery);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, pixelFormat, type, nullptr);
+    glEndQuery(GL_TIME_ELAPSED);
+    slot.queryPending = true;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (mPersistent)
+    {
+        // the buffer may be written again once the GPU passed this point
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    mStats.cpuMs = std::chrono::duration<double, std::milli>(end - start).count();
+    mStats.bytes = bytes;
+    ++mStats.frames;
+
+    return !GL_CHECK_ERROR(__FILE__, __LINE__);
+}
+
+/**
+    * Release all GL objects
+    */
+void StreamingTextureUploader::cleanup()
+{
+    if (!mInitialized)
+    {
+        return;
+    }
+    for (Slot& slot : mSlots)
+    {
+        if (slot.fence)
+        {
+            glDeleteSync(slot.fence);
+            slot.fence = 0;
+        }
+        if (slot.mapped)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            slot.mapped = nullptr;
+        }
+        glDeleteBuffers(1, &slot.pbo);
+        glDeleteQueries(1, &slot.timerQuery);
+        slot = Slot();
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (mTexture != 0)
+    {
+        glDeleteTextures(1, &mTexture);
+        mTexture = 0;
+    }
+    mWidth = mHeight = 0;
+    mInitialized = false;
+}
+
+//--------------------------------------------------------------------------------
+
+namespace {
+
+    const char* vertexShaderSourceDisplay = R"(
+    #version 330 core
+
+    out vec2 uv;
+
+    void main() {
+        // one triangle covering the viewport, no vertex buffer
+        vec2 pos = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);
+        uv = vec2(pos.x * 0.5 + 0.5, 0.5 - pos.y * 0.5);
+        gl_Position = vec4(pos, 0.0, 1.0);
+    }
+    )";
+
+    // Mirrors applyDisplayTransform in display_lut.cpp
+    const char* fragmentShaderSourceDisplay = R"(
+    #version 330 core
+
+    in vec2 uv;
+    uniform sampler2D hdr;
+    uniform sampler3D lut;
+    uniform float exposure;
+    uniform int toneCurve;
+    uniform bool log2Shaper;
+    uniform vec2 domain;
+    uniform float lutSize;
+
+    out vec4 frag_color;
+
+    vec3 applyToneCurve(vec3 x) {
+        x = clamp(x, 0.0, 65504.0);
+        if (toneCurve == 1) {
+            return x / (1.0 + x);
+        }
+        if (toneCurve == 2) {
+            return min((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 1.0);
+        }
+        return x;
+    }
+
+    void main() {
+        vec4 color = texture(hdr, uv);
+        vec3 v = applyToneCurve(color.rgb * exposure);
+        if (log2Shaper) {
+            v = log2(max(v / 0.18, 1e-10));
+        }
+        vec3 t = clamp((v - domain.x) / (domain.y - domain.x), 0.0, 1.0);
+        // texel centers, so the filter interpolates between the grid points
+        vec3 coord = (t * (lutSize - 1.0) + 0.5) / lutSize;
+        frag_color = vec4(clamp(texture(lut, coord).rgb, 0.0, 1.0), clamp(color.a, 0.0, 1.0));
+    }
+    )";
+
+    GLuint compileDisplayShader(GLenum type, const char* source)
+    {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+
+        GLint success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            char infoLog[512];
+            glGetShaderInfoLog(shader, 512, NULL, infoLog);
+            std::cerr << "Shader compilation failed: " << infoLog << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+
+}
+
+bool DisplayTransformGl::initialize()
+{
+    if (mProgram != 0)
+    {
+        return true;
+    }
+
+    GLuint vertexShader = compileDisplayShader(GL_VERTEX_SHADER, vertexShaderSourceDisplay);
+    GLuint fragmentShader = compileDisplayShader(GL_FRAGMENT_SHADER, fragmentShaderSourceDisplay);
+    if (vertexShader == 0 || fragmentShader == 0)
+    {
+        std::cerr << "Failed to compile display transform shaders" << std::endl;
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return false;
+    }
+
+    mProgram = glCreateProgram();
+    glAttachShader(mProgram, vertexShader);
+    glAttachShader(mProgram, fragmentShader);
+    glLinkProgram(mProgram);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint success;
+    glGetProgramiv(mProgram, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[512];
+        glGetProgramInfoLog(mProgram, 512, NULL, infoLog);
+        std::cerr << "Display transform program linking failed: " << infoLog << std::endl;
+        cleanup();
+        return false;
+    }
+
+    mHdrLoc = glGetUniformLocation(mProgram, "hdr");
+    mLutLoc = glGetUniformLocation(mProgram, "lut");
+    mExposureLoc = glGetUniformLocation(mProgram, "exposure");
+    mToneCurveLoc = glGetUniformLocation(mProgram, "toneCurve");
+    mLog2ShaperLoc = glGetUniformLocation(mProgram, "log2Shaper");
+    mDomainLoc = glGetUniformLocation(mProgram, "domain");
+    mLutSizeLoc = glGetUniformLocation(mProgram, "lutSize");
+
+    // core profile draws need a bound VAO even without attributes
+    glGenVertexArrays(1, &mVAO);
+
+    glGenTextures(1, &mLutTexture);
+    glBindTexture(GL_TEXTURE_3D, mLutTexture);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    if (!mDefaultLut)
+    {
+        mDefaultLut = DisplayLut3D::srgbDisplay();
+    }
+    mUploadedLut = nullptr;
+    GL_CHECK_ERROR(__FILE__, __LINE__);
+    return true;
+}
+
+void DisplayTransformGl::setLut(std::shared_ptr<const DisplayLut3D> lut)
+{
+    mLut = std::move(lut);
+}
+
+void DisplayTransformGl::uploadLut(const DisplayLut3D& lut)
+{
+    const GLsizei size = (GLsizei)lut.size();
+    glBindTexture(GL_TEXTURE_3D, mLutTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB32F, size, size, size, 0, GL_RGB, GL_FLOAT, lut.data().data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+    GL_CHECK_ERROR(__FILE__, __LINE__);
+    mUploadedLut = &lut;
+    ++mLutUploads;
+}
+
+void DisplayTransformGl::render(GLuint hdrTexture, const DisplaySettings& settings)
+{
+    if (mProgram == 0 || hdrTexture == 0)
+    {
+        return;
+    }
+
+    const DisplayLut3D& lut = mLut && mLut->size() >= 2 ? *mLut : *mDefaultLut;
+    if (mUploadedLut != &lut)
+    {
+        uploadLut(lut);
+    }
+
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(mProgram);
+    glUniform1i(mHdrLoc, 0);
+    glUniform1i(mLutLoc, 1);
+    glUniform1f(mExposureLoc, settings.exposureScale());
+    glUniform1i(mToneCurveLoc, (GLint)settings.toneCurve);
+    glUniform1i(mLog2ShaperLoc, lut.shaper() == DisplayLut3D::SHAPER_LOG2 ? 1 : 0);
+    glUniform2f(mDomainLoc, lut.domainMin(), lut.domainMax());
+    glUniform1f(mLutSizeLoc, (float)lut.size());
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, mLutTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+
+    glBindVertexArray(mVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    GL_CHECK_ERROR(__FILE__, __LINE__);
+}
+
+void DisplayTransformGl::cleanup()
+{
+    if (mProgram != 0)
+    {
+        glDeleteProgram(mProgram);
+        mProgram = 0;
+    }
+    if (mVAO != 0)
+    {
+        glDeleteVertexArrays(1, &mVAO);
+        mVAO = 0;
+    }
+    if (mLutTexture != 0)
+    {
+        glDeleteTextures(1, &mLutTexture);
+        mLutTexture = 0;
+    }
+    mUploadedLut = nullptr;
+}
@@ -5,8 +5,12 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <memory>
 #include <vector>
 
+#include "display_lut.h"
+#include "pixel_convert.h"
+
 namespace SharedUtils {
 
 #define GL_CHECK_ERROR(file, line)	SharedUtils::RendererGl::GLCheckErrors(file, line)
@@ -245,4 +249,153 @@ namespace SharedUtils {
         }
     };
 
+
+    /**
+     * Streams CPU images into a GL texture through a ring of pixel unpack buffers.
+     * The pixels are copied into one buffer while the GPU still transfers the previous
+     * frames from the others, and glTexSubImage2D returns without waiting for the copy.
+     * Uses persistently mapped buffers with fences when ARB_buffer_storage is available,
+     * otherwise orphans and remaps the buffer each frame.
+     */
+    class StreamingTextureUploader {
+    public:
+        /**
+         * Timings of the last upload
+         */
+        struct Stats
+        {
+            double cpuMs = 0.0;         // fence wait, copy into the buffer and texture update call
+            double gpuMs = -1.0;        // GPU transfer time of an earlier frame, -1 until known
+            size_t bytes = 0;
+            bool reallocated = false;   // texture storage was recreated for a new size or format
+            uint64_t frames = 0;
+        };
+
+        explicit StreamingTextureUploader(unsigned ringSize = 3);
+
+        ~StreamingTextureUploader() {
+            cleanup();
+        }
+
+        /**
+         * Create the buffers, needs a current GL context
+         */
+        bool initialize();
+
+        /**
+         * Upload a frame. srcPitch is in bytes, mono formats are shown as gray.
+         * Returns false for formats without a GL equivalent.
+         */
+        bool upload(PixelConvert::PixelFormat format, const void* pixels, uint32_t width, uint32_t height, size_t srcPitch);
+
+        /**
+         * Release all GL objects
+         */
+        void cleanup();
+
+        /**
+         * Texture holding the last uploaded frame, 0 before the first upload
+         */
+        GLuint texture() const { return mTexture; }
+
+        bool isPersistent() const { return mPersistent; }
+
+        const Stats& lastStats() const { return mStats; }
+
+        /**
+         * GL formats for an Octane image format. Returns false if there is none.
+         */
+        static bool glFormatFor(PixelConvert::PixelFormat format, GLenum& internalFormat, GLenum& pixelFormat, GLenum& type);
+
+    private:
+        struct Slot
+        {
+            GLuint pbo = 0;
+            void* mapped = nullptr;     // persistent mapping, null in orphaning mode
+            size_t capacity = 0;
+            GLsync fence = 0;
+            GLuint timerQuery = 0;
+            bool queryPending = false;
+        };
+
+        void ensureTexture(PixelConvert::PixelFormat format, uint32_t width, uint32_t height);
+        void* mapSlot(Slot& slot, size_t bytes);
+        void waitForSlot(Slot& slot);
+        void collectGpuTime(Slot& slot);
+
+        std::vector<Slot> mSlots;
+        unsigned mNextSlot = 0;
+        bool mPersistent = false;
+        bool mInitialized = false;
+
+        GLuint mTexture = 0;
+        uint32_t mWidth = 0;
+        uint32_t mHeight = 0;
+        PixelConvert::PixelFormat mFormat = PixelConvert::PIXEL_FORMAT_LDR_RGBA;
+
+        Stats mStats;
+    };
+
+    /**
+     * GL version of applyDisplayTransform: draws an HDR texture into the current
+     * framebuffer with exposure, tone curve and a 3D LUT texture in the fragment shader.
+     * The LUT is only uploaded when it changes, so scrubbing the exposure or switching
+     * the curve just sets uniforms. The hardware trilinear filter on the LUT texture
+     * matches the CPU path.
+     */
+    class DisplayTransformGl {
+    public:
+        DisplayTransformGl() = default;
+
+        ~DisplayTransformGl() {
+            cleanup();
+        }
+
+        /**
+         * Compile the shader and create the default sRGB LUT, needs a current GL context
+         */
+        bool initialize();
+
+        /**
+         * LUT for the following draws, null for the sRGB display encoding
+         */
+        void setLut(std::shared_ptr<const DisplayLut3D> lut);
+
+        /**
+         * Draw hdrTexture over the whole viewport. Row 0 of the texture is at the top,
+         * like RendererGl::renderQuad.
+         */
+        void render(GLuint hdrTexture, const DisplaySettings& settings);
+
+        /**
+         * Release all GL objects
+         */
+        void cleanup();
+
+        /**
+         * Number of LUT uploads so far
+         */
+        uint64_t lutUploads() const { return mLutUploads; }
+
+    private:
+        void uploadLut(const DisplayLut3D& lut);
+
+        GLuint mProgram = 0;
+        GLuint mVAO = 0;
+        GLuint mLutTexture = 0;
+
+        GLint mHdrLoc = -1;
+        GLint mLutLoc = -1;
+        GLint mExposureLoc = -1;
+        GLint mToneCurveLoc = -1;
+        GLint mLog2ShaperLoc = -1;
+        GLint mDomainLoc = -1;
+        GLint mLutSizeLoc = -1;
+
+        std::shared_ptr<const DisplayLut3D> mDefaultLut;
+        std::shared_ptr<const DisplayLut3D> mLut;
+        const DisplayLut3D* mUploadedLut = nullptr;
+        uint64_t mLutUploads = 0;
+    };
+
 };
\ No newline at end of file
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SharedUtils {
+
+    /**
+     * Small fixed-size worker pool for the sample applications.
+     * Used for data parallel work (parallelFor) and for fire-and-forget tasks (submit).
+     */
+    class ThreadPool {
+    public:
+        /**
+         * Create the pool. A thread count of 0 uses one worker per hardware thread,
+         * minus the calling thread which also takes part in parallelFor().
+         */
+        explicit ThreadPool(unsigned threadCount = 0)
+        {
+            if (threadCount == 0)
+            {
+                unsigned hw = std::thread::hardware_concurrency();
+                threadCount = hw > 1 ? hw - 1 : 1;
+            }
+            mWorkers.reserve(threadCount);
+            for (unsigned i = 0; i < threadCount; ++i)
+            {
+                mWorkers.emplace_back([this]() { workerLoop(); });
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStopping = true;
+            }
+            mCondition.notify_all();
+            for (std::thread& worker : mWorkers)
+            {
+                if (worker.joinable())
+                {
+                    worker.join();
+                }
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * Number of worker threads, not counting the caller
+         */
+        unsigned threadCount() const { return static_cast<unsigned>(mWorkers.size()); }
+
+        /**
+         * Queue a task for any worker. Tasks still queued on destruction are run before the workers exit.
+         */
+        void submit(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mTasks.push_back(std::move(task));
+            }
+            mCondition.notify_one();
+        }
+
+        /**
+         * Split [0, count) into contiguous ranges of at least minChunk items and call
+         * fn(begin, end) for each of them. The calling thread works on the first range
+         * and returns once all ranges are done.
+         */
+        void parallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& fn)
+        {
+            if (count == 0)
+            {
+                return;
+            }
+            minChunk = std::max<size_t>(minChunk, 1);
+            size_t chunks = std::min<size_t>(mWorkers.size() + 1, (count + minChunk - 1) / minChunk);
+            if (chunks <= 1)
+            {
+                fn(0, count);
+                return;
+            }
+
+            struct Batch {
+                std::mutex mutex;
+                std::condition_variable done;
+                size_t remaining;
+            } batch;
+            batch.remaining = chunks - 1;
+
+            const size_t chunkSize = (count + chunks - 1) / chunks;
+            for (size_t c = 1; c < chunks; ++c)
+            {
+                const size_t begin = c * chunkSize;
+                const size_t end = std::min(count, begin + chunkSize);
+                submit([&fn, &batch, begin, end]() {
+                    if (begin < end)
+                    {
+                        fn(begin, end);
+                    }
+                    std::lock_guard<std::mutex> lock(batch.mutex);
+                    if (--batch.remaining == 0)
+                    {
+                        batch.done.notify_one();
+                    }
+                });
+            }
+
+            fn(0, std::min(count, chunkSize));
+
+            std::unique_lock<std::mutex> lock(batch.mutex);
+            batch.done.wait(lock, [&batch]() { return batch.remaining == 0; });
+        }
+
+    private:
+        void workerLoop()
+        {
+            for (;;)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+                    if (mTasks.empty())
+                    {
+                        return;
+                    }
+                    task = std::move(mTasks.front());
+                    mTasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::vector<std::thread> mWorkers;
+        std::deque<std::function<void()>> mTasks;
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        bool mStopping = false;
+    };
+
+};
@@ -0,0 +1,278 @@
+#include "thumbnail_cache.h"
+#include "mapped_file.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+namespace SharedUtils {
+
+    namespace {
+
+        const char FILE_MAGIC[8] = { 'O', 'C', 'T', 'T', 'H', 'M', 'B', '1' };
+        const uint32_t RECORD_MAGIC = 0x424d4854;      // "THMB"
+
+        struct RecordHeader
+        {
+            uint32_t magic;
+            uint32_t format;
+            uint64_t key;
+            uint32_t width;
+            uint32_t height;
+            uint64_t bytes;
+        };
+        static_assert(sizeof(RecordHeader) == 32, "record header layout is part of the file format");
+
+        // pixels start 8 byte aligned, float formats can be used straight from the mapping
+        uint64_t paddedSize(uint64_t bytes)
+        {
+            return (bytes + 7) & ~uint64_t(7);
+        }
+
+        bool validRecord(const RecordHeader& header)
+        {
+            return header.magic == RECORD_MAGIC &&
+                   header.format <= PixelConvert::PIXEL_FORMAT_HALF_MONO_ALPHA &&
+                   header.bytes == (uint64_t)header.width * header.height *
+                                   PixelConvert::bytesPerPixel((PixelConvert::PixelFormat)header.format);
+        }
+
+        bool writeEmptyFile(const std::string& path)
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+            return (bool)file;
+        }
+
+        // end of the last complete record, 0 if the file isn't a cache file
+        uint64_t validFileSize(const std::string& path, uint64_t fileSize)
+        {
+            std::ifstream file(path, std::ios::binary);
+            char magic[sizeof(FILE_MAGIC)];
+            if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0)
+            {
+                return 0;
+            }
+            uint64_t offset = sizeof(FILE_MAGIC);
+            RecordHeader header;
+            while (offset + sizeof(header) <= fileSize)
+            {
+                file.seekg((std::streamoff)offset);
+                if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !validRecord(header))
+                {
+                    break;
+                }
+                const uint64_t end = offset + sizeof(header) + paddedSize(header.bytes);
+                if (end > fileSize)
+                {
+                    break;
+                }
+                offset = end;
+            }
+            return offset;
+        }
+
+    }
+
+    void KeyHasher::add(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            mHash = (mHash ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+
+    void KeyHasher::add(const std::string& value)
+    {
+        // length first, so ("ab", "c") and ("a", "bc") differ
+        addValue((uint64_t)value.size());
+        add(value.data(), value.size());
+    }
+
+    ThumbnailCache::ThumbnailCache() = default;
+
+    ThumbnailCache::~ThumbnailCache() = default;
+
+    bool ThumbnailCache::open(const std::string& path)
+    {
+        close();
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        std::error_code error;
+        const std::filesystem::path filePath(path);
+        if (filePath.has_parent_path())
+        {
+            std::filesystem::create_directories(filePath.parent_path(), error);
+        }
+
+        const uint64_t fileSize = std::filesystem::exists(filePath, error) ? std::filesystem::file_size(filePath, error) : 0;
+        const uint64_t validSize = fileSize > 0 ? validFileSize(path, fileSize) : 0;
+        if (validSize == 0)
+        {
+            if (!writeEmptyFile(path))
+            {
+                std::cerr << "ThumbnailCache: can't create " << path << ", caching in memory only" << std::endl;
+                return false;
+            }
+        }
+        else if (validSize < fileSize)
+        {
+            std::filesystem::resize_file(filePath, validSize, error);
+            if (error)
+            {
+                std::cerr << "ThumbnailCache: can't repair " << path << ": " << error.message() << std::endl;
+                return false;
+            }
+        }
+        mPath = path;
+
+        if (validSize > sizeof(FILE_MAGIC))
+        {
+            std::unique_ptr<MappedFile> mapping(new MappedFile());
+            if (!mapping->map(path, (size_t)validSize))
+            {
+                std::cerr << "ThumbnailCache: can't map " << path << ", cached entries are not used" << std::endl;
+                return true;
+            }
+            // the headers were validated by validFileSize()
+            size_t offset = sizeof(FILE_MAGIC);
+            while (offset + sizeof(RecordHeader) <= mapping->size())
+            {
+                RecordHeader header;
+                std::memcpy(&header, mapping->data() + offset, sizeof(header));
+                Thumbnail thumbnail;
+                thumbnail.format = (PixelConvert::PixelFormat)header.format;
+                thumbnail.width = header.width;
+                thumbnail.height = header.height;
+                thumbnail.pixels = mapping->data() + offset + sizeof(header);
+                thumbnail.bytes = (size_t)header.bytes;
+                // later records replace earlier ones with the same key
+                mEntries[header.key] = thumbnail;
+                offset += sizeof(header) + (size_t)paddedSize(header.bytes);
+            }
+            mStats.mappedEntries = mEntries.size();
+            mStats.mappedBytes = mapping->size();
+            mMapping = std::move(mapping);
+        }
+        return true;
+    }
+
+    void ThumbnailCache::close()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEntries.clear();
+        mOwnedPixels.clear();
+        mMapping.reset();
+        mPath.clear();
+        mStats = Stats();
+    }
+
+    bool ThumbnailCache::isOpen() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return !mPath.empty();
+    }
+
+    bool ThumbnailCache::find(uint64_t key, Thumbnail& thumbnail)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const auto it = mEntries.find(key);
+        if (it == mEntries.end())
+        {
+            ++mStats.misses;
+            return false;
+        }
+        ++mStats.hits;
+        thumbnail = it->second;
+        return true;
+    }
+
+    bool ThumbnailCache::contains(uint64_t key) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEntries.find(key) != mEntries.end();
+    }
+
+    Thumbnail ThumbnailCache::insert(uint64_t key, PixelConvert::PixelFormat format, uint32_t width, uint32_t height,
+                                     const void* pixels)
+    {
+        Thumbnail thumbnail;
+        thumbnail.format = format;
+        thumbnail.width = width;
+        thumbnail.height = height;
+        thumbnail.bytes = (size_t)width * height * PixelConvert::bytesPerPixel(format);
+
+        // copy outside the lock, thumbnails of a browser are inserted from several threads
+        std::unique_ptr<uint8_t[]> copy(new uint8_t[thumbnail.bytes > 0 ? thumbnail.bytes : 1]);
+        std::memcpy(copy.get(), pixels, thumbnail.bytes);
+        thumbnail.pixels = copy.get();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mOwnedPixels.push_back(std::move(copy));
+        mEntries[key] = thumbnail;
+        ++mStats.newEntries;
+        if (!mPath.empty())
+        {
+            appendRecord(key, thumbnail);
+        }
+        return thumbnail;
+    }
+
+    void ThumbnailCache::appendRecord(uint64_t key, const Thumbnail& thumbnail)
+    {
+        FILE* file = std::fopen(mPath.c_str(), "ab");
+        if (!file)
+        {
+            ++mStats.failedWrites;
+            return;
+        }
+        RecordHeader header;
+        header.magic = RECORD_MAGIC;
+        header.format = (uint32_t)thumbnail.format;
+        header.key = key;
+        header.width = thumbnail.width;
+        header.height = thumbnail.height;
+        header.bytes = thumbnail.bytes;
+        const uint64_t padding = paddedSize(header.bytes) - header.bytes;
+        const uint8_t zeros[8] = {};
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        ok = ok && std::fwrite(thumbnail.pixels, 1, thumbnail.bytes, file) == thumbnail.bytes;
+        ok = ok && std::fwrite(zeros, 1, (size_t)padding, file) == padding;
+        // a partial record is cut off by the next open()
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok)
+        {
+            ++mStats.failedWrites;
+        }
+    }
+
+    void ThumbnailCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEntries.clear();
+        mOwnedPixels.clear();
+        mMapping.reset();
+        mStats = Stats();
+        if (!mPath.empty() && !writeEmptyFile(mPath))
+        {
+            ++mStats.failedWrites;
+        }
+    }
+
+    size_t ThumbnailCache::size() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEntries.size();
+    }
+
+    ThumbnailCache::Stats ThumbnailCache::stats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+} // namespace SharedUtils
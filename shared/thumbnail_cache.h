@@ -0,0 +1,116 @@
+#pragma once
+
+#include "pixel_convert.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SharedUtils {
+
+    class MappedFile;
+
+    /**
+     * 64 bit FNV-1a, for building cache keys out of many small values
+     */
+    class KeyHasher
+    {
+    public:
+        void add(const void* data, size_t size);
+        void add(const std::string& value);
+
+        template <typename T>
+        void addValue(const T& value) { add(&value, sizeof(value)); }
+
+        uint64_t value() const { return mHash; }
+
+    private:
+        uint64_t mHash = 14695981039346656037ull;
+    };
+
+    /**
+     * Image stored in a ThumbnailCache. The pixels stay valid until the cache is cleared or
+     * closed, entries are never modified, not even by a newer entry with the same key.
+     */
+    struct Thumbnail
+    {
+        PixelConvert::PixelFormat format = PixelConvert::PIXEL_FORMAT_LDR_RGBA;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        const uint8_t* pixels = nullptr;    // tightly packed rows, top row first
+        size_t bytes = 0;
+    };
+
+    /**
+     * Small images by 64 bit key, persisted in a single file that is memory mapped when the
+     * cache is opened.
+     *
+     * Entries of earlier runs are served straight from the mapping, so opening a cache with
+     * thousands of thumbnails only reads their headers and a lookup never copies pixels.
+     * New entries are kept in memory and appended to the file, they are mapped the next
+     * time the cache is opened. A torn record at the end, from a crash during an append,
+     * is cut off when opening.
+     *
+     * The file only grows; clear() starts over. All methods are thread safe.
+     */
+    class ThumbnailCache
+    {
+    public:
+        struct Stats
+        {
+            size_t mappedEntries = 0;       // found in the file when it was opened
+            size_t newEntries = 0;
+            size_t mappedBytes = 0;
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t failedWrites = 0;
+        };
+
+        ThumbnailCache();
+        ~ThumbnailCache();
+
+        ThumbnailCache(const ThumbnailCache&) = delete;
+        ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+        /**
+         * Open or create the cache file. Without a file the cache only lives in memory.
+         * Returns false if the file can't be created, the cache is usable in memory then.
+         */
+        bool open(const std::string& path);
+        void close();
+        bool isOpen() const;
+
+        bool find(uint64_t key, Thumbnail& thumbnail);
+        bool contains(uint64_t key) const;
+
+        /**
+         * Add an image, pixels are tightly packed rows of the format. The returned
+         * thumbnail points to the cache's copy.
+         */
+        Thumbnail insert(uint64_t key, PixelConvert::PixelFormat format, uint32_t width, uint32_t height,
+                         const void* pixels);
+
+        /**
+         * Drop all entries and delete the file contents
+         */
+        void clear();
+
+        size_t size() const;
+        Stats stats() const;
+
+    private:
+        void appendRecord(uint64_t key, const Thumbnail& thumbnail);
+
+        mutable std::mutex mMutex;
+        std::string mPath;
+        std::unique_ptr<MappedFile> mMapping;
+        std::unordered_map<uint64_t, Thumbnail> mEntries;
+        std::vector<std::unique_ptr<uint8_t[]>> mOwnedPixels;
+        Stats mStats;
+    };
+
+} // namespace SharedUtils
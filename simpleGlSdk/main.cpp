@@ -8,18 +8,33 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <iomanip>
 #include <cmath>
 #include <mutex>
 #include <atomic>
 #include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <string>
 
 #include "shared_rendering.h"
+#include "../shared/frame_mailbox.h"
+#include "../shared/pixel_convert.h"
 #include "../shared/camera_system.h"
 #include "../shared/model_manager.h"
 
 // SDK integration (using actual SDK calls)
 #include "../shared/camera_sync_livelink.h"
 #include "../shared/camera_sync_sdk.h"
+#include "../shared/aov_capture_sdk.h"
+#include "../shared/render_stats_recorder_sdk.h"
+#include "../shared/ocio_display_sdk.h"
+#include "../shared/convergence_monitor_sdk.h"
+#include "../shared/dynamic_resolution_sdk.h"
+#include "../shared/cryptomatte_picker_sdk.h"
+#include "../shared/camera_latency_sdk.h"
+#include "../shared/image_waiter_sdk.h"
 
 #ifdef DO_GRPC_SDK_ENABLED
 #include "grpcsettings.h"
@@ -53,6 +68,8 @@ SharedUtils::RendererGl renderer;
 CameraSyncSdk cameraSync;
 //CameraSyncLiveLink cameraSync; 
 GLuint mTextureNameGL = 0;
+// Streams CPU render images into a texture for the callback and grab paths
+SharedUtils::StreamingTextureUploader g_textureUploader;
 bool showTestQuad = false;
 
 // Rendering mode enumeration
@@ -63,13 +80,57 @@ enum RenderMode {
 
 // Global variables for callback-based rendering
 #ifdef DO_GRPC_SDK_ENABLED
-std::mutex g_renderImageMutex;
-std::vector<Octane::ApiRenderImage> g_latestRenderImages;
-bool g_hasNewRenderData = false;
-bool g_hasSharedSurfaceData = false;
+// Render image handed from the callback thread to the render loop. The callback
+// service allocates mBuffer per image and leaves it to the receiver, so the slot
+// owns it and frees it when the slot is reused. Images that are not 8-bit RGBA are
+// converted into pixels by prepareFrame() and image.mBuffer points there.
+struct CallbackFrame {
+    Octane::ApiRenderImage image;
+    std::unique_ptr<const char[]> buffer;
+    std::vector<uint8_t> pixels;
+    uint64_t cameraSequence = 0;            // camera update the image answers, see g_cameraLatency
+};
+SharedUtils::FrameMailbox<CallbackFrame> g_renderFrames;
+std::atomic<bool> g_hasSharedSurfaceData{false};
 std::atomic<int> g_callbackCount{0};
 bool g_callbackRegistered = false;
 RenderMode g_renderMode = RENDER_MODE_CALLBACK;
+// Writes all enabled render passes to the working directory, created on the first capture
+std::unique_ptr<AovCaptureSdk> g_aovCapture;
+// Time series of the render statistics, exported to render_stats.csv on exit.
+// Polls as well, the statistics callback is only sent to module SDK clients.
+RenderStatsRecorderSdk g_renderStats(4096, std::chrono::milliseconds(250));
+// Client side display transform (E toggles): Octane sends linear HDR frames and the
+// exposure (+/-), tone curve (T) and OCIO view LUT (V) are applied here, so changing
+// them needs no round trip. Drawn by the GL shader, or on the callback thread by the
+// CPU path if the shader is not available.
+OcioDisplaySdk g_ocioDisplay;
+SharedUtils::DisplayTransformGl g_displayTransformGl;
+std::atomic<bool> g_displayTransformGlReady{false};
+std::atomic<bool> g_clientDisplay{false};
+std::mutex g_displayMutex;
+SharedUtils::DisplaySettings g_displaySettings;
+std::shared_ptr<const SharedUtils::DisplayLut3D> g_displayLut;
+size_t g_displayViewIndex = 0;
+// the uploaded texture holds linear HDR data for the display transform
+bool g_showingHdrFrame = false;
+// Pauses the render once successive frames stop changing (M toggles), the tile error
+// map of the last comparison is written to convergence_tiles.exr on exit
+ConvergenceMonitorSdk g_convergence;
+std::atomic<bool> g_convergenceEnabled{false};
+// Sub-samples the render while the camera moves and restores full resolution once it
+// stops (D toggles), the display quad scales the smaller frames to the window
+DynamicResolutionSdk g_dynamicResolution;
+// Highlights the matte under the cursor from a local copy of the cryptomatte pass
+// (K toggles), hovering costs no round trip to Octane
+CryptomattePickerSdk g_cryptomattePicker;
+std::vector<uint8_t> g_highlightPixels;
+std::vector<uint8_t> g_highlightMask;
+// Camera change to frame on screen, percentiles printed on exit and shown in the window
+// title (H toggles)
+CameraLatencySdk g_cameraLatency;
+// Long poll of octane_imagewait, feeds the display when the callback can't be registered
+ImageWaiterSdk g_imageWaiter;
 #endif
 
 // Windows-specific shared surface variables
@@ -175,90 +236,62 @@ void setupTexture(const ApiRenderImage& image)
 #endif
         if (image.mBuffer)
         {
-            std::cout << " Processing new render data..." << std::endl;
-            std::cout << "   Image: " << image.mSize.x << "x" << image.mSize.y 
-                      << ", Type: " << image.mType << std::endl;
-            
-            // Determine OpenGL format and type based on Octane image type
-            GLenum internalFormat = GL_RGBA8;
-            GLenum format = GL_RGBA;
-            GLenum type = GL_UNSIGNED_BYTE;
-            
-            switch (image.mType)
-            {
-            case Octane::IMAGE_TYPE_LDR_MONO:
-                internalFormat = GL_R8;
-                format = GL_RED;
-                type = GL_UNSIGNED_BYTE;
-                break;
-            case Octane::IMAGE_TYPE_HDR_MONO:
-                internalFormat = GL_R32F;
-                format = GL_RED;
-                type = GL_FLOAT;
-                break;
-            case Octane::IMAGE_TYPE_LDR_MONO_ALPHA:
-                internalFormat = GL_RG8;
-                format = GL_RG;
-                type = GL_UNSIGNED_BYTE;
-                break;
-            case Octane::IMAGE_TYPE_HDR_MONO_ALPHA:
-                internalFormat = GL_RG32F;
-                format = GL_RG;
-                type = GL_FLOAT;
-                break;
-            case Octane::IMAGE_TYPE_LDR_RGBA:
-                internalFormat = GL_RGBA8;
-                format = GL_RGBA;
-                type = GL_UNSIGNED_BYTE;
-                break;
-            case Octane::IMAGE_TYPE_HDR_RGBA:
-                internalFormat = GL_RGBA32F;
-                format = GL_RGBA;
-                type = GL_FLOAT;
-                break;
-            default:
-                std::cout << "  Unknown image type " << image.mType << ", using RGBA8" << std::endl;
-                break;
+            // Streamed through the uploader's buffer ring, the copy of this frame overlaps
+            // with the GPU still drawing the previous one. Mono and HDR types keep their format.
+            const auto format = static_cast<SharedUtils::PixelConvert::PixelFormat>(image.mType);
+            const size_t pitchBytes = static_cast<size_t>(image.mPitch) * SharedUtils::PixelConvert::bytesPerPixel(format);
+            if (!g_textureUploader.upload(format, image.mBuffer, image.mSize.x, image.mSize.y, pitchBytes)) {
+                std::cout << " Texture upload failed, image type " << image.mType << std::endl;
+                return;
             }
 
-            const void* bufferData = image.mBuffer;
-            int width = image.mSize.x;
-            int height = image.mSize.y;
-
-            // Recreate texture if dimensions changed
-            static int lastWidth = 0, lastHeight = 0;
-            if (width != lastWidth || height != lastHeight) {
-                std::cout << "   Recreating texture for new dimensions: " << width << "x" << height << std::endl;
-                if (mTextureNameGL != 0) {
-                    glDeleteTextures(1, &mTextureNameGL);
-                }
-                glGenTextures(1, &mTextureNameGL);
-                lastWidth = width;
-                lastHeight = height;
+#ifdef DO_GRPC_SDK_ENABLED
+            g_showingHdrFrame = format == SharedUtils::PixelConvert::PIXEL_FORMAT_HDR_RGBA;
+#endif
+            const SharedUtils::StreamingTextureUploader::Stats& stats = g_textureUploader.lastStats();
+            if (stats.reallocated) {
+                std::cout << "   Texture recreated for " << image.mSize.x << "x" << image.mSize.y
+                          << ", type " << image.mType << std::endl;
             }
-
-            glBindTexture(GL_TEXTURE_2D, mTextureNameGL);
-            
-            // Set texture parameters
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            
-            // Upload texture data with correct dimensions and format
-            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, bufferData);
-            
-            GLenum error = glGetError();
-            if (error != GL_NO_ERROR) {
-                std::cout << " OpenGL error during texture upload: 0x" << std::hex << error << std::dec << std::endl;
-            } else {
-                std::cout << " Texture updated successfully!" << std::endl;
+            std::cout << " Texture upload: " << std::fixed << std::setprecision(3) << stats.cpuMs << " ms cpu";
+            if (stats.gpuMs >= 0.0) {
+                std::cout << ", " << stats.gpuMs << " ms gpu";
             }
-            
-            glBindTexture(GL_TEXTURE_2D, 0);
+            std::cout << std::defaultfloat << ", " << (stats.bytes >> 10) << " KB" << std::endl;
         }
 }
 
+#ifdef DO_GRPC_SDK_ENABLED
+// Tints the matte over a copy of an LDR frame, any other frame is returned as is. The ID
+// buffer is at full resolution, sub-sampled frames are not highlighted.
+ApiRenderImage highlightMatte(const ApiRenderImage& image, uint32_t matteId)
+{
+    const std::shared_ptr<const SharedUtils::CryptomatteIdBuffer> ids = g_cryptomattePicker.buffer();
+    if (matteId == 0 || !ids || !image.mBuffer || image.mType != Octane::IMAGE_TYPE_LDR_RGBA ||
+        ids->width() != image.mSize.x || ids->height() != image.mSize.y) {
+        return image;
+    }
+    const uint32_t width = image.mSize.x;
+    const uint32_t height = image.mSize.y;
+    g_highlightPixels.resize(static_cast<size_t>(width) * height * 4);
+    g_highlightMask.resize(static_cast<size_t>(width) * height);
+    for (uint32_t y = 0; y < height; ++y) {
+        memcpy(g_highlightPixels.data() + static_cast<size_t>(y) * width * 4,
+               static_cast<const uint8_t*>(image.mBuffer) + static_cast<size_t>(y) * image.mPitch * 4,
+               static_cast<size_t>(width) * 4);
+    }
+    ids->buildMask(matteId, g_highlightMask.data(), width);
+    const uint8_t color[3] = { 255, 160, 0 };
+    SharedUtils::tintRgba8(g_highlightPixels.data(), static_cast<size_t>(width) * 4, g_highlightMask.data(), width,
+                           width, height, color, 0.5f);
+
+    ApiRenderImage highlighted = image;
+    highlighted.mBuffer = g_highlightPixels.data();
+    highlighted.mPitch = width;
+    return highlighted;
+}
+#endif
+
 #ifdef _WIN32
 // Helper function to get HRESULT error description
 std::string GetHRESULTErrorDescription(HRESULT hr) {
@@ -538,13 +571,67 @@ void cleanupSharedSurface() {
 #endif
 
 #ifdef DO_GRPC_SDK_ENABLED
+// Feeds a new render image to the monitors and readies it for display, for images of the
+// callback and of the image waiter alike. frame.buffer is freed once the image is converted.
+void prepareFrame(const Octane::ApiRenderImage& img, CallbackFrame& frame)
+{
+    g_dynamicResolution.onFrame(img);
+    g_cryptomattePicker.onFrame(img);
+    if (g_convergenceEnabled) {
+        g_convergence.feed(img);
+    }
+    frame.image = img;
+    frame.cameraSequence = g_cameraLatency.onFrame(img);
+
+    // HDR, half and mono results are converted to 8-bit RGBA here so the render
+    // loop only uploads, and uploads a quarter of the HDR data
+    const auto format = static_cast<SharedUtils::PixelConvert::PixelFormat>(img.mType);
+    const bool clientDisplay = g_clientDisplay && format == SharedUtils::PixelConvert::PIXEL_FORMAT_HDR_RGBA;
+    if (clientDisplay && g_displayTransformGlReady) {
+        // uploaded as float, the shader applies the display transform
+    } else if (clientDisplay) {
+        SharedUtils::DisplaySettings settings;
+        std::shared_ptr<const SharedUtils::DisplayLut3D> lut;
+        {
+            std::lock_guard<std::mutex> lock(g_displayMutex);
+            settings = g_displaySettings;
+            lut = g_displayLut;
+        }
+        frame.pixels.resize(static_cast<size_t>(img.mSize.x) * img.mSize.y * 4);
+        SharedUtils::applyDisplayTransform(static_cast<const float*>(img.mBuffer),
+                                           img.mPitch * SharedUtils::PixelConvert::bytesPerPixel(format),
+                                           img.mSize.x,
+                                           img.mSize.y,
+                                           frame.pixels.data(),
+                                           static_cast<size_t>(img.mSize.x) * 4,
+                                           settings,
+                                           lut.get());
+        frame.buffer.reset();
+        frame.image.mBuffer = frame.pixels.data();
+        frame.image.mType = Octane::IMAGE_TYPE_LDR_RGBA;
+        frame.image.mPitch = img.mSize.x;
+    } else if (img.mType != Octane::IMAGE_TYPE_LDR_RGBA && SharedUtils::PixelConvert::bytesPerPixel(format) != 0) {
+        frame.pixels.resize(static_cast<size_t>(img.mSize.x) * img.mSize.y * 4);
+        SharedUtils::PixelConvert::convertToRgba8(format,
+                                                  img.mBuffer,
+                                                  img.mPitch * SharedUtils::PixelConvert::bytesPerPixel(format),
+                                                  img.mSize.x,
+                                                  img.mSize.y,
+                                                  frame.pixels.data(),
+                                                  static_cast<size_t>(img.mSize.x) * 4,
+                                                  false);
+        frame.buffer.reset();
+        frame.image.mBuffer = frame.pixels.data();
+        frame.image.mType = Octane::IMAGE_TYPE_LDR_RGBA;
+        frame.image.mPitch = img.mSize.x;
+    }
+}
+
 // Enhanced callback function that handles both shared surfaces and regular buffers
 void OnNewImageCallback(const Octane::ApiArray<Octane::ApiRenderImage>& renderImages, void* userData)
 {
     (void)userData; // Suppress unused parameter warning
     
-    std::lock_guard<std::mutex> lock(g_renderImageMutex);
-    
     g_callbackCount++;
     bool foundSharedSurface = false;
     bool foundRegularBuffer = false;
@@ -567,21 +654,23 @@ void OnNewImageCallback(const Octane::ApiArray<Octane::ApiRenderImage>& renderIm
             
         } else */
         if (img.mBuffer != nullptr) {
-            foundRegularBuffer = true;
-            // Store regular buffer as fallback
-            if (i == 0) { // Only store the first image to avoid excessive copying
-                g_latestRenderImages.clear();
-                g_latestRenderImages.push_back(img);
+            if (i == 0 && !foundSharedSurface) {
+                foundRegularBuffer = true;
+                CallbackFrame& frame = g_renderFrames.producerSlot();
+                frame.buffer.reset(static_cast<const char*>(img.mBuffer));
+                prepareFrame(img, frame);
+            } else {
+                // Only the first image is displayed, release the others right away
+                delete[] static_cast<const char*>(img.mBuffer);
             }
         }
     }
     
     if (foundSharedSurface) {
         // Shared surface takes priority - no buffer copying needed
-        g_hasNewRenderData = false; // Clear regular buffer flag
     } else if (foundRegularBuffer) {
-        // Use regular buffer callback approach
-        g_hasNewRenderData = true;
+        // Use regular buffer callback approach, a frame the render loop did not pick up yet is replaced
+        g_renderFrames.publish();
         g_hasSharedSurfaceData = false;
         
         std::cout << " Received render callback #" << g_callbackCount.load() 
@@ -638,6 +727,10 @@ int main() {
     
     // Initialize systems
     renderer.initialize();
+    g_textureUploader.initialize();
+#ifdef DO_GRPC_SDK_ENABLED
+    g_displayTransformGlReady = g_displayTransformGl.initialize();
+#endif
     modelManager.initialize(&renderer);
     cameraController.initialize(window);
     
@@ -645,11 +738,23 @@ int main() {
     cameraController.onLoadModel = [&]() {
         modelManager.loadModelFromDialog();
         modelManager.updateWindowTitle(window, "3D Model Viewer - SDK Edition");
+        g_convergence.reset();
     };
     
     cameraController.onResetModel = [&]() {
         modelManager.resetToDefaultCube();
         modelManager.updateWindowTitle(window, "3D Model Viewer - SDK Edition");
+        g_convergence.reset();
+    };
+
+    cameraController.onCaptureAovs = [&]() {
+#ifdef DO_GRPC_SDK_ENABLED
+        // returns once the passes are fetched, they are encoded while Octane keeps rendering
+        if (!g_aovCapture) {
+            g_aovCapture = std::make_unique<AovCaptureSdk>(".");
+        }
+        g_aovCapture->capture();
+#endif
     };
     
     // Set up SDK camera sync callback
@@ -720,7 +825,18 @@ int main() {
     std::cout << "Mouse Wheel: Zoom in/out (syncs with Octane via SDK)" << std::endl;
     std::cout << "L: Load 3D model file" << std::endl;
     std::cout << "R: Reset to default cube" << std::endl;
+    std::cout << "C: Capture all enabled render passes to EXR files" << std::endl;
     std::cout << "Q: Toggle between Octane render and local cube" << std::endl;
+#ifdef DO_GRPC_SDK_ENABLED
+    std::cout << "K: Toggle cryptomatte hover highlight" << std::endl;
+    std::cout << "H: Toggle camera latency in the window title" << std::endl;
+    std::cout << "E: Toggle client side display transform (HDR frames)" << std::endl;
+    std::cout << "+/-: Exposure up/down by 0.25 stops (client display transform)" << std::endl;
+    std::cout << "T: Cycle tone curve (client display transform)" << std::endl;
+    std::cout << "V: Cycle OCIO display view (client display transform)" << std::endl;
+    std::cout << "M: Toggle convergence monitor, pauses the render once it stops changing" << std::endl;
+    std::cout << "D: Toggle dynamic resolution while the camera moves" << std::endl;
+#endif
     std::cout << "ESC: Exit" << std::endl;
     std::cout << "===============================================\n" << std::endl;
     
@@ -769,7 +885,7 @@ int main() {
             cameraSync.initialize();
             
             // Register callback after successful connection (only once)
-            if (!g_callbackRegistered) {
+            if (!g_callbackRegistered && !g_imageWaiter.running()) {
                 std::cout << " Registering render image callback..." << std::endl;
                 try {
                     OctaneGRPC::ApiRenderEngineProxy::setOnNewImageCallback(OnNewImageCallback, nullptr);
@@ -777,8 +893,13 @@ int main() {
                     g_callbackRegistered = true;
                 } catch (const std::exception& e) {
                     std::cout << " Failed to register render image callback: " << e.what() << std::endl;
+                    std::cout << " Waiting for images via octane_imagewait at " << g_imageWaiter.settings().address << std::endl;
+                    g_imageWaiter.start();
                 }
             }
+            if (!g_renderStats.isRunning()) {
+                g_renderStats.start();
+            }
         }
 
         // Process input
@@ -809,6 +930,118 @@ int main() {
         } else if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_RELEASE) {
             qKeyPressed = false;
         }
+
+#ifdef DO_GRPC_SDK_ENABLED
+        // Client side display transform, see g_clientDisplay
+        static bool eKeyPressed = false;
+        if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS && !eKeyPressed) {
+            const bool enable = !g_clientDisplay;
+            if (enable ? OcioDisplaySdk::requestHdrOutput() : OcioDisplaySdk::requestLdrOutput()) {
+                if (enable && g_ocioDisplay.refresh() && !g_ocioDisplay.displayViews().empty()) {
+                    const auto views = g_ocioDisplay.displayViews();
+                    g_displayViewIndex %= views.size();
+                    auto lut = g_ocioDisplay.lut(views[g_displayViewIndex].display, views[g_displayViewIndex].view);
+                    std::lock_guard<std::mutex> lock(g_displayMutex);
+                    g_displayLut = lut;
+                }
+                g_clientDisplay = enable;
+                std::cout << "Display transform: " << (enable ? "client (HDR frames)" : "Octane") << std::endl;
+            }
+            eKeyPressed = true;
+        } else if (glfwGetKey(window, GLFW_KEY_E) == GLFW_RELEASE) {
+            eKeyPressed = false;
+        }
+
+        static bool exposureKeyPressed = false;
+        const bool exposureUp = glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_KP_ADD) == GLFW_PRESS;
+        const bool exposureDown = glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_KP_SUBTRACT) == GLFW_PRESS;
+        if ((exposureUp || exposureDown) && !exposureKeyPressed && g_clientDisplay) {
+            std::lock_guard<std::mutex> lock(g_displayMutex);
+            g_displaySettings.exposure += exposureUp ? 0.25f : -0.25f;
+            std::cout << "Exposure: " << std::showpos << g_displaySettings.exposure << std::noshowpos << " stops" << std::endl;
+            exposureKeyPressed = true;
+        } else if (!exposureUp && !exposureDown) {
+            exposureKeyPressed = false;
+        }
+
+        static bool tKeyPressed = false;
+        if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS && !tKeyPressed && g_clientDisplay) {
+            std::lock_guard<std::mutex> lock(g_displayMutex);
+            g_displaySettings.toneCurve = static_cast<SharedUtils::ToneCurve>((g_displaySettings.toneCurve + 1) % (SharedUtils::TONE_CURVE_ACES_FILMIC + 1));
+            std::cout << "Tone curve: " << SharedUtils::toneCurveName(g_displaySettings.toneCurve) << std::endl;
+            tKeyPressed = true;
+        } else if (glfwGetKey(window, GLFW_KEY_T) == GLFW_RELEASE) {
+            tKeyPressed = false;
+        }
+
+        static bool mKeyPressed = false;
+        if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS && !mKeyPressed) {
+            const bool enable = !g_convergenceEnabled;
+            g_convergence.reset();
+            g_convergenceEnabled = enable;
+            const ConvergenceMonitorSdk::Settings settings = g_convergence.settings();
+            std::cout << "Convergence monitor: " << (enable ? "on" : "off");
+            if (enable) {
+                std::cout << ", pauses at PSNR >= " << settings.minPsnr << " dB and tile error <= " << settings.maxTileError;
+            }
+            std::cout << std::endl;
+            mKeyPressed = true;
+        } else if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE) {
+            mKeyPressed = false;
+        }
+
+        static bool dKeyPressed = false;
+        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS && !dKeyPressed) {
+            const bool enable = !g_dynamicResolution.enabled();
+            g_dynamicResolution.setEnabled(enable);
+            std::cout << "Dynamic resolution: " << (enable ? "on" : "off") << ", target "
+                      << g_dynamicResolution.settings().targetLatencyMs << " ms" << std::endl;
+            dKeyPressed = true;
+        } else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_RELEASE) {
+            dKeyPressed = false;
+        }
+
+        static bool kKeyPressed = false;
+        if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS && !kKeyPressed) {
+            const bool enable = !g_cryptomattePicker.enabled();
+            g_cryptomattePicker.setEnabled(enable);
+            if (enable) {
+                // the pass must be enabled in the render AOVs
+                g_cryptomattePicker.refresh();
+            }
+            std::cout << "Cryptomatte hover: " << (enable ? "on" : "off") << ", pass "
+                      << g_cryptomattePicker.settings().pass << std::endl;
+            kKeyPressed = true;
+        } else if (glfwGetKey(window, GLFW_KEY_K) == GLFW_RELEASE) {
+            kKeyPressed = false;
+        }
+
+        static bool hKeyPressed = false;
+        if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS && !hKeyPressed) {
+            const bool enable = !g_cameraLatency.hudEnabled();
+            g_cameraLatency.setHudEnabled(enable);
+            std::cout << "Camera latency HUD: " << (enable ? "on" : "off") << std::endl;
+            hKeyPressed = true;
+        } else if (glfwGetKey(window, GLFW_KEY_H) == GLFW_RELEASE) {
+            hKeyPressed = false;
+        }
+
+        static bool vKeyPressed = false;
+        if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS && !vKeyPressed && g_clientDisplay) {
+            // the LUT of each view is baked once, cycling back is free
+            const auto views = g_ocioDisplay.displayViews();
+            if (!views.empty()) {
+                g_displayViewIndex = (g_displayViewIndex + 1) % views.size();
+                auto lut = g_ocioDisplay.lut(views[g_displayViewIndex].display, views[g_displayViewIndex].view);
+                std::lock_guard<std::mutex> lock(g_displayMutex);
+                g_displayLut = lut;
+                std::cout << "Display view: " << views[g_displayViewIndex].display << " / " << views[g_displayViewIndex].view << std::endl;
+            }
+            vKeyPressed = true;
+        } else if (glfwGetKey(window, GLFW_KEY_V) == GLFW_RELEASE) {
+            vKeyPressed = false;
+        }
+#endif
         
         // Process camera and model input
         cameraController.processInput(window);
@@ -826,28 +1059,106 @@ int main() {
                                                0.1f, 100.0f);
         glm::vec3 viewPos = cameraController.camera.getPosition();
         
+#ifdef DO_GRPC_SDK_ENABLED
+        const CameraLatencySdk::Clock::time_point cameraIssued = CameraLatencySdk::Clock::now();
+#endif
         cameraSync.setCamera(viewPos, cameraController.camera.center, glm::vec3(0.0f, 1.0f, 0.0f));
 
 #ifdef DO_GRPC_SDK_ENABLED
+        // any camera change restarts the render, sub-sample until the camera stops
+        static glm::vec3 lastViewPos = viewPos;
+        static glm::vec3 lastCenter = cameraController.camera.center;
+        if (viewPos != lastViewPos || cameraController.camera.center != lastCenter) {
+            lastViewPos = viewPos;
+            lastCenter = cameraController.camera.center;
+            g_dynamicResolution.notifyInteraction();
+            g_cameraLatency.onCameraUpdate(cameraIssued);
+            // continues a render the monitor paused, the new view has to converge again
+            g_convergence.reset();
+        }
+        g_dynamicResolution.update();
+        // camera update of the frame drawn this iteration, stamped after the swap
+        uint64_t displayedCameraSequence = 0;
+
         // Handle rendering based on current mode
         if (g_renderMode == RENDER_MODE_SHARED_SURFACE) {
 #ifdef _WIN32
             // Shared surface rendering - check if we have new data
-            {
-                std::lock_guard<std::mutex> lock(g_renderImageMutex);
-                if (g_hasSharedSurfaceData) {
-                    // Data is already in shared GPU memory - just use the shared texture
-                    // No CPU-GPU transfer needed!
-                    g_hasSharedSurfaceData = false; // Mark as processed
-                }
+            if (g_hasSharedSurfaceData.exchange(false)) {
+                // Data is already in shared GPU memory - just use the shared texture
+                // No CPU-GPU transfer needed!
             }
 #endif
         } else {
-            // Callback mode rendering - check for new buffer data
-            std::lock_guard<std::mutex> lock(g_renderImageMutex);
-            if (g_hasNewRenderData && !g_latestRenderImages.empty()) {
-                setupTexture(g_latestRenderImages[0]);
-                g_hasNewRenderData = false; // Mark as processed
+            // Callback mode rendering - take the newest frame, never waits on the callback thread
+            static bool hasFrame = false;
+            const bool newFrame = g_renderFrames.consume();
+            hasFrame = hasFrame || newFrame;
+            // the image waiter owns the buffer of its frame, it stays valid until the next consume()
+            static CallbackFrame waitedFrame;
+            // which of the two the texture shows, a changed highlight is redrawn from it
+            static bool textureFromWaiter = false;
+
+            // the hovered matte is a lookup in the local ID buffer, no RPC per mouse move
+            static uint32_t hoveredMatte = 0;
+            static uint64_t highlightGeneration = 0;
+            static std::string hoveredName;
+            uint32_t matte = 0;
+            if (g_cryptomattePicker.enabled()) {
+                double cursorX, cursorY;
+                int windowWidth, windowHeight;
+                glfwGetCursorPos(window, &cursorX, &cursorY);
+                glfwGetWindowSize(window, &windowWidth, &windowHeight);
+                if (windowWidth > 0 && windowHeight > 0) {
+                    matte = g_cryptomattePicker.idAt(cursorX / windowWidth, cursorY / windowHeight);
+                }
+            }
+            std::string matteName;
+            if (matte != 0 && !g_cryptomattePicker.matteName(matte, matteName)) {
+                char hexId[16];
+                snprintf(hexId, sizeof(hexId), "%08x", matte);
+                matteName = hexId;
+            }
+            // matte and HUD go after the model manager's title, it changes when a model is loaded
+            static std::string shownHud;
+            static std::string shownModelTitle;
+            const std::string hud = g_cameraLatency.hudText();
+            const std::string modelTitle = modelManager.windowTitle("3D Model Viewer - SDK Edition");
+            if (matteName != hoveredName || hud != shownHud || modelTitle != shownModelTitle) {
+                hoveredName = matteName;
+                shownHud = hud;
+                shownModelTitle = modelTitle;
+                std::string title = modelTitle + (matteName.empty() ? std::string() : " - " + matteName);
+                if (!hud.empty()) {
+                    title += " | " + hud;
+                }
+                glfwSetWindowTitle(window, title.c_str());
+            }
+            const uint64_t generation = g_cryptomattePicker.generation();
+            const bool highlightChanged = matte != hoveredMatte || generation != highlightGeneration;
+            hoveredMatte = matte;
+            highlightGeneration = generation;
+            if (newFrame || (highlightChanged && hasFrame && !textureFromWaiter)) {
+                setupTexture(highlightMatte(g_renderFrames.consumerSlot().image, hoveredMatte));
+                textureFromWaiter = false;
+            } else if (highlightChanged && textureFromWaiter) {
+                setupTexture(highlightMatte(waitedFrame.image, hoveredMatte));
+            }
+            if (newFrame) {
+                displayedCameraSequence = g_renderFrames.consumerSlot().cameraSequence;
+                g_cameraLatency.onUploaded(displayedCameraSequence);
+            }
+
+            // without the callback the newest long poll result, never waits either
+            if (g_imageWaiter.running() && g_imageWaiter.frames().consume()) {
+                const ImageWaiterSdk::Frame& waited = g_imageWaiter.frames().consumerSlot();
+                if (!waited.images.empty()) {
+                    prepareFrame(waited.images[0], waitedFrame);
+                    setupTexture(highlightMatte(waitedFrame.image, hoveredMatte));
+                    textureFromWaiter = true;
+                    g_cameraLatency.onUploaded(waitedFrame.cameraSequence);
+                    displayedCameraSequence = waitedFrame.cameraSequence;
+                }
             }
         }
 #else
@@ -881,13 +1192,22 @@ int main() {
                     renderer.renderQuad(mTextureNameGL);
                 }
 #endif
+            } else if (g_showingHdrFrame && g_displayTransformGlReady && g_textureUploader.texture()) {
+                // Linear HDR frame, exposure, curve and LUT are only shader uniforms and a cached texture
+                SharedUtils::DisplaySettings settings;
+                {
+                    std::lock_guard<std::mutex> lock(g_displayMutex);
+                    settings = g_displaySettings;
+                    g_displayTransformGl.setLut(g_displayLut);
+                }
+                g_displayTransformGl.render(g_textureUploader.texture(), settings);
             } else {
-                // Use regular callback texture
-                renderer.renderQuad(mTextureNameGL);
+                // Use the streamed callback texture, the test texture until the first frame arrived
+                renderer.renderQuad(g_textureUploader.texture() ? g_textureUploader.texture() : mTextureNameGL);
             }
 #else
-            // Use regular texture (no SDK)
-            renderer.renderQuad(mTextureNameGL);
+            // Use the grabbed render result, or the test texture
+            renderer.renderQuad(g_textureUploader.texture() ? g_textureUploader.texture() : mTextureNameGL);
 #endif
         }
         else
@@ -897,6 +1217,11 @@ int main() {
         }
         // Swap buffers
         glfwSwapBuffers(window);
+#ifdef DO_GRPC_SDK_ENABLED
+        if (showTestQuad) {
+            g_cameraLatency.onDisplayed(displayedCameraSequence);
+        }
+#endif
     }
     
     // Cleanup
@@ -913,7 +1238,43 @@ int main() {
         }
     }
     
+    if (g_imageWaiter.running()) {
+        g_imageWaiter.stop();
+        g_imageWaiter.printSummary(std::cout);
+    }
+
     std::cout << " Total callbacks received: " << g_callbackCount.load() << std::endl;
+    std::cout << " Frames displayed: " << g_renderFrames.consumedCount()
+              << ", dropped: " << g_renderFrames.droppedCount() << std::endl;
+
+    if (g_aovCapture) {
+        g_aovCapture->flush();
+        g_aovCapture->printReport(std::cout);
+        g_aovCapture.reset();
+    }
+
+    if (g_convergenceEnabled) {
+        g_convergenceEnabled = false;
+        g_convergence.printSummary(std::cout);
+        if (g_convergence.exportTileMap("convergence_tiles.exr")) {
+            std::cout << " Convergence tile errors written to convergence_tiles.exr" << std::endl;
+        }
+    }
+
+    g_dynamicResolution.setEnabled(false);
+    g_dynamicResolution.update();
+    g_dynamicResolution.printSummary(std::cout);
+
+    g_cryptomattePicker.setEnabled(false);
+    g_cryptomattePicker.printSummary(std::cout);
+
+    g_cameraLatency.printSummary(std::cout);
+
+    g_renderStats.stop();
+    g_renderStats.printSummary(std::cout);
+    if (g_renderStats.recordedCount() > 0 && g_renderStats.exportToFile("render_stats.csv")) {
+        std::cout << " Render statistics written to render_stats.csv" << std::endl;
+    }
 
 #ifdef _WIN32
     // Cleanup shared surface resources
@@ -926,6 +1287,10 @@ int main() {
     if (mTextureNameGL != 0) {
         glDeleteTextures(1, &mTextureNameGL);
     }
+    g_textureUploader.cleanup();
+#ifdef DO_GRPC_SDK_ENABLED
+    g_displayTransformGl.cleanup();
+#endif
     renderer.cleanup();
     
     glfwTerminate();